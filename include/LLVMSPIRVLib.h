@@ -45,6 +45,7 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
 
 namespace llvm {
 // Pass initialization functions need to be declared before inclusion of
@@ -59,12 +60,19 @@ void initializeSPIRVLowerConstExprPass(PassRegistry &);
 void initializeSPIRVLowerSPIRBlocksPass(PassRegistry &);
 void initializeSPIRVLowerOCLBlocksPass(PassRegistry &);
 void initializeSPIRVLowerMemmovePass(PassRegistry &);
+void initializeSPIRVLowerNVPTXAddrSpacePass(PassRegistry &);
+void initializeSPIRVLowerWMMAPass(PassRegistry &);
+void initializeSPIRVLowerNVVMAsyncCopyPass(PassRegistry &);
 void initializeSPIRVRegularizeLLVMPass(PassRegistry &);
 void initializeSPIRVToOCL12Pass(PassRegistry &);
 void initializeSPIRVToOCL20Pass(PassRegistry &);
 void initializePreprocessMetadataPass(PassRegistry &);
 
 class ModulePass;
+namespace legacy {
+class PassManager;
+class PassManagerBase;
+} // namespace legacy
 } // namespace llvm
 
 #include "llvm/IR/Module.h"
@@ -72,6 +80,7 @@ class ModulePass;
 namespace SPIRV {
 
 class SPIRVModule;
+class LLVMToSPIRV;
 
 /// \brief Check if a string contains SPIR-V binary.
 bool isSpirvBinary(std::string &Img);
@@ -105,6 +114,57 @@ std::unique_ptr<SPIRVModule> readSpirvModule(std::istream &IS,
                                              const SPIRV::TranslatorOpts &Opts,
                                              std::string &ErrMsg);
 
+/// \brief Compute the exact size in words of the binary encoding of \p BM.
+/// This encodes the module once without storing it; the std::vector
+/// overload of writeSpirvModule does not need it.
+size_t getSpirvModuleWordCount(SPIRVModule &BM);
+
+/// \brief Encode \p BM as SPIR-V binary into a caller-provided buffer of
+/// \p NumWords words. The buffer size can be queried with
+/// getSpirvModuleWordCount.
+/// \returns false if the buffer is too small.
+bool writeSpirvModule(SPIRVModule &BM, uint32_t *Words, size_t NumWords);
+
+/// \brief Encode \p BM as SPIR-V binary into \p Words in a single pass.
+/// \p Words grows as needed and is resized to exactly the size of the
+/// encoded module; its capacity is reused when it is passed again.
+/// \returns true if succeeds.
+bool writeSpirvModule(SPIRVModule &BM, std::vector<uint32_t> &Words);
+
+/// \brief A directory of translation results, keyed by a hash of the input
+/// bytes and of every translation option which can change the result.
+/// Results are written atomically, so concurrent translations may share one
+/// cache directory.
+class TranslationCache {
+public:
+  /// \p MaxSizeBytes bounds the total size of the cached results; the least
+  /// recently used ones are evicted first. The bound is enforced when the
+  /// directory is pruned, which happens at most once per pruning interval
+  /// (20 minutes), so the cache may exceed it in between. 0 means no bound
+  /// besides the available disk space.
+  explicit TranslationCache(const std::string &Dir, uint64_t MaxSizeBytes = 0);
+
+  /// \brief Compute the key of translating \p Input with \p Opts. \p Kind
+  /// tells apart results of the same input which differ otherwise, e.g. by
+  /// the direction of the translation or the output format.
+  static std::string getKey(const std::string &Input,
+                            const TranslatorOpts &Opts,
+                            const std::string &Kind);
+
+  /// \returns true and sets \p Result if a result is cached for \p Key.
+  bool lookup(const std::string &Key, std::string &Result) const;
+
+  /// \brief Cache \p Result for \p Key. If the pruning interval has passed,
+  /// also evict old results if the cache grew over its size bound and remove
+  /// temporary files left behind by translations which did not finish.
+  /// \returns false if the result could not be written.
+  bool store(const std::string &Key, const std::string &Result);
+
+private:
+  std::string Dir;
+  uint64_t MaxSizeBytes;
+};
+
 } // End namespace SPIRV
 
 namespace llvm {
@@ -123,11 +183,43 @@ bool readSpirv(LLVMContext &C, std::istream &IS, Module *&M,
 bool writeSpirv(Module *M, const SPIRV::TranslatorOpts &Opts, std::ostream &OS,
                 std::string &ErrMsg);
 
+/// \brief Translate LLVM module to SPIR-V and store the binary in \p Words.
+/// The buffer is allocated once with the exact size of the encoded module,
+/// so it can be passed to a consumer without additional copies.
+/// \returns true if succeeds.
+bool writeSpirv(Module *M, const SPIRV::TranslatorOpts &Opts,
+                std::vector<uint32_t> &Words, std::string &ErrMsg);
+
 /// \brief Load SPIR-V from istream and translate to LLVM module.
 /// \returns true if succeeds.
 bool readSpirv(LLVMContext &C, const SPIRV::TranslatorOpts &Opts,
                std::istream &IS, Module *&M, std::string &ErrMsg);
 
+/// \brief Link several SPIR-V modules into one LLVM module. Functions and
+/// variables decorated with LinkageAttributes Import are resolved against the
+/// ones decorated with LinkageAttributes Export in the other inputs. The
+/// inputs are linked as SPIR-V and the result is translated to LLVM IR.
+/// \returns null on failure.
+std::unique_ptr<Module> linkSpirvToLLVM(LLVMContext &C,
+                                        const SPIRV::TranslatorOpts &Opts,
+                                        ArrayRef<std::istream *> Inputs,
+                                        std::string &ErrMsg);
+
+/// \brief Link several SPIR-V modules into one and write it to ostream.
+/// Types and constants shared by the inputs are emitted once and the result
+/// uses a dense Id range. The inputs are not translated to LLVM IR.
+/// \returns true if succeeds.
+bool linkSpirv(const SPIRV::TranslatorOpts &Opts,
+               ArrayRef<std::istream *> Inputs, std::ostream &OS,
+               std::string &ErrMsg);
+
+/// \brief Link several SPIR-V modules into one and store the binary in
+/// \p Words.
+/// \returns true if succeeds.
+bool linkSpirv(const SPIRV::TranslatorOpts &Opts,
+               ArrayRef<std::istream *> Inputs, std::vector<uint32_t> &Words,
+               std::string &ErrMsg);
+
 /// \brief Partially load SPIR-V from the stream and decode only instructions
 /// needed to get information about specialization constants.
 /// \returns true if succeeds.
@@ -135,6 +227,102 @@ using SpecConstInfoTy = std::pair<uint32_t, uint32_t>;
 bool getSpecConstInfo(std::istream &IS,
                       std::vector<SpecConstInfoTy> &SpecConstInfo);
 
+/// \brief A SPIR-V module that is decoded once and then translated to LLVM IR
+/// for any number of sets of specialization constant values.
+class SpirvSpecializer {
+public:
+  /// Decode SPIR-V from \p IS. Values of specialization constants set in
+  /// \p Opts are used unless a call to specialize() overrides them.
+  SpirvSpecializer(std::istream &IS, const SPIRV::TranslatorOpts &Opts);
+  ~SpirvSpecializer();
+
+  /// \returns false if the input could not be decoded; the reason is
+  /// available via getError().
+  bool isValid() const { return BM != nullptr; }
+  const std::string &getError() const { return DecodeErr; }
+
+  /// \brief Translate the decoded module to LLVM IR, substituting
+  /// \p SpecValues (pairs of SpecId and value bits) for the specialization
+  /// constants. If \p FoldBranches is set, or branch folding is enabled in
+  /// the options, conditional branches and switches on constants are
+  /// translated as unconditional branches and the blocks which are no longer
+  /// reachable are not translated at all. Errors of a previous call are not
+  /// carried over.
+  /// \returns null on failure.
+  std::unique_ptr<Module>
+  specialize(LLVMContext &C,
+             ArrayRef<std::pair<uint32_t, uint64_t>> SpecValues,
+             std::string &ErrMsg, bool FoldBranches = false);
+
+private:
+  std::unique_ptr<SPIRV::SPIRVModule> BM;
+  SPIRV::TranslatorOpts Opts;
+  std::string DecodeErr;
+};
+
+/// \brief A series of translations with the same options. The pass pipelines
+/// which writeSpirv and readSpirv build for every call are built once per
+/// session and rerun on every module. Every translation still gets a
+/// SPIRVModule of its own, so translations do not see each other's results.
+/// A session must only be used by one thread at a time.
+class SpirvTranslatorSession {
+public:
+  explicit SpirvTranslatorSession(const SPIRV::TranslatorOpts &Opts);
+  ~SpirvTranslatorSession();
+
+  const SPIRV::TranslatorOpts &getOpts() const { return Opts; }
+
+  /// \brief The context to create the modules passed to
+  /// writeSpirvIncremental in. The session owns it, so it outlives the
+  /// state the incremental translation keeps between calls.
+  LLVMContext &getContext() { return *Context; }
+
+  /// \brief Translate LLVM module to SPIR-V and write to ostream.
+  /// \returns true if succeeds.
+  bool writeSpirv(Module *M, std::ostream &OS, std::string &ErrMsg);
+
+  /// \brief Translate LLVM module to SPIR-V and store the binary in \p Words.
+  /// \returns true if succeeds.
+  bool writeSpirv(Module *M, std::vector<uint32_t> &Words,
+                  std::string &ErrMsg);
+
+  /// \brief Translate LLVM module to SPIR-V like writeSpirv, translating
+  /// only the functions whose bodies changed since the module translated by
+  /// the previous call. Any other change causes a full translation, as do
+  /// debug information and changes of the floating point contraction
+  /// requirements of a function. \p M is lowered in place, so a new module
+  /// is to be passed each time, in the context of the session; a module in
+  /// another context is translated in full and discards the state. The
+  /// capabilities and extensions of the removed code are kept until the next
+  /// full translation, and so are unused types and constants unless dead
+  /// entry elimination is enabled.
+  /// \returns true if succeeds.
+  bool writeSpirvIncremental(Module *M, std::vector<uint32_t> &Words,
+                             std::string &ErrMsg);
+
+  /// \brief Load SPIR-V from istream and translate to an LLVM module in
+  /// \p C.
+  /// \returns null on failure.
+  std::unique_ptr<Module> readSpirv(LLVMContext &C, std::istream &IS,
+                                    std::string &ErrMsg);
+
+private:
+  bool translate(Module *M, SPIRV::SPIRVModule &BM, std::string &ErrMsg);
+
+  SPIRV::TranslatorOpts Opts;
+  std::unique_ptr<LLVMContext> Context;
+  /// Pipelines translating LLVM modules to SPIR-V and their LLVMToSPIRV
+  /// passes, indexed by whether loops are simplified first.
+  std::unique_ptr<legacy::PassManager> WriterPMs[2];
+  SPIRV::LLVMToSPIRV *Writers[2] = {nullptr, nullptr};
+  /// Pipelines of writeSpirvIncremental, whose LLVMToSPIRV passes own the
+  /// SPIR-V modules the translations are updated in.
+  std::unique_ptr<legacy::PassManager> IncrementalPMs[2];
+  SPIRV::LLVMToSPIRV *IncrementalWriters[2] = {nullptr, nullptr};
+  /// Lowering of the builtins of translated SPIR-V modules, once needed.
+  std::unique_ptr<legacy::PassManager> ReaderPM;
+};
+
 /// \brief Convert a SPIRVModule into LLVM IR.
 /// \returns null on failure.
 std::unique_ptr<Module>
@@ -188,6 +376,18 @@ ModulePass *createSPIRVLowerOCLBlocks();
 /// variable.
 ModulePass *createSPIRVLowerMemmove();
 
+/// Create a pass for mapping NVPTX address spaces to SPIR address spaces and
+/// inferring the address space of generic pointers.
+ModulePass *createSPIRVLowerNVPTXAddrSpace();
+
+/// Create a pass for lowering NVVM WMMA intrinsics to SPIR-V joint matrix
+/// built-ins.
+ModulePass *createSPIRVLowerWMMA();
+
+/// Create a pass for lowering NVVM cp.async intrinsics to OpenCL async work
+/// group copies.
+ModulePass *createSPIRVLowerNVVMAsyncCopy();
+
 /// Create a pass for regularize LLVM module to be translated to SPIR-V.
 ModulePass *createSPIRVRegularizeLLVM();
 
@@ -211,6 +411,11 @@ ModulePass *createPreprocessMetadata();
 /// ostream.
 ModulePass *createSPIRVWriterPass(std::ostream &Str);
 
+/// Add the passes which lower a module for the LLVMToSPIRV pass, as enabled
+/// by \p Opts, to \p PassMgr. writeSpirv runs them before the translation.
+void addPassesForSPIRV(legacy::PassManagerBase &PassMgr,
+                       const SPIRV::TranslatorOpts &Opts);
+
 /// Create and return a pass that writes the module to the specified
 /// ostream.
 ModulePass *createSPIRVWriterPass(std::ostream &Str,
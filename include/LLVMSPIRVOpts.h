@@ -42,6 +42,8 @@
 #include <cassert>
 #include <cstdint>
 #include <map>
+#include <set>
+#include <string>
 #include <unordered_map>
 
 namespace SPIRV {
@@ -103,6 +105,14 @@ public:
 
   void setMemToRegEnabled(bool Mem2Reg) { SPIRVMemToReg = Mem2Reg; }
 
+  bool isLoadStoreVectorizationEnabled() const {
+    return LoadStoreVectorization;
+  }
+
+  void setLoadStoreVectorizationEnabled(bool Enabled) {
+    LoadStoreVectorization = Enabled;
+  }
+
   void setGenKernelArgNameMDEnabled(bool ArgNameMD) {
     GenKernelArgNameMD = ArgNameMD;
   }
@@ -127,6 +137,18 @@ public:
     return true;
   }
 
+  const std::unordered_map<uint32_t, uint64_t> &getSpecConsts() const {
+    return ExternalSpecialization;
+  }
+
+  bool isSpecConstBranchFoldingEnabled() const {
+    return SpecConstBranchFolding;
+  }
+
+  void setSpecConstBranchFoldingEnabled(bool Enabled) {
+    SpecConstBranchFolding = Enabled;
+  }
+
   void setFPContractMode(FPContractMode Mode) { FPCMode = Mode; }
 
   FPContractMode getFPContractMode() const { return FPCMode; }
@@ -152,15 +174,48 @@ public:
 
   void setDebugInfoEIS(DebugInfoEIS EIS) { DebugInfoVersion = EIS; }
 
+  bool isDeadEntryEliminationEnabled() const { return EliminateDeadEntries; }
+
+  void setDeadEntryEliminationEnabled(bool Enabled) {
+    EliminateDeadEntries = Enabled;
+  }
+
+  void addSelectedKernel(const std::string &Name) {
+    SelectedKernels.insert(Name);
+  }
+
+  const std::set<std::string> &getSelectedKernels() const {
+    return SelectedKernels;
+  }
+
+  bool hasSelectedKernels() const { return !SelectedKernels.empty(); }
+
+  bool isKernelSelected(const std::string &Name) const {
+    return SelectedKernels.count(Name);
+  }
+
+  bool isLazyFunctionDecodingEnabled() const { return LazyFunctionDecoding; }
+
+  void setLazyFunctionDecodingEnabled(bool Enabled) {
+    LazyFunctionDecoding = Enabled;
+  }
+
 private:
   // Common translation options
   VersionNumber MaxVersion = VersionNumber::MaximumVersion;
   ExtensionsStatusMap ExtStatusMap;
   // SPIRVMemToReg option affects LLVM IR regularization phase
   bool SPIRVMemToReg = false;
+  // Merge adjacent scalar loads and stores into vector accesses before
+  // translation
+  bool LoadStoreVectorization = false;
   // SPIR-V to LLVM translation options
-  bool GenKernelArgNameMD;
+  bool GenKernelArgNameMD = false;
   std::unordered_map<uint32_t, uint64_t> ExternalSpecialization;
+  // Translate conditional branches and switches on constants, e.g. on
+  // specialized values, as unconditional branches and skip the blocks which
+  // are not reachable anymore
+  bool SpecConstBranchFolding = false;
   // Controls floating point contraction.
   //
   // - FPContractMode::On allows to choose a mode according to
@@ -181,6 +236,18 @@ private:
   bool SPIRVAllowUnknownIntrinsics = false;
 
   DebugInfoEIS DebugInfoVersion = DebugInfoEIS::SPIRV_Debug;
+
+  // Remove types, constants and global variables which are not referenced
+  // from the generated SPIR-V module
+  bool EliminateDeadEntries = false;
+
+  // Keep function bodies of the input SPIR-V module in binary form until
+  // they are translated, instead of decoding all of them upfront
+  bool LazyFunctionDecoding = false;
+
+  // Names of the kernels to translate. If not empty, other kernels are
+  // dropped along with the functions and global variables only they use
+  std::set<std::string> SelectedKernels;
 };
 
 } // namespace SPIRV
@@ -41,6 +41,7 @@
 #include "OCLUtil.h"
 #include "SPIRVInternal.h"
 
+#include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/IR/IRBuilder.h"
@@ -115,6 +116,11 @@ public:
   /// Transform OCL builtin function to SPIR-V builtin function.
   void transBuiltin(CallInst *CI, OCLBuiltinTransInfo &Info);
 
+  /// Map Info.UniqName of an OCL builtin function returning \p RetTy to the
+  /// name of the SPIR-V builtin function.
+  /// \returns false if there is no such SPIR-V builtin function.
+  bool transBuiltinName(Type *RetTy, OCLBuiltinTransInfo &Info);
+
   /// Transform OCL work item builtin functions to SPIR-V builtin variables.
   void transWorkItemBuiltinsToVariables();
 
@@ -173,6 +179,11 @@ public:
   void visitCallBuiltinSimple(CallInst *CI, StringRef MangledName,
                               const std::string &DemangledName);
 
+  /// Transform the calls of simple builtins collected by visitCallInst like
+  /// visitCallBuiltinSimple, one batch per callee, so that the SPIR-V builtin
+  /// is mangled once per callee.
+  void transSimpleBuiltinCalls();
+
   /// Transform get_image_{width|height|depth|dim}.
   /// get_image_xxx(...) =>
   ///   dimension = __spirv_ImageQuerySizeLod_R{ReturnType}(...);
@@ -291,6 +302,13 @@ private:
   LLVMContext *Ctx;
   unsigned CLVer; /// OpenCL version as major*10+minor
   std::set<Value *> ValuesToDelete;
+  /// Calls left to visitCallBuiltinSimple by visitCallInst, grouped by callee.
+  MapVector<Function *, std::vector<CallInst *>> SimpleBuiltinCalls;
+  /// Builtin variables created by transWorkItemBuiltinsToVariables.
+  GlobalVariable *WorkgroupSize = nullptr;
+  GlobalVariable *WorkgroupId = nullptr;
+  GlobalVariable *NumWorkgroups = nullptr;
+  GlobalVariable *LocalInvocationId = nullptr;
 
   ConstantInt *addInt32(int I) { return getInt32(M, I); }
   ConstantInt *addSizet(uint64_t I) { return getSizet(M, I); }
@@ -356,6 +374,7 @@ bool OCL20ToSPIRV::runOnModule(Module &Module) {
   transWorkItemBuiltinsToVariables();
 
   visit(*M);
+  transSimpleBuiltinCalls();
 
   for (auto &I : ValuesToDelete)
     if (auto Inst = dyn_cast<Instruction>(I))
@@ -363,6 +382,7 @@ bool OCL20ToSPIRV::runOnModule(Module &Module) {
   for (auto &I : ValuesToDelete)
     if (auto GV = dyn_cast<GlobalValue>(I))
       GV->eraseFromParent();
+  ValuesToDelete.clear();
 
   eraseUselessFunctions(M); // remove unused functions declarations
   LLVM_DEBUG(dbgs() << "After OCL20ToSPIRV:\n" << *M);
@@ -595,7 +615,7 @@ void OCL20ToSPIRV::visitCallInst(CallInst &CI) {
       visitSubgroupAVCBuiltinCall(&CI, MangledName, DemangledName);
     return;
   }
-  visitCallBuiltinSimple(&CI, MangledName, DemangledName);
+  SimpleBuiltinCalls[F].push_back(&CI);
 }
 
 void OCL20ToSPIRV::visitCallNDRange(CallInst *CI,
@@ -1091,12 +1111,11 @@ void OCL20ToSPIRV::visitCallGroupBuiltin(CallInst *CI, StringRef MangledName,
   transBuiltin(CI, Info);
 }
 
-void OCL20ToSPIRV::transBuiltin(CallInst *CI, OCLBuiltinTransInfo &Info) {
-  AttributeList Attrs = CI->getCalledFunction()->getAttributes();
+bool OCL20ToSPIRV::transBuiltinName(Type *RetTy, OCLBuiltinTransInfo &Info) {
   Op OC = OpNop;
   unsigned ExtOp = ~0U;
   if (StringRef(Info.UniqName).startswith(kSPIRVName::Prefix))
-    return;
+    return false;
   if (OCLSPIRVBuiltinMap::find(Info.UniqName, &OC)) {
     if (OC == OpImageRead) {
       // There are several read_image* functions defined by OpenCL C spec, but
@@ -1109,13 +1128,20 @@ void OCL20ToSPIRV::transBuiltin(CallInst *CI, OCLBuiltinTransInfo &Info) {
       // Both functions above are represented by the same SPIR-V
       // instruction: argument types are the same, only return type is
       // different
-      Info.UniqName = getSPIRVFuncName(OC, CI->getType());
+      Info.UniqName = getSPIRVFuncName(OC, RetTy);
     } else {
       Info.UniqName = getSPIRVFuncName(OC);
     }
   } else if ((ExtOp = getExtOp(Info.MangledName, Info.UniqName)) != ~0U)
     Info.UniqName = getSPIRVExtFuncName(SPIRVEIS_OpenCL, ExtOp);
   else
+    return false;
+  return true;
+}
+
+void OCL20ToSPIRV::transBuiltin(CallInst *CI, OCLBuiltinTransInfo &Info) {
+  AttributeList Attrs = CI->getCalledFunction()->getAttributes();
+  if (!transBuiltinName(CI->getType(), Info))
     return;
   if (!Info.RetTy)
     mutateCallInstSPIRV(
@@ -1306,15 +1332,32 @@ void OCL20ToSPIRV::visitCallBuiltinSimple(CallInst *CI, StringRef MangledName,
   Info.UniqName = DemangledName;
   transBuiltin(CI, Info);
 }
-GlobalVariable *WorkgroupSize = nullptr;
-GlobalVariable *WorkgroupId = nullptr;
-GlobalVariable *NumWorkgroups = nullptr;
-GlobalVariable *LocalInvocationId = nullptr;
+
+void OCL20ToSPIRV::transSimpleBuiltinCalls() {
+  for (auto &FCalls : SimpleBuiltinCalls) {
+    Function *F = FCalls.first;
+    OCLBuiltinTransInfo Info;
+    Info.MangledName = F->getName().str();
+    oclIsBuiltin(F->getName(), &Info.UniqName);
+    if (!transBuiltinName(F->getReturnType(), Info))
+      continue;
+    std::string Name = Info.UniqName + Info.Postfix;
+    AttributeList Attrs = F->getAttributes();
+    BuiltinFuncMangleInfo BtnInfo;
+    mutateCallInsts(
+        M, FCalls.second,
+        [&](CallInst *, std::vector<Value *> &Args) { return Name; },
+        &BtnInfo, &Attrs);
+  }
+  SimpleBuiltinCalls.clear();
+}
+
 /// Translates OCL work-item builtin functions to SPIRV builtin variables.
 /// Function like get_global_id(i) -> x = load GlobalInvocationId; extract x, i
 /// Function like get_work_dim() -> load WorkDim
 void OCL20ToSPIRV::transWorkItemBuiltinsToVariables() {
   LLVM_DEBUG(dbgs() << "Enter transWorkItemBuiltinsToVariables\n");
+  WorkgroupSize = WorkgroupId = NumWorkgroups = LocalInvocationId = nullptr;
   std::vector<Function *> WorkList;
   for (auto &I : *M) {
     std::string DemangledName;
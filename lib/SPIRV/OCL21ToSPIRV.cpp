@@ -121,6 +121,7 @@ bool OCL21ToSPIRV::runOnModule(Module &Module) {
   for (auto &I : ValuesToDelete)
     if (auto GV = dyn_cast<GlobalValue>(I))
       GV->eraseFromParent();
+  ValuesToDelete.clear();
 
   LLVM_DEBUG(dbgs() << "After OCL21ToSPIRV:\n" << *M);
   std::string Err;
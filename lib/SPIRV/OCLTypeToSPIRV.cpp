@@ -72,6 +72,8 @@ bool OCLTypeToSPIRV::runOnModule(Module &Module) {
   LLVM_DEBUG(dbgs() << "Enter OCLTypeToSPIRV:\n");
   M = &Module;
   Ctx = &M->getContext();
+  AdaptedTy.clear();
+  WorkSet.clear();
   auto Src = getSPIRVSource(&Module);
   if (std::get<0>(Src) != spv::SourceLanguageOpenCL_C)
     return false;
@@ -795,6 +795,14 @@ Instruction *mutateCallInstOCL(
   return mutateCallInst(M, CI, ArgMutate, RetMutate, &BtnInfo, Attrs);
 }
 
+void mutateCallInstsOCL(
+    Module *M, Function *F, ArrayRef<CallInst *> Calls,
+    std::function<std::string(CallInst *, std::vector<Value *> &)> ArgMutate,
+    AttributeList *Attrs) {
+  OCLBuiltinFuncMangleInfo BtnInfo(F);
+  mutateCallInsts(M, Calls, ArgMutate, &BtnInfo, Attrs);
+}
+
 static std::pair<StringRef, StringRef>
 getSrcAndDstElememntTypeName(BitCastInst *BIC) {
   if (!BIC)
@@ -259,6 +259,13 @@ const unsigned CL21 = 201000;
 const unsigned CL30 = 300000;
 } // namespace kOCLVer
 
+namespace kOCLTypeQualifierName {
+const static char Const[] = "const";
+const static char Volatile[] = "volatile";
+const static char Restrict[] = "restrict";
+const static char Pipe[] = "pipe";
+} // namespace kOCLTypeQualifierName
+
 namespace OclExt {
 // clang-format off
 enum Kind {
@@ -407,6 +414,13 @@ Instruction *mutateCallInstOCL(
     std::function<Instruction *(CallInst *)> RetMutate,
     AttributeList *Attrs = nullptr);
 
+/// Mutate calls of the OpenCL builtin function \p F in one batch to call
+/// another OpenCL builtin function. See mutateCallInsts.
+void mutateCallInstsOCL(
+    Module *M, Function *F, ArrayRef<CallInst *> Calls,
+    std::function<std::string(CallInst *, std::vector<Value *> &)> ArgMutate,
+    AttributeList *Attrs = nullptr);
+
 /// Check if instruction is bitcast from spirv.ConstantSampler to spirv.Sampler
 bool isSamplerInitializer(Instruction *Inst);
 
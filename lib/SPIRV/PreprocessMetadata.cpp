@@ -71,6 +71,9 @@ public:
   bool runOnModule(Module &M) override;
   void visit(Module *M);
   void preprocessNVPTXMetadata(Module *M, SPIRVMDBuilder *B, SPIRVMDWalker *W);
+  /// Build the OpenCL kernel argument metadata of the CUDA kernel \p F from
+  /// the types and attributes of its arguments.
+  void transKernelArgMetadata(Function *F);
   void preprocessVectorComputeMetadata(Module *M, SPIRVMDBuilder *B,
                                        SPIRVMDWalker *W);
 
@@ -210,6 +213,74 @@ void PreprocessMetadata::visit(Module *M) {
   }
 }
 
+/// Address space of a kernel pointer argument in the SPIR numbering. CUDA
+/// passes buffers as generic pointers, which point to global memory.
+static unsigned getKernelArgAddrSpace(PointerType *PtrTy) {
+  SPIRAddressSpace AS = SPIRAS_Global;
+  NVPTXSPIRAddrSpaceMap::find(
+      static_cast<NVPTXAddressSpace>(PtrTy->getAddressSpace()), &AS);
+  return AS == SPIRAS_Generic ? SPIRAS_Global : AS;
+}
+
+/// OpenCL C spelling of the type of a kernel argument.
+static std::string getKernelArgTypeName(Type *Ty) {
+  if (auto *PtrTy = dyn_cast<PointerType>(Ty))
+    return getKernelArgTypeName(PtrTy->getElementType()) + "*";
+  if (Ty->isVoidTy())
+    return "void";
+  if (auto *ST = dyn_cast<StructType>(Ty)) {
+    if (!ST->hasName())
+      return "struct";
+    StringRef Name = ST->getName();
+    // Clang names records "struct.S", "class.S" or "union.U".
+    auto Split = Name.split('.');
+    if (Split.first == "struct" || Split.first == "class")
+      return ("struct " + Split.second).str();
+    if (Split.first == "union")
+      return ("union " + Split.second).str();
+    return Name.str();
+  }
+  if (Ty->isIntegerTy(1))
+    return "bool";
+  return mapLLVMTypeToOCLType(Ty, /*Signed=*/true);
+}
+
+/// Type qualifiers implied by the attributes of a kernel argument.
+static std::string getKernelArgTypeQual(const Argument &Arg) {
+  std::string Qual;
+  if (!Arg.getType()->isPointerTy())
+    return Qual;
+  if (Arg.hasNoAliasAttr())
+    Qual = kOCLTypeQualifierName::Restrict;
+  if (Arg.onlyReadsMemory()) {
+    Qual += Qual.empty() ? "" : " ";
+    Qual += kOCLTypeQualifierName::Const;
+  }
+  return Qual;
+}
+
+void PreprocessMetadata::transKernelArgMetadata(Function *F) {
+  std::vector<Metadata *> AddrSpaces;
+  std::vector<Metadata *> AccessQuals;
+  std::vector<Metadata *> Types;
+  std::vector<Metadata *> TypeQuals;
+  for (Argument &Arg : F->args()) {
+    unsigned AS = SPIRAS_Private;
+    if (auto *PtrTy = dyn_cast<PointerType>(Arg.getType()))
+      AS = getKernelArgAddrSpace(PtrTy);
+    AddrSpaces.push_back(ConstantAsMetadata::get(
+        ConstantInt::get(Type::getInt32Ty(*Ctx), AS)));
+    AccessQuals.push_back(MDString::get(*Ctx, "none"));
+    Types.push_back(MDString::get(*Ctx, getKernelArgTypeName(Arg.getType())));
+    TypeQuals.push_back(MDString::get(*Ctx, getKernelArgTypeQual(Arg)));
+  }
+  F->setMetadata(SPIR_MD_KERNEL_ARG_ADDR_SPACE, MDNode::get(*Ctx, AddrSpaces));
+  F->setMetadata(SPIR_MD_KERNEL_ARG_ACCESS_QUAL,
+                 MDNode::get(*Ctx, AccessQuals));
+  F->setMetadata(SPIR_MD_KERNEL_ARG_TYPE, MDNode::get(*Ctx, Types));
+  F->setMetadata(SPIR_MD_KERNEL_ARG_BASE_TYPE, MDNode::get(*Ctx, Types));
+  F->setMetadata(SPIR_MD_KERNEL_ARG_TYPE_QUAL, MDNode::get(*Ctx, TypeQuals));
+}
 
 void PreprocessMetadata::preprocessNVPTXMetadata(Module *M, SPIRVMDBuilder *B,
                                                  SPIRVMDWalker *W) {
@@ -270,51 +341,7 @@ void PreprocessMetadata::preprocessNVPTXMetadata(Module *M, SPIRVMDBuilder *B,
       std::cout << F->getName().str() << std::endl;
       kernels.insert(F);
 
-      // construct kernel_arg_access_qual
-      std::vector<Metadata *> kernel_arg_access_qual_Vec;
-      auto A = F->arg_begin(), E = F->arg_end();
-      for (unsigned I = 0; A != E; ++I, ++A) {
-        kernel_arg_access_qual_Vec.push_back(MDString::get(*Ctx, "none"));
-      }
-      F->setMetadata("kernel_arg_access_qual",
-                     MDNode::get(*Ctx, kernel_arg_access_qual_Vec));
-      kernel_arg_access_qual_Vec.clear();
-
-      // construct kernel_arg_type
-      std::vector<Metadata *> kernel_arg_type_Vec;
-      A = F->arg_begin();
-      E = F->arg_end();
-      for (unsigned I = 0; A != E; ++I, ++A) {
-        if (A->getType()->isPointerTy()) {
-          if (A->getType()->isFloatingPointTy())
-            kernel_arg_type_Vec.push_back(MDString::get(*Ctx, "float*"));
-          else
-            kernel_arg_type_Vec.push_back(MDString::get(*Ctx, "int*"));
-        } else {
-          if (A->getType()->isFloatTy())
-            kernel_arg_type_Vec.push_back(MDString::get(*Ctx, "float"));
-          if (A->getType()->isIntegerTy())
-            kernel_arg_type_Vec.push_back(MDString::get(*Ctx, "int"));
-        }
-      }
-      F->setMetadata("kernel_arg_type", MDNode::get(*Ctx, kernel_arg_type_Vec));
-      kernel_arg_type_Vec.clear();
-
-      // construct kernel_arg_addr_space
-      std::vector<Metadata *> kernel_arg_addr_space_Vec;
-      A = F->arg_begin();
-      E = F->arg_end();
-      for (unsigned I = 0; A != E; ++I, ++A) {
-        if (A->getType()->isPointerTy())
-          kernel_arg_addr_space_Vec.push_back(ConstantAsMetadata::get(
-              ConstantInt::get(Type::getInt32Ty(*Ctx), 1)));
-        else
-          kernel_arg_addr_space_Vec.push_back(ConstantAsMetadata::get(
-              ConstantInt::get(Type::getInt32Ty(*Ctx), 0)));
-      }
-      F->setMetadata("kernel_arg_addr_space",
-                     MDNode::get(*Ctx, kernel_arg_addr_space_Vec));
-      kernel_arg_addr_space_Vec.clear();
+      transKernelArgMetadata(F);
 
       // makr this Function as KERNEL
       F->setCallingConv(CallingConv::SPIR_KERNEL);
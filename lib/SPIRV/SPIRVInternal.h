@@ -211,6 +211,27 @@ inline void SPIRVMap<SPIRAddressSpace, SPIRVStorageClassKind>::init() {
 }
 typedef SPIRVMap<SPIRAddressSpace, SPIRVStorageClassKind> SPIRSPIRVAddrSpaceMap;
 
+/// Address spaces of the NVPTX target, as produced by CUDA front ends.
+enum NVPTXAddressSpace {
+  NVPTXAS_Generic = 0,
+  NVPTXAS_Global = 1,
+  NVPTXAS_Shared = 3,
+  NVPTXAS_Const = 4,
+  NVPTXAS_Local = 5,
+  NVPTXAS_Param = 101,
+};
+
+template <>
+inline void SPIRVMap<NVPTXAddressSpace, SPIRAddressSpace>::init() {
+  add(NVPTXAS_Generic, SPIRAS_Generic);
+  add(NVPTXAS_Global, SPIRAS_Global);
+  add(NVPTXAS_Shared, SPIRAS_Local);
+  add(NVPTXAS_Const, SPIRAS_Constant);
+  add(NVPTXAS_Local, SPIRAS_Private);
+  add(NVPTXAS_Param, SPIRAS_Private);
+}
+typedef SPIRVMap<NVPTXAddressSpace, SPIRAddressSpace> NVPTXSPIRAddrSpaceMap;
+
 // Maps OCL builtin function to SPIRV builtin variable.
 template <>
 inline void SPIRVMap<std::string, SPIRVAccessQualifierKind>::init() {
@@ -300,6 +321,7 @@ const static char ConstantSampler[] = "ConstantSampler";
 const static char PipeStorage[] = "PipeStorage";
 const static char ConstantPipeStorage[] = "ConstantPipeStorage";
 const static char VmeImageINTEL[] = "VmeImageINTEL";
+const static char JointMatrixINTEL[] = "JointMatrixINTEL";
 } // namespace kSPIRVTypeName
 
 namespace kSPR2TypeName {
@@ -350,6 +372,12 @@ const static char TranslateSPIRVMemScope[] = "__translate_spirv_memory_scope";
 const static char TranslateSPIRVMemFence[] = "__translate_spirv_memory_fence";
 } // namespace kSPIRVName
 
+namespace kNVVMName {
+const static char WMMAPrefix[] = "llvm.nvvm.wmma.";
+const static char CpAsyncPrefix[] = "llvm.nvvm.cp.async.";
+const static char SRegPrefix[] = "llvm.nvvm.read.ptx.sreg.";
+} // namespace kNVVMName
+
 namespace kSPIRVPostfix {
 const static char Sat[] = "sat";
 const static char Rtz[] = "rtz";
@@ -697,7 +725,19 @@ Instruction *mutateCallInstSPIRV(
     std::function<Instruction *(CallInst *)> RetMutate,
     AttributeList *Attrs = nullptr);
 
-/// Mutate function by change the arguments.
+/// Mutates a batch of call instructions by changing the arguments, like
+/// mutateCallInst does for a single call. The callee of the mutated calls is
+/// looked up or created once for each distinct name and signature returned by
+/// \p ArgMutate rather than once per call, so \p Mangle and \p Attrs must
+/// not depend on the call site.
+void mutateCallInsts(
+    Module *M, ArrayRef<CallInst *> Calls,
+    std::function<std::string(CallInst *, std::vector<Value *> &)> ArgMutate,
+    BuiltinFuncMangleInfo *Mangle = nullptr, AttributeList *Attrs = nullptr,
+    bool TakeName = false);
+
+/// Mutate function by change the arguments. All calls of \p F are mutated in
+/// one batch with mutateCallInsts.
 /// \param ArgMutate mutates the function arguments.
 /// \param TakeName Take the original function's name if a new function with
 ///   different type needs to be created.
@@ -857,6 +897,14 @@ std::string getSPIRVImageTypePostfixes(StringRef SampledType,
                                        SPIRVTypeImageDescriptor Desc,
                                        SPIRVAccessQualifierKind Acc);
 
+/// Get the postfixes of SPIR-V joint matrix type name as in
+/// spirv.JointMatrixINTEL._postfixes.
+std::string getSPIRVJointMatrixINTELTypePostfixes(StringRef ComponentType,
+                                                  unsigned Rows,
+                                                  unsigned Columns,
+                                                  unsigned Layout,
+                                                  unsigned Scope);
+
 /// Get the sampled type name used in postfix of image type in SPIR-V
 /// friendly LLVM IR.
 std::string getSPIRVImageSampledTypeName(SPIRVType *Ty);
@@ -0,0 +1,642 @@
+//===- SPIRVLinker.cpp - Link SPIR-V modules ------------------------------===//
+//
+//                     The LLVM/SPIRV Translator
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+// Copyright (c) 2014 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimers.
+// Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimers in the documentation
+// and/or other materials provided with the distribution.
+// Neither the names of Advanced Micro Devices, Inc., nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// Software without specific prior written permission.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH
+// THE SOFTWARE.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements linking of separately translated SPIR-V modules into
+// a single SPIR-V module.
+//
+// The inputs are linked at the level of SPIR-V words. The Ids of every input
+// are moved into a range of their own, so that they cannot clash, and the
+// instructions of all inputs are merged section by section in the logical
+// layout of a module. While merging:
+// - Capabilities, extensions and extended instruction set imports are
+//   emitted once.
+// - Types and constants which are equal after the merge, including their
+//   names and decorations, are emitted once.
+// - Functions and variables decorated with LinkageAttributes Import are
+//   replaced by the ones with the same name decorated with LinkageAttributes
+//   Export, if any input defines them.
+// The result is renumbered to a dense Id range.
+//
+// Which operands of an instruction are Ids is told by SPIRVIdOperandDecoder.
+// Instructions it does not know about are reported as an error rather than
+// copied with possibly stale Ids.
+//
+//===----------------------------------------------------------------------===//
+#define DEBUG_TYPE "spirv-link"
+
+#include "LLVMSPIRVLib.h"
+#include "SPIRVIdOperands.h"
+#include "SPIRVModule.h"
+#include "SPIRVOpCode.h"
+#include "SPIRVStream.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
+
+#include <algorithm>
+#include <numeric>
+#include <set>
+#include <sstream>
+#include <unordered_map>
+
+using namespace llvm;
+using namespace SPIRV;
+
+namespace {
+
+/// \returns true for instructions defining a type or a constant which can be
+/// replaced by an equal one of another input.
+bool isMergeable(Op OC) {
+  switch (OC) {
+  case OpConstantTrue:
+  case OpConstantFalse:
+  case OpConstant:
+  case OpConstantComposite:
+  case OpConstantSampler:
+  case OpConstantNull:
+  case OpConstantPipeStorage:
+  case OpUndef:
+    return true;
+  default:
+    return isTypeOpCode(OC);
+  }
+}
+
+/// An instruction of an input module. Its Ids are already moved into the Id
+/// range of the input.
+struct LinkInst : SPIRVEncodedInst {
+  bool Removed = false;
+};
+
+/// Merges the instructions of the input modules section by section.
+class SPIRVLinker {
+public:
+  SPIRVLinker(std::string &ErrMsg) : ErrMsg(ErrMsg), Canonical(1, 0) {}
+
+  bool addModule(ArrayRef<uint32_t> Words);
+  bool link(std::vector<uint32_t> &Out);
+
+private:
+  /// Sections of the logical layout of a module, up to the functions.
+  enum Section {
+    Capabilities,
+    Extensions,
+    ExtInstImports,
+    MemoryModels,
+    EntryPoints,
+    ExecutionModes,
+    DebugSources,
+    DebugNames,
+    DebugModuleProcessed,
+    Annotations,
+    Globals,
+    NumSections
+  };
+
+  struct LinkFunction {
+    std::vector<LinkInst> Insts;
+    bool IsDeclaration = true;
+    bool Removed = false;
+  };
+
+  static Section getSection(Op OC);
+
+  /// \returns the Id which replaces \p Id in the linked module, or 0 if \p Id
+  /// was removed without a replacement.
+  uint32_t getCanonical(uint32_t Id) const {
+    while (Canonical[Id] != Id && Canonical[Id])
+      Id = Canonical[Id];
+    return Canonical[Id];
+  }
+  bool isKept(uint32_t Id) const { return Canonical[Id] == Id; }
+
+  void mergeExtInstImports();
+  void mergeStrings();
+  void mergeTypesAndConstants();
+  bool resolveImports();
+  bool checkEntryPoints();
+  bool emit(const LinkInst &LI);
+  bool emitAnnotation(const LinkInst &LI);
+
+  std::string &ErrMsg;
+  uint32_t Version = 0;
+  uint32_t Generator = 0;
+  std::vector<LinkInst> Sections[NumSections];
+  std::vector<LinkFunction> Functions;
+  /// The Id which replaces each Id of the inputs. Every Id maps to itself
+  /// unless it is merged into another one or removed.
+  std::vector<uint32_t> Canonical;
+
+  std::vector<uint32_t> *Out = nullptr;
+  std::vector<uint32_t> NewIds;
+  uint32_t NextId = 1;
+};
+
+SPIRVLinker::Section SPIRVLinker::getSection(Op OC) {
+  switch (OC) {
+  case OpCapability:
+    return Capabilities;
+  case OpExtension:
+    return Extensions;
+  case OpExtInstImport:
+    return ExtInstImports;
+  case OpMemoryModel:
+    return MemoryModels;
+  case OpEntryPoint:
+    return EntryPoints;
+  case OpExecutionMode:
+  case OpExecutionModeId:
+    return ExecutionModes;
+  case OpString:
+  case OpSourceExtension:
+  case OpSource:
+  case OpSourceContinued:
+    return DebugSources;
+  case OpName:
+  case OpMemberName:
+    return DebugNames;
+  case OpModuleProcessed:
+    return DebugModuleProcessed;
+  case OpDecorate:
+  case OpMemberDecorate:
+  case OpDecorationGroup:
+  case OpGroupDecorate:
+  case OpGroupMemberDecorate:
+  case OpDecorateId:
+    return Annotations;
+  default:
+    return Globals;
+  }
+}
+
+bool SPIRVLinker::addModule(ArrayRef<uint32_t> Words) {
+  if (Words.size() < 5 || Words[0] != MagicNumber || !Words[3]) {
+    ErrMsg = "invalid SPIR-V binary";
+    return false;
+  }
+  if (Canonical.size() == 1)
+    Generator = Words[2];
+  Version = std::max(Version, Words[1]);
+  uint32_t Bound = Words[3];
+  uint32_t Base = Canonical.size() - 1;
+  Canonical.resize(Canonical.size() + Bound - 1);
+  std::iota(Canonical.begin() + Base + 1, Canonical.end(), Base + 1);
+
+  SmallVector<ArrayRef<uint32_t>, 0> Insts;
+  for (size_t I = 5, E = Words.size(); I < E;) {
+    unsigned WordCount = Words[I] >> WordCountShift;
+    if (!WordCount || I + WordCount > E) {
+      ErrMsg = "invalid SPIR-V binary";
+      return false;
+    }
+    Insts.push_back(Words.slice(I, WordCount));
+    I += WordCount;
+  }
+
+  SPIRVIdOperandDecoder Decoder;
+  for (ArrayRef<uint32_t> Ins : Insts)
+    Decoder.scan(Ins);
+
+  bool InFunction = false;
+  for (ArrayRef<uint32_t> Ins : Insts) {
+    LinkInst LI;
+    LI.Words.assign(Ins.begin(), Ins.end());
+    if (!Decoder.decode(LI, ErrMsg))
+      return false;
+    for (uint16_t P : LI.IdPos) {
+      if (!LI.Words[P] || LI.Words[P] >= Bound) {
+        ErrMsg = "Id " + std::to_string(LI.Words[P]) + " is out of bound";
+        return false;
+      }
+      LI.Words[P] += Base;
+    }
+
+    Op OC = LI.getOpCode();
+    if (OC == OpFunction) {
+      if (InFunction) {
+        ErrMsg = "missing OpFunctionEnd";
+        return false;
+      }
+      Functions.emplace_back();
+      InFunction = true;
+    }
+    if (!InFunction) {
+      Sections[getSection(OC)].push_back(std::move(LI));
+      continue;
+    }
+    LinkFunction &F = Functions.back();
+    if (OC == OpLabel)
+      F.IsDeclaration = false;
+    F.Insts.push_back(std::move(LI));
+    if (OC == OpFunctionEnd)
+      InFunction = false;
+  }
+  if (InFunction) {
+    ErrMsg = "missing OpFunctionEnd";
+    return false;
+  }
+  return true;
+}
+
+void SPIRVLinker::mergeExtInstImports() {
+  StringMap<uint32_t> Imports;
+  for (LinkInst &LI : Sections[ExtInstImports]) {
+    auto It = Imports.insert({getLiteralString(LI.Words, 2), LI.getResult()});
+    if (!It.second) {
+      Canonical[LI.getResult()] = It.first->second;
+      LI.Removed = true;
+    }
+  }
+}
+
+void SPIRVLinker::mergeStrings() {
+  StringMap<uint32_t> Strings;
+  for (LinkInst &LI : Sections[DebugSources]) {
+    if (LI.getOpCode() != OpString)
+      continue;
+    auto It = Strings.insert({getLiteralString(LI.Words, 2), LI.getResult()});
+    if (!It.second) {
+      Canonical[LI.getResult()] = It.first->second;
+      LI.Removed = true;
+    }
+  }
+}
+
+void SPIRVLinker::mergeTypesAndConstants() {
+  // Types and constants are only merged if they have the same names and
+  // decorations. Operands of decorations are literals except for
+  // OpDecorateId, whose Ids are taken as they are, so that constants
+  // decorated by Id are merged only within one input.
+  DenseMap<uint32_t, std::vector<std::string>> Attributes;
+  DenseSet<uint32_t> NotMergeable;
+  auto AddAttribute = [&](const LinkInst &LI) {
+    std::string Attr(reinterpret_cast<const char *>(&LI.Words[0]),
+                     sizeof(uint32_t));
+    Attr.append(reinterpret_cast<const char *>(&LI.Words[2]),
+                (LI.Words.size() - 2) * sizeof(uint32_t));
+    Attributes[LI.Words[1]].push_back(std::move(Attr));
+  };
+  for (const LinkInst &LI : Sections[DebugNames])
+    AddAttribute(LI);
+  for (const LinkInst &LI : Sections[Annotations]) {
+    switch (LI.getOpCode()) {
+    case OpDecorate:
+    case OpMemberDecorate:
+    case OpDecorateId:
+      AddAttribute(LI);
+      break;
+    case OpGroupDecorate:
+    case OpGroupMemberDecorate:
+      for (size_t I = 1, E = LI.IdPos.size(); I < E; ++I)
+        NotMergeable.insert(LI.Words[LI.IdPos[I]]);
+      break;
+    default:
+      break;
+    }
+  }
+  for (auto &It : Attributes)
+    std::sort(It.second.begin(), It.second.end());
+  for (const LinkInst &LI : Sections[Globals])
+    if (LI.getOpCode() == OpTypeForwardPointer)
+      NotMergeable.insert(LI.Words[1]);
+
+  std::unordered_map<std::string, uint32_t> Defined;
+  for (LinkInst &LI : Sections[Globals]) {
+    uint32_t Id = LI.getResult();
+    if (!isMergeable(LI.getOpCode()) || NotMergeable.count(Id))
+      continue;
+    // Types and constants only refer to earlier definitions, which are
+    // already merged.
+    SmallVector<uint32_t, 8> Words(LI.Words.begin(), LI.Words.end());
+    for (uint16_t P : LI.IdPos)
+      Words[P] = P == LI.ResultPos ? 0 : getCanonical(Words[P]);
+    std::string Key(reinterpret_cast<const char *>(Words.data()),
+                    Words.size() * sizeof(uint32_t));
+    auto Attr = Attributes.find(Id);
+    if (Attr != Attributes.end())
+      for (const std::string &A : Attr->second)
+        Key += A;
+    auto It = Defined.insert({std::move(Key), Id});
+    if (!It.second) {
+      Canonical[Id] = It.first->second;
+      LI.Removed = true;
+    }
+  }
+}
+
+bool SPIRVLinker::resolveImports() {
+  StringMap<uint32_t> Exports;
+  std::vector<std::pair<std::string, uint32_t>> Imports;
+  for (const LinkInst &LI : Sections[Annotations]) {
+    if (LI.getOpCode() != OpDecorate ||
+        LI.Words.size() < 4 || LI.Words[2] != DecorationLinkageAttributes)
+      continue;
+    std::string Name = getLiteralString(LI.Words, 3);
+    unsigned TypePos = skipLiteralString(LI.Words, 3);
+    if (TypePos >= LI.Words.size())
+      continue;
+    if (LI.Words[TypePos] == LinkageTypeImport) {
+      Imports.emplace_back(Name, LI.Words[1]);
+    } else if (LI.Words[TypePos] == LinkageTypeExport &&
+               !Exports.insert({Name, LI.Words[1]}).second) {
+      ErrMsg = "symbol multiply defined: " + Name;
+      return false;
+    }
+  }
+  if (Imports.empty())
+    return true;
+
+  // Functions and variables by their Ids, with their types.
+  DenseMap<uint32_t, std::pair<uint32_t, LinkFunction *>> FunctionsById;
+  DenseMap<uint32_t, std::pair<uint32_t, LinkInst *>> VariablesById;
+  for (LinkFunction &F : Functions) {
+    const LinkInst &Def = F.Insts.front();
+    FunctionsById[Def.getResult()] = {Def.Words[4], &F};
+  }
+  for (LinkInst &LI : Sections[Globals])
+    if (LI.getOpCode() == OpVariable)
+      VariablesById[LI.getResult()] = {LI.Words[1], &LI};
+
+  for (auto &Import : Imports) {
+    auto Export = Exports.find(Import.first);
+    if (Export == Exports.end())
+      continue;
+    uint32_t ImportId = Import.second;
+    uint32_t ExportId = Export->second;
+    auto ImportF = FunctionsById.find(ImportId);
+    auto ExportF = FunctionsById.find(ExportId);
+    auto ImportV = VariablesById.find(ImportId);
+    auto ExportV = VariablesById.find(ExportId);
+    if (ImportF != FunctionsById.end() && ExportF != FunctionsById.end() &&
+        ImportF->second.second->IsDeclaration &&
+        !ExportF->second.second->IsDeclaration) {
+      if (getCanonical(ImportF->second.first) !=
+          getCanonical(ExportF->second.first)) {
+        ErrMsg = "type mismatch for symbol: " + Import.first;
+        return false;
+      }
+      LinkFunction &F = *ImportF->second.second;
+      F.Removed = true;
+      for (const LinkInst &LI : F.Insts)
+        if (LI.getOpCode() == OpFunctionParameter)
+          Canonical[LI.getResult()] = 0;
+    } else if (ImportV != VariablesById.end() &&
+               ExportV != VariablesById.end()) {
+      if (getCanonical(ImportV->second.first) !=
+          getCanonical(ExportV->second.first)) {
+        ErrMsg = "type mismatch for symbol: " + Import.first;
+        return false;
+      }
+      ImportV->second.second->Removed = true;
+    } else {
+      ErrMsg = "cannot resolve symbol: " + Import.first;
+      return false;
+    }
+    Canonical[ImportId] = ExportId;
+  }
+  return true;
+}
+
+bool SPIRVLinker::checkEntryPoints() {
+  std::set<std::pair<uint32_t, std::string>> Names;
+  for (const LinkInst &LI : Sections[EntryPoints]) {
+    std::string Name = getLiteralString(LI.Words, 3);
+    if (!Names.insert({LI.Words[1], Name}).second) {
+      ErrMsg = "entry point multiply defined: " + Name;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool SPIRVLinker::emit(const LinkInst &LI) {
+  size_t Start = Out->size();
+  Out->insert(Out->end(), LI.Words.begin(), LI.Words.end());
+  for (uint16_t P : LI.IdPos) {
+    uint32_t &Word = (*Out)[Start + P];
+    uint32_t Id = getCanonical(Word);
+    if (!Id) {
+      ErrMsg = "reference to a removed declaration";
+      return false;
+    }
+    if (!NewIds[Id])
+      NewIds[Id] = NextId++;
+    Word = NewIds[Id];
+  }
+  return true;
+}
+
+bool SPIRVLinker::emitAnnotation(const LinkInst &LI) {
+  Op OC = LI.getOpCode();
+  if (OC != OpGroupDecorate && OC != OpGroupMemberDecorate)
+    // Decorations of merged or resolved Ids are dropped with them.
+    return OC == OpDecorationGroup || isKept(LI.Words[1]) ? emit(LI) : true;
+
+  // Keep the targets which are not merged into other Ids.
+  LinkInst Filtered;
+  Filtered.Words.push_back(0);
+  Filtered.Words.push_back(LI.Words[1]);
+  Filtered.IdPos.push_back(1);
+  unsigned Step = OC == OpGroupDecorate ? 1 : 2;
+  for (size_t I = 2, E = LI.Words.size(); I + Step <= E; I += Step) {
+    if (!isKept(LI.Words[I]))
+      continue;
+    Filtered.IdPos.push_back(Filtered.Words.size());
+    Filtered.Words.append(&LI.Words[I], &LI.Words[I] + Step);
+  }
+  if (Filtered.Words.size() == 2)
+    return true;
+  Filtered.Words[0] = (Filtered.Words.size() << WordCountShift) | OC;
+  return emit(Filtered);
+}
+
+bool SPIRVLinker::link(std::vector<uint32_t> &Words) {
+  if (Sections[MemoryModels].empty()) {
+    ErrMsg = "missing OpMemoryModel";
+    return false;
+  }
+  for (const LinkInst &LI : Sections[MemoryModels])
+    if (LI.Words != Sections[MemoryModels].front().Words) {
+      ErrMsg = "linked modules use different memory models";
+      return false;
+    }
+  mergeExtInstImports();
+  mergeStrings();
+  mergeTypesAndConstants();
+  if (!resolveImports() || !checkEntryPoints())
+    return false;
+
+  Words.clear();
+  Words.insert(Words.end(), {MagicNumber, Version, Generator, 0, 0});
+  Out = &Words;
+  NewIds.assign(Canonical.size(), 0);
+  NextId = 1;
+
+  // Instructions of these sections which are equal after the merge are only
+  // emitted once.
+  std::set<std::vector<uint32_t>> Emitted;
+  auto EmitOnce = [&](const LinkInst &LI) {
+    std::vector<uint32_t> Key(LI.Words.begin(), LI.Words.end());
+    for (uint16_t P : LI.IdPos)
+      Key[P] = getCanonical(Key[P]);
+    return !Emitted.insert(std::move(Key)).second || emit(LI);
+  };
+
+  for (unsigned S = 0; S < NumSections; ++S) {
+    for (const LinkInst &LI : Sections[S]) {
+      if (LI.Removed)
+        continue;
+      bool Success = true;
+      switch (S) {
+      case Capabilities:
+      case Extensions:
+      case DebugSources:
+      case DebugModuleProcessed:
+        Success = EmitOnce(LI);
+        break;
+      case MemoryModels:
+        Success = &LI != &Sections[S].front() || emit(LI);
+        break;
+      case DebugNames:
+        Success = !isKept(LI.Words[1]) || EmitOnce(LI);
+        break;
+      case Annotations:
+        Success = emitAnnotation(LI);
+        break;
+      default:
+        Success = emit(LI);
+      }
+      if (!Success)
+        return false;
+    }
+  }
+  // Function declarations precede all function definitions.
+  for (bool Declarations : {true, false})
+    for (const LinkFunction &F : Functions) {
+      if (F.Removed || F.IsDeclaration != Declarations)
+        continue;
+      for (const LinkInst &LI : F.Insts)
+        if (!emit(LI))
+          return false;
+    }
+
+  Words[3] = NextId;
+  return true;
+}
+
+/// Read every input as a SPIRVModule and link their binary encodings.
+bool linkSpirvWords(const SPIRV::TranslatorOpts &Opts,
+                    ArrayRef<std::istream *> Inputs,
+                    std::vector<uint32_t> &Words, std::string &ErrMsg) {
+  if (Inputs.empty()) {
+    ErrMsg = "no SPIR-V modules to link";
+    return false;
+  }
+  SPIRVLinker Linker(ErrMsg);
+  for (std::istream *IS : Inputs) {
+    // Decoding and encoding the input again accepts both the binary and the
+    // text format and rejects invalid modules early.
+    std::unique_ptr<SPIRVModule> BM(readSpirvModule(*IS, Opts, ErrMsg));
+    if (!BM)
+      return false;
+    if (!writeSpirvModule(*BM, Words)) {
+      BM->getError(ErrMsg);
+      return false;
+    }
+    BM.reset();
+    if (!Linker.addModule(Words))
+      return false;
+  }
+  return Linker.link(Words);
+}
+
+std::unique_ptr<SPIRVModule>
+readLinkedModule(const SPIRV::TranslatorOpts &Opts,
+                 const std::vector<uint32_t> &Words, std::string &ErrMsg) {
+  std::istringstream IS(
+      std::string(reinterpret_cast<const char *>(Words.data()),
+                  Words.size() * sizeof(uint32_t)));
+#ifdef _SPIRV_SUPPORT_TEXT_FMT
+  auto SaveOpt = SPIRVUseTextFormat;
+  SPIRVUseTextFormat = false;
+#endif
+  std::unique_ptr<SPIRVModule> BM(readSpirvModule(IS, Opts, ErrMsg));
+#ifdef _SPIRV_SUPPORT_TEXT_FMT
+  SPIRVUseTextFormat = SaveOpt;
+#endif
+  return BM;
+}
+
+} // namespace
+
+std::unique_ptr<Module>
+llvm::linkSpirvToLLVM(LLVMContext &C, const SPIRV::TranslatorOpts &Opts,
+                      ArrayRef<std::istream *> Inputs, std::string &ErrMsg) {
+  std::vector<uint32_t> Words;
+  if (!linkSpirvWords(Opts, Inputs, Words, ErrMsg))
+    return nullptr;
+  std::unique_ptr<SPIRVModule> BM = readLinkedModule(Opts, Words, ErrMsg);
+  if (!BM)
+    return nullptr;
+  return convertSpirvToLLVM(C, *BM, Opts, ErrMsg);
+}
+
+bool llvm::linkSpirv(const SPIRV::TranslatorOpts &Opts,
+                     ArrayRef<std::istream *> Inputs, std::ostream &OS,
+                     std::string &ErrMsg) {
+  std::vector<uint32_t> Words;
+  if (!linkSpirvWords(Opts, Inputs, Words, ErrMsg))
+    return false;
+#ifdef _SPIRV_SUPPORT_TEXT_FMT
+  if (SPIRVUseTextFormat) {
+    std::unique_ptr<SPIRVModule> BM = readLinkedModule(Opts, Words, ErrMsg);
+    if (!BM)
+      return false;
+    OS << *BM;
+    return true;
+  }
+#endif
+  OS.write(reinterpret_cast<const char *>(Words.data()),
+           Words.size() * sizeof(uint32_t));
+  return true;
+}
+
+bool llvm::linkSpirv(const SPIRV::TranslatorOpts &Opts,
+                     ArrayRef<std::istream *> Inputs,
+                     std::vector<uint32_t> &Words, std::string &ErrMsg) {
+  return linkSpirvWords(Opts, Inputs, Words, ErrMsg);
+}
@@ -42,9 +42,11 @@
 #include "SPIRVMDBuilder.h"
 #include "SPIRVMDWalker.h"
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/InstIterator.h"
 #include "llvm/IR/InstVisitor.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Verifier.h"
@@ -53,7 +55,7 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 
-#include <list>
+#include <algorithm>
 #include <set>
 
 using namespace llvm;
@@ -78,6 +80,13 @@ public:
   static char ID;
 
 private:
+  typedef DenseMap<ConstantExpr *, Instruction *> LoweredConstExprMap;
+
+  void lowerOperands(Instruction *I, BasicBlock *Entry,
+                     LoweredConstExprMap &Lowered);
+  Value *lowerConstExpr(Value *V, Instruction *InsPoint, BasicBlock *Entry,
+                        LoweredConstExprMap &Lowered);
+
   Module *M;
   LLVMContext *Ctx;
 };
@@ -103,6 +112,64 @@ bool SPIRVLowerConstExpr::runOnModule(Module &Module) {
   return true;
 }
 
+// A vector operand is expanded only if all of its elements need lowering.
+static bool isConstExprVector(Value *V) {
+  auto *Vec = dyn_cast<ConstantVector>(V);
+  return Vec && std::all_of(Vec->op_begin(), Vec->op_end(), [](Value *E) {
+           return isa<ConstantExpr>(E) || isa<Function>(E);
+         });
+}
+
+static bool hasConstExprOperand(const Instruction &I) {
+  return std::any_of(I.op_begin(), I.op_end(), [](const Use &U) {
+    return isa<ConstantExpr>(U.get()) || isConstExprVector(U.get());
+  });
+}
+
+/// Returns the instruction computing \p V in the current function. The
+/// instruction is created before \p InsPoint the first time \p V is seen and
+/// its own constant expression operands are lowered right before it.
+Value *SPIRVLowerConstExpr::lowerConstExpr(Value *V, Instruction *InsPoint,
+                                           BasicBlock *Entry,
+                                           LoweredConstExprMap &Lowered) {
+  auto *CE = dyn_cast<ConstantExpr>(V);
+  if (!CE)
+    return V;
+  auto Loc = Lowered.find(CE);
+  if (Loc != Lowered.end())
+    return Loc->second;
+  SPIRVDBG(dbgs() << "[lowerConstantExpressions] " << *CE;)
+  auto ReplInst = CE->getAsInstruction();
+  ReplInst->insertBefore(InsPoint);
+  SPIRVDBG(dbgs() << " -> " << *ReplInst << '\n';)
+  Lowered[CE] = ReplInst;
+  lowerOperands(ReplInst, Entry, Lowered);
+  return ReplInst;
+}
+
+void SPIRVLowerConstExpr::lowerOperands(Instruction *I, BasicBlock *Entry,
+                                        LoweredConstExprMap &Lowered) {
+  auto InsPoint = I->getParent() == Entry ? I : Entry->getTerminator();
+  for (unsigned OI = 0, OE = I->getNumOperands(); OI != OE; ++OI) {
+    auto Op = I->getOperand(OI);
+    if (isConstExprVector(Op)) {
+      // Expand a vector of constexprs and construct it back with series of
+      // insertelement instructions
+      auto *Vec = cast<ConstantVector>(Op);
+      auto *PhiI = dyn_cast<PHINode>(I);
+      auto *VecInsPoint = PhiI ? &PhiI->getIncomingBlock(OI)->back() : I;
+      Value *Repl = UndefValue::get(Vec->getType());
+      unsigned Idx = 0;
+      for (auto &E : Vec->operands())
+        Repl = InsertElementInst::Create(
+            Repl, lowerConstExpr(E, InsPoint, Entry, Lowered),
+            ConstantInt::get(Type::getInt32Ty(*Ctx), Idx++), "", VecInsPoint);
+      I->setOperand(OI, Repl);
+    } else if (isa<ConstantExpr>(Op))
+      I->setOperand(OI, lowerConstExpr(Op, InsPoint, Entry, Lowered));
+  }
+}
+
 /// Since SPIR-V cannot represent constant expression, constant expressions
 /// in LLVM needs to be lowered to instructions.
 /// For each function, the constant expressions used by instructions of the
@@ -110,76 +177,21 @@ bool SPIRVLowerConstExpr::runOnModule(Module &Module) {
 /// dominates all other BB's. Each constant expression only needs to be lowered
 /// once in each function and all uses of it by instructions in that function
 /// is replaced by one instruction.
+/// Instructions are visited in program order starting with the entry block,
+/// so a lowered instruction always precedes the later users that reuse it.
 /// ToDo: remove redundant instructions for common subexpression
 
 void SPIRVLowerConstExpr::visit(Module *M) {
-  for (auto &I : M->functions()) {
-    std::list<Instruction *> WorkList;
-    for (auto &BI : I) {
-      for (auto &II : BI) {
-        WorkList.push_back(&II);
-      }
-    }
-    auto FBegin = I.begin();
-    while (!WorkList.empty()) {
-      auto II = WorkList.front();
-
-      auto LowerOp = [&II, &FBegin, &I](Value *V) -> Value * {
-        if (isa<Function>(V))
-          return V;
-        auto *CE = cast<ConstantExpr>(V);
-        SPIRVDBG(dbgs() << "[lowerConstantExpressions] " << *CE;)
-        auto ReplInst = CE->getAsInstruction();
-        auto InsPoint = II->getParent() == &*FBegin ? II : &FBegin->back();
-        ReplInst->insertBefore(InsPoint);
-        SPIRVDBG(dbgs() << " -> " << *ReplInst << '\n';)
-        std::vector<Instruction *> Users;
-        // Do not replace use during iteration of use. Do it in another loop
-        for (auto U : CE->users()) {
-          SPIRVDBG(dbgs() << "[lowerConstantExpressions] Use: " << *U << '\n';)
-          if (auto InstUser = dyn_cast<Instruction>(U)) {
-            // Only replace users in scope of current function
-            if (InstUser->getParent()->getParent() == &I)
-              Users.push_back(InstUser);
-          }
-        }
-        for (auto &User : Users)
-          User->replaceUsesOfWith(CE, ReplInst);
-        return ReplInst;
-      };
-
-      WorkList.pop_front();
-      for (unsigned OI = 0, OE = II->getNumOperands(); OI != OE; ++OI) {
-        auto Op = II->getOperand(OI);
-        auto *Vec = dyn_cast<ConstantVector>(Op);
-        if (Vec && std::all_of(Vec->op_begin(), Vec->op_end(), [](Value *V) {
-              return isa<ConstantExpr>(V) || isa<Function>(V);
-            })) {
-          // Expand a vector of constexprs and construct it back with series of
-          // insertelement instructions
-          std::list<Value *> OpList;
-          std::transform(Vec->op_begin(), Vec->op_end(),
-                         std::back_inserter(OpList),
-                         [LowerOp](Value *V) { return LowerOp(V); });
-          Value *Repl = nullptr;
-          unsigned Idx = 0;
-          auto *PhiII = dyn_cast<PHINode>(II);
-          auto *InsPoint = PhiII ? &PhiII->getIncomingBlock(OI)->back() : II;
-          std::list<Instruction *> ReplList;
-          for (auto V : OpList) {
-            if (auto *Inst = dyn_cast<Instruction>(V))
-              ReplList.push_back(Inst);
-            Repl = InsertElementInst::Create(
-                (Repl ? Repl : UndefValue::get(Vec->getType())), V,
-                ConstantInt::get(Type::getInt32Ty(M->getContext()), Idx++), "",
-                InsPoint);
-          }
-          II->replaceUsesOfWith(Op, Repl);
-          WorkList.splice(WorkList.begin(), ReplList);
-        } else if (auto CE = dyn_cast<ConstantExpr>(Op))
-          WorkList.push_front(cast<Instruction>(LowerOp(CE)));
-      }
-    }
+  for (auto &F : M->functions()) {
+    if (F.isDeclaration())
+      continue;
+    std::vector<Instruction *> WorkList;
+    for (auto &I : instructions(F))
+      if (hasConstExprOperand(I))
+        WorkList.push_back(&I);
+    LoweredConstExprMap Lowered;
+    for (auto *I : WorkList)
+      lowerOperands(I, &F.getEntryBlock(), Lowered);
   }
 }
 
@@ -0,0 +1,665 @@
+//===- SPIRVLowerNVPTXAddrSpace.cpp - Map NVPTX address spaces to SPIR ----===//
+//
+//                     The LLVM/SPIRV Translator
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+// Copyright (c) 2014 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimers.
+// Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimers in the documentation
+// and/or other materials provided with the distribution.
+// Neither the names of Advanced Micro Devices, Inc., nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// Software without specific prior written permission.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH
+// THE SOFTWARE.
+//
+//
+// This file implements rewriting of the NVPTX address spaces of a CUDA module
+// to the SPIR numbering expected by the rest of the translator, followed by
+// the inference of the address space of generic pointers.
+//
+// CUDA kernels receive their buffers as generic pointers and reach __shared__
+// and __constant__ variables through casts to generic. Once the address
+// spaces are remapped, kernel pointer arguments are made CrossWorkgroup and
+// every generic pointer which is known to point into a single address space
+// is rebuilt in that address space, so that loads and stores access memory
+// through storage class specific pointers instead of OpPtrCastToGeneric.
+//
+//===----------------------------------------------------------------------===//
+#include "SPIRVInternal.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Intrinsics.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Operator.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Pass.h"
+#include "llvm/PassSupport.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/Local.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+
+#define DEBUG_TYPE "spvnvptxaddrspace"
+
+using namespace llvm;
+using namespace SPIRV;
+
+namespace SPIRV {
+cl::opt<bool> SPIRVLowerNVPTXAddrSpaceValidate(
+    "spvnvptxaddrspace-validate",
+    cl::desc("Validate module after mapping NVPTX address spaces to SPIR "
+             "address spaces"));
+
+/// Address space of a generic pointer which is not known yet.
+static const unsigned UnknownAS = SPIRAS_Count;
+
+static unsigned mapNVPTXAddrSpace(unsigned AS) {
+  SPIRAddressSpace SPIRAS;
+  if (NVPTXSPIRAddrSpaceMap::find(static_cast<NVPTXAddressSpace>(AS), &SPIRAS))
+    return SPIRAS;
+  return AS;
+}
+
+/// Maps types with NVPTX pointers to the same types with SPIR pointers.
+/// Identified structs containing such pointers are recreated under the same
+/// name once renameStructs is called.
+class NVPTXAddrSpaceTypeMapper : public ValueMapTypeRemapper {
+public:
+  Type *remapType(Type *Ty) override;
+  void renameStructs();
+
+private:
+  bool needsRemap(Type *Ty);
+
+  DenseMap<Type *, Type *> Mapped;
+  DenseMap<Type *, bool> NeedsRemap;
+  std::vector<std::pair<StructType *, StructType *>> Structs;
+};
+
+bool NVPTXAddrSpaceTypeMapper::needsRemap(Type *Ty) {
+  auto Loc = NeedsRemap.find(Ty);
+  if (Loc != NeedsRemap.end())
+    return Loc->second;
+  // Recursive structs reach themselves through pointers, which are enough to
+  // decide.
+  NeedsRemap[Ty] = false;
+  bool Result = false;
+  if (auto *PT = dyn_cast<PointerType>(Ty)) {
+    unsigned AS = PT->getAddressSpace();
+    Result = needsRemap(PT->getElementType()) ||
+             (!PT->getElementType()->isFunctionTy() &&
+              mapNVPTXAddrSpace(AS) != AS);
+  } else {
+    for (Type *Sub : Ty->subtypes())
+      Result = needsRemap(Sub) || Result;
+  }
+  return NeedsRemap[Ty] = Result;
+}
+
+Type *NVPTXAddrSpaceTypeMapper::remapType(Type *Ty) {
+  auto Loc = Mapped.find(Ty);
+  if (Loc != Mapped.end())
+    return Loc->second;
+  if (!needsRemap(Ty))
+    return Mapped[Ty] = Ty;
+
+  LLVMContext &C = Ty->getContext();
+  if (auto *ST = dyn_cast<StructType>(Ty)) {
+    if (ST->isLiteral()) {
+      SmallVector<Type *, 8> Elements;
+      for (Type *E : ST->elements())
+        Elements.push_back(remapType(E));
+      return Mapped[Ty] = StructType::get(C, Elements, ST->isPacked());
+    }
+    StructType *NewST = StructType::create(C);
+    Mapped[Ty] = NewST;
+    Structs.emplace_back(ST, NewST);
+    SmallVector<Type *, 8> Elements;
+    for (Type *E : ST->elements())
+      Elements.push_back(remapType(E));
+    NewST->setBody(Elements, ST->isPacked());
+    return NewST;
+  }
+
+  Type *NewTy = nullptr;
+  if (auto *PT = dyn_cast<PointerType>(Ty)) {
+    unsigned AS = PT->getAddressSpace();
+    // Function pointers are not data pointers and keep their address space.
+    if (!PT->getElementType()->isFunctionTy())
+      AS = mapNVPTXAddrSpace(AS);
+    NewTy = PointerType::get(remapType(PT->getElementType()), AS);
+  } else if (auto *AT = dyn_cast<ArrayType>(Ty)) {
+    NewTy = ArrayType::get(remapType(AT->getElementType()),
+                           AT->getNumElements());
+  } else if (auto *VT = dyn_cast<VectorType>(Ty)) {
+    NewTy = VectorType::get(remapType(VT->getElementType()),
+                            VT->getElementCount());
+  } else if (auto *FT = dyn_cast<FunctionType>(Ty)) {
+    SmallVector<Type *, 8> Params;
+    for (Type *P : FT->params())
+      Params.push_back(remapType(P));
+    NewTy = FunctionType::get(remapType(FT->getReturnType()), Params,
+                              FT->isVarArg());
+  } else {
+    llvm_unreachable("Unexpected type with pointers");
+  }
+  return Mapped[Ty] = NewTy;
+}
+
+void NVPTXAddrSpaceTypeMapper::renameStructs() {
+  for (auto &S : Structs) {
+    if (!S.first->hasName())
+      continue;
+    std::string Name = S.first->getName().str();
+    S.first->setName("");
+    S.second->setName(Name);
+  }
+  Structs.clear();
+}
+
+class SPIRVLowerNVPTXAddrSpace : public ModulePass {
+public:
+  SPIRVLowerNVPTXAddrSpace() : ModulePass(ID) {
+    initializeSPIRVLowerNVPTXAddrSpacePass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnModule(Module &M) override;
+
+  static char ID;
+
+private:
+  /// Recreate every global, function and alias of \p M with SPIR address
+  /// spaces. Pointer arguments of kernels become CrossWorkgroup pointers.
+  void remapModule(Module &M);
+  /// Move allocas created in another address space by the remapping back to
+  /// the private one.
+  void fixAllocas(Function &F);
+  /// Rebuild the generic pointers of \p F which only point into one address
+  /// space in that address space.
+  void inferAddressSpaces(Function &F);
+};
+
+char SPIRVLowerNVPTXAddrSpace::ID = 0;
+
+bool SPIRVLowerNVPTXAddrSpace::runOnModule(Module &M) {
+  if (!Triple(M.getTargetTriple()).isNVPTX())
+    return false;
+
+  remapModule(M);
+  for (Function &F : M) {
+    if (F.isDeclaration())
+      continue;
+    fixAllocas(F);
+    inferAddressSpaces(F);
+  }
+
+  if (SPIRVLowerNVPTXAddrSpaceValidate) {
+    LLVM_DEBUG(dbgs() << "After SPIRVLowerNVPTXAddrSpace:\n" << M);
+    std::string Err;
+    raw_string_ostream ErrorOS(Err);
+    if (verifyModule(M, &ErrorOS)) {
+      Err = std::string("Fails to verify module: ") + Err;
+      report_fatal_error(Err.c_str(), false);
+    }
+  }
+  return true;
+}
+
+void SPIRVLowerNVPTXAddrSpace::remapModule(Module &M) {
+  NVPTXAddrSpaceTypeMapper TM;
+  ValueToValueMapTy VMap;
+  std::vector<std::pair<GlobalValue *, GlobalValue *>> Replaced;
+  std::vector<GlobalVariable *> Globals;
+  std::vector<Function *> Functions;
+  std::vector<GlobalAlias *> Aliases;
+  for (GlobalVariable &GV : M.globals())
+    Globals.push_back(&GV);
+  for (Function &F : M)
+    Functions.push_back(&F);
+  for (GlobalAlias &GA : M.aliases())
+    Aliases.push_back(&GA);
+
+  for (GlobalVariable *GV : Globals) {
+    unsigned AS = mapNVPTXAddrSpace(GV->getAddressSpace());
+    // There are no generic variables, CUDA puts them in global memory.
+    unsigned VarAS = AS == SPIRAS_Generic ? unsigned(SPIRAS_Global) : AS;
+    auto *NewGV = new GlobalVariable(
+        M, TM.remapType(GV->getValueType()), GV->isConstant(), GV->getLinkage(),
+        nullptr, "", GV, GV->getThreadLocalMode(), VarAS,
+        GV->isExternallyInitialized());
+    NewGV->copyAttributesFrom(GV);
+    NewGV->copyMetadata(GV, 0);
+    Replaced.emplace_back(GV, NewGV);
+    VMap[GV] = VarAS == AS ? static_cast<Constant *>(NewGV)
+                            : ConstantExpr::getAddrSpaceCast(
+                                  NewGV, TM.remapType(GV->getType()));
+  }
+
+  for (Function *F : Functions) {
+    auto *FT = cast<FunctionType>(TM.remapType(F->getFunctionType()));
+    if (F->getCallingConv() == CallingConv::SPIR_KERNEL) {
+      SmallVector<Type *, 8> Params(FT->param_begin(), FT->param_end());
+      for (Type *&P : Params)
+        if (P->isPointerTy() && P->getPointerAddressSpace() == SPIRAS_Generic)
+          P = PointerType::get(P->getPointerElementType(), SPIRAS_Global);
+      FT = FunctionType::get(FT->getReturnType(), Params, FT->isVarArg());
+    }
+    Function *NewF = Function::Create(FT, F->getLinkage(), F->getAddressSpace(),
+                                      "", &M);
+    NewF->copyAttributesFrom(F);
+    Replaced.emplace_back(F, NewF);
+    VMap[F] = NewF;
+  }
+
+  for (GlobalAlias *GA : Aliases) {
+    auto *NewGA = GlobalAlias::create(
+        TM.remapType(GA->getValueType()),
+        mapNVPTXAddrSpace(GA->getAddressSpace()), GA->getLinkage(), "",
+        nullptr, &M);
+    NewGA->copyAttributesFrom(GA);
+    Replaced.emplace_back(GA, NewGA);
+    VMap[GA] = NewGA;
+  }
+
+  for (auto &R : Replaced) {
+    if (auto *GV = dyn_cast<GlobalVariable>(R.first)) {
+      if (GV->hasInitializer())
+        cast<GlobalVariable>(R.second)->setInitializer(
+            MapValue(GV->getInitializer(), VMap, RF_None, &TM));
+    } else if (auto *GA = dyn_cast<GlobalAlias>(R.first)) {
+      cast<GlobalAlias>(R.second)->setAliasee(
+          MapValue(GA->getAliasee(), VMap, RF_None, &TM));
+    }
+  }
+
+  for (auto &R : Replaced) {
+    auto *F = dyn_cast<Function>(R.first);
+    if (!F)
+      continue;
+    auto *NewF = cast<Function>(R.second);
+    if (F->isDeclaration()) {
+      NewF->copyMetadata(F, 0);
+      continue;
+    }
+
+    // Kernel pointer arguments are cast back to generic at the entry, the
+    // inference below removes the casts which are not needed.
+    SmallVector<Instruction *, 4> ArgCasts;
+    for (auto I = F->arg_begin(), NewI = NewF->arg_begin(), E = F->arg_end();
+         I != E; ++I, ++NewI) {
+      NewI->setName(I->getName());
+      Type *Ty = TM.remapType(I->getType());
+      if (NewI->getType() == Ty) {
+        VMap[&*I] = &*NewI;
+        continue;
+      }
+      auto *Cast = new AddrSpaceCastInst(&*NewI, Ty, I->getName() + ".gen");
+      ArgCasts.push_back(Cast);
+      VMap[&*I] = Cast;
+    }
+
+    // The subprogram is moved to the new function rather than cloned.
+    DISubprogram *SP = F->getSubprogram();
+    F->setSubprogram(nullptr);
+    SmallVector<ReturnInst *, 8> Returns;
+    CloneFunctionInto(NewF, F, VMap, /*ModuleLevelChanges=*/false, Returns, "",
+                      nullptr, &TM);
+    NewF->setSubprogram(SP);
+    NewF->setAttributes(F->getAttributes());
+
+    Instruction *InsertPt = &*NewF->getEntryBlock().getFirstInsertionPt();
+    for (Instruction *Cast : ArgCasts) {
+      if (Cast->use_empty())
+        Cast->deleteValue();
+      else
+        Cast->insertBefore(InsertPt);
+    }
+  }
+
+  // Named metadata such as !nvvm.annotations and !spirv.ExecutionMode refer
+  // to functions. Debug info does not refer to values and is kept as is.
+  for (NamedMDNode &NMD : M.named_metadata()) {
+    if (NMD.getName().startswith("llvm.dbg."))
+      continue;
+    for (unsigned I = 0, E = NMD.getNumOperands(); I != E; ++I)
+      NMD.setOperand(I, MapMetadata(NMD.getOperand(I), VMap, RF_None, &TM));
+  }
+
+  for (auto &R : Replaced)
+    R.first->dropAllReferences();
+  for (auto &R : Replaced) {
+    GlobalValue *Old = R.first;
+    std::string Name = Old->getName().str();
+    Old->replaceAllUsesWith(UndefValue::get(Old->getType()));
+    Old->eraseFromParent();
+    R.second->setName(Name);
+  }
+  TM.renameStructs();
+
+  // Overloaded intrinsics are mangled with the types of their pointers.
+  for (auto I = M.begin(), E = M.end(); I != E;) {
+    Function &F = *I++;
+    if (auto Remangled = Intrinsic::remangleIntrinsicFunction(&F)) {
+      F.replaceAllUsesWith(*Remangled);
+      F.eraseFromParent();
+    }
+  }
+}
+
+void SPIRVLowerNVPTXAddrSpace::fixAllocas(Function &F) {
+  unsigned AllocaAS = F.getParent()->getDataLayout().getAllocaAddrSpace();
+  SmallVector<AllocaInst *, 8> Allocas;
+  for (Instruction &I : instructions(F))
+    if (auto *AI = dyn_cast<AllocaInst>(&I))
+      if (AI->getType()->getAddressSpace() != AllocaAS)
+        Allocas.push_back(AI);
+
+  for (AllocaInst *AI : Allocas) {
+    auto *NewAI = new AllocaInst(AI->getAllocatedType(), AllocaAS,
+                                 AI->getArraySize(), "", AI);
+    NewAI->setAlignment(MaybeAlign(AI->getAlignment()));
+    NewAI->takeName(AI);
+    SmallVector<DbgVariableIntrinsic *, 1> DbgUsers;
+    findDbgUsers(DbgUsers, AI);
+    for (DbgVariableIntrinsic *DVI : DbgUsers)
+      DVI->setArgOperand(0, MetadataAsValue::get(AI->getContext(),
+                                                 ValueAsMetadata::get(NewAI)));
+    auto *Cast = new AddrSpaceCastInst(NewAI, AI->getType(), "", AI);
+    Cast->setDebugLoc(AI->getDebugLoc());
+    AI->replaceAllUsesWith(Cast);
+    AI->eraseFromParent();
+  }
+}
+
+static bool isGenericPointer(Type *Ty) {
+  return Ty->isPointerTy() && Ty->getPointerAddressSpace() == SPIRAS_Generic;
+}
+
+/// Instructions computing a generic pointer from another pointer, which can
+/// be rebuilt in a specific address space.
+static bool isAddressExpression(const Instruction &I) {
+  if (!isGenericPointer(I.getType()))
+    return false;
+  switch (I.getOpcode()) {
+  case Instruction::AddrSpaceCast:
+  case Instruction::GetElementPtr:
+  case Instruction::BitCast:
+  case Instruction::PHI:
+  case Instruction::Select:
+    return true;
+  default:
+    return false;
+  }
+}
+
+static unsigned joinAddrSpaces(unsigned A, unsigned B) {
+  if (A == UnknownAS)
+    return B;
+  if (B == UnknownAS || A == B)
+    return A;
+  return SPIRAS_Generic;
+}
+
+static unsigned getConstantAddrSpace(const Constant *C) {
+  if (!isGenericPointer(C->getType()))
+    return C->getType()->getPointerAddressSpace();
+  if (isa<ConstantPointerNull>(C) || isa<UndefValue>(C))
+    return UnknownAS;
+  if (auto *CE = dyn_cast<ConstantExpr>(C)) {
+    switch (CE->getOpcode()) {
+    case Instruction::AddrSpaceCast:
+    case Instruction::GetElementPtr:
+    case Instruction::BitCast:
+      return getConstantAddrSpace(CE->getOperand(0));
+    default:
+      break;
+    }
+  }
+  return SPIRAS_Generic;
+}
+
+/// Rebuild the generic pointer constant \p C in address space \p AS.
+static Constant *rebuildConstant(Constant *C, unsigned AS) {
+  auto *NewTy = PointerType::get(C->getType()->getPointerElementType(), AS);
+  if (!isGenericPointer(C->getType()))
+    return ConstantExpr::getBitCast(C, NewTy);
+  if (isa<ConstantPointerNull>(C))
+    return ConstantPointerNull::get(NewTy);
+  if (isa<UndefValue>(C))
+    return UndefValue::get(NewTy);
+  auto *CE = cast<ConstantExpr>(C);
+  Constant *Ptr = rebuildConstant(CE->getOperand(0), AS);
+  if (auto *GEP = dyn_cast<GEPOperator>(CE)) {
+    SmallVector<Constant *, 4> Indices;
+    for (unsigned I = 1, E = CE->getNumOperands(); I != E; ++I)
+      Indices.push_back(CE->getOperand(I));
+    return ConstantExpr::getGetElementPtr(GEP->getSourceElementType(), Ptr,
+                                          Indices, GEP->isInBounds());
+  }
+  return ConstantExpr::getBitCast(Ptr, NewTy);
+}
+
+/// Erase the instructions of \p Insts which are only used by each other.
+static void eraseUnusedInstructions(ArrayRef<Instruction *> Insts) {
+  SmallPtrSet<Instruction *, 16> Set(Insts.begin(), Insts.end());
+  SmallPtrSet<Instruction *, 16> Live;
+  SmallVector<Instruction *, 16> Worklist;
+  for (Instruction *I : Insts)
+    for (User *U : I->users())
+      if (!Set.count(cast<Instruction>(U))) {
+        Worklist.push_back(I);
+        break;
+      }
+  while (!Worklist.empty()) {
+    Instruction *I = Worklist.pop_back_val();
+    if (!Live.insert(I).second)
+      continue;
+    for (Value *Op : I->operands())
+      if (auto *OpI = dyn_cast<Instruction>(Op))
+        if (Set.count(OpI))
+          Worklist.push_back(OpI);
+  }
+  SmallVector<Instruction *, 16> Dead;
+  for (Instruction *I : Insts)
+    if (!Live.count(I))
+      Dead.push_back(I);
+  for (Instruction *I : Dead)
+    I->dropAllReferences();
+  for (Instruction *I : Dead)
+    I->eraseFromParent();
+}
+
+void SPIRVLowerNVPTXAddrSpace::inferAddressSpaces(Function &F) {
+  ReversePostOrderTraversal<Function *> RPOT(&F);
+  std::vector<Instruction *> Exprs;
+  DenseMap<Value *, unsigned> InferredAS;
+  for (BasicBlock *BB : RPOT)
+    for (Instruction &I : *BB)
+      if (isAddressExpression(I)) {
+        Exprs.push_back(&I);
+        InferredAS[&I] = UnknownAS;
+      }
+  if (Exprs.empty())
+    return;
+
+  auto GetAS = [&](Value *V) -> unsigned {
+    if (!isGenericPointer(V->getType()))
+      return V->getType()->getPointerAddressSpace();
+    auto Loc = InferredAS.find(V);
+    if (Loc != InferredAS.end())
+      return Loc->second;
+    if (auto *C = dyn_cast<Constant>(V))
+      return getConstantAddrSpace(C);
+    return SPIRAS_Generic;
+  };
+  auto Transfer = [&](Instruction *I) -> unsigned {
+    switch (I->getOpcode()) {
+    case Instruction::PHI: {
+      unsigned AS = UnknownAS;
+      for (Value *In : cast<PHINode>(I)->incoming_values())
+        AS = joinAddrSpaces(AS, GetAS(In));
+      return AS;
+    }
+    case Instruction::Select:
+      return joinAddrSpaces(GetAS(I->getOperand(1)), GetAS(I->getOperand(2)));
+    default:
+      return GetAS(I->getOperand(0));
+    }
+  };
+
+  // Solve to a fixed point, then give up on the pointers which are still
+  // unknown, such as cycles of PHIs without any other incoming pointer.
+  SetVector<Instruction *> Worklist;
+  Worklist.insert(Exprs.begin(), Exprs.end());
+  while (true) {
+    while (!Worklist.empty()) {
+      Instruction *I = Worklist.pop_back_val();
+      unsigned AS = Transfer(I);
+      if (AS == InferredAS[I])
+        continue;
+      InferredAS[I] = AS;
+      for (User *U : I->users())
+        if (InferredAS.count(U))
+          Worklist.insert(cast<Instruction>(U));
+    }
+    for (Instruction *I : Exprs)
+      if (InferredAS[I] == UnknownAS) {
+        InferredAS[I] = SPIRAS_Generic;
+        for (User *U : I->users())
+          if (InferredAS.count(U))
+            Worklist.insert(cast<Instruction>(U));
+      }
+    if (Worklist.empty())
+      break;
+  }
+
+  // Rebuild the pointers in their address space. Instructions are visited in
+  // reverse post order, so operands other than incoming values of PHIs are
+  // rebuilt before their users.
+  DenseMap<Value *, Value *> Rebuilt;
+  std::vector<Instruction *> OldInsts;
+  std::vector<Instruction *> NewInsts;
+  auto GetRebuilt = [&](Value *V, unsigned AS) -> Value * {
+    auto Loc = Rebuilt.find(V);
+    if (Loc != Rebuilt.end())
+      return Loc->second;
+    return rebuildConstant(cast<Constant>(V), AS);
+  };
+  for (Instruction *I : Exprs) {
+    unsigned AS = InferredAS[I];
+    if (AS == SPIRAS_Generic)
+      continue;
+    auto *NewTy = PointerType::get(I->getType()->getPointerElementType(), AS);
+    IRBuilder<> Builder(I);
+    Value *New = nullptr;
+    // Casts of a pointer to its own type fold to the pointer.
+    Value *Src = nullptr;
+    switch (I->getOpcode()) {
+    case Instruction::PHI:
+      New = Builder.CreatePHI(NewTy, cast<PHINode>(I)->getNumIncomingValues());
+      break;
+    case Instruction::Select:
+      New = Builder.CreateSelect(I->getOperand(0),
+                                 GetRebuilt(I->getOperand(1), AS),
+                                 GetRebuilt(I->getOperand(2), AS));
+      break;
+    case Instruction::GetElementPtr: {
+      auto *GEP = cast<GetElementPtrInst>(I);
+      SmallVector<Value *, 4> Indices(GEP->idx_begin(), GEP->idx_end());
+      Value *Ptr = GetRebuilt(GEP->getPointerOperand(), AS);
+      New = GEP->isInBounds()
+                ? Builder.CreateInBoundsGEP(GEP->getSourceElementType(), Ptr,
+                                            Indices)
+                : Builder.CreateGEP(GEP->getSourceElementType(), Ptr, Indices);
+      break;
+    }
+    case Instruction::AddrSpaceCast:
+      if (!isGenericPointer(I->getOperand(0)->getType())) {
+        Src = I->getOperand(0);
+        New = Builder.CreateBitCast(Src, NewTy);
+        break;
+      }
+      LLVM_FALLTHROUGH;
+    default:
+      Src = GetRebuilt(I->getOperand(0), AS);
+      New = Builder.CreateBitCast(Src, NewTy);
+      break;
+    }
+    Rebuilt[I] = New;
+    OldInsts.push_back(I);
+    auto *NewI = dyn_cast<Instruction>(New);
+    if (NewI && New != Src) {
+      NewI->takeName(I);
+      NewI->setDebugLoc(I->getDebugLoc());
+      NewInsts.push_back(NewI);
+    }
+  }
+  if (OldInsts.empty())
+    return;
+
+  for (Instruction *I : OldInsts) {
+    auto *Phi = dyn_cast<PHINode>(I);
+    if (!Phi)
+      continue;
+    auto *NewPhi = cast<PHINode>(Rebuilt[I]);
+    unsigned AS = NewPhi->getType()->getPointerAddressSpace();
+    for (unsigned J = 0, E = Phi->getNumIncomingValues(); J != E; ++J)
+      NewPhi->addIncoming(GetRebuilt(Phi->getIncomingValue(J), AS),
+                          Phi->getIncomingBlock(J));
+  }
+
+  // Memory accesses use the rebuilt pointers. Other users, such as calls,
+  // keep the generic pointer.
+  for (Instruction *I : OldInsts) {
+    Value *New = Rebuilt[I];
+    for (auto UI = I->use_begin(), UE = I->use_end(); UI != UE;) {
+      Use &U = *UI++;
+      User *Usr = U.getUser();
+      if ((isa<LoadInst>(Usr) &&
+           U.getOperandNo() == LoadInst::getPointerOperandIndex()) ||
+          (isa<StoreInst>(Usr) &&
+           U.getOperandNo() == StoreInst::getPointerOperandIndex()) ||
+          (isa<AtomicRMWInst>(Usr) &&
+           U.getOperandNo() == AtomicRMWInst::getPointerOperandIndex()) ||
+          (isa<AtomicCmpXchgInst>(Usr) &&
+           U.getOperandNo() == AtomicCmpXchgInst::getPointerOperandIndex()))
+        U.set(New);
+    }
+  }
+
+  eraseUnusedInstructions(OldInsts);
+  eraseUnusedInstructions(NewInsts);
+}
+
+} // namespace SPIRV
+
+INITIALIZE_PASS(SPIRVLowerNVPTXAddrSpace, "spvnvptxaddrspace",
+                "Map NVPTX address spaces to SPIR and infer generic pointers",
+                false, false)
+
+ModulePass *llvm::createSPIRVLowerNVPTXAddrSpace() {
+  return new SPIRVLowerNVPTXAddrSpace();
+}
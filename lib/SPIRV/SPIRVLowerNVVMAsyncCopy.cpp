@@ -0,0 +1,572 @@
+//===- SPIRVLowerNVVMAsyncCopy.cpp - Lower cp.async to group copies -------===//
+//
+//                     The LLVM/SPIRV Translator
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+// Copyright (c) 2014 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimers.
+// Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimers in the documentation
+// and/or other materials provided with the distribution.
+// Neither the names of Advanced Micro Devices, Inc., nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// Software without specific prior written permission.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH
+// THE SOFTWARE.
+//
+//
+// This file implements lowering of the NVVM cp.async intrinsics, which copy
+// global memory to shared memory asynchronously, to the OpenCL
+// async_work_group_copy and wait_group_events built-ins. OCL20ToSPIRV then
+// translates them to OpGroupAsyncCopy and OpGroupWaitEvents.
+//
+// cp.async copies are issued by every thread for its own part of a tile, while
+// an async work group copy is issued by the whole work group for a range of
+// elements. A copy is turned into a work group copy when its source and
+// destination are the same uniform base plus the x local id times the copy
+// size, and the function has uniform control flow. The copy then covers the
+// tile of all the threads with local size x elements.
+//
+// Copies are only turned into work group copies in kernels which call no
+// function issuing, committing or waiting for copies. The events of such a
+// kernel are then all committed and waited in the kernel itself, and the
+// whole work group is known to reach its uniform control flow.
+//
+// The copies issued between two cp.async.commit.group are chained to a single
+// event. Committed events are kept in a ring buffer with one slot per group
+// which cp.async.wait.group may leave pending, so that a software pipeline
+// still overlaps its copies with computation.
+//
+// The other copies are done synchronously, in which case committing and
+// waiting have nothing to do.
+//
+//===----------------------------------------------------------------------===//
+#include "OCLUtil.h"
+#include "SPIRVInternal.h"
+#include "llvm/Analysis/ConstantFolding.h"
+#include "llvm/IR/GetElementPtrTypeIterator.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Pass.h"
+#include "llvm/PassSupport.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+
+#define DEBUG_TYPE "spvnvvmasynccopy"
+
+using namespace llvm;
+using namespace SPIRV;
+using namespace OCLUtil;
+
+namespace SPIRV {
+cl::opt<bool> SPIRVLowerNVVMAsyncCopyValidate(
+    "spvnvvmasynccopy-validate",
+    cl::desc("Validate module after lowering NVVM cp.async intrinsics to "
+             "async work group copies"));
+
+enum class AsyncCopyKind { None, Copy, Commit, Wait, WaitAll };
+
+/// \returns the kind of the cp.async intrinsic \p F, and the number of bytes
+/// it copies in \p Size.
+static AsyncCopyKind getAsyncCopyKind(Function *F, unsigned &Size) {
+  StringRef Name = F->getName();
+  if (!Name.consume_front(kNVVMName::CpAsyncPrefix))
+    return AsyncCopyKind::None;
+  if (Name == "commit.group")
+    return AsyncCopyKind::Commit;
+  if (Name == "wait.group")
+    return AsyncCopyKind::Wait;
+  if (Name == "wait.all")
+    return AsyncCopyKind::WaitAll;
+  // The .s forms with a source size and the mbarrier forms are not lowered.
+  if ((Name.consume_front("ca.shared.global.") ||
+       Name.consume_front("cg.shared.global.")) &&
+      !Name.getAsInteger(10, Size) && (Size == 4 || Size == 8 || Size == 16))
+    return AsyncCopyKind::Copy;
+  return AsyncCopyKind::None;
+}
+
+static bool isSReg(Value *V, StringRef Reg) {
+  auto *CI = dyn_cast<CallInst>(V);
+  Function *F = CI ? CI->getCalledFunction() : nullptr;
+  if (!F)
+    return false;
+  StringRef Name = F->getName();
+  return Name.consume_front(kNVVMName::SRegPrefix) && Name.startswith(Reg);
+}
+
+/// \returns true if \p V reads a special register which has the same value
+/// in every work-item of a work group.
+static bool isUniformSReg(Value *V) {
+  return isSReg(V, "ntid.") || isSReg(V, "ctaid.") || isSReg(V, "nctaid.");
+}
+
+class SPIRVLowerNVVMAsyncCopy : public ModulePass {
+public:
+  SPIRVLowerNVVMAsyncCopy()
+      : ModulePass(ID), M(nullptr), EventTy(nullptr), NumSlots(0),
+        CurEvent(nullptr), HasCurEvent(nullptr), Events(nullptr),
+        Pending(nullptr), Head(nullptr) {
+    initializeSPIRVLowerNVVMAsyncCopyPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnModule(Module &M) override;
+
+  static char ID;
+
+private:
+  /// Find the functions which issue, commit or wait for copies, directly or
+  /// through the functions they call.
+  void findAsyncCopyUsers();
+  /// \returns true if the copies of \p F may become work group copies, i.e.
+  /// \p F is a kernel and the functions it calls do not use cp.async.
+  bool isSelfContained(Function &F);
+  bool lowerFunction(Function &F);
+  /// Find the values of \p F which may differ between the work-items of a
+  /// work group.
+  void findDivergentValues(Function &F);
+  bool hasUniformControlFlow(Function &F);
+  /// Get the factor of the x local id in \p V, in bytes if \p V is a
+  /// pointer. \returns false if \p V is not an affine function of it.
+  bool getLocalIdScale(Value *V, int64_t &Scale);
+  /// \returns \p V as computed by the work-item with a x local id of 0.
+  Value *getFirstWorkItemValue(Value *V, Instruction *InsertBefore);
+
+  void lowerToGroupCopy(CallInst *CI, unsigned Size);
+  void lowerToCopy(CallInst *CI, unsigned Size);
+  /// Create the ring buffer of events at the beginning of \p F.
+  void addEventQueue(Function &F, unsigned Slots);
+  void addCommit(Instruction *InsertBefore);
+  /// Wait for the committed groups except the \p Pending most recent ones.
+  void addWait(unsigned Pending, Instruction *InsertBefore);
+  void addWaitSlot(Value *Slot, Instruction *InsertBefore);
+  CallInst *addOCLCall(StringRef Name, Type *RetTy, ArrayRef<Value *> Args,
+                       Instruction *InsertBefore);
+
+  Module *M;
+  Type *EventTy;
+  DenseSet<Value *> Divergent;
+  DenseSet<Function *> AsyncCopyUsers;
+  /// Event queue of the current function.
+  unsigned NumSlots;
+  AllocaInst *CurEvent;
+  AllocaInst *HasCurEvent;
+  AllocaInst *Events;
+  AllocaInst *Pending;
+  AllocaInst *Head;
+};
+
+char SPIRVLowerNVVMAsyncCopy::ID = 0;
+
+bool SPIRVLowerNVVMAsyncCopy::runOnModule(Module &Module) {
+  M = &Module;
+  EventTy = getOrCreateOpaquePtrType(M, SPIR_TYPE_NAME_EVENT_T,
+                                     SPIRAS_Private);
+  findAsyncCopyUsers();
+  bool Changed = false;
+  for (Function &F : Module)
+    if (!F.isDeclaration())
+      Changed |= lowerFunction(F);
+  if (!Changed)
+    return false;
+
+  for (Function &F : make_early_inc_range(Module)) {
+    unsigned Size = 0;
+    if (F.isDeclaration() && F.use_empty() &&
+        getAsyncCopyKind(&F, Size) != AsyncCopyKind::None)
+      F.eraseFromParent();
+  }
+
+  if (SPIRVLowerNVVMAsyncCopyValidate) {
+    LLVM_DEBUG(dbgs() << "After SPIRVLowerNVVMAsyncCopy:\n" << Module);
+    std::string Err;
+    raw_string_ostream ErrorOS(Err);
+    if (verifyModule(Module, &ErrorOS)) {
+      Err = std::string("Fails to verify module: ") + Err;
+      report_fatal_error(Err.c_str(), false);
+    }
+  }
+  return true;
+}
+
+void SPIRVLowerNVVMAsyncCopy::findAsyncCopyUsers() {
+  AsyncCopyUsers.clear();
+  SmallVector<Function *, 8> Worklist;
+  for (Function &F : *M) {
+    unsigned Size = 0;
+    if (F.isDeclaration() && getAsyncCopyKind(&F, Size) != AsyncCopyKind::None)
+      Worklist.push_back(&F);
+  }
+  while (!Worklist.empty()) {
+    Function *F = Worklist.pop_back_val();
+    for (User *U : F->users()) {
+      auto *CI = dyn_cast<CallInst>(U);
+      if (CI && CI->getCalledFunction() == F &&
+          AsyncCopyUsers.insert(CI->getFunction()).second)
+        Worklist.push_back(CI->getFunction());
+    }
+  }
+}
+
+bool SPIRVLowerNVVMAsyncCopy::isSelfContained(Function &F) {
+  if (F.getCallingConv() != CallingConv::SPIR_KERNEL)
+    return false;
+  for (Instruction &I : instructions(F)) {
+    auto *CI = dyn_cast<CallInst>(&I);
+    if (!CI)
+      continue;
+    Function *Callee = CI->getCalledFunction();
+    // An indirect call may reach a function using cp.async.
+    if (!Callee) {
+      if (!CI->isInlineAsm())
+        return false;
+      continue;
+    }
+    if (!Callee->isDeclaration() && AsyncCopyUsers.count(Callee))
+      return false;
+  }
+  return true;
+}
+
+bool SPIRVLowerNVVMAsyncCopy::lowerFunction(Function &F) {
+  std::vector<std::pair<CallInst *, unsigned>> Copies;
+  std::vector<std::pair<CallInst *, AsyncCopyKind>> Syncs;
+  std::vector<ReturnInst *> Returns;
+  unsigned MaxPending = 0;
+  for (Instruction &I : instructions(F)) {
+    if (auto *RI = dyn_cast<ReturnInst>(&I))
+      Returns.push_back(RI);
+    auto *CI = dyn_cast<CallInst>(&I);
+    if (!CI || !CI->getCalledFunction())
+      continue;
+    unsigned Size = 0;
+    AsyncCopyKind Kind = getAsyncCopyKind(CI->getCalledFunction(), Size);
+    if (Kind == AsyncCopyKind::Copy) {
+      Copies.push_back({CI, Size});
+      continue;
+    }
+    if (Kind == AsyncCopyKind::Wait) {
+      auto *N = dyn_cast<ConstantInt>(CI->getArgOperand(0));
+      if (!N)
+        return false;
+      MaxPending = std::max<unsigned>(MaxPending, N->getZExtValue());
+    }
+    if (Kind != AsyncCopyKind::None)
+      Syncs.push_back({CI, Kind});
+  }
+  if (Copies.empty() && Syncs.empty())
+    return false;
+
+  // The other copies are done synchronously, so that the commits and waits of
+  // any function have nothing left to do for them.
+  bool CanGroup = !Copies.empty() && isSelfContained(F);
+  if (CanGroup) {
+    findDivergentValues(F);
+    CanGroup = hasUniformControlFlow(F);
+  }
+  std::vector<std::pair<CallInst *, unsigned>> GroupCopies;
+  for (auto &C : Copies) {
+    int64_t DstScale = 0;
+    int64_t SrcScale = 0;
+    if (CanGroup && getLocalIdScale(C.first->getArgOperand(0), DstScale) &&
+        getLocalIdScale(C.first->getArgOperand(1), SrcScale) &&
+        DstScale == C.second && SrcScale == C.second)
+      GroupCopies.push_back(C);
+    else
+      lowerToCopy(C.first, C.second);
+  }
+
+  if (!GroupCopies.empty()) {
+    addEventQueue(F, MaxPending + 1);
+    for (auto &C : GroupCopies)
+      lowerToGroupCopy(C.first, C.second);
+    for (auto &S : Syncs) {
+      if (S.second == AsyncCopyKind::Commit ||
+          S.second == AsyncCopyKind::WaitAll)
+        addCommit(S.first);
+      if (S.second == AsyncCopyKind::Wait)
+        addWait(cast<ConstantInt>(S.first->getArgOperand(0))->getZExtValue(),
+                S.first);
+      if (S.second == AsyncCopyKind::WaitAll)
+        addWait(0, S.first);
+    }
+    // Copies still in flight are completed before the kernel exits.
+    for (ReturnInst *RI : Returns) {
+      addCommit(RI);
+      addWait(0, RI);
+    }
+  }
+  for (auto &S : Syncs)
+    S.first->eraseFromParent();
+  return true;
+}
+
+void SPIRVLowerNVVMAsyncCopy::findDivergentValues(Function &F) {
+  Divergent.clear();
+  SmallVector<Value *, 16> Worklist;
+  if (F.getCallingConv() != CallingConv::SPIR_KERNEL)
+    for (Argument &Arg : F.args())
+      Worklist.push_back(&Arg);
+  for (Instruction &I : instructions(F))
+    if (isa<LoadInst>(I) || isa<AllocaInst>(I) || isa<AtomicRMWInst>(I) ||
+        isa<AtomicCmpXchgInst>(I) || (isa<CallInst>(I) && !isUniformSReg(&I)))
+      Worklist.push_back(&I);
+  while (!Worklist.empty()) {
+    Value *V = Worklist.pop_back_val();
+    if (!Divergent.insert(V).second)
+      continue;
+    for (User *U : V->users())
+      if (isa<Instruction>(U))
+        Worklist.push_back(U);
+  }
+}
+
+bool SPIRVLowerNVVMAsyncCopy::hasUniformControlFlow(Function &F) {
+  for (BasicBlock &BB : F) {
+    Instruction *Term = BB.getTerminator();
+    if (auto *BI = dyn_cast<BranchInst>(Term)) {
+      if (BI->isConditional() && Divergent.count(BI->getCondition()))
+        return false;
+    } else if (auto *SI = dyn_cast<SwitchInst>(Term)) {
+      if (Divergent.count(SI->getCondition()))
+        return false;
+    } else if (Term->getNumSuccessors()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool SPIRVLowerNVVMAsyncCopy::getLocalIdScale(Value *V, int64_t &Scale) {
+  Scale = 0;
+  if (!Divergent.count(V))
+    return true;
+  if (isSReg(V, "tid.x")) {
+    Scale = 1;
+    return true;
+  }
+  auto *I = dyn_cast<Instruction>(V);
+  if (!I)
+    return false;
+  int64_t LHS = 0;
+  int64_t RHS = 0;
+  switch (I->getOpcode()) {
+  case Instruction::ZExt:
+  case Instruction::SExt:
+  case Instruction::Trunc:
+  case Instruction::BitCast:
+  case Instruction::AddrSpaceCast:
+    return getLocalIdScale(I->getOperand(0), Scale);
+  case Instruction::Add:
+  case Instruction::Sub:
+    if (!getLocalIdScale(I->getOperand(0), LHS) ||
+        !getLocalIdScale(I->getOperand(1), RHS))
+      return false;
+    Scale = I->getOpcode() == Instruction::Add ? LHS + RHS : LHS - RHS;
+    return true;
+  case Instruction::Mul:
+  case Instruction::Shl: {
+    auto *C = dyn_cast<ConstantInt>(I->getOperand(1));
+    if (!C || !getLocalIdScale(I->getOperand(0), LHS))
+      return false;
+    Scale = I->getOpcode() == Instruction::Mul ? LHS * C->getSExtValue()
+                                               : LHS << C->getZExtValue();
+    return true;
+  }
+  case Instruction::GetElementPtr: {
+    auto *GEP = cast<GetElementPtrInst>(I);
+    if (!getLocalIdScale(GEP->getPointerOperand(), Scale))
+      return false;
+    const DataLayout &DL = M->getDataLayout();
+    for (auto GTI = gep_type_begin(GEP), E = gep_type_end(GEP); GTI != E;
+         ++GTI) {
+      // Structure field indices are constants.
+      if (GTI.isStruct())
+        continue;
+      int64_t IdxScale = 0;
+      if (!getLocalIdScale(GTI.getOperand(), IdxScale))
+        return false;
+      Scale += IdxScale * DL.getTypeAllocSize(GTI.getIndexedType());
+    }
+    return true;
+  }
+  default:
+    return false;
+  }
+}
+
+Value *SPIRVLowerNVVMAsyncCopy::getFirstWorkItemValue(
+    Value *V, Instruction *InsertBefore) {
+  if (!Divergent.count(V))
+    return V;
+  if (isSReg(V, "tid.x"))
+    return Constant::getNullValue(V->getType());
+  Instruction *Clone = cast<Instruction>(V)->clone();
+  for (Use &Op : Clone->operands())
+    Op.set(getFirstWorkItemValue(Op.get(), InsertBefore));
+  if (Constant *C = ConstantFoldInstruction(Clone, M->getDataLayout())) {
+    Clone->deleteValue();
+    return C;
+  }
+  Clone->insertBefore(InsertBefore);
+  return Clone;
+}
+
+/// \returns the type copied as a whole by a cp.async of \p Size bytes.
+static Type *getCopyType(LLVMContext &Ctx, unsigned Size) {
+  Type *Int32Ty = Type::getInt32Ty(Ctx);
+  return Size == 4 ? Int32Ty : VectorType::get(Int32Ty, Size / 4);
+}
+
+void SPIRVLowerNVVMAsyncCopy::lowerToGroupCopy(CallInst *CI, unsigned Size) {
+  Type *EltTy = getCopyType(M->getContext(), Size);
+  Value *Dst = getFirstWorkItemValue(CI->getArgOperand(0), CI);
+  Value *Src = getFirstWorkItemValue(CI->getArgOperand(1), CI);
+  IRBuilder<> Builder(CI);
+  Dst = Builder.CreatePointerCast(
+      Dst, PointerType::get(EltTy, Dst->getType()->getPointerAddressSpace()));
+  Src = Builder.CreatePointerCast(
+      Src, PointerType::get(EltTy, Src->getType()->getPointerAddressSpace()));
+  FunctionCallee LocalSize = M->getOrInsertFunction(
+      std::string(kNVVMName::SRegPrefix) + "ntid.x",
+      Type::getInt32Ty(M->getContext()));
+  Value *NumElts = Builder.CreateZExtOrTrunc(Builder.CreateCall(LocalSize),
+                                             getSizetType(M));
+  Value *Event = addOCLCall(
+      kOCLBuiltinName::AsyncWorkGroupCopy, EventTy,
+      {Dst, Src, NumElts, Builder.CreateLoad(EventTy, CurEvent)}, CI);
+  Builder.CreateStore(Event, CurEvent);
+  Builder.CreateStore(getInt32(M, 1), HasCurEvent);
+  CI->eraseFromParent();
+}
+
+void SPIRVLowerNVVMAsyncCopy::lowerToCopy(CallInst *CI, unsigned Size) {
+  Type *EltTy = getCopyType(M->getContext(), Size);
+  Value *Dst = CI->getArgOperand(0);
+  Value *Src = CI->getArgOperand(1);
+  IRBuilder<> Builder(CI);
+  Dst = Builder.CreatePointerCast(
+      Dst, PointerType::get(EltTy, Dst->getType()->getPointerAddressSpace()));
+  Src = Builder.CreatePointerCast(
+      Src, PointerType::get(EltTy, Src->getType()->getPointerAddressSpace()));
+  // cp.async requires both addresses to be aligned to the copy size.
+  Builder.CreateAlignedStore(
+      Builder.CreateAlignedLoad(EltTy, Src, MaybeAlign(Size)), Dst,
+      MaybeAlign(Size));
+  CI->eraseFromParent();
+}
+
+void SPIRVLowerNVVMAsyncCopy::addEventQueue(Function &F, unsigned Slots) {
+  NumSlots = Slots;
+  Type *Int32Ty = Type::getInt32Ty(M->getContext());
+  IRBuilder<> Builder(&*F.getEntryBlock().getFirstInsertionPt());
+  CurEvent = Builder.CreateAlloca(EventTy, nullptr, "async.event");
+  HasCurEvent = Builder.CreateAlloca(Int32Ty, nullptr, "async.has.event");
+  Events = Builder.CreateAlloca(ArrayType::get(EventTy, NumSlots), nullptr,
+                                "async.events");
+  Pending = Builder.CreateAlloca(ArrayType::get(Int32Ty, NumSlots), nullptr,
+                                 "async.pending");
+  Head = Builder.CreateAlloca(Int32Ty, nullptr, "async.head");
+  Builder.CreateStore(Constant::getNullValue(EventTy), CurEvent);
+  Builder.CreateStore(getInt32(M, 0), HasCurEvent);
+  Builder.CreateStore(getInt32(M, 0), Head);
+  for (unsigned I = 0; I != NumSlots; ++I)
+    Builder.CreateStore(getInt32(M, 0),
+                        Builder.CreateConstInBoundsGEP2_32(
+                            Pending->getAllocatedType(), Pending, 0, I));
+}
+
+void SPIRVLowerNVVMAsyncCopy::addCommit(Instruction *InsertBefore) {
+  Type *Int32Ty = Type::getInt32Ty(M->getContext());
+  IRBuilder<> Builder(InsertBefore);
+  Value *Count = Builder.CreateLoad(Int32Ty, Head);
+  Value *Slot = Builder.CreateURem(Count, getInt32(M, NumSlots));
+  // The oldest group is completed if every slot is in use.
+  addWaitSlot(Slot, InsertBefore);
+  Builder.SetInsertPoint(InsertBefore);
+  Value *Zero = getInt32(M, 0);
+  Builder.CreateStore(
+      Builder.CreateLoad(EventTy, CurEvent),
+      Builder.CreateInBoundsGEP(Events->getAllocatedType(), Events,
+                                {Zero, Slot}));
+  Builder.CreateStore(
+      Builder.CreateLoad(Int32Ty, HasCurEvent),
+      Builder.CreateInBoundsGEP(Pending->getAllocatedType(), Pending,
+                                {Zero, Slot}));
+  Builder.CreateStore(Constant::getNullValue(EventTy), CurEvent);
+  Builder.CreateStore(Zero, HasCurEvent);
+  Builder.CreateStore(Builder.CreateAdd(Count, getInt32(M, 1)), Head);
+}
+
+void SPIRVLowerNVVMAsyncCopy::addWait(unsigned NumPending,
+                                      Instruction *InsertBefore) {
+  Type *Int32Ty = Type::getInt32Ty(M->getContext());
+  // The group committed I groups before the last one is in slot
+  // (Head - 1 - I) mod NumSlots.
+  for (unsigned I = NumSlots; I-- > NumPending;) {
+    IRBuilder<> Builder(InsertBefore);
+    Value *Slot = Builder.CreateURem(
+        Builder.CreateAdd(Builder.CreateLoad(Int32Ty, Head),
+                          getInt32(M, NumSlots - 1 - I)),
+        getInt32(M, NumSlots));
+    addWaitSlot(Slot, InsertBefore);
+  }
+}
+
+void SPIRVLowerNVVMAsyncCopy::addWaitSlot(Value *Slot,
+                                          Instruction *InsertBefore) {
+  Type *Int32Ty = Type::getInt32Ty(M->getContext());
+  Value *Zero = getInt32(M, 0);
+  IRBuilder<> Builder(InsertBefore);
+  Value *Flag = Builder.CreateInBoundsGEP(Pending->getAllocatedType(),
+                                          Pending, {Zero, Slot});
+  Value *IsPending = Builder.CreateICmpNE(Builder.CreateLoad(Int32Ty, Flag),
+                                          Zero);
+  // The condition is uniform since the work group issues every copy.
+  Instruction *Then = SplitBlockAndInsertIfThen(IsPending, InsertBefore,
+                                                false);
+  Builder.SetInsertPoint(Then);
+  Value *Event = Builder.CreateInBoundsGEP(Events->getAllocatedType(), Events,
+                                           {Zero, Slot});
+  addOCLCall(kOCLBuiltinName::WaitGroupEvent,
+             Type::getVoidTy(M->getContext()), {getInt32(M, 1), Event}, Then);
+  Builder.CreateStore(Zero, Flag);
+}
+
+CallInst *SPIRVLowerNVVMAsyncCopy::addOCLCall(StringRef Name, Type *RetTy,
+                                              ArrayRef<Value *> Args,
+                                              Instruction *InsertBefore) {
+  std::string MangledName;
+  mangleOpenClBuiltin(Name.str(), getTypes(Args), MangledName);
+  return addCallInst(M, MangledName, RetTy, Args, nullptr, InsertBefore);
+}
+
+} // namespace SPIRV
+
+INITIALIZE_PASS(SPIRVLowerNVVMAsyncCopy, "spvnvvmasynccopy",
+                "Lower NVVM cp.async intrinsics to async work group copies",
+                false, false)
+
+ModulePass *llvm::createSPIRVLowerNVVMAsyncCopy() {
+  return new SPIRVLowerNVVMAsyncCopy();
+}
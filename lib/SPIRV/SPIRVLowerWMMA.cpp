@@ -0,0 +1,578 @@
+//===- SPIRVLowerWMMA.cpp - Lower WMMA intrinsics to joint matrices -------===//
+//
+//                     The LLVM/SPIRV Translator
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+// Copyright (c) 2014 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimers.
+// Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimers in the documentation
+// and/or other materials provided with the distribution.
+// Neither the names of Advanced Micro Devices, Inc., nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// Software without specific prior written permission.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH
+// THE SOFTWARE.
+//
+//
+// This file implements lowering of the llvm.nvvm.wmma.* fragment intrinsics
+// of a CUDA module to SPV_INTEL_joint_matrix operations.
+//
+// NVPTX represents a WMMA fragment as the struct of registers one thread
+// holds, while a joint matrix is an opaque value owned by the whole subgroup.
+// Fragment loads, stores and multiply-adds are rewritten to
+// __spirv_JointMatrix*INTEL calls on spirv.JointMatrixINTEL values, and the
+// registers flowing between them through extractvalue and phi nodes are
+// replaced by matrices. A fragment whose registers all hold the same value is
+// built with __spirv_CompositeConstruct. Pointers keep their address space,
+// so fragments may live in global, local or generic memory.
+//
+// A function whose fragments cannot be rebuilt this way, for instance because
+// their registers are used by element-wise arithmetic, is reported as an
+// error, since its WMMA intrinsics have no other SPIR-V counterpart.
+//
+//===----------------------------------------------------------------------===//
+#include "SPIRVInternal.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/Analysis/VectorUtils.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Operator.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Pass.h"
+#include "llvm/PassSupport.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+
+#include <map>
+
+#define DEBUG_TYPE "spvwmma"
+
+using namespace llvm;
+using namespace SPIRV;
+
+namespace SPIRV {
+cl::opt<bool> SPIRVLowerWMMAValidate(
+    "spvwmma-validate",
+    cl::desc("Validate module after lowering WMMA intrinsics to joint "
+             "matrix operations"));
+
+/// Layout of a joint matrix, either in memory or in its type.
+enum JointMatrixLayout { RowMajor = 0, ColumnMajor = 1 };
+
+/// Operation and shape encoded in the name of a llvm.nvvm.wmma.* intrinsic.
+struct WMMAIntrinsicInfo {
+  enum KindTy { Load, Store, MMA } Kind;
+  /// Fragment a, b, c or d accessed by a load or a store, d for an MMA.
+  char Frag;
+  unsigned M;
+  unsigned N;
+  unsigned K;
+  /// Layout of the fragment of a load or a store, or of the A and B
+  /// fragments of an MMA.
+  bool ColMajor[2];
+  bool HasStride;
+  /// Whether the fragment holds float rather than half elements. For an MMA
+  /// this describes the C and D fragments.
+  bool IsF32;
+
+  /// \returns the layout of the type of fragment \p F. The accumulator is
+  /// always row major, A and B follow the layout they are used with.
+  unsigned getTypeLayout(char F) const {
+    if (F == 'c' || F == 'd')
+      return RowMajor;
+    bool Col = Kind == MMA ? ColMajor[F == 'b'] : ColMajor[0];
+    return Col ? ColumnMajor : RowMajor;
+  }
+};
+
+static bool parseGeometry(StringRef Geom, WMMAIntrinsicInfo &Info) {
+  if (!Geom.consume_front("m") || Geom.consumeInteger(10, Info.M) ||
+      !Geom.consume_front("n") || Geom.consumeInteger(10, Info.N) ||
+      !Geom.consume_front("k") || Geom.consumeInteger(10, Info.K) ||
+      !Geom.empty())
+    return false;
+  // Only the half precision geometries are mapped.
+  return Info.K == 16 && ((Info.M == 16 && Info.N == 16) ||
+                          (Info.M == 32 && Info.N == 8) ||
+                          (Info.M == 8 && Info.N == 32));
+}
+
+static bool parseLayout(StringRef Layout, bool &ColMajor) {
+  if (Layout != "row" && Layout != "col")
+    return false;
+  ColMajor = Layout == "col";
+  return true;
+}
+
+static bool parseElementType(StringRef Ty, bool &IsF32) {
+  if (Ty != "f16" && Ty != "f32")
+    return false;
+  IsF32 = Ty == "f32";
+  return true;
+}
+
+/// Decode \p Name, which is one of
+///   llvm.nvvm.wmma.<geom>.load.<a|b|c>.<layout>[.stride].<type>.<ptr type>
+///   llvm.nvvm.wmma.<geom>.store.d.<layout>[.stride].<type>.<ptr type>
+///   llvm.nvvm.wmma.<geom>.mma.<a layout>.<b layout>.<d type>.<c type>
+/// \returns false if the intrinsic has no joint matrix equivalent.
+static bool parseWMMAIntrinsic(StringRef Name, WMMAIntrinsicInfo &Info) {
+  if (!Name.consume_front(kNVVMName::WMMAPrefix))
+    return false;
+  SmallVector<StringRef, 8> Parts;
+  Name.split(Parts, '.');
+  if (Parts.size() < 2 || !parseGeometry(Parts[0], Info))
+    return false;
+
+  if (Parts[1] == "mma") {
+    // Saturating and mixed precision multiply-adds are not lowered: the
+    // accumulator and the result share a single joint matrix type.
+    if (Parts.size() != 6 || Parts[4] != Parts[5])
+      return false;
+    Info.Kind = WMMAIntrinsicInfo::MMA;
+    Info.Frag = 'd';
+    Info.HasStride = false;
+    return parseLayout(Parts[2], Info.ColMajor[0]) &&
+           parseLayout(Parts[3], Info.ColMajor[1]) &&
+           parseElementType(Parts[4], Info.IsF32);
+  }
+
+  if (Parts[1] == "load")
+    Info.Kind = WMMAIntrinsicInfo::Load;
+  else if (Parts[1] == "store")
+    Info.Kind = WMMAIntrinsicInfo::Store;
+  else
+    return false;
+  if (Parts.size() < 6 || Parts[2].size() != 1)
+    return false;
+  Info.Frag = Parts[2][0];
+  if (Info.Kind == WMMAIntrinsicInfo::Load
+          ? Info.Frag != 'a' && Info.Frag != 'b' && Info.Frag != 'c'
+          : Info.Frag != 'd')
+    return false;
+  Info.HasStride = Parts[4] == "stride";
+  size_t TypeIdx = Info.HasStride ? 5 : 4;
+  if (Parts.size() != TypeIdx + 2 || !parseLayout(Parts[3], Info.ColMajor[0]) ||
+      !parseElementType(Parts[TypeIdx], Info.IsF32))
+    return false;
+  // A and B fragments always hold half elements.
+  return !Info.IsF32 || Info.Frag == 'c' || Info.Frag == 'd';
+}
+
+/// \returns the number of rows and columns of fragment \p Frag.
+static std::pair<unsigned, unsigned>
+getFragmentShape(const WMMAIntrinsicInfo &Info, char Frag) {
+  switch (Frag) {
+  case 'a':
+    return {Info.M, Info.K};
+  case 'b':
+    return {Info.K, Info.N};
+  default:
+    return {Info.M, Info.N};
+  }
+}
+
+/// \returns the number of registers holding fragment \p Frag.
+static unsigned getFragmentSize(const WMMAIntrinsicInfo &Info, char Frag) {
+  // A and B fragments hold 8 pairs of halfs, C and D fragments either 4 pairs
+  // of halfs or 8 floats.
+  if (Frag == 'a' || Frag == 'b' || Info.IsF32)
+    return 8;
+  return 4;
+}
+
+class SPIRVLowerWMMA : public ModulePass {
+public:
+  SPIRVLowerWMMA() : ModulePass(ID), M(nullptr), Func(nullptr) {
+    initializeSPIRVLowerWMMAPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnModule(Module &M) override;
+
+  static char ID;
+
+private:
+  /// Rewrite the WMMA intrinsics called by \p F. An error is reported if one
+  /// of them cannot be rewritten.
+  bool lowerFunction(Function &F);
+  /// Rewrite the WMMA load or MMA \p CI, whose operands are filled in later.
+  bool lowerDefinition(CallInst *CI, const WMMAIntrinsicInfo &Info);
+  /// Set the matrix operands of the rewritten MMA, or rewrite the store,
+  /// \p CI.
+  bool lowerUse(CallInst *CI, const WMMAIntrinsicInfo &Info);
+  /// Erase the instructions created for the current function and report
+  /// that its WMMA intrinsics cannot be lowered because of \p Reason.
+  void rollBack(const Twine &Reason);
+
+  Type *getComponentType(bool IsF32);
+  Type *getMatrixType(bool IsF32, std::pair<unsigned, unsigned> Shape,
+                      unsigned Layout);
+  /// \returns \p Ptr as a pointer to \p CompTy. Only bitcasts are looked
+  /// through, so the address space of \p Ptr is kept.
+  Value *getPointer(Value *Ptr, Type *CompTy, Instruction *InsertBefore);
+  /// \returns the matrix of type \p MatTy whose registers are \p Elts, or
+  /// nullptr if it cannot be rebuilt.
+  Value *getMatrix(ArrayRef<Value *> Elts, Type *MatTy);
+  Value *getMatrixFromPHIs(ArrayRef<Value *> Elts, Type *MatTy);
+  Value *getMatrixFromSplat(Value *V, Type *MatTy);
+  CallInst *addCall(Op OC, Type *RetTy, ArrayRef<Value *> Args,
+                    Instruction *InsertBefore);
+
+  Module *M;
+  Function *Func;
+  /// Builtin declarations keyed by mangled name and type. Matrix operations
+  /// on different matrix types share a mangled name, so the declarations
+  /// created after the first one get a suffix.
+  std::map<std::pair<std::string, FunctionType *>, Function *> Funcs;
+  /// Matrix defined by each WMMA load and MMA of the current function.
+  DenseMap<CallInst *, CallInst *> Defs;
+  /// Matrices rebuilt from registers of the current function.
+  std::map<std::vector<Value *>, Value *> Matrices;
+  std::vector<Instruction *> NewInsts;
+  /// Instructions handling the registers of fragments, which are dead once
+  /// every WMMA intrinsic is rewritten.
+  std::vector<Instruction *> OldInsts;
+};
+
+char SPIRVLowerWMMA::ID = 0;
+
+bool SPIRVLowerWMMA::runOnModule(Module &Module) {
+  M = &Module;
+  Funcs.clear();
+  bool Changed = false;
+  for (Function &F : Module)
+    if (!F.isDeclaration())
+      Changed |= lowerFunction(F);
+  // Drop the declarations left unused by the rewrite.
+  for (auto &F : Funcs)
+    if (F.second->isDeclaration() && F.second->use_empty())
+      F.second->eraseFromParent();
+  for (Function &F : make_early_inc_range(Module))
+    if (F.isDeclaration() && F.use_empty() &&
+        F.getName().startswith(kNVVMName::WMMAPrefix))
+      F.eraseFromParent();
+
+  if (Changed && SPIRVLowerWMMAValidate) {
+    LLVM_DEBUG(dbgs() << "After SPIRVLowerWMMA:\n" << Module);
+    std::string Err;
+    raw_string_ostream ErrorOS(Err);
+    if (verifyModule(Module, &ErrorOS)) {
+      Err = std::string("Fails to verify module: ") + Err;
+      report_fatal_error(Err.c_str(), false);
+    }
+  }
+  return Changed;
+}
+
+bool SPIRVLowerWMMA::lowerFunction(Function &F) {
+  Func = &F;
+  Defs.clear();
+  Matrices.clear();
+  NewInsts.clear();
+  OldInsts.clear();
+  std::vector<std::pair<CallInst *, WMMAIntrinsicInfo>> Calls;
+  ReversePostOrderTraversal<Function *> RPOT(&F);
+  for (BasicBlock *BB : RPOT)
+    for (Instruction &I : *BB) {
+      auto *CI = dyn_cast<CallInst>(&I);
+      Function *Callee = CI ? CI->getCalledFunction() : nullptr;
+      if (!Callee || !Callee->getName().startswith(kNVVMName::WMMAPrefix))
+        continue;
+      WMMAIntrinsicInfo Info;
+      if (!parseWMMAIntrinsic(Callee->getName(), Info)) {
+        rollBack("unsupported intrinsic " + Callee->getName());
+        return false;
+      }
+      Calls.push_back({CI, Info});
+    }
+  if (Calls.empty())
+    return false;
+
+  // Matrices are defined before any of their uses is rewritten, since
+  // fragments may flow around loops.
+  for (auto &C : Calls)
+    if (C.second.Kind != WMMAIntrinsicInfo::Store &&
+        !lowerDefinition(C.first, C.second)) {
+      rollBack("unexpected fragment type of " +
+               C.first->getCalledFunction()->getName());
+      return false;
+    }
+  for (auto &C : Calls)
+    if (C.second.Kind != WMMAIntrinsicInfo::Load &&
+        !lowerUse(C.first, C.second)) {
+      rollBack("unable to rebuild the fragments used by " +
+               C.first->getCalledFunction()->getName());
+      return false;
+    }
+
+  // The registers of the fragments must not be used by anything else than
+  // the rewritten intrinsics.
+  for (auto &C : Calls)
+    OldInsts.push_back(C.first);
+  SmallPtrSet<Instruction *, 32> Dead(OldInsts.begin(), OldInsts.end());
+  for (Instruction *I : Dead)
+    for (User *U : I->users())
+      if (!Dead.count(cast<Instruction>(U))) {
+        std::string Use;
+        raw_string_ostream OS(Use);
+        OS << *U;
+        rollBack("fragment register is used by " + StringRef(OS.str()).trim());
+        return false;
+      }
+  for (Instruction *I : Dead)
+    I->dropAllReferences();
+  for (Instruction *I : Dead)
+    I->eraseFromParent();
+  return true;
+}
+
+bool SPIRVLowerWMMA::lowerDefinition(CallInst *CI,
+                                     const WMMAIntrinsicInfo &Info) {
+  auto *STy = dyn_cast<StructType>(CI->getType());
+  if (!STy || STy->getNumElements() != getFragmentSize(Info, Info.Frag))
+    return false;
+  Type *MatTy = getMatrixType(Info.IsF32, getFragmentShape(Info, Info.Frag),
+                              Info.getTypeLayout(Info.Frag));
+
+  if (Info.Kind == WMMAIntrinsicInfo::MMA) {
+    Type *AMatTy = getMatrixType(false, getFragmentShape(Info, 'a'),
+                                 Info.getTypeLayout('a'));
+    Type *BMatTy = getMatrixType(false, getFragmentShape(Info, 'b'),
+                                 Info.getTypeLayout('b'));
+    Defs[CI] = addCall(OpJointMatrixMadINTEL, MatTy,
+                       {UndefValue::get(AMatTy), UndefValue::get(BMatTy),
+                        UndefValue::get(MatTy), getInt32(M, ScopeSubgroup)},
+                       CI);
+    return true;
+  }
+
+  auto Shape = getFragmentShape(Info, Info.Frag);
+  Value *Ptr = getPointer(CI->getArgOperand(0), getComponentType(Info.IsF32),
+                          CI);
+  // Without an explicit stride the fragment is densely packed.
+  Value *Stride = Info.HasStride
+                      ? CI->getArgOperand(1)
+                      : getInt32(M, Info.ColMajor[0] ? Shape.first
+                                                     : Shape.second);
+  Value *Layout = getInt32(M, Info.ColMajor[0] ? ColumnMajor : RowMajor);
+  Defs[CI] = addCall(OpJointMatrixLoadINTEL, MatTy,
+                     {Ptr, Stride, Layout, getInt32(M, ScopeSubgroup)}, CI);
+  return true;
+}
+
+bool SPIRVLowerWMMA::lowerUse(CallInst *CI, const WMMAIntrinsicInfo &Info) {
+  if (Info.Kind == WMMAIntrinsicInfo::MMA) {
+    CallInst *MulAdd = Defs[CI];
+    unsigned Begin = 0;
+    unsigned I = 0;
+    for (char Frag : {'a', 'b', 'c'}) {
+      unsigned Size = getFragmentSize(Info, Frag);
+      if (CI->getNumArgOperands() < Begin + Size)
+        return false;
+      std::vector<Value *> Elts(CI->arg_begin() + Begin,
+                               CI->arg_begin() + Begin + Size);
+      Value *Mat = getMatrix(Elts, MulAdd->getArgOperand(I)->getType());
+      if (!Mat)
+        return false;
+      MulAdd->setArgOperand(I++, Mat);
+      Begin += Size;
+    }
+    return CI->getNumArgOperands() == Begin;
+  }
+
+  unsigned Size = getFragmentSize(Info, 'd');
+  if (CI->getNumArgOperands() != Size + 1 + Info.HasStride)
+    return false;
+  auto Shape = getFragmentShape(Info, 'd');
+  std::vector<Value *> Elts(CI->arg_begin() + 1, CI->arg_begin() + 1 + Size);
+  Value *Mat = getMatrix(
+      Elts, getMatrixType(Info.IsF32, Shape, Info.getTypeLayout('d')));
+  if (!Mat)
+    return false;
+  Value *Ptr = getPointer(CI->getArgOperand(0), getComponentType(Info.IsF32),
+                          CI);
+  Value *Stride = Info.HasStride
+                      ? CI->getArgOperand(Size + 1)
+                      : getInt32(M, Info.ColMajor[0] ? Shape.first
+                                                     : Shape.second);
+  Value *Layout = getInt32(M, Info.ColMajor[0] ? ColumnMajor : RowMajor);
+  addCall(OpJointMatrixStoreINTEL, Type::getVoidTy(M->getContext()),
+          {Ptr, Mat, Stride, Layout, getInt32(M, ScopeSubgroup)}, CI);
+  return true;
+}
+
+void SPIRVLowerWMMA::rollBack(const Twine &Reason) {
+  for (Instruction *I : NewInsts)
+    I->dropAllReferences();
+  for (Instruction *I : NewInsts)
+    I->eraseFromParent();
+  NewInsts.clear();
+  // The WMMA intrinsics left in place have no SPIR-V counterpart.
+  std::string Err = ("Unable to lower WMMA intrinsics of " + Func->getName() +
+                     " to joint matrix operations: " + Reason)
+                        .str();
+  report_fatal_error(Err.c_str(), false);
+}
+
+Type *SPIRVLowerWMMA::getComponentType(bool IsF32) {
+  return IsF32 ? Type::getFloatTy(M->getContext())
+               : Type::getHalfTy(M->getContext());
+}
+
+Type *SPIRVLowerWMMA::getMatrixType(bool IsF32,
+                                    std::pair<unsigned, unsigned> Shape,
+                                    unsigned Layout) {
+  return getOrCreateOpaquePtrType(
+      M, getSPIRVTypeName(kSPIRVTypeName::JointMatrixINTEL,
+                          getSPIRVJointMatrixINTELTypePostfixes(
+                              IsF32 ? kSPIRVImageSampledTypeName::Float
+                                    : kSPIRVImageSampledTypeName::Half,
+                              Shape.first, Shape.second, Layout,
+                              ScopeSubgroup)));
+}
+
+Value *SPIRVLowerWMMA::getPointer(Value *Ptr, Type *CompTy,
+                                  Instruction *InsertBefore) {
+  while (auto *BC = dyn_cast<BitCastOperator>(Ptr))
+    Ptr = BC->getOperand(0);
+  auto *PtrTy =
+      PointerType::get(CompTy, Ptr->getType()->getPointerAddressSpace());
+  if (Ptr->getType() == PtrTy)
+    return Ptr;
+  auto *Cast = CastInst::CreatePointerCast(Ptr, PtrTy, "", InsertBefore);
+  NewInsts.push_back(Cast);
+  return Cast;
+}
+
+Value *SPIRVLowerWMMA::getMatrix(ArrayRef<Value *> Elts, Type *MatTy) {
+  std::vector<Value *> Key(Elts.begin(), Elts.end());
+  auto Loc = Matrices.find(Key);
+  if (Loc != Matrices.end())
+    return Loc->second->getType() == MatTy ? Loc->second : nullptr;
+
+  // Registers extracted in order from a single fragment.
+  if (auto *EV = dyn_cast<ExtractValueInst>(Elts[0])) {
+    auto *Def = Defs.lookup(dyn_cast<CallInst>(EV->getAggregateOperand()));
+    if (!Def || Def->getType() != MatTy ||
+        EV->getAggregateOperand()->getType()->getStructNumElements() !=
+            Elts.size())
+      return nullptr;
+    for (unsigned I = 0, E = Elts.size(); I != E; ++I) {
+      auto *EltEV = dyn_cast<ExtractValueInst>(Elts[I]);
+      if (!EltEV || EltEV->getAggregateOperand() != EV->getAggregateOperand() ||
+          EltEV->getNumIndices() != 1 || *EltEV->idx_begin() != I)
+        return nullptr;
+    }
+    for (Value *V : Elts)
+      OldInsts.push_back(cast<Instruction>(V));
+    return Matrices[Key] = Def;
+  }
+
+  if (isa<PHINode>(Elts[0]))
+    return getMatrixFromPHIs(Elts, MatTy);
+
+  if (std::all_of(Elts.begin(), Elts.end(),
+                  [&](Value *V) { return V == Elts[0]; }))
+    if (Value *Fill = getMatrixFromSplat(Elts[0], MatTy))
+      return Matrices[Key] = Fill;
+  return nullptr;
+}
+
+Value *SPIRVLowerWMMA::getMatrixFromPHIs(ArrayRef<Value *> Elts,
+                                         Type *MatTy) {
+  auto *First = cast<PHINode>(Elts[0]);
+  for (Value *V : Elts) {
+    auto *PN = dyn_cast<PHINode>(V);
+    if (!PN || PN->getParent() != First->getParent() ||
+        PN->getNumIncomingValues() != First->getNumIncomingValues())
+      return nullptr;
+  }
+
+  // The matrix is registered before its incoming values are rebuilt, which
+  // may refer back to it.
+  auto *Mat = PHINode::Create(MatTy, First->getNumIncomingValues(), "",
+                              &First->getParent()->front());
+  NewInsts.push_back(Mat);
+  Matrices[std::vector<Value *>(Elts.begin(), Elts.end())] = Mat;
+  for (unsigned I = 0, E = First->getNumIncomingValues(); I != E; ++I) {
+    BasicBlock *BB = First->getIncomingBlock(I);
+    std::vector<Value *> Incoming;
+    for (Value *V : Elts) {
+      int Idx = cast<PHINode>(V)->getBasicBlockIndex(BB);
+      if (Idx < 0)
+        return nullptr;
+      Incoming.push_back(cast<PHINode>(V)->getIncomingValue(Idx));
+    }
+    Value *IncomingMat = getMatrix(Incoming, MatTy);
+    if (!IncomingMat)
+      return nullptr;
+    Mat->addIncoming(IncomingMat, BB);
+  }
+  for (Value *V : Elts)
+    OldInsts.push_back(cast<Instruction>(V));
+  return Mat;
+}
+
+Value *SPIRVLowerWMMA::getMatrixFromSplat(Value *V, Type *MatTy) {
+  Value *Scalar = V;
+  if (V->getType()->isVectorTy())
+    Scalar = const_cast<Value *>(getSplatValue(V));
+  if (!Scalar || !Scalar->getType()->isFloatingPointTy())
+    return nullptr;
+
+  // Build the matrix where every use of the register can see it.
+  Instruction *InsertBefore = nullptr;
+  if (auto *PN = dyn_cast<PHINode>(Scalar))
+    InsertBefore = PN->getParent()->getFirstNonPHI();
+  else if (auto *I = dyn_cast<Instruction>(Scalar))
+    InsertBefore = I->getNextNode();
+  else
+    InsertBefore = &*Func->getEntryBlock().getFirstInsertionPt();
+  return addCall(OpCompositeConstruct, MatTy, {Scalar}, InsertBefore);
+}
+
+CallInst *SPIRVLowerWMMA::addCall(Op OC, Type *RetTy, ArrayRef<Value *> Args,
+                                  Instruction *InsertBefore) {
+  auto ArgTys = getTypes(Args);
+  std::string Name;
+  mangleOpenClBuiltin(getSPIRVFuncName(OC), ArgTys, Name);
+  auto *FT = FunctionType::get(RetTy, ArgTys, false);
+  Function *&F = Funcs[{Name, FT}];
+  if (!F) {
+    F = M->getFunction(Name);
+    if (!F || F->getFunctionType() != FT) {
+      F = Function::Create(FT, GlobalValue::ExternalLinkage, Name, M);
+      F->setCallingConv(CallingConv::SPIR_FUNC);
+      F->addFnAttr(Attribute::NoUnwind);
+    }
+  }
+  auto *Call = CallInst::Create(F, Args, "", InsertBefore);
+  Call->setCallingConv(F->getCallingConv());
+  NewInsts.push_back(Call);
+  return Call;
+}
+
+} // namespace SPIRV
+
+INITIALIZE_PASS(SPIRVLowerWMMA, "spvwmma",
+                "Lower WMMA intrinsics to joint matrix operations", false,
+                false)
+
+ModulePass *llvm::createSPIRVLowerWMMA() { return new SPIRVLowerWMMA(); }
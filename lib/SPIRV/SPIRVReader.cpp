@@ -81,6 +81,7 @@
 #include <set>
 #include <sstream>
 #include <string>
+#include <unordered_set>
 
 #define DEBUG_TYPE "spirv"
 
@@ -102,13 +103,6 @@ const char *KPlaceholderPrefix = "placeholder.";
 static bool DbgSaveTmpLLVM = false;
 static const char *DbgTmpLLVMFileName = "_tmp_llvmbil.ll";
 
-namespace kOCLTypeQualifierName {
-const static char *Const = "const";
-const static char *Volatile = "volatile";
-const static char *Restrict = "restrict";
-const static char *Pipe = "pipe";
-} // namespace kOCLTypeQualifierName
-
 static bool isKernel(SPIRVFunction *BF) {
   return BF->getModule()->isEntryPoint(ExecutionModelKernel, BF->getId());
 }
@@ -450,6 +444,19 @@ Type *SPIRVToLLVM::transType(SPIRVType *T, bool IsClassMember) {
                                                PT->getAccessQualifier()),
                           getOCLOpaqueTypeAddrSpace(T->getOpCode())));
   }
+  case OpTypeJointMatrixINTEL: {
+    auto MT = static_cast<SPIRVTypeJointMatrixINTEL *>(T);
+    return mapType(
+        T, getOrCreateOpaquePtrType(
+               M, getSPIRVTypeName(
+                      kSPIRVTypeName::JointMatrixINTEL,
+                      getSPIRVJointMatrixINTELTypePostfixes(
+                          getSPIRVImageSampledTypeName(MT->getComponentType()),
+                          MT->getRows()->getZExtIntValue(),
+                          MT->getColumns()->getZExtIntValue(),
+                          MT->getLayout()->getZExtIntValue(),
+                          MT->getScope()->getZExtIntValue()))));
+  }
   case OpTypePipeStorage: {
     auto PST = static_cast<SPIRVTypePipeStorage *>(T);
     return mapType(
@@ -1314,6 +1321,49 @@ Value *SPIRVToLLVM::oclTransConstantPipeStorage(
                             GlobalValue::NotThreadLocal, SPIRAS_Global);
 }
 
+template <typename T>
+static void appendRawElement(std::string &Raw, uint64_t Value) {
+  T Elt = static_cast<T>(Value);
+  Raw.append(reinterpret_cast<const char *>(&Elt), sizeof(T));
+}
+
+/// Builds a ConstantDataArray directly from the literal words of \p BCC if
+/// all of its elements are plain scalar OpConstants, so large lookup tables
+/// do not materialize one LLVM constant per element. Returns nullptr if the
+/// composite does not qualify.
+static Constant *transConstantDataArray(SPIRVConstantComposite *BCC,
+                                        ArrayType *AT) {
+  Type *ElemTy = AT->getElementType();
+  if (!ConstantDataSequential::isElementTypeCompatible(ElemTy))
+    return nullptr;
+  auto Elements = BCC->getElements();
+  unsigned ElemBytes = ElemTy->getPrimitiveSizeInBits() / 8;
+  std::string Raw;
+  Raw.reserve(Elements.size() * ElemBytes);
+  for (auto *E : Elements) {
+    if (E->getOpCode() != OpConstant)
+      return nullptr;
+    uint64_t Value = static_cast<SPIRVConstant *>(E)->getZExtIntValue();
+    switch (ElemBytes) {
+    case 1:
+      appendRawElement<uint8_t>(Raw, Value);
+      break;
+    case 2:
+      appendRawElement<uint16_t>(Raw, Value);
+      break;
+    case 4:
+      appendRawElement<uint32_t>(Raw, Value);
+      break;
+    case 8:
+      appendRawElement<uint64_t>(Raw, Value);
+      break;
+    default:
+      return nullptr;
+    }
+  }
+  return ConstantDataArray::getRaw(Raw, Elements.size(), ElemTy);
+}
+
 /// For instructions, this function assumes they are created in order
 /// and appended to the given basic block. An instruction may use a
 /// instruction from another BB which has not been translated. Such
@@ -1408,6 +1458,10 @@ Value *SPIRVToLLVM::transValueWithoutDecoration(SPIRVValue *BV, Function *F,
   case OpConstantComposite:
   case OpSpecConstantComposite: {
     auto BCC = static_cast<SPIRVConstantComposite *>(BV);
+    if (OC == OpConstantComposite && BV->getType()->isTypeArray())
+      if (auto CDA = transConstantDataArray(
+              BCC, cast<ArrayType>(transType(BCC->getType()))))
+        return mapValue(BV, CDA);
     std::vector<Constant *> CV;
     for (auto &I : BCC->getElements())
       CV.push_back(dyn_cast<Constant>(transValue(I, F, BB)));
@@ -1586,6 +1640,11 @@ Value *SPIRVToLLVM::transValueWithoutDecoration(SPIRVValue *BV, Function *F,
 
   case OpBranchConditional: {
     auto *BR = static_cast<SPIRVBranchConditional *>(BV);
+    auto Folded = FoldedBranchTargets.find(BR->getParent());
+    if (Folded != FoldedBranchTargets.end())
+      return mapValue(
+          BV, BranchInst::Create(
+                  cast<BasicBlock>(transValue(Folded->second, F, BB)), BB));
     auto *BC = BranchInst::Create(
         cast<BasicBlock>(transValue(BR->getTrueLabel(), F, BB)),
         cast<BasicBlock>(transValue(BR->getFalseLabel(), F, BB)),
@@ -1601,9 +1660,18 @@ Value *SPIRVToLLVM::transValueWithoutDecoration(SPIRVValue *BV, Function *F,
                             Phi->getPairs().size() / 2, Phi->getName(), BB)));
     Phi->foreachPair([&](SPIRVValue *IncomingV, SPIRVBasicBlock *IncomingBB,
                          size_t Index) {
-      auto Translated = transValue(IncomingV, F, BB);
-      LPhi->addIncoming(Translated,
-                        dyn_cast<BasicBlock>(transValue(IncomingBB, F, BB)));
+      if (isSkippedEdge(IncomingBB, Phi->getParent()))
+        return;
+      auto IncomingLBB = dyn_cast<BasicBlock>(transValue(IncomingBB, F, BB));
+      // Values defined later in the function, e.g. along a loop back edge,
+      // are filled in once the whole function body is translated.
+      if (IncomingV->isInst() && !ValueMap.count(IncomingV)) {
+        PendingPhiIncomings.push_back(
+            {LPhi, LPhi->getNumIncomingValues(), IncomingV});
+        LPhi->addIncoming(UndefValue::get(LPhi->getType()), IncomingLBB);
+        return;
+      }
+      LPhi->addIncoming(transValue(IncomingV, F, BB), IncomingLBB);
     });
     return LPhi;
   }
@@ -1731,6 +1799,11 @@ Value *SPIRVToLLVM::transValueWithoutDecoration(SPIRVValue *BV, Function *F,
 
   case OpSwitch: {
     auto BS = static_cast<SPIRVSwitch *>(BV);
+    auto Folded = FoldedBranchTargets.find(BS->getParent());
+    if (Folded != FoldedBranchTargets.end())
+      return mapValue(
+          BV, BranchInst::Create(
+                  cast<BasicBlock>(transValue(Folded->second, F, BB)), BB));
     auto Select = transValue(BS->getSelect(), F, BB);
     auto LS = SwitchInst::Create(
         Select, dyn_cast<BasicBlock>(transValue(BS->getDefault(), F, BB)),
@@ -2053,6 +2126,10 @@ Value *SPIRVToLLVM::transValueWithoutDecoration(SPIRVValue *BV, Function *F,
       return mapValue(BV,
                       ConstantStruct::get(
                           dyn_cast<StructType>(transType(CC->getType())), CV));
+    case OpTypeJointMatrixINTEL:
+      // A joint matrix filled with a single value has no LLVM
+      // counterpart and stays a SPIR-V built-in call.
+      return mapValue(BV, transSPIRVBuiltinFromInst(CC, BB));
     default:
       llvm_unreachable("Unhandled type!");
     }
@@ -2341,11 +2418,94 @@ bool SPIRVToLLVM::foreachFuncCtlMask(SourceTy Source, FuncTy Func) {
   return true;
 }
 
+/// Returns the blocks of \p BF reachable from its entry block in reverse
+/// post-order of the CFG, followed by the unreachable blocks in layout order
+/// if \p AppendUnreachable is set. A block in \p FoldedTargets has its mapped
+/// block as the only successor.
+static std::vector<SPIRVBasicBlock *> getBlocksInReversePostOrder(
+    SPIRVFunction *BF,
+    const DenseMap<SPIRVBasicBlock *, SPIRVBasicBlock *> &FoldedTargets,
+    bool AppendUnreachable) {
+  size_t NumBlocks = BF->getNumBasicBlock();
+  std::vector<SPIRVBasicBlock *> Order;
+  Order.reserve(NumBlocks);
+  if (NumBlocks == 0)
+    return Order;
+
+  auto GetSuccessors = [&](SPIRVBasicBlock *BB) {
+    std::vector<SPIRVBasicBlock *> Succs;
+    auto Folded = FoldedTargets.find(BB);
+    if (Folded != FoldedTargets.end()) {
+      Succs.push_back(Folded->second);
+      return Succs;
+    }
+    auto Term = BB->getTerminateInstr();
+    if (!Term)
+      return Succs;
+    switch (Term->getOpCode()) {
+    case OpBranch:
+      Succs.push_back(static_cast<SPIRVBasicBlock *>(
+          static_cast<const SPIRVBranch *>(Term)->getTargetLabel()));
+      break;
+    case OpBranchConditional: {
+      auto BC = static_cast<const SPIRVBranchConditional *>(Term);
+      Succs.push_back(static_cast<SPIRVBasicBlock *>(BC->getTrueLabel()));
+      Succs.push_back(static_cast<SPIRVBasicBlock *>(BC->getFalseLabel()));
+      break;
+    }
+    case OpSwitch: {
+      auto Switch = static_cast<const SPIRVSwitch *>(Term);
+      Succs.push_back(Switch->getDefault());
+      Switch->foreachPair(
+          [&](SPIRVSwitch::LiteralTy, SPIRVBasicBlock *Target) {
+            Succs.push_back(Target);
+          });
+      break;
+    }
+    default:
+      break;
+    }
+    return Succs;
+  };
+
+  // Iterative depth-first search recording blocks in post-order.
+  std::unordered_set<SPIRVBasicBlock *> Visited;
+  std::vector<std::pair<SPIRVBasicBlock *, std::vector<SPIRVBasicBlock *>>>
+      Stack;
+  SPIRVBasicBlock *Entry = BF->getBasicBlock(0);
+  Visited.insert(Entry);
+  Stack.emplace_back(Entry, GetSuccessors(Entry));
+  while (!Stack.empty()) {
+    auto &Succs = Stack.back().second;
+    if (Succs.empty()) {
+      Order.push_back(Stack.back().first);
+      Stack.pop_back();
+      continue;
+    }
+    SPIRVBasicBlock *Succ = Succs.back();
+    Succs.pop_back();
+    if (Succ && Succ->isBasicBlock() && Visited.insert(Succ).second)
+      Stack.emplace_back(Succ, GetSuccessors(Succ));
+  }
+  std::reverse(Order.begin(), Order.end());
+
+  if (!AppendUnreachable)
+    return Order;
+  for (size_t I = 0; I != NumBlocks; ++I)
+    if (!Visited.count(BF->getBasicBlock(I)))
+      Order.push_back(BF->getBasicBlock(I));
+  return Order;
+}
+
 Function *SPIRVToLLVM::transFunction(SPIRVFunction *BF) {
   auto Loc = FuncMap.find(BF);
   if (Loc != FuncMap.end())
     return Loc->second;
 
+  // With lazy function decoding the body is decoded on first use, e.g. when
+  // the function is reached through a call before its own turn comes.
+  bool HasValidBody = BF->materialize();
+
   auto IsKernel = isKernel(BF);
   auto Linkage = IsKernel ? GlobalValue::ExternalLinkage : transLinkageType(BF);
   FunctionType *FT = dyn_cast<FunctionType>(transType(BF->getFunctionType()));
@@ -2353,6 +2513,10 @@ Function *SPIRVToLLVM::transFunction(SPIRVFunction *BF) {
       mapValue(BF, Function::Create(FT, Linkage, BF->getName(), M)));
   mapFunction(BF, F);
 
+  if (BM->hasSelectedKernels())
+    if (DISubprogram *SP = DbgTran->getFuncSubprogram(BF->getId()))
+      F->setSubprogram(SP);
+
   if (BF->hasDecorate(DecorationReferencedIndirectlyINTEL))
     F->addFnAttr("referenced-indirectly");
 
@@ -2390,25 +2554,114 @@ Function *SPIRVToLLVM::transFunction(SPIRVFunction *BF) {
                     SPIRSPIRVFuncParamAttrMap::rmap(Kind));
   });
 
+  if (!HasValidBody)
+    return F;
+
+  // Branches on constants become unconditional, and the blocks which are then
+  // unreachable are left out instead of being translated and removed later.
+  bool HasFoldedBranches = false;
+  if (BM->isSpecConstBranchFoldingEnabled()) {
+    for (size_t I = 0, E = BF->getNumBasicBlock(); I != E; ++I) {
+      SPIRVBasicBlock *BBB = BF->getBasicBlock(I);
+      if (SPIRVBasicBlock *Target =
+              getFoldedBranchTarget(BBB->getTerminateInstr())) {
+        FoldedBranchTargets[BBB] = Target;
+        HasFoldedBranches = true;
+      }
+    }
+  }
+  std::vector<SPIRVBasicBlock *> Order = getBlocksInReversePostOrder(
+      BF, FoldedBranchTargets, /*AppendUnreachable=*/!HasFoldedBranches);
+  if (HasFoldedBranches) {
+    DenseSet<SPIRVBasicBlock *> Reachable(Order.begin(), Order.end());
+    for (size_t I = 0, E = BF->getNumBasicBlock(); I != E; ++I)
+      if (!Reachable.count(BF->getBasicBlock(I)))
+        SkippedBlocks.insert(BF->getBasicBlock(I));
+  }
+
   // Creating all basic blocks before creating instructions.
   for (size_t I = 0, E = BF->getNumBasicBlock(); I != E; ++I) {
-    transValue(BF->getBasicBlock(I), F, nullptr);
+    if (!SkippedBlocks.count(BF->getBasicBlock(I)))
+      transValue(BF->getBasicBlock(I), F, nullptr);
   }
 
-  for (size_t I = 0, E = BF->getNumBasicBlock(); I != E; ++I) {
-    SPIRVBasicBlock *BBB = BF->getBasicBlock(I);
+  // Blocks are translated in reverse post-order so that every non-PHI operand
+  // is translated before its use. PHI operands coming along back edges are
+  // the only forward references left; they are resolved below without
+  // placeholders.
+  size_t PendingBegin = PendingPhiIncomings.size();
+  for (SPIRVBasicBlock *BBB : Order) {
     BasicBlock *BB = dyn_cast<BasicBlock>(transValue(BBB, F, nullptr));
-    for (size_t BI = 0, BE = BBB->getNumInst(); BI != BE; ++BI) {
-      SPIRVInstruction *BInst = BBB->getInst(BI);
+    for (SPIRVInstruction *BInst = BBB->getFirstInst(); BInst;
+         BInst = BInst->getNext())
       transValue(BInst, F, BB, false);
-    }
   }
 
+  for (size_t I = PendingBegin; I != PendingPhiIncomings.size(); ++I) {
+    auto &P = PendingPhiIncomings[I];
+    P.Phi->setIncomingValue(P.Index,
+                            transValue(P.Value, F, P.Phi->getParent()));
+  }
+  PendingPhiIncomings.resize(PendingBegin);
+
   transLLVMLoopMetadata(F);
 
   return F;
 }
 
+/// Returns the only block which \p Term can branch to if it is a conditional
+/// branch or a switch on a constant, e.g. on a specialized
+/// OpSpecConstantTrue, and null otherwise.
+SPIRVBasicBlock *
+SPIRVToLLVM::getFoldedBranchTarget(const SPIRVInstruction *Term) {
+  if (!Term)
+    return nullptr;
+  auto GetConstant = [&](SPIRVValue *V) -> ConstantInt * {
+    if (!isConstantOpCode(V->getOpCode()))
+      return nullptr;
+    return dyn_cast<ConstantInt>(transValue(V, nullptr, nullptr));
+  };
+
+  switch (Term->getOpCode()) {
+  case OpBranchConditional: {
+    auto BC = static_cast<const SPIRVBranchConditional *>(Term);
+    ConstantInt *Cond = GetConstant(BC->getCondition());
+    if (!Cond)
+      return nullptr;
+    return static_cast<SPIRVBasicBlock *>(Cond->isOne() ? BC->getTrueLabel()
+                                                        : BC->getFalseLabel());
+  }
+  case OpSwitch: {
+    auto BS = static_cast<const SPIRVSwitch *>(Term);
+    ConstantInt *Select = GetConstant(BS->getSelect());
+    if (!Select)
+      return nullptr;
+    SPIRVBasicBlock *Target = BS->getDefault();
+    BS->foreachPair(
+        [&](SPIRVSwitch::LiteralTy Literals, SPIRVBasicBlock *Label) {
+          uint64_t Literal = uint64_t(Literals.at(0));
+          if (Literals.size() == 2)
+            Literal += uint64_t(Literals.at(1)) << 32;
+          if (ConstantInt::get(Select->getType(), Literal) == Select)
+            Target = Label;
+        });
+    return Target;
+  }
+  default:
+    return nullptr;
+  }
+}
+
+/// Returns true if \p From is not translated, or if its terminator was folded
+/// to branch to a block other than \p To.
+bool SPIRVToLLVM::isSkippedEdge(SPIRVBasicBlock *From,
+                                SPIRVBasicBlock *To) const {
+  if (SkippedBlocks.count(From))
+    return true;
+  auto Folded = FoldedBranchTargets.find(From);
+  return Folded != FoldedBranchTargets.end() && Folded->second != To;
+}
+
 Value *SPIRVToLLVM::transAsmINTEL(SPIRVAsmINTEL *BA) {
   assert(BA);
   bool HasSideEffect = BA->hasDecorate(DecorationSideEffectsINTEL);
@@ -2890,9 +3143,28 @@ bool SPIRVToLLVM::translate() {
     DbgTran->transDebugInst(EI);
   }
 
+  for (const std::string &Name : BM->getSelectedKernels()) {
+    bool Found = false;
+    for (unsigned I = 0, E = BM->getNumFunctions(); I != E && !Found; ++I) {
+      SPIRVFunction *BF = BM->getFunction(I);
+      Found = isKernel(BF) && BF->getName() == Name;
+    }
+    if (!BM->getErrorLog().checkError(Found, SPIRVEC_UnknownKernel, Name))
+      return false;
+  }
+
   for (unsigned I = 0, E = BM->getNumFunctions(); I != E; ++I) {
-    transFunction(BM->getFunction(I));
+    SPIRVFunction *BF = BM->getFunction(I);
+    // With a kernel selection only the selected kernels are translated from
+    // here. The functions they call are translated on demand.
+    if (BM->hasSelectedKernels() &&
+        !(isKernel(BF) && BM->isKernelSelected(BF->getName())))
+      continue;
+    transFunction(BF);
   }
+  // A lazily decoded function body is only validated when it is decoded.
+  if (!BM->isModuleValid())
+    return false;
 
   if (!transMetadata())
     return false;
@@ -3144,7 +3416,7 @@ bool SPIRVToLLVM::transFPContractMetadata() {
   bool ContractOff = false;
   for (unsigned I = 0, E = BM->getNumFunctions(); I != E; ++I) {
     SPIRVFunction *BF = BM->getFunction(I);
-    if (!isKernel(BF))
+    if (!isKernel(BF) || !getTranslatedValue(BF))
       continue;
     if (BF->getExecutionMode(ExecutionModeContractionOff)) {
       ContractOff = true;
@@ -3219,7 +3491,10 @@ bool SPIRVToLLVM::transMetadata() {
   for (unsigned I = 0, E = BM->getNumFunctions(); I != E; ++I) {
     SPIRVFunction *BF = BM->getFunction(I);
     Function *F = static_cast<Function *>(getTranslatedValue(BF));
-    assert(F && "Invalid translated function");
+    if (!F) {
+      assert(BM->hasSelectedKernels() && "Invalid translated function");
+      continue;
+    }
 
     transOCLMetadata(BF);
     transVectorComputeMetadata(BF);
@@ -3860,6 +4135,66 @@ bool llvm::readSpirv(LLVMContext &C, const SPIRV::TranslatorOpts &Opts,
   return true;
 }
 
+std::unique_ptr<Module>
+llvm::SpirvTranslatorSession::readSpirv(LLVMContext &C, std::istream &IS,
+                                        std::string &ErrMsg) {
+  std::unique_ptr<SPIRVModule> BM(readSpirvModule(IS, Opts, ErrMsg));
+  if (!BM)
+    return nullptr;
+
+  std::unique_ptr<Module> M(new Module("", C));
+  SPIRVToLLVM BTL(M.get(), BM.get());
+  if (!BTL.translate()) {
+    BM->getError(ErrMsg);
+    return nullptr;
+  }
+
+  if (!ReaderPM) {
+    // nullptr means no additional lowering is required
+    if (llvm::ModulePass *LoweringPass = createSPIRVBIsLoweringPass(
+            *M, Opts.getDesiredBIsRepresentation())) {
+      ReaderPM = std::make_unique<legacy::PassManager>();
+      ReaderPM->add(LoweringPass);
+    }
+  }
+  if (ReaderPM)
+    ReaderPM->run(*M);
+
+  if (DbgSaveTmpLLVM)
+    dumpLLVM(M.get(), DbgTmpLLVMFileName);
+  return M;
+}
+
+llvm::SpirvSpecializer::SpirvSpecializer(std::istream &IS,
+                                         const SPIRV::TranslatorOpts &Opts)
+    : Opts(Opts) {
+  BM = readSpirvModule(IS, Opts, DecodeErr);
+}
+
+llvm::SpirvSpecializer::~SpirvSpecializer() {}
+
+std::unique_ptr<Module> llvm::SpirvSpecializer::specialize(
+    LLVMContext &C, ArrayRef<std::pair<uint32_t, uint64_t>> SpecValues,
+    std::string &ErrMsg, bool FoldBranches) {
+  if (!BM) {
+    ErrMsg = DecodeErr;
+    return nullptr;
+  }
+  // An error of a previous specialization must not fail this one. A module
+  // made invalid by a lazily decoded body stays invalid, with its error.
+  if (BM->isModuleValid())
+    BM->getErrorLog().setError(SPIRVEC_Success, "");
+  SPIRV::TranslatorOpts SpecOpts = Opts;
+  for (auto &SV : SpecValues)
+    SpecOpts.setSpecConst(SV.first, SV.second);
+  if (FoldBranches)
+    SpecOpts.setSpecConstBranchFoldingEnabled(true);
+  BM->setTranslatorOpts(SpecOpts);
+  std::unique_ptr<Module> M = convertSpirvToLLVM(C, *BM, SpecOpts, ErrMsg);
+  BM->setTranslatorOpts(Opts);
+  return M;
+}
+
 bool llvm::getSpecConstInfo(std::istream &IS,
                             std::vector<SpecConstInfoTy> &SpecConstInfo) {
   std::unique_ptr<SPIRVModule> BM(SPIRVModule::createSPIRVModule());
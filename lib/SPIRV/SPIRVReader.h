@@ -44,6 +44,7 @@
 #include "SPIRVModule.h"
 
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/IR/GlobalValue.h" // llvm::GlobalValue::LinkageTypes
 #include "llvm/IR/Metadata.h"    // llvm::Metadata
 
@@ -60,6 +61,7 @@ class LLVMContext;
 class MDString;
 class IntrinsicInst;
 class LoadInst;
+class PHINode;
 class BranchInst;
 class BinaryOperator;
 class Value;
@@ -97,6 +99,8 @@ public:
   std::vector<Value *> transValue(const std::vector<SPIRVValue *> &,
                                   Function *F, BasicBlock *);
   Function *transFunction(SPIRVFunction *F);
+  SPIRVBasicBlock *getFoldedBranchTarget(const SPIRVInstruction *Term);
+  bool isSkippedEdge(SPIRVBasicBlock *From, SPIRVBasicBlock *To) const;
   Value *transBlockInvoke(SPIRVValue *Invoke, BasicBlock *BB);
   Instruction *transEnqueueKernelBI(SPIRVInstruction *BI, BasicBlock *BB);
   Instruction *transWGSizeQueryBI(SPIRVInstruction *BI, BasicBlock *BB);
@@ -187,6 +191,14 @@ public:
   typedef std::map<const BasicBlock *, const SPIRVValue *>
       SPIRVToLLVMLoopMetadataMap;
 
+  // A PHI incoming value which is defined later in the function. The PHI
+  // operand at Index holds undef until the whole function body is translated.
+  struct PendingPhiIncoming {
+    PHINode *Phi;
+    unsigned Index;
+    SPIRVValue *Value;
+  };
+
 private:
   Module *M;
   BuiltinVarMap BuiltinGVMap;
@@ -205,6 +217,16 @@ private:
   // metadata SPIR-V instruction in SPIR-V representation of this basic block.
   SPIRVToLLVMLoopMetadataMap FuncLoopMetadataMap;
 
+  // PHI operands referring to values not yet translated. Entries are resolved
+  // at the end of the translation of the function containing the PHI.
+  std::vector<PendingPhiIncoming> PendingPhiIncomings;
+
+  // With branch folding enabled, the only target of each block which ends
+  // with a conditional branch or a switch on a constant, and the blocks which
+  // are not reachable through these targets and so are not translated.
+  DenseMap<SPIRVBasicBlock *, SPIRVBasicBlock *> FoldedBranchTargets;
+  DenseSet<SPIRVBasicBlock *> SkippedBlocks;
+
   Type *mapType(SPIRVType *BT, Type *T);
 
   // If a value is mapped twice, the existing mapped value is a placeholder,
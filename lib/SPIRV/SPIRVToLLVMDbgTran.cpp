@@ -491,8 +491,10 @@ DINode *SPIRVToLLVMDbgTran::transFunction(const SPIRVExtInst *DebugInst) {
   FuncMap[RealFuncId] = DIS;
 
   // Function.
+  // With a kernel selection only the functions reachable from the selected
+  // kernels are translated. They pick up DIS when that happens.
   SPIRVEntry *E = BM->getEntry(Ops[FunctionIdIdx]);
-  if (E->getOpCode() == OpFunction) {
+  if (E->getOpCode() == OpFunction && !BM->hasSelectedKernels()) {
     SPIRVFunction *BF = static_cast<SPIRVFunction *>(E);
     llvm::Function *F = SPIRVReader->transFunction(BF);
     assert(F && "Translation of function failed!");
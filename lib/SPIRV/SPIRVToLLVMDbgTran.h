@@ -82,6 +82,12 @@ public:
   }
   Instruction *transDebugIntrinsic(const SPIRVExtInst *DebugInst,
                                    BasicBlock *BB);
+  /// Returns the subprogram translated for the SPIR-V function \p FuncId, or
+  /// nullptr if there is none.
+  DISubprogram *getFuncSubprogram(SPIRVId FuncId) const {
+    auto Loc = FuncMap.find(FuncId);
+    return Loc == FuncMap.end() ? nullptr : Loc->second;
+  }
   void finalize();
 
 private:
@@ -496,13 +496,23 @@ void SPIRVToOCL::visitCallSPIRVImageMediaBlockBuiltin(CallInst *CI, Op OC) {
 }
 
 void SPIRVToOCL::visitCallSPIRVBuiltin(CallInst *CI, Op OC) {
-  AttributeList Attrs = CI->getCalledFunction()->getAttributes();
-  mutateCallInstOCL(
-      M, CI,
-      [=](CallInst *, std::vector<Value *> &Args) {
-        return OCLSPIRVBuiltinMap::rmap(OC);
-      },
-      &Attrs);
+  SPIRVBuiltinCalls[CI->getCalledFunction()].push_back(CI);
+}
+
+void SPIRVToOCL::transSPIRVBuiltinCalls() {
+  for (auto &FCalls : SPIRVBuiltinCalls) {
+    Function *F = FCalls.first;
+    std::string DemangledName;
+    oclIsBuiltin(F->getName(), &DemangledName);
+    std::string OCLName =
+        OCLSPIRVBuiltinMap::rmap(getSPIRVFuncOC(DemangledName));
+    AttributeList Attrs = F->getAttributes();
+    mutateCallInstsOCL(
+        M, F, FCalls.second,
+        [&](CallInst *, std::vector<Value *> &Args) { return OCLName; },
+        &Attrs);
+  }
+  SPIRVBuiltinCalls.clear();
 }
 
 std::string SPIRVToOCL::getGroupBuiltinPrefix(CallInst *CI) {
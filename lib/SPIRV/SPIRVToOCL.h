@@ -40,6 +40,7 @@
 
 #include "OCLUtil.h"
 #include "SPIRVInternal.h"
+#include "llvm/ADT/MapVector.h"
 #include "llvm/IR/InstVisitor.h"
 #include "llvm/Pass.h"
 #include "llvm/PassSupport.h"
@@ -100,9 +101,14 @@ public:
   void visitCallSPIRVImageMediaBlockBuiltin(CallInst *CI, Op OC);
 
   /// Transform __spirv_* builtins to OCL 2.0 builtins.
-  /// No change with arguments.
+  /// No change with arguments. The call is only recorded here and transformed
+  /// together with the other calls of its callee by transSPIRVBuiltinCalls().
   void visitCallSPIRVBuiltin(CallInst *CI, Op OC);
 
+  /// Transform the calls recorded by visitCallSPIRVBuiltin, one batch per
+  /// callee, so that the OCL builtin is mangled once per callee.
+  void transSPIRVBuiltinCalls();
+
   /// Get prefix work_/sub_ for OCL group builtin functions.
   /// Assuming the first argument of \param CI is a constant integer for
   /// workgroup/subgroup scope enums.
@@ -159,5 +165,7 @@ private:
 protected:
   Module *M;
   LLVMContext *Ctx;
+  /// Calls recorded by visitCallSPIRVBuiltin, grouped by callee.
+  MapVector<Function *, std::vector<CallInst *>> SPIRVBuiltinCalls;
 };
 } // namespace SPIRV
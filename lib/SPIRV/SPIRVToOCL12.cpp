@@ -113,6 +113,7 @@ bool SPIRVToOCL12::runOnModule(Module &Module) {
   M = &Module;
   Ctx = &M->getContext();
   visit(*M);
+  transSPIRVBuiltinCalls();
 
   eraseUselessFunctions(&Module);
 
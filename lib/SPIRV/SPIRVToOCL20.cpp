@@ -91,6 +91,7 @@ bool SPIRVToOCL20::runOnModule(Module &Module) {
   M = &Module;
   Ctx = &M->getContext();
   visit(*M);
+  transSPIRVBuiltinCalls();
 
   eraseUselessFunctions(&Module);
 
@@ -0,0 +1,216 @@
+//===- SPIRVTranslationCache.cpp - On-disk cache of translation results ---===//
+//
+//                     The LLVM/SPIRV Translator
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+// Copyright (c) 2014 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimers.
+// Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimers in the documentation
+// and/or other materials provided with the distribution.
+// Neither the names of Advanced Micro Devices, Inc., nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// Software without specific prior written permission.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH
+// THE SOFTWARE.
+//
+//
+// This file implements a directory based cache of translation results.
+//
+//===----------------------------------------------------------------------===//
+
+#include "LLVMSPIRVLib.h"
+#include "SPIRVInternal.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/CachePruning.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SHA1.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <chrono>
+
+using namespace llvm;
+using namespace SPIRV;
+
+namespace SPIRV {
+extern cl::opt<bool> EraseOCLMD;
+extern cl::opt<bool> SPIRVLowerConst;
+extern cl::opt<bool> SPIRVEnableStepExpansion;
+} // namespace SPIRV
+
+namespace {
+// Bump when the format of the key or of the cached results changes.
+const unsigned CacheFormatVersion = 3;
+// pruneCache only considers files with this prefix.
+const char CacheFilePrefix[] = "llvmcache-";
+// Results are written to files with this prefix before they are renamed.
+const char TempFilePrefix[] = "tmp-";
+// Name of the file whose modification time pruneCache uses to find out when
+// the directory was pruned last.
+const char TimestampFileName[] = "llvmcache.timestamp";
+} // namespace
+
+/// Write every option which can change the result of a translation to \p OS
+/// in a fixed order, so that equal options always give equal encodings.
+static void encodeTranslatorOpts(const TranslatorOpts &Opts, raw_ostream &OS) {
+  OS << "max-version=" << static_cast<uint32_t>(Opts.getMaxVersion());
+  OS << ";ext=";
+  for (unsigned I = static_cast<unsigned>(ExtensionID::First) + 1,
+                E = static_cast<unsigned>(ExtensionID::Last);
+       I != E; ++I)
+    OS << Opts.isAllowedToUseExtension(static_cast<ExtensionID>(I));
+  OS << ";mem2reg=" << Opts.isSPIRVMemToRegEnabled();
+  OS << ";ld-st-vectorize=" << Opts.isLoadStoreVectorizationEnabled();
+  OS << ";arg-name-md=" << Opts.isGenArgNameMDEnabled();
+  std::vector<std::pair<uint32_t, uint64_t>> SpecConsts(
+      Opts.getSpecConsts().begin(), Opts.getSpecConsts().end());
+  std::sort(SpecConsts.begin(), SpecConsts.end());
+  OS << ";spec-const=";
+  for (auto &SC : SpecConsts)
+    OS << SC.first << ':' << SC.second << ',';
+  OS << ";fp-contract=" << static_cast<uint32_t>(Opts.getFPContractMode());
+  OS << ";bis=" << static_cast<uint32_t>(Opts.getDesiredBIsRepresentation());
+  OS << ";unknown-intrinsics=" << Opts.isSPIRVAllowUnknownIntrinsicsEnabled();
+  OS << ";debug-eis=" << static_cast<uint32_t>(Opts.getDebugInfoEIS());
+  OS << ";dead-entries=" << Opts.isDeadEntryEliminationEnabled();
+  OS << ";fold-branches=" << Opts.isSpecConstBranchFoldingEnabled();
+  // Translation flags which are not part of TranslatorOpts.
+  OS << ";erase-cl-md=" << EraseOCLMD;
+  OS << ";lower-const-expr=" << SPIRVLowerConst;
+  OS << ";expand-step=" << SPIRVEnableStepExpansion;
+  OS << ";kernels=";
+  for (auto &Name : Opts.getSelectedKernels())
+    OS << Name.size() << ':' << Name;
+}
+
+/// \returns true if the last pruning of \p Dir was longer ago than
+/// \p Interval, so that pruneCache is going to prune it again.
+static bool isPruningDue(StringRef Dir, std::chrono::seconds Interval) {
+  SmallString<128> TimestampFile(Dir);
+  sys::path::append(TimestampFile, TimestampFileName);
+  sys::fs::file_status Status;
+  if (sys::fs::status(TimestampFile, Status))
+    return true;
+  return std::chrono::system_clock::now() - Status.getLastModificationTime() >
+         Interval;
+}
+
+/// Remove the temporary files of stores which did not finish, e.g. because
+/// the process was killed, and were last written more than \p MaxAge ago.
+static void removeStaleTempFiles(StringRef Dir, std::chrono::seconds MaxAge) {
+  auto Now = std::chrono::system_clock::now();
+  std::error_code EC;
+  for (sys::fs::directory_iterator File(Dir, EC), FileEnd;
+       File != FileEnd && !EC; File.increment(EC)) {
+    if (!sys::path::filename(File->path()).startswith(TempFilePrefix))
+      continue;
+    ErrorOr<sys::fs::basic_file_status> Status = File->status();
+    if (!Status || Now - Status->getLastModificationTime() <= MaxAge)
+      continue;
+    sys::fs::remove(File->path());
+  }
+}
+
+TranslationCache::TranslationCache(const std::string &Dir,
+                                   uint64_t MaxSizeBytes)
+    : Dir(Dir), MaxSizeBytes(MaxSizeBytes) {}
+
+std::string TranslationCache::getKey(const std::string &Input,
+                                     const TranslatorOpts &Opts,
+                                     const std::string &Kind) {
+  std::string Header;
+  raw_string_ostream OS(Header);
+  OS << "format=" << CacheFormatVersion << ";translator=" << KTranslatorVer
+     << ";kind=" << Kind << ';';
+  encodeTranslatorOpts(Opts, OS);
+  OS << ';' << Input.size() << ';';
+  SHA1 Hasher;
+  Hasher.update(OS.str());
+  Hasher.update(Input);
+  return toHex(Hasher.final(), /*LowerCase=*/true);
+}
+
+bool TranslationCache::lookup(const std::string &Key,
+                              std::string &Result) const {
+  SmallString<128> Path(Dir);
+  sys::path::append(Path, CacheFilePrefix + Key);
+  int FD;
+  if (sys::fs::openFileForRead(Path, FD))
+    return false;
+  auto Buf = MemoryBuffer::getOpenFile(FD, Path, /*FileSize=*/-1,
+                                       /*RequiresNullTerminator=*/false);
+  // Mark the result as recently used, so that eviction keeps it.
+  sys::fs::setLastAccessAndModificationTime(FD,
+                                            std::chrono::system_clock::now());
+  sys::fs::closeFile(FD);
+  if (!Buf)
+    return false;
+  Result = (*Buf)->getBuffer().str();
+  return true;
+}
+
+bool TranslationCache::store(const std::string &Key,
+                             const std::string &Result) {
+  if (sys::fs::create_directories(Dir))
+    return false;
+
+  // Write to a temporary file first and rename it, so that a reader never
+  // sees a partially written result.
+  SmallString<128> TempPath(Dir);
+  sys::path::append(TempPath, Twine(TempFilePrefix) + "%%%%%%%%%%%%");
+  Expected<sys::fs::TempFile> Temp = sys::fs::TempFile::create(TempPath);
+  if (!Temp) {
+    consumeError(Temp.takeError());
+    return false;
+  }
+  {
+    raw_fd_ostream OS(Temp->FD, /*shouldClose=*/false);
+    OS << Result;
+    OS.flush();
+    if (OS.has_error()) {
+      OS.clear_error();
+      consumeError(Temp->discard());
+      return false;
+    }
+  }
+  SmallString<128> Path(Dir);
+  sys::path::append(Path, CacheFilePrefix + Key);
+  if (Error E = Temp->keep(Path)) {
+    consumeError(std::move(E));
+    return false;
+  }
+
+  // Pruning scans the whole directory, so it runs at most once per interval
+  // of the default policy instead of after every store. The temporary files
+  // of killed translations are cleaned up at the same time.
+  CachePruningPolicy Policy;
+  Policy.Expiration = std::chrono::seconds(0);
+  if (MaxSizeBytes)
+    Policy.MaxSizeBytes = MaxSizeBytes;
+  if (isPruningDue(Dir, *Policy.Interval))
+    removeStaleTempFiles(Dir, *Policy.Interval);
+  pruneCache(Dir, Policy);
+  return true;
+}
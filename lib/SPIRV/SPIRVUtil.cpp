@@ -688,15 +688,77 @@ Instruction *mutateCallInst(
   return NewI;
 }
 
+namespace {
+/// Callees created while mutating a batch of calls, keyed by the name returned
+/// by the argument mutation and the signature of the new call. A batch rarely
+/// produces more than one callee, so they are searched linearly.
+class MutatedCalleeCache {
+public:
+  MutatedCalleeCache(Module *M, BuiltinFuncMangleInfo *Mangle,
+                     AttributeList *Attrs, bool TakeFuncName)
+      : M(M), Mangle(Mangle), Attrs(Attrs), TakeFuncName(TakeFuncName) {}
+
+  Function *get(StringRef Name, Type *RetTy, ArrayRef<Value *> Args) {
+    ArgTys.clear();
+    for (auto Arg : Args)
+      ArgTys.push_back(Arg->getType());
+    auto FT = FunctionType::get(RetTy, ArgTys, false);
+    for (auto &C : Callees)
+      if (C.FT == FT && C.Name == Name)
+        return C.F;
+    auto F = getOrCreateFunction(M, RetTy, ArgTys, Name, Mangle, Attrs,
+                                 TakeFuncName);
+    Callees.push_back({Name.str(), FT, F});
+    return F;
+  }
+
+private:
+  struct Callee {
+    std::string Name;
+    FunctionType *FT;
+    Function *F;
+  };
+  Module *M;
+  BuiltinFuncMangleInfo *Mangle;
+  AttributeList *Attrs;
+  bool TakeFuncName;
+  SmallVector<Callee, 2> Callees;
+  SmallVector<Type *, 8> ArgTys;
+};
+} // namespace
+
+void mutateCallInsts(
+    Module *M, ArrayRef<CallInst *> Calls,
+    std::function<std::string(CallInst *, std::vector<Value *> &)> ArgMutate,
+    BuiltinFuncMangleInfo *Mangle, AttributeList *Attrs, bool TakeFuncName) {
+  MutatedCalleeCache Callees(M, Mangle, Attrs, TakeFuncName);
+  std::vector<Value *> Args;
+  for (auto CI : Calls) {
+    LLVM_DEBUG(dbgs() << "[mutateCallInsts] " << *CI);
+    Args.assign(CI->arg_begin(), CI->arg_end());
+    auto NewName = ArgMutate(CI, Args);
+    auto F = Callees.get(NewName, CI->getType(), Args);
+    auto NewCI = CallInst::Create(F, Args, "", CI);
+    NewCI->setCallingConv(F->getCallingConv());
+    NewCI->setAttributes(F->getAttributes());
+    NewCI->setDebugLoc(CI->getDebugLoc());
+    NewCI->takeName(CI);
+    LLVM_DEBUG(dbgs() << " => " << *NewCI << '\n');
+    CI->replaceAllUsesWith(NewCI);
+    CI->eraseFromParent();
+  }
+}
+
 void mutateFunction(
     Function *F,
     std::function<std::string(CallInst *, std::vector<Value *> &)> ArgMutate,
     BuiltinFuncMangleInfo *Mangle, AttributeList *Attrs, bool TakeFuncName) {
-  auto M = F->getParent();
-  for (auto I = F->user_begin(), E = F->user_end(); I != E;) {
-    if (auto CI = dyn_cast<CallInst>(*I++))
-      mutateCallInst(M, CI, ArgMutate, Mangle, Attrs, TakeFuncName);
-  }
+  std::vector<CallInst *> Calls;
+  for (auto U : F->users())
+    if (auto CI = dyn_cast<CallInst>(U))
+      Calls.push_back(CI);
+  mutateCallInsts(F->getParent(), Calls, ArgMutate, Mangle, Attrs,
+                  TakeFuncName);
   if (F->use_empty())
     F->eraseFromParent();
 }
@@ -1285,6 +1347,20 @@ std::string getSPIRVImageTypePostfixes(StringRef SampledType,
   return OS.str();
 }
 
+std::string getSPIRVJointMatrixINTELTypePostfixes(StringRef ComponentType,
+                                                  unsigned Rows,
+                                                  unsigned Columns,
+                                                  unsigned Layout,
+                                                  unsigned Scope) {
+  std::string S;
+  raw_string_ostream OS(S);
+  OS << kSPIRVTypeName::PostfixDelim << ComponentType
+     << kSPIRVTypeName::PostfixDelim << Rows << kSPIRVTypeName::PostfixDelim
+     << Columns << kSPIRVTypeName::PostfixDelim << Layout
+     << kSPIRVTypeName::PostfixDelim << Scope;
+  return OS.str();
+}
+
 std::string getSPIRVImageSampledTypeName(SPIRVType *Ty) {
   switch (Ty->getOpCode()) {
   case OpTypeVoid:
@@ -56,6 +56,7 @@
 #include "VectorComputeUtil.h"
 
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/Analysis/ValueTracking.h"
@@ -63,6 +64,7 @@
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/InlineAsm.h"
+#include "llvm/IR/InstIterator.h"
 #include "llvm/IR/InstrTypes.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
@@ -76,6 +78,7 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Transforms/Utils.h" // loop-simplify pass
+#include "llvm/Transforms/Vectorize.h"
 
 #include <cstdlib>
 #include <functional>
@@ -109,10 +112,31 @@ LLVMToSPIRV::LLVMToSPIRV(SPIRVModule *SMod)
   DbgTran = std::make_unique<LLVMToSPIRVDbgTran>(nullptr, SMod, this);
 }
 
+void LLVMToSPIRV::setSPIRVModule(SPIRVModule *SMod) {
+  BM = SMod;
+  TypeMap.clear();
+  ValueMap.clear();
+  IndexGroupArrayMap.clear();
+  FPContractMap.clear();
+  ReusedTypes.clear();
+  SrcLang = 0;
+  SrcLangVer = 0;
+  DbgTran = std::make_unique<LLVMToSPIRVDbgTran>(nullptr, SMod, this);
+}
+
+void LLVMToSPIRV::setIncremental(const TranslatorOpts &Opts) {
+  IncrementalOpts = std::make_unique<TranslatorOpts>(Opts);
+  LastModule.reset();
+}
+
 bool LLVMToSPIRV::runOnModule(Module &Mod) {
   M = &Mod;
   CG = std::make_unique<CallGraph>(Mod);
   Ctx = &M->getContext();
+  if (IncrementalOpts) {
+    translateIncrementally();
+    return true;
+  }
   DbgTran->setModule(M);
   assert(BM && "SPIR-V module not initialized");
   translate();
@@ -247,11 +271,66 @@ static bool recursiveType(const StructType *ST, const Type *Ty) {
   return Run(Ty);
 }
 
+// A context which already has a struct of the name of a struct being created,
+// for instance because it holds a previous version of the module, appends a
+// number to the name, as in struct.S.0.
+static StringRef getStructBaseName(StructType *ST) {
+  StringRef Name = ST->getName();
+  StringRef Base = Name.rtrim("0123456789");
+  if (Base.size() == Name.size() || !Base.consume_back(".") || Base.empty())
+    return Name;
+  return Base;
+}
+
+/// \returns a hash of the structure of \p T, which is equal for equal types
+/// of different modules. A struct on \p Path, whose elements are being
+/// hashed already, is hashed by name only.
+static hash_code hashTypeShape(Type *T, SmallPtrSetImpl<StructType *> &Path) {
+  hash_code H = hash_combine(T->getTypeID());
+  if (T->isIntegerTy())
+    return hash_combine(H, T->getIntegerBitWidth());
+  if (T->isPointerTy())
+    return hash_combine(H, T->getPointerAddressSpace(),
+                        hashTypeShape(T->getPointerElementType(), Path));
+  if (T->isArrayTy())
+    return hash_combine(H, T->getArrayNumElements(),
+                        hashTypeShape(T->getArrayElementType(), Path));
+  if (T->isVectorTy())
+    return hash_combine(H, T->getVectorNumElements(),
+                        hashTypeShape(T->getVectorElementType(), Path));
+  if (auto FT = dyn_cast<FunctionType>(T)) {
+    H = hash_combine(H, FT->isVarArg(), FT->getNumParams());
+    for (Type *Ty : FT->subtypes())
+      H = hash_combine(H, hashTypeShape(Ty, Path));
+    return H;
+  }
+  if (auto ST = dyn_cast<StructType>(T)) {
+    H = hash_combine(H, ST->isLiteral(), ST->isPacked(), ST->isOpaque());
+    if (ST->hasName())
+      H = hash_combine(H, getStructBaseName(ST));
+    if (ST->isOpaque() || !Path.insert(ST).second)
+      return H;
+    H = hash_combine(H, ST->getNumElements());
+    for (Type *Ty : ST->elements())
+      H = hash_combine(H, hashTypeShape(Ty, Path));
+    Path.erase(ST);
+    return H;
+  }
+  return H;
+}
+
 SPIRVType *LLVMToSPIRV::transType(Type *T) {
   LLVMToSPIRVTypeMap::iterator Loc = TypeMap.find(T);
   if (Loc != TypeMap.end())
     return Loc->second;
 
+  if (!ReusedTypes.empty()) {
+    SmallPtrSet<StructType *, 4> Path;
+    auto It = ReusedTypes.find(hashTypeShape(T, Path));
+    if (It != ReusedTypes.end())
+      return mapType(T, It->second);
+  }
+
   SPIRVDBG(dbgs() << "[transType] " << *T << '\n');
   if (T->isVoidTy())
     return mapType(T, BM->addVoidType());
@@ -475,7 +554,23 @@ SPIRVType *LLVMToSPIRV::transSPIRVOpaqueType(Type *T) {
     return mapType(T, BM->addQueueType());
   else if (TN == kSPIRVTypeName::PipeStorage)
     return mapType(T, BM->addPipeStorageType());
-  else
+  else if (TN == kSPIRVTypeName::JointMatrixINTEL) {
+    if (!BM->checkExtension(ExtensionID::SPV_INTEL_joint_matrix,
+                            SPIRVEC_RequiresExtension,
+                            "SPV_INTEL_joint_matrix\n" + toString(T)))
+      return nullptr;
+    assert(Postfixes.size() == 5 && "Invalid joint matrix type ops");
+    auto TransConst = [&](const std::string &Postfix) {
+      return static_cast<SPIRVConstant *>(
+          transValue(getInt32(M, atoi(Postfix.c_str())), nullptr));
+    };
+    auto CompT = transType(
+        getLLVMTypeForSPIRVImageSampledTypePostfix(Postfixes[0], *Ctx));
+    return mapType(T, BM->addJointMatrixINTELType(
+                          CompT, TransConst(Postfixes[1]),
+                          TransConst(Postfixes[2]), TransConst(Postfixes[3]),
+                          TransConst(Postfixes[4])));
+  } else
     return mapType(T,
                    BM->addOpaqueGenericType(SPIRVOpaqueTypeOpCodeMap::map(TN)));
 }
@@ -628,11 +723,21 @@ SPIRVValue *LLVMToSPIRV::transConstant(Value *V) {
         BT, ConstFP->getValueAPF().bitcastToAPInt().getZExtValue());
   }
 
-  if (auto ConstDA = dyn_cast<ConstantDataArray>(V)) {
+  if (auto ConstDS = dyn_cast<ConstantDataSequential>(V)) {
+    // Emit the elements straight from the packed data instead of creating an
+    // LLVM constant per element first. Repeated values share one OpConstant
+    // because the module uniques constants.
+    SPIRVType *ElemTy = transType(ConstDS->getElementType());
+    bool IsInt = ConstDS->getElementType()->isIntegerTy();
     std::vector<SPIRVValue *> BV;
-    for (unsigned I = 0, E = ConstDA->getNumElements(); I != E; ++I)
-      BV.push_back(transValue(ConstDA->getElementAsConstant(I), nullptr, true,
-                              FuncTransMode::Pointer));
+    BV.reserve(ConstDS->getNumElements());
+    for (unsigned I = 0, E = ConstDS->getNumElements(); I != E; ++I) {
+      uint64_t Bits = IsInt ? ConstDS->getElementAsInteger(I)
+                            : ConstDS->getElementAsAPFloat(I)
+                                  .bitcastToAPInt()
+                                  .getZExtValue();
+      BV.push_back(BM->addConstant(ElemTy, Bits));
+    }
     return BM->addCompositeConstant(transType(V->getType()), BV);
   }
 
@@ -643,14 +748,6 @@ SPIRVValue *LLVMToSPIRV::transConstant(Value *V) {
     return BM->addCompositeConstant(transType(V->getType()), BV);
   }
 
-  if (auto ConstDV = dyn_cast<ConstantDataVector>(V)) {
-    std::vector<SPIRVValue *> BV;
-    for (unsigned I = 0, E = ConstDV->getNumElements(); I != E; ++I)
-      BV.push_back(transValue(ConstDV->getElementAsConstant(I), nullptr, true,
-                              FuncTransMode::Pointer));
-    return BM->addCompositeConstant(transType(V->getType()), BV);
-  }
-
   if (auto ConstV = dyn_cast<ConstantVector>(V)) {
     std::vector<SPIRVValue *> BV;
     for (auto I = ConstV->op_begin(), E = ConstV->op_end(); I != E; ++I)
@@ -777,21 +874,13 @@ SPIRVInstruction *LLVMToSPIRV::transCmpInst(CmpInst *Cmp, SPIRVBasicBlock *BB) {
 SPIRV::SPIRVInstruction *LLVMToSPIRV::transUnaryInst(UnaryInstruction *U,
                                                      SPIRVBasicBlock *BB) {
   Op BOC = OpNop;
-  enum NVPTXAddressSpace {
-    Generic,
-    Global,
-    Internal,
-    Shared,
-    Constant,
-    Local,
-  };
   if (auto Cast = dyn_cast<AddrSpaceCastInst>(U)) {
-    if (Cast->getDestTy()->getPointerAddressSpace() == Generic) {
-      assert(Cast->getSrcTy()->getPointerAddressSpace() != Constant &&
+    if (Cast->getDestTy()->getPointerAddressSpace() == SPIRAS_Generic) {
+      assert(Cast->getSrcTy()->getPointerAddressSpace() != SPIRAS_Constant &&
              "Casts from constant address space to generic are illegal");
       BOC = OpPtrCastToGeneric;
     } else {
-      assert(Cast->getDestTy()->getPointerAddressSpace() != Constant &&
+      assert(Cast->getDestTy()->getPointerAddressSpace() != SPIRAS_Constant &&
              "Casts from generic address space to constant are illegal");
       assert(Cast->getSrcTy()->getPointerAddressSpace() == SPIRAS_Generic);
       BOC = OpGenericCastToPtr;
@@ -1890,6 +1979,14 @@ SPIRVValue *LLVMToSPIRV::transIntrinsicInst(IntrinsicInst *II,
   case Intrinsic::dbg_label:
     return nullptr;
   default:
+    // WMMA fragment operations are rewritten by SPIRVLowerWMMA only when
+    // joint matrices are allowed.
+    if (II->getCalledFunction()->getName().startswith(kNVVMName::WMMAPrefix) &&
+        !BM->checkExtension(ExtensionID::SPV_INTEL_joint_matrix,
+                            SPIRVEC_RequiresExtension,
+                            "SPV_INTEL_joint_matrix\n" +
+                                II->getCalledFunction()->getName().str()))
+      return nullptr;
     if (BM->isSPIRVAllowUnknownIntrinsicsEnabled()) {
       return BM->addCallInst(
           transFunctionDecl(II->getCalledFunction()),
@@ -2280,21 +2377,13 @@ bool LLVMToSPIRV::translate() {
   if (!transGlobalVariables())
     return false;
 
-  for (auto &F : *M) {
-    auto FT = F.getFunctionType();
-    std::map<unsigned, Type *> ChangedType;
-    oclGetMutatedArgumentTypesByBuiltin(FT, ChangedType, &F);
-    mutateFuncArgType(ChangedType, &F);
-  }
+  mutateBuiltinArgTypes();
 
   // SPIR-V logical layout requires all function declarations go before
   // function definitions.
   std::vector<Function *> Decls, Defs;
   for (auto &F : *M) {
-    if (isBuiltinTransToInst(&F) || isBuiltinTransToExtInst(&F) ||
-        F.getName().startswith(SPCV_CAST) ||
-        F.getName().startswith(LLVM_MEMCPY) ||
-        F.getName().startswith(SAMPLER_INIT))
+    if (!isTranslatedAsFunction(&F))
       continue;
     if (F.isDeclaration())
       Decls.push_back(&F);
@@ -2318,6 +2407,24 @@ bool LLVMToSPIRV::translate() {
   return true;
 }
 
+// Calls to builtins translated to instructions and to the casts inserted by
+// mutateFuncArgType are translated by the callers.
+bool LLVMToSPIRV::isTranslatedAsFunction(Function *F) {
+  return !isBuiltinTransToInst(F) && !isBuiltinTransToExtInst(F) &&
+         !F->getName().startswith(SPCV_CAST) &&
+         !F->getName().startswith(LLVM_MEMCPY) &&
+         !F->getName().startswith(SAMPLER_INIT);
+}
+
+void LLVMToSPIRV::mutateBuiltinArgTypes() {
+  for (auto &F : *M) {
+    auto FT = F.getFunctionType();
+    std::map<unsigned, Type *> ChangedType;
+    oclGetMutatedArgumentTypesByBuiltin(FT, ChangedType, &F);
+    mutateFuncArgType(ChangedType, &F);
+  }
+}
+
 llvm::IntegerType *LLVMToSPIRV::getSizetType(unsigned AS) {
   return IntegerType::getIntNTy(M->getContext(),
                                 M->getDataLayout().getPointerSizeInBits(AS));
@@ -2527,11 +2634,14 @@ bool LLVMToSPIRV::transOCLKernelMetadata() {
           [](const std::string &Str, SPIRVFunctionParameter *BA) {
             if (Str.find("volatile") != std::string::npos)
               BA->addDecorate(new SPIRVDecorate(DecorationVolatile, BA));
-            if (Str.find("restrict") != std::string::npos)
+            // noalias arguments are already decorated from their attribute.
+            if (Str.find("restrict") != std::string::npos &&
+                !BA->hasAttr(FunctionParameterAttributeNoAlias))
               BA->addDecorate(
                   new SPIRVDecorate(DecorationFuncParamAttr, BA,
                                     FunctionParameterAttributeNoAlias));
-            if (Str.find("const") != std::string::npos)
+            if (Str.find("const") != std::string::npos &&
+                !BA->hasAttr(FunctionParameterAttributeNoWrite))
               BA->addDecorate(
                   new SPIRVDecorate(DecorationFuncParamAttr, BA,
                                     FunctionParameterAttributeNoWrite));
@@ -2612,6 +2722,15 @@ LLVMToSPIRV::transBuiltinToInstWithoutDecoration(Op OC, CallInst *CI,
     auto BArgs = transValue(getArguments(CI), BB);
     return BM->addSelectInst(BArgs[0], BArgs[1], BArgs[2], BB);
   }
+  case OpCompositeConstruct: {
+    // Only generated for types which have no LLVM counterpart, such as
+    // joint matrices filled with a single value.
+    std::vector<SPIRVId> Constituents;
+    for (auto *BV : transValue(getArguments(CI), BB))
+      Constituents.push_back(BV->getId());
+    return BM->addCompositeConstructInst(transType(CI->getType()),
+                                         Constituents, BB);
+  }
   case OpSampledImage: {
     // Clang can generate SPIRV-friendly call for OpSampledImage instruction,
     // i.e. __spirv_SampledImage... But it can't generate correct return type
@@ -2731,6 +2850,417 @@ bool LLVMToSPIRV::joinFPContract(Function *F, FPContract C) {
   llvm_unreachable("Unhandled FPContract value.");
 }
 
+namespace {
+/// Hashes the parts of a module the incremental mode of LLVMToSPIRV compares
+/// modules by. Global values are identified by their position in the module
+/// and the values local to a function by their position in the function, so
+/// equal modules in the same context hash equally although their values are
+/// distinct. Types are hashed by shape, as the context renames the structs of
+/// a module loaded next to a previous version of it. Uniqued attribute lists
+/// are hashed by address, as the context owns them.
+class ModuleHasher {
+public:
+  explicit ModuleHasher(Module &M) : M(M) {
+    unsigned N = 0;
+    for (const GlobalValue &GV : M.global_values())
+      GlobalNo[&GV] = N++;
+  }
+
+  hash_code hashShape(OCLTypeToSPIRV &TypeAdaptor);
+  hash_code hashBody(const Function &F);
+
+private:
+  hash_code hashType(Type *T);
+  hash_code hashValue(const Value *V);
+  hash_code hashConstant(const Constant *C);
+  hash_code hashMetadata(const Metadata *MD);
+  hash_code hashMDNode(const MDNode *N);
+  hash_code hashInst(const Instruction &I);
+  template <class T> hash_code hashAttachedMetadata(const T &Obj);
+
+  Module &M;
+  DenseMap<const GlobalValue *, unsigned> GlobalNo;
+  // Arguments, blocks and instructions of the function being hashed.
+  DenseMap<const Value *, unsigned> LocalNo;
+  DenseMap<const Constant *, hash_code> ConstantHashes;
+  DenseMap<Type *, hash_code> TypeHashes;
+  // Nodes on the path to the node being hashed, to stop at cycles.
+  DenseMap<const MDNode *, unsigned> MDNodeNo;
+};
+} // anonymous namespace
+
+hash_code ModuleHasher::hashShape(OCLTypeToSPIRV &TypeAdaptor) {
+  hash_code H = hash_combine(M.getDataLayoutStr(), M.getTargetTriple(),
+                             M.getSourceFileName());
+  for (GlobalValue &GV : M.global_values()) {
+    H = hash_combine(H, GV.getValueID(), GV.getName(), hashType(GV.getType()),
+                     hashType(GV.getValueType()), GV.getLinkage(),
+                     GV.getVisibility(), GV.getThreadLocalMode(),
+                     GV.getUnnamedAddr(), GV.getDLLStorageClass());
+    if (auto GO = dyn_cast<GlobalObject>(&GV))
+      H = hash_combine(H, GO->getSection(), GO->getAlignment(),
+                       hashAttachedMetadata(*GO));
+    if (auto GVar = dyn_cast<GlobalVariable>(&GV)) {
+      H = hash_combine(H, GVar->isConstant(), GVar->isExternallyInitialized());
+      if (GVar->hasInitializer())
+        H = hash_combine(H, hashConstant(GVar->getInitializer()));
+    } else if (auto F = dyn_cast<Function>(&GV)) {
+      H = hash_combine(H, F->getCallingConv(),
+                       F->getAttributes().getRawPointer(), F->isDeclaration(),
+                       hashType(TypeAdaptor.getAdaptedType(F)));
+      for (const Argument &Arg : F->args())
+        H = hash_combine(H, Arg.getName());
+    } else if (auto GA = dyn_cast<GlobalAlias>(&GV)) {
+      H = hash_combine(H, hashConstant(GA->getAliasee()));
+    }
+  }
+  for (const NamedMDNode &NMD : M.named_metadata()) {
+    H = hash_combine(H, NMD.getName());
+    for (const MDNode *Op : NMD.operands())
+      H = hash_combine(H, hashMetadata(Op));
+  }
+  return H;
+}
+
+hash_code ModuleHasher::hashBody(const Function &F) {
+  LocalNo.clear();
+  unsigned N = 0;
+  for (const Argument &Arg : F.args())
+    LocalNo[&Arg] = N++;
+  for (const BasicBlock &BB : F) {
+    LocalNo[&BB] = N++;
+    for (const Instruction &I : BB)
+      LocalNo[&I] = N++;
+  }
+  hash_code H = hash_combine(F.isDeclaration(), F.size());
+  for (const BasicBlock &BB : F) {
+    H = hash_combine(H, BB.getName(), BB.size());
+    for (const Instruction &I : BB)
+      H = hash_combine(H, I.getName(), hashInst(I));
+  }
+  return H;
+}
+
+hash_code ModuleHasher::hashType(Type *T) {
+  if (!T)
+    return hash_code(0);
+  auto Loc = TypeHashes.find(T);
+  if (Loc != TypeHashes.end())
+    return Loc->second;
+  SmallPtrSet<StructType *, 4> Path;
+  return TypeHashes[T] = hashTypeShape(T, Path);
+}
+
+hash_code ModuleHasher::hashValue(const Value *V) {
+  if (auto GV = dyn_cast<GlobalValue>(V))
+    return hash_combine(0, GlobalNo.lookup(GV));
+  if (auto C = dyn_cast<Constant>(V))
+    return hashConstant(C);
+  auto Loc = LocalNo.find(V);
+  if (Loc != LocalNo.end())
+    return hash_combine(1, Loc->second);
+  if (auto MDV = dyn_cast<MetadataAsValue>(V))
+    return hash_combine(2, hashMetadata(MDV->getMetadata()));
+  if (auto Asm = dyn_cast<InlineAsm>(V))
+    return hash_combine(3, hashType(Asm->getFunctionType()),
+                        Asm->getAsmString(), Asm->getConstraintString(),
+                        Asm->hasSideEffects(), Asm->isAlignStack(),
+                        Asm->getDialect());
+  return hash_combine(4, V->getValueID(), hashType(V->getType()));
+}
+
+hash_code ModuleHasher::hashConstant(const Constant *C) {
+  if (auto GV = dyn_cast<GlobalValue>(C))
+    return hashValue(GV);
+  if (auto CI = dyn_cast<ConstantInt>(C))
+    return hash_combine(hashType(CI->getType()), CI->getValue());
+  if (auto CFP = dyn_cast<ConstantFP>(C))
+    return hash_combine(hashType(CFP->getType()), CFP->getValueAPF());
+  if (auto CDS = dyn_cast<ConstantDataSequential>(C))
+    return hash_combine(hashType(CDS->getType()), CDS->getRawDataValues());
+  if (auto BA = dyn_cast<BlockAddress>(C)) {
+    Function *F = BA->getFunction();
+    return hash_combine(
+        hashValue(F),
+        std::distance(F->begin(), BA->getBasicBlock()->getIterator()));
+  }
+
+  auto Loc = ConstantHashes.find(C);
+  if (Loc != ConstantHashes.end())
+    return Loc->second;
+  hash_code H = hash_combine(C->getValueID(), hashType(C->getType()),
+                             C->getRawSubclassOptionalData());
+  if (auto CE = dyn_cast<ConstantExpr>(C)) {
+    H = hash_combine(H, CE->getOpcode());
+    if (CE->isCompare())
+      H = hash_combine(H, CE->getPredicate());
+    if (CE->hasIndices())
+      H = hash_combine(H, hash_combine_range(CE->getIndices().begin(),
+                                             CE->getIndices().end()));
+    if (auto GEP = dyn_cast<GEPOperator>(CE))
+      H = hash_combine(H, hashType(GEP->getSourceElementType()));
+  }
+  for (const Value *Op : C->operands())
+    H = hash_combine(H, hashValue(Op));
+  ConstantHashes[C] = H;
+  return H;
+}
+
+hash_code ModuleHasher::hashMetadata(const Metadata *MD) {
+  if (!MD)
+    return hash_code(0);
+  if (auto S = dyn_cast<MDString>(MD))
+    return hash_combine(MD->getMetadataID(), S->getString());
+  if (auto VAM = dyn_cast<ValueAsMetadata>(MD))
+    return hash_combine(MD->getMetadataID(), hashValue(VAM->getValue()));
+  if (auto N = dyn_cast<MDNode>(MD))
+    return hashMDNode(N);
+  return hash_combine(MD->getMetadataID(), MD);
+}
+
+// Tuples such as kernel annotations and loop metadata are hashed by contents,
+// since they refer to the values of the module. Other nodes, mostly debug
+// information, are hashed by address: a module with those is never
+// translated incrementally.
+hash_code ModuleHasher::hashMDNode(const MDNode *N) {
+  if (!isa<MDTuple>(N))
+    return hash_combine(N->getMetadataID(), N);
+  auto Loc = MDNodeNo.find(N);
+  if (Loc != MDNodeNo.end())
+    return hash_combine(N->getMetadataID(), Loc->second);
+  MDNodeNo[N] = MDNodeNo.size();
+  hash_code H = hash_combine(N->getMetadataID(), N->isDistinct(),
+                             N->getNumOperands());
+  for (const MDOperand &Op : N->operands())
+    H = hash_combine(H, hashMetadata(Op));
+  MDNodeNo.erase(N);
+  return H;
+}
+
+template <class T> hash_code ModuleHasher::hashAttachedMetadata(const T &Obj) {
+  SmallVector<std::pair<unsigned, MDNode *>, 4> MDs;
+  Obj.getAllMetadata(MDs);
+  hash_code H = hash_combine(MDs.size());
+  for (auto &MD : MDs)
+    H = hash_combine(H, MD.first, hashMetadata(MD.second));
+  return H;
+}
+
+hash_code ModuleHasher::hashInst(const Instruction &I) {
+  hash_code H = hash_combine(I.getOpcode(), hashType(I.getType()),
+                             I.getRawSubclassOptionalData(),
+                             I.getNumOperands(), hashAttachedMetadata(I));
+  for (const Value *Op : I.operands())
+    H = hash_combine(H, hashValue(Op));
+
+  if (auto Cmp = dyn_cast<CmpInst>(&I))
+    return hash_combine(H, Cmp->getPredicate());
+  if (auto LI = dyn_cast<LoadInst>(&I))
+    return hash_combine(H, LI->isVolatile(), LI->getAlignment(),
+                        LI->getOrdering(), LI->getSyncScopeID());
+  if (auto SI = dyn_cast<StoreInst>(&I))
+    return hash_combine(H, SI->isVolatile(), SI->getAlignment(),
+                        SI->getOrdering(), SI->getSyncScopeID());
+  if (auto AI = dyn_cast<AllocaInst>(&I))
+    return hash_combine(H, hashType(AI->getAllocatedType()),
+                        AI->getAlignment());
+  if (auto GEP = dyn_cast<GetElementPtrInst>(&I))
+    return hash_combine(H, hashType(GEP->getSourceElementType()));
+  if (auto CB = dyn_cast<CallBase>(&I)) {
+    H = hash_combine(H, CB->getCallingConv(),
+                     CB->getAttributes().getRawPointer(),
+                     hashType(CB->getFunctionType()));
+    if (auto CI = dyn_cast<CallInst>(CB))
+      H = hash_combine(H, CI->getTailCallKind());
+    // The signature of the callee is part of the module shape already, but
+    // keep the body hash meaningful on its own.
+    if (const Function *Callee = CB->getCalledFunction())
+      H = hash_combine(H, hashType(Callee->getFunctionType()),
+                       Callee->getAttributes().getRawPointer(),
+                       Callee->getCallingConv());
+    return H;
+  }
+  if (auto RMW = dyn_cast<AtomicRMWInst>(&I))
+    return hash_combine(H, RMW->getOperation(), RMW->isVolatile(),
+                        RMW->getOrdering(), RMW->getSyncScopeID());
+  if (auto CX = dyn_cast<AtomicCmpXchgInst>(&I))
+    return hash_combine(H, CX->isVolatile(), CX->isWeak(),
+                        CX->getSuccessOrdering(), CX->getFailureOrdering(),
+                        CX->getSyncScopeID());
+  if (auto Fence = dyn_cast<FenceInst>(&I))
+    return hash_combine(H, Fence->getOrdering(), Fence->getSyncScopeID());
+  if (auto EV = dyn_cast<ExtractValueInst>(&I))
+    return hash_combine(H, hash_combine_range(EV->idx_begin(), EV->idx_end()));
+  if (auto IV = dyn_cast<InsertValueInst>(&I))
+    return hash_combine(H, hash_combine_range(IV->idx_begin(), IV->idx_end()));
+  if (auto SV = dyn_cast<ShuffleVectorInst>(&I)) {
+    SmallVector<int, 16> Mask;
+    SV->getShuffleMask(Mask);
+    return hash_combine(H, hash_combine_range(Mask.begin(), Mask.end()));
+  }
+  if (auto PN = dyn_cast<PHINode>(&I)) {
+    for (const BasicBlock *BB : PN->blocks())
+      H = hash_combine(H, hashValue(BB));
+    return H;
+  }
+  return H;
+}
+
+LLVMToSPIRV::ModuleHashes LLVMToSPIRV::hashModule() {
+  ModuleHasher Hasher(*M);
+  ModuleHashes Hashes;
+  Hashes.Shape = Hasher.hashShape(getAnalysis<OCLTypeToSPIRV>());
+  for (const Function &F : *M)
+    Hashes.Bodies.push_back(Hasher.hashBody(F));
+  Hashes.NumGlobals = M->global_size();
+  return Hashes;
+}
+
+// The hashes are taken before the translation, which changes the module.
+// Functions and globals the translation adds are appended and never looked up
+// in the saved state.
+void LLVMToSPIRV::translateIncrementally() {
+  ModuleHashes Hashes = hashModule();
+  bool HasDebugInfo =
+      !M->debug_compile_units().empty() ||
+      any_of(*M, [](const Function &F) { return F.getSubprogram(); });
+  bool Translated = LastModule && LastModule->Hashes.Shape == Hashes.Shape &&
+                    !HasDebugInfo && transChangedFunctions(Hashes);
+  if (!Translated) {
+    OwnedBM.reset(SPIRVModule::createSPIRVModule(*IncrementalOpts));
+    setSPIRVModule(OwnedBM.get());
+    DbgTran->setModule(M);
+    Translated = translate();
+  }
+  LastModule.reset();
+  ReusedTypes.clear();
+  std::string ErrMsg;
+  if (Translated && BM->getErrorLog().getError(ErrMsg) == SPIRVEC_Success)
+    LastModule = saveIncrementalState(std::move(Hashes));
+  TypeMap.clear();
+  ValueMap.clear();
+}
+
+// Reuses the SPIR-V of the functions whose bodies hash as they did in the last
+// module, and translates the other ones again. Returns false if the module
+// has to be translated from scratch.
+bool LLVMToSPIRV::transChangedFunctions(const ModuleHashes &Hashes) {
+  const IncrementalState &Last = *LastModule;
+  TypeMap.clear();
+  ValueMap.clear();
+  FPContractMap.clear();
+  IndexGroupArrayMap.clear();
+  for (auto &I : Last.TypeIds)
+    ReusedTypes[I.first] = static_cast<SPIRVType *>(BM->getEntry(I.second));
+  DbgTran = std::make_unique<LLVMToSPIRVDbgTran>(M, BM, this);
+
+  std::vector<Function *> Funcs, Changed;
+  for (auto &F : *M)
+    Funcs.push_back(&F);
+  for (size_t I = 0, E = Last.FuncIds.size(); I != E; ++I) {
+    Function *F = Funcs[I];
+    if (Last.FuncIds[I] != SPIRVID_INVALID)
+      ValueMap[F] = BM->getValue(Last.FuncIds[I]);
+    if (!F->isDeclaration() && Hashes.Bodies[I] != Last.Hashes.Bodies[I])
+      Changed.push_back(F);
+    else if (Last.FPContracts[I] != FPContract::UNDEF)
+      FPContractMap[F] = Last.FPContracts[I];
+  }
+  // Globals removed as dead entries are translated again, so that changed
+  // functions may use them. Their annotations cannot be, as those were
+  // translated with the other global values.
+  bool HasAnnotations = M->getNamedGlobal("llvm.global.annotations");
+  auto GI = M->global_begin();
+  for (size_t I = 0, E = Last.GlobalIds.size(); I != E; ++I, ++GI) {
+    if (GI->getName() == "llvm.global.annotations")
+      continue;
+    if (Last.GlobalIds[I] != SPIRVID_INVALID)
+      ValueMap[&*GI] = BM->getValue(Last.GlobalIds[I]);
+    else if (HasAnnotations || !transValue(&*GI, nullptr))
+      return false;
+  }
+
+  mutateBuiltinArgTypes();
+  for (auto F : Changed) {
+    if (!isTranslatedAsFunction(F))
+      continue;
+    if (auto BF = static_cast<SPIRVFunction *>(getTranslatedValue(F)))
+      BM->eraseFunctionBody(BF);
+    transFunction(F);
+  }
+
+  // Contraction requirements propagate to the callers, so the execution modes
+  // of unchanged kernels stay valid only if no function changed its one.
+  for (size_t I = 0, E = Last.FPContracts.size(); I != E; ++I)
+    if (Last.FPContracts[I] == FPContract::DISABLED)
+      fpContractUpdateRecursive(Funcs[I], FPContract::DISABLED);
+  for (size_t I = 0, E = Last.FPContracts.size(); I != E; ++I)
+    if (getFPContract(Funcs[I]) != Last.FPContracts[I])
+      return false;
+
+  for (size_t I = 0, E = Last.FuncIds.size(); I != E; ++I) {
+    if (!isKernel(Funcs[I]))
+      continue;
+    if (auto BF = static_cast<SPIRVFunction *>(getTranslatedValue(Funcs[I]))) {
+      BF->clearVariables();
+      collectInputOutputVariables(BF, Funcs[I]);
+    }
+  }
+
+  BM->optimizeDecorates();
+  BM->resolveUnknownStructFields();
+  BM->createForwardPointers();
+  return true;
+}
+
+std::unique_ptr<LLVMToSPIRV::IncrementalState>
+LLVMToSPIRV::saveIncrementalState(ModuleHashes Hashes) {
+  auto State = std::make_unique<IncrementalState>();
+  auto GetId = [&](Value *V) {
+    auto BV = getTranslatedValue(V);
+    return BV ? BV->getId() : SPIRVID_INVALID;
+  };
+  auto FI = M->begin();
+  for (size_t I = 0, E = Hashes.Bodies.size(); I != E; ++I, ++FI) {
+    State->FuncIds.push_back(GetId(&*FI));
+    State->FPContracts.push_back(getFPContract(&*FI));
+  }
+  auto GI = M->global_begin();
+  for (size_t I = 0; I != Hashes.NumGlobals; ++I, ++GI)
+    State->GlobalIds.push_back(GetId(&*GI));
+  State->Hashes = std::move(Hashes);
+
+  // The types are looked up by shape in the next module, whose structs the
+  // context may have renamed.
+  std::vector<std::pair<size_t, SPIRVId>> Types;
+  for (auto &I : TypeMap)
+    if (I.second) {
+      SmallPtrSet<StructType *, 4> Path;
+      Types.emplace_back(hashTypeShape(I.first, Path), I.second->getId());
+    }
+
+  // The entries of the replaced function bodies are erased with them, but the
+  // types and constants only they used are left to the dead entry elimination.
+  if (IncrementalOpts->isDeadEntryEliminationEnabled()) {
+    BM->eliminateDeadEntries();
+    for (auto &Id : State->GlobalIds)
+      if (Id != SPIRVID_INVALID && !BM->exist(Id))
+        Id = SPIRVID_INVALID;
+  }
+
+  std::set<size_t> Ambiguous;
+  for (auto &I : Types) {
+    if (!BM->exist(I.second))
+      continue;
+    auto Ins = State->TypeIds.insert(I);
+    if (!Ins.second && Ins.first->second != I.second)
+      Ambiguous.insert(I.first);
+  }
+  for (size_t H : Ambiguous)
+    State->TypeIds.erase(H);
+  return State;
+}
+
 } // namespace SPIRV
 
 char LLVMToSPIRV::ID = 0;
@@ -2745,11 +3275,13 @@ ModulePass *llvm::createLLVMToSPIRV(SPIRVModule *SMod) {
   return new LLVMToSPIRV(SMod);
 }
 
-void addPassesForSPIRV(legacy::PassManager &PassMgr,
-                       const SPIRV::TranslatorOpts &Opts) {
+void llvm::addPassesForSPIRV(legacy::PassManagerBase &PassMgr,
+                             const SPIRV::TranslatorOpts &Opts) {
   if (Opts.isSPIRVMemToRegEnabled())
     PassMgr.add(createPromoteMemoryToRegisterPass());
   PassMgr.add(createPreprocessMetadata());
+  PassMgr.add(createSPIRVLowerNVPTXAddrSpace());
+  PassMgr.add(createSPIRVLowerNVVMAsyncCopy());
   PassMgr.add(createOCL21ToSPIRV());
   PassMgr.add(createSPIRVLowerSPIRBlocks());
   PassMgr.add(createOCLTypeToSPIRV());
@@ -2759,6 +3291,12 @@ void addPassesForSPIRV(legacy::PassManager &PassMgr,
   PassMgr.add(createSPIRVLowerConstExpr());
   PassMgr.add(createSPIRVLowerBool());
   PassMgr.add(createSPIRVLowerMemmove());
+  if (Opts.isAllowedToUseExtension(ExtensionID::SPV_INTEL_joint_matrix))
+    PassMgr.add(createSPIRVLowerWMMA());
+  // Runs last, so that the lowering passes above see the original scalar
+  // accesses and the vector accesses are translated as they are.
+  if (Opts.isLoadStoreVectorizationEnabled())
+    PassMgr.add(createLoadStoreVectorizerPass());
 }
 
 bool isValidLLVMModule(Module *M, SPIRVErrorLog &ErrorLog) {
@@ -2793,27 +3331,255 @@ bool llvm::writeSpirv(Module *M, std::ostream &OS, std::string &ErrMsg) {
   return llvm::writeSpirv(M, DefaultOpts, OS, ErrMsg);
 }
 
-bool llvm::writeSpirv(Module *M, const SPIRV::TranslatorOpts &Opts,
-                      std::ostream &OS, std::string &ErrMsg) {
-  std::unique_ptr<SPIRVModule> BM(SPIRVModule::createSPIRVModule(Opts));
-  if (!isValidNVPTXModule(M, BM->getErrorLog()))
+/// Removes the kernels which are not selected by \p Opts, together with the
+/// functions and global variables which only they reach, so that the rest of
+/// the translation only sees the call graph of the selected kernels. Kernels
+/// are the functions listed as !"kernel" in !nvvm.annotations and SPIR
+/// kernels. Returns false if a selected kernel is not in \p M.
+static bool removeUnselectedKernels(Module &M, SPIRVErrorLog &ErrorLog,
+                                    const SPIRV::TranslatorOpts &Opts) {
+  if (!Opts.hasSelectedKernels())
+    return true;
+
+  SmallPtrSet<GlobalValue *, 32> Live;
+  SmallVector<GlobalValue *, 32> Worklist;
+  auto MarkLive = [&](GlobalValue *GV) {
+    if (Live.insert(GV).second)
+      Worklist.push_back(GV);
+  };
+
+  std::set<std::string> Missing = Opts.getSelectedKernels();
+  auto SelectKernel = [&](Function *F) {
+    if (!F || F->isDeclaration() || !Opts.isKernelSelected(F->getName().str()))
+      return;
+    Missing.erase(F->getName().str());
+    MarkLive(F);
+  };
+  NamedMDNode *Annotations = M.getNamedMetadata("nvvm.annotations");
+  if (Annotations) {
+    for (MDNode *MD : Annotations->operands()) {
+      if (MD->getNumOperands() != 3)
+        continue;
+      auto *Kind = dyn_cast<MDString>(MD->getOperand(1));
+      if (Kind && Kind->getString() == "kernel")
+        SelectKernel(mdconst::dyn_extract_or_null<Function>(MD->getOperand(0)));
+    }
+  }
+  for (Function &F : M)
+    if (F.getCallingConv() == CallingConv::SPIR_KERNEL)
+      SelectKernel(&F);
+  if (!Missing.empty())
+    return ErrorLog.checkError(false, SPIRVEC_UnknownKernel, *Missing.begin());
+
+  // Intrinsic global variables such as llvm.used keep alive what they list.
+  for (GlobalVariable &GV : M.globals())
+    if (GV.getName().startswith("llvm."))
+      MarkLive(&GV);
+
+  SmallPtrSet<const Constant *, 32> Visited;
+  auto ScanOperands = [&](User *U) {
+    SmallVector<User *, 16> Stack{U};
+    while (!Stack.empty()) {
+      User *Cur = Stack.pop_back_val();
+      for (Value *Op : Cur->operands()) {
+        if (auto *GV = dyn_cast<GlobalValue>(Op))
+          MarkLive(GV);
+        else if (auto *C = dyn_cast<Constant>(Op))
+          if (Visited.insert(C).second)
+            Stack.push_back(C);
+      }
+    }
+  };
+  while (!Worklist.empty()) {
+    GlobalValue *GV = Worklist.pop_back_val();
+    ScanOperands(GV);
+    if (auto *F = dyn_cast<Function>(GV))
+      for (Instruction &I : instructions(F))
+        ScanOperands(&I);
+  }
+
+  // Annotations of the removed kernels must go before the kernels do.
+  if (Annotations) {
+    SmallVector<MDNode *, 16> Kept;
+    for (MDNode *MD : Annotations->operands()) {
+      auto *GV = MD->getNumOperands()
+                     ? mdconst::dyn_extract_or_null<GlobalValue>(
+                           MD->getOperand(0))
+                     : nullptr;
+      if (!GV || Live.count(GV))
+        Kept.push_back(MD);
+    }
+    Annotations->clearOperands();
+    for (MDNode *MD : Kept)
+      Annotations->addOperand(MD);
+  }
+
+  std::vector<GlobalValue *> Dead;
+  for (Function &F : M)
+    if (!Live.count(&F))
+      Dead.push_back(&F);
+  for (GlobalVariable &GV : M.globals())
+    if (!Live.count(&GV))
+      Dead.push_back(&GV);
+  for (GlobalAlias &GA : M.aliases())
+    if (!Live.count(&GA))
+      Dead.push_back(&GA);
+  for (GlobalValue *GV : Dead)
+    GV->dropAllReferences();
+  for (GlobalValue *GV : Dead) {
+    GV->removeDeadConstantUsers();
+    if (!GV->use_empty())
+      GV->replaceAllUsesWith(UndefValue::get(GV->getType()));
+    GV->eraseFromParent();
+  }
+  return true;
+}
+
+/// Checks \p M and removes the kernels not selected by \p Opts before the
+/// translation passes run.
+static bool prepareLLVMToSPIRV(Module *M, SPIRVErrorLog &ErrorLog,
+                               const SPIRV::TranslatorOpts &Opts,
+                               std::string &ErrMsg) {
+  if (!isValidNVPTXModule(M, ErrorLog) ||
+      !removeUnselectedKernels(*M, ErrorLog, Opts)) {
+    ErrorLog.getError(ErrMsg);
     return false;
+  }
+  return true;
+}
 
-  legacy::PassManager PassMgr;
+static bool finishLLVMToSPIRV(SPIRVModule &BM,
+                              const SPIRV::TranslatorOpts &Opts,
+                              std::string &ErrMsg) {
+  if (BM.getError(ErrMsg) != SPIRVEC_Success)
+    return false;
+  if (Opts.isDeadEntryEliminationEnabled())
+    BM.eliminateDeadEntries();
+  return true;
+}
+
+/// Adds the passes translating a module to \p BM to \p PassMgr.
+/// \returns the translation pass.
+static LLVMToSPIRV *addTranslationPasses(legacy::PassManager &PassMgr,
+                                         SPIRVModule *BM,
+                                         const SPIRV::TranslatorOpts &Opts,
+                                         bool SimplifyLoops) {
   addPassesForSPIRV(PassMgr, Opts);
   // Run loop simplify pass in order to avoid duplicate OpLoopMerge
   // instruction. It can happen in case of continue operand in the loop.
-  if (hasLoopMetadata(M))
+  if (SimplifyLoops)
     PassMgr.add(createLoopSimplifyPass());
-  PassMgr.add(createLLVMToSPIRV(BM.get()));
+  auto Writer = new LLVMToSPIRV(BM);
+  PassMgr.add(Writer);
+  return Writer;
+}
+
+static bool translateLLVMToSPIRV(Module *M, SPIRVModule &BM,
+                                 const SPIRV::TranslatorOpts &Opts,
+                                 std::string &ErrMsg) {
+  if (!prepareLLVMToSPIRV(M, BM.getErrorLog(), Opts, ErrMsg))
+    return false;
+  legacy::PassManager PassMgr;
+  addTranslationPasses(PassMgr, &BM, Opts, hasLoopMetadata(M));
   PassMgr.run(*M);
+  return finishLLVMToSPIRV(BM, Opts, ErrMsg);
+}
 
-  if (BM->getError(ErrMsg) != SPIRVEC_Success)
+bool llvm::writeSpirv(Module *M, const SPIRV::TranslatorOpts &Opts,
+                      std::ostream &OS, std::string &ErrMsg) {
+  std::unique_ptr<SPIRVModule> BM(SPIRVModule::createSPIRVModule(Opts));
+  if (!translateLLVMToSPIRV(M, *BM, Opts, ErrMsg))
     return false;
   OS << *BM;
   return true;
 }
 
+bool llvm::writeSpirv(Module *M, const SPIRV::TranslatorOpts &Opts,
+                      std::vector<uint32_t> &Words, std::string &ErrMsg) {
+  std::unique_ptr<SPIRVModule> BM(SPIRVModule::createSPIRVModule(Opts));
+  if (!translateLLVMToSPIRV(M, *BM, Opts, ErrMsg))
+    return false;
+  if (!writeSpirvModule(*BM, Words)) {
+    BM->getError(ErrMsg);
+    return false;
+  }
+  return true;
+}
+
+llvm::SpirvTranslatorSession::SpirvTranslatorSession(
+    const SPIRV::TranslatorOpts &Opts)
+    : Opts(Opts), Context(std::make_unique<LLVMContext>()) {}
+
+llvm::SpirvTranslatorSession::~SpirvTranslatorSession() {}
+
+bool llvm::SpirvTranslatorSession::translate(Module *M, SPIRVModule &BM,
+                                             std::string &ErrMsg) {
+  if (!prepareLLVMToSPIRV(M, BM.getErrorLog(), Opts, ErrMsg))
+    return false;
+  bool SimplifyLoops = hasLoopMetadata(M);
+  auto &PassMgr = WriterPMs[SimplifyLoops];
+  if (!PassMgr) {
+    PassMgr = std::make_unique<legacy::PassManager>();
+    Writers[SimplifyLoops] =
+        addTranslationPasses(*PassMgr, &BM, Opts, SimplifyLoops);
+  } else
+    Writers[SimplifyLoops]->setSPIRVModule(&BM);
+  PassMgr->run(*M);
+  // The maps of the writer point into BM, whose entries may be erased below
+  // and which the caller destroys.
+  Writers[SimplifyLoops]->setSPIRVModule(nullptr);
+  return finishLLVMToSPIRV(BM, Opts, ErrMsg);
+}
+
+bool llvm::SpirvTranslatorSession::writeSpirv(Module *M, std::ostream &OS,
+                                              std::string &ErrMsg) {
+  std::unique_ptr<SPIRVModule> BM(SPIRVModule::createSPIRVModule(Opts));
+  if (!translate(M, *BM, ErrMsg))
+    return false;
+  OS << *BM;
+  return true;
+}
+
+bool llvm::SpirvTranslatorSession::writeSpirv(Module *M,
+                                              std::vector<uint32_t> &Words,
+                                              std::string &ErrMsg) {
+  std::unique_ptr<SPIRVModule> BM(SPIRVModule::createSPIRVModule(Opts));
+  if (!translate(M, *BM, ErrMsg))
+    return false;
+  if (!writeSpirvModule(*BM, Words)) {
+    BM->getError(ErrMsg);
+    return false;
+  }
+  return true;
+}
+
+bool llvm::SpirvTranslatorSession::writeSpirvIncremental(
+    Module *M, std::vector<uint32_t> &Words, std::string &ErrMsg) {
+  SPIRVErrorLog ErrorLog;
+  if (!prepareLLVMToSPIRV(M, ErrorLog, Opts, ErrMsg))
+    return false;
+  bool SimplifyLoops = hasLoopMetadata(M);
+  auto &PassMgr = IncrementalPMs[SimplifyLoops];
+  if (!PassMgr) {
+    PassMgr = std::make_unique<legacy::PassManager>();
+    IncrementalWriters[SimplifyLoops] =
+        addTranslationPasses(*PassMgr, nullptr, Opts, SimplifyLoops);
+    IncrementalWriters[SimplifyLoops]->setIncremental(Opts);
+  }
+  PassMgr->run(*M);
+  SPIRVModule *BM = IncrementalWriters[SimplifyLoops]->getSPIRVModule();
+  bool Written = BM->getError(ErrMsg) == SPIRVEC_Success;
+  if (Written && !writeSpirvModule(*BM, Words)) {
+    BM->getError(ErrMsg);
+    Written = false;
+  }
+  // The state refers to the uniqued attribute lists of the context, which
+  // only the session context is known to keep alive.
+  if (&M->getContext() != Context.get())
+    IncrementalWriters[SimplifyLoops]->setIncremental(Opts);
+  return Written;
+}
+
 bool llvm::regularizeLlvmForSpirv(Module *M, std::string &ErrMsg) {
   SPIRV::TranslatorOpts DefaultOpts;
   // To preserve old behavior of the translator, let's enable all extensions
@@ -53,10 +53,12 @@
 #include "SPIRVType.h"
 #include "SPIRVValue.h"
 
+#include "llvm/ADT/Hashing.h"
 #include "llvm/Analysis/CallGraph.h"
 #include "llvm/IR/IntrinsicInst.h"
 
 #include <memory>
+#include <unordered_map>
 
 using namespace llvm;
 using namespace SPIRV;
@@ -74,6 +76,20 @@ public:
 
   bool runOnModule(Module &Mod) override;
 
+  /// Translate the next module run on to \p SMod, forgetting everything
+  /// about the modules translated before.
+  void setSPIRVModule(SPIRVModule *SMod);
+
+  /// Keep translating to the same SPIR-V module, created with \p Opts and
+  /// owned by the pass, as long as only function bodies change between the
+  /// modules run on, and re-translate the changed functions only. The
+  /// modules are compared in part by the addresses of the attribute lists
+  /// and metadata their context owns, so the context of the last module must
+  /// outlive the next run, or this is to be called again in between.
+  void setIncremental(const TranslatorOpts &Opts);
+
+  SPIRVModule *getSPIRVModule() const { return BM; }
+
   void getAnalysisUsage(AnalysisUsage &AU) const override {
     AU.addRequired<OCLTypeToSPIRV>();
   }
@@ -202,6 +218,36 @@ private:
       const Function *FS,
       const std::unordered_set<const Function *> Funcs) const;
   void collectInputOutputVariables(SPIRVFunction *SF, Function *F);
+  bool isTranslatedAsFunction(Function *F);
+  void mutateBuiltinArgTypes();
+
+  // Incremental mode.
+  struct ModuleHashes {
+    hash_code Shape;               // Everything except function bodies.
+    std::vector<hash_code> Bodies; // Per function, in module order.
+    size_t NumGlobals = 0;
+  };
+  struct IncrementalState {
+    ModuleHashes Hashes;
+    std::vector<SPIRVId> FuncIds;
+    std::vector<SPIRVId> GlobalIds;
+    std::vector<FPContract> FPContracts;
+    /// Translated types by the hash of their shape, leaving out the hashes
+    /// shared by types translated differently.
+    std::unordered_map<size_t, SPIRVId> TypeIds;
+  };
+  std::unique_ptr<TranslatorOpts> IncrementalOpts;
+  std::unique_ptr<SPIRVModule> OwnedBM;
+  /// The last module translated in incremental mode, if it succeeded.
+  std::unique_ptr<IncrementalState> LastModule;
+  /// Types of the last module, which transType maps the types of the module
+  /// being translated incrementally to by shape.
+  std::unordered_map<size_t, SPIRVType *> ReusedTypes;
+
+  ModuleHashes hashModule();
+  void translateIncrementally();
+  bool transChangedFunctions(const ModuleHashes &Hashes);
+  std::unique_ptr<IncrementalState> saveIncrementalState(ModuleHashes Hashes);
 };
 
 } // namespace SPIRV
@@ -49,7 +49,8 @@
 using namespace SPIRV;
 
 SPIRVBasicBlock::SPIRVBasicBlock(SPIRVId TheId, SPIRVFunction *Func)
-    : SPIRVValue(Func->getModule(), 2, OpLabel, TheId), ParentF(Func) {
+    : SPIRVValue(Func->getModule(), 2, OpLabel, TheId), ParentF(Func),
+      FirstInst(nullptr), LastInst(nullptr), NumInst(0) {
   setAttr();
   validate();
 }
@@ -58,31 +59,72 @@ SPIRVDecoder SPIRVBasicBlock::getDecoder(std::istream &IS) {
   return SPIRVDecoder(IS, *this);
 }
 
+SPIRVInstruction *
+SPIRVBasicBlock::getPrevious(const SPIRVInstruction *I) const {
+  assert(I->getParent() == this && "Instruction is not in this block");
+  return I->Prev;
+}
+
+SPIRVInstruction *SPIRVBasicBlock::getNext(const SPIRVInstruction *I) const {
+  assert(I->getParent() == this && "Instruction is not in this block");
+  return I->Next;
+}
+
 /// Assume I contains valid Id.
 SPIRVInstruction *
 SPIRVBasicBlock::addInstruction(SPIRVInstruction *I,
                                 const SPIRVInstruction *InsertBefore) {
   assert(I && "Invalid instruction");
+  assert(!I->Prev && !I->Next && I != FirstInst &&
+         "Instruction is already in a block");
   Module->add(I);
   I->setParent(this);
+  SPIRVInstruction *Pos = nullptr;
   if (InsertBefore) {
-    auto Pos = find(InsertBefore);
+    assert(InsertBefore->getParent() == this && "Invalid insertion point");
+    Pos = const_cast<SPIRVInstruction *>(InsertBefore);
     // If insertion of a new instruction before the one passed to the function
     // is illegal, insertion before the returned instruction is guaranteed
     // to retain correct instruction order in a block
-    if (Pos != InstVec.begin() && (isa<OpLoopMerge>(*std::prev(Pos)) ||
-                                   isa<OpLoopControlINTEL>(*std::prev(Pos))))
-      --Pos;
-    InstVec.insert(Pos, I);
-  } else
-    InstVec.push_back(I);
+    if (Pos->Prev && (isa<OpLoopMerge>(Pos->Prev) ||
+                      isa<OpLoopControlINTEL>(Pos->Prev)))
+      Pos = Pos->Prev;
+  }
+  I->Next = Pos;
+  I->Prev = Pos ? Pos->Prev : LastInst;
+  if (I->Prev)
+    I->Prev->Next = I;
+  else
+    FirstInst = I;
+  if (Pos)
+    Pos->Prev = I;
+  else
+    LastInst = I;
+  ++NumInst;
   return I;
 }
 
+void SPIRVBasicBlock::eraseInstruction(const SPIRVInstruction *I) {
+  assert(I->getParent() == this && "Instruction is not in this block");
+  SPIRVInstruction *Prev = I->Prev;
+  SPIRVInstruction *Next = I->Next;
+  if (Prev)
+    Prev->Next = Next;
+  else
+    FirstInst = Next;
+  if (Next)
+    Next->Prev = Prev;
+  else
+    LastInst = Prev;
+  auto *Inst = const_cast<SPIRVInstruction *>(I);
+  Inst->Prev = Inst->Next = nullptr;
+  --NumInst;
+}
+
 void SPIRVBasicBlock::encodeChildren(spv_ostream &O) const {
   O << SPIRVNL();
-  for (size_t I = 0, E = InstVec.size(); I != E; ++I)
-    O << *InstVec[I];
+  for (const SPIRVInstruction *I = FirstInst; I; I = I->Next)
+    O << *I;
 }
 
 _SPIRV_IMP_ENCDEC1(SPIRVBasicBlock, Id)
@@ -41,7 +41,6 @@
 #define SPIRV_LIBSPIRV_SPIRVBASICBLOCK_H
 
 #include "SPIRVValue.h"
-#include <algorithm>
 
 namespace SPIRV {
 class SPIRVFunction;
@@ -52,42 +51,29 @@ class SPIRVBasicBlock : public SPIRVValue {
 public:
   SPIRVBasicBlock(SPIRVId TheId, SPIRVFunction *Func);
 
-  SPIRVBasicBlock() : SPIRVValue(OpLabel), ParentF(NULL) { setAttr(); }
+  SPIRVBasicBlock()
+      : SPIRVValue(OpLabel), ParentF(NULL), FirstInst(nullptr),
+        LastInst(nullptr), NumInst(0) {
+    setAttr();
+  }
 
   SPIRVDecoder getDecoder(std::istream &IS) override;
   SPIRVFunction *getParent() const { return ParentF; }
-  size_t getNumInst() const { return InstVec.size(); }
-  SPIRVInstruction *getInst(size_t I) const { return InstVec[I]; }
-  SPIRVInstruction *getPrevious(const SPIRVInstruction *I) const {
-    auto Loc = find(I);
-    if (Loc == InstVec.end() || Loc == InstVec.begin())
-      return nullptr;
-    return *(--Loc);
-  }
-  SPIRVInstruction *getNext(const SPIRVInstruction *I) const {
-    auto Loc = find(I);
-    if (Loc == InstVec.end())
-      return nullptr;
-    ++Loc;
-    if (Loc == InstVec.end())
-      return nullptr;
-    return *Loc;
-  }
+  size_t getNumInst() const { return NumInst; }
+  /// Instructions form an intrusive list, so positioning and walking is
+  /// constant time. Iterate with getFirstInst() and getNext().
+  SPIRVInstruction *getFirstInst() const { return FirstInst; }
+  SPIRVInstruction *getPrevious(const SPIRVInstruction *I) const;
+  SPIRVInstruction *getNext(const SPIRVInstruction *I) const;
   // Return the last instruction in the BB or nullptr if the BB is empty.
-  const SPIRVInstruction *getTerminateInstr() const {
-    return InstVec.empty() ? nullptr : InstVec.back();
-  }
+  const SPIRVInstruction *getTerminateInstr() const { return LastInst; }
 
   void setScope(SPIRVEntry *Scope) override;
   void setParent(SPIRVFunction *F) { ParentF = F; }
   SPIRVInstruction *
   addInstruction(SPIRVInstruction *I,
                  const SPIRVInstruction *InsertBefore = nullptr);
-  void eraseInstruction(const SPIRVInstruction *I) {
-    auto Loc = find(I);
-    assert(Loc != InstVec.end());
-    InstVec.erase(Loc);
-  }
+  void eraseInstruction(const SPIRVInstruction *I);
 
   void setAttr() { setHasNoType(); }
   _SPIRV_DCL_ENCDEC
@@ -99,17 +85,9 @@ public:
 
 private:
   SPIRVFunction *ParentF;
-  typedef std::vector<SPIRVInstruction *> SPIRVInstructionVector;
-  SPIRVInstructionVector InstVec;
-
-  SPIRVInstructionVector::const_iterator
-  find(const SPIRVInstruction *Inst) const {
-    return std::find(InstVec.begin(), InstVec.end(), Inst);
-  }
-
-  SPIRVInstructionVector::iterator find(const SPIRVInstruction *Inst) {
-    return std::find(InstVec.begin(), InstVec.end(), Inst);
-  }
+  SPIRVInstruction *FirstInst;
+  SPIRVInstruction *LastInst;
+  size_t NumInst;
 };
 
 typedef SPIRVBasicBlock SPIRVLabel;
@@ -43,9 +43,8 @@
 #include "SPIRVValue.h"
 
 namespace SPIRV {
-template <class T, class B>
-spv_ostream &operator<<(spv_ostream &O, const std::multiset<T *, B> &V) {
-  for (auto &I : V)
+spv_ostream &operator<<(spv_ostream &O, const SPIRVDecorateSet &Decs) {
+  for (auto &I : Decs)
     O << *I;
   return O;
 }
@@ -257,6 +256,46 @@ operator()(const SPIRVDecorateGeneric *A, const SPIRVDecorateGeneric *B) const {
   return Res;
 }
 
+SPIRVDecorateSet::value_type SPIRVDecorateSet::insert(value_type Dec) {
+  auto Res = Unique.insert(Dec);
+  if (!Res.second) {
+    SPIRVDBG(spvdbgs() << "[compare decorate] " << *Dec << " vs " << **Res.first
+                       << " : same\n");
+    return *Res.first;
+  }
+  SPIRVDBG(spvdbgs() << "[add decorate] " << *Dec << '\n');
+  if (IsSorted && !Decs.empty())
+    IsSorted = !SPIRVDecorateGeneric::Comparator()(Dec, Decs.back());
+  Decs.push_back(Dec);
+  return Dec;
+}
+
+void SPIRVDecorateSet::sort() const {
+  if (IsSorted)
+    return;
+  // Stable sort keeps equivalent decorations in insertion order, as
+  // std::multiset does.
+  std::stable_sort(Decs.begin(), Decs.end(),
+                   SPIRVDecorateGeneric::Comparator());
+  IsSorted = true;
+}
+
+size_t
+SPIRVDecorateSet::Hash::operator()(const SPIRVDecorateGeneric *Dec) const {
+  // Must be consistent with operator== below.
+  size_t H = Dec->getTargetId();
+  auto Combine = [&H](size_t V) {
+    H ^= V + 0x9e3779b9 + (H << 6) + (H >> 2);
+  };
+  Combine(Dec->getOpCode());
+  if (Dec->isMemberDecorate())
+    Combine(static_cast<const SPIRVMemberDecorate *>(Dec)->getMemberNumber());
+  Combine(Dec->getDecorateKind());
+  for (size_t I = 0, E = Dec->getLiteralCount(); I != E; ++I)
+    Combine(Dec->getLiteral(I));
+  return H;
+}
+
 bool operator==(const SPIRVDecorateGeneric &A, const SPIRVDecorateGeneric &B) {
   if (A.getTargetId() != B.getTargetId())
     return false;
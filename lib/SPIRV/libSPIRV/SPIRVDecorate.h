@@ -44,6 +44,7 @@
 #include "SPIRVStream.h"
 #include "SPIRVUtil.h"
 #include <string>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -106,27 +107,55 @@ protected:
   SPIRVDecorationGroup *Owner; // Owning decorate group
 };
 
-class SPIRVDecorateSet
-    : public std::multiset<SPIRVDecorateGeneric *,
-                           SPIRVDecorateGeneric::Comparator> {
+/// Set of decorations emitted at module scope, ordered by
+/// SPIRVDecorateGeneric::Comparator. Duplicates, i.e. decorations equal by
+/// target, kind and literals, are detected with a hash lookup. Decorations are
+/// kept in insertion order and only sorted when the set is walked, which gives
+/// the same order as a std::multiset without its per-insertion cost.
+class SPIRVDecorateSet {
 public:
-  typedef std::multiset<SPIRVDecorateGeneric *,
-                        SPIRVDecorateGeneric::Comparator>
-      BaseType;
-  iterator insert(value_type &Dec) {
-    auto ER = BaseType::equal_range(Dec);
-    for (auto I = ER.first, E = ER.second; I != E; ++I) {
-      SPIRVDBG(spvdbgs() << "[compare decorate] " << *Dec << " vs " << **I
-                         << " : ");
-      if (**I == *Dec)
-        return I;
-      SPIRVDBG(spvdbgs() << " diff\n");
-    }
-    SPIRVDBG(spvdbgs() << "[add decorate] " << *Dec << '\n');
-    return BaseType::insert(Dec);
+  typedef SPIRVDecorateGeneric *value_type;
+  typedef std::vector<value_type>::const_iterator const_iterator;
+  typedef const_iterator iterator;
+
+  /// Insert \p Dec unless an equal decoration is already in the set.
+  /// \returns the decoration kept in the set.
+  value_type insert(value_type Dec);
+  const_iterator begin() const {
+    sort();
+    return Decs.begin();
+  }
+  const_iterator end() const {
+    sort();
+    return Decs.end();
+  }
+  bool empty() const { return Decs.empty(); }
+  size_t size() const { return Decs.size(); }
+  void clear() {
+    Decs.clear();
+    Unique.clear();
+    IsSorted = true;
   }
+
+private:
+  struct Hash {
+    size_t operator()(const SPIRVDecorateGeneric *Dec) const;
+  };
+  struct Equal {
+    bool operator()(const SPIRVDecorateGeneric *A,
+                    const SPIRVDecorateGeneric *B) const {
+      return *A == *B;
+    }
+  };
+  void sort() const;
+
+  mutable std::vector<value_type> Decs;
+  mutable bool IsSorted = true;
+  std::unordered_set<value_type, Hash, Equal> Unique;
 };
 
+spv_ostream &operator<<(spv_ostream &O, const SPIRVDecorateSet &Decs);
+
 class SPIRVDecorate : public SPIRVDecorateGeneric {
 public:
   static const Op OC = OpDecorate;
@@ -333,6 +362,12 @@ public:
     Targets.resize(WC - FixedWC);
   }
   virtual void decorateTargets() = 0;
+  SPIRVDecorationGroup *getDecorationGroup() const { return DecorationGroup; }
+  const std::vector<SPIRVId> &getTargets() const { return Targets; }
+  void setTargets(const std::vector<SPIRVId> &TheTargets) {
+    Targets = TheTargets;
+    SPIRVEntryNoIdGeneric::setWordCount(FixedWC + Targets.size());
+  }
   _SPIRV_DCL_ENCDEC
 protected:
   SPIRVDecorationGroup *DecorationGroup;
@@ -130,9 +130,31 @@ void SPIRVEntry::setWordCount(SPIRVWord TheWordCount) {
   WordCount = TheWordCount;
 }
 
+SPIRVEntry::~SPIRVEntry() {
+  if (Attrib & SPIRVEA_NAME)
+    Module->getEntryInfoIndex().eraseName(this);
+  if (Attrib & SPIRVEA_LINE)
+    Module->getEntryInfoIndex().eraseLine(this);
+}
+
+const std::string &SPIRVEntry::getName() const {
+  static const std::string NoName;
+  if (!(Attrib & SPIRVEA_NAME))
+    return NoName;
+  return Module->getEntryInfoIndex().getName(this);
+}
+
 void SPIRVEntry::setName(const std::string &TheName) {
-  Name = TheName;
-  SPIRVDBG(spvdbgs() << "Set name for obj " << Id << " " << Name << '\n');
+  SPIRVDBG(spvdbgs() << "Set name for obj " << Id << " " << TheName << '\n');
+  if (TheName.empty()) {
+    if (Attrib & SPIRVEA_NAME)
+      Module->getEntryInfoIndex().eraseName(this);
+    Attrib &= ~SPIRVEA_NAME;
+    return;
+  }
+  assert(Module && "Entry must belong to a module to have a name");
+  Module->getEntryInfoIndex().setName(this, TheName);
+  Attrib |= SPIRVEA_NAME;
 }
 
 void SPIRVEntry::setModule(SPIRVModule *TheModule) {
@@ -148,8 +170,8 @@ void SPIRVEntry::encode(spv_ostream &O) const {
 }
 
 void SPIRVEntry::encodeName(spv_ostream &O) const {
-  if (!Name.empty())
-    O << SPIRVName(this, Name);
+  if (Attrib & SPIRVEA_NAME)
+    O << SPIRVName(this, getName());
 }
 
 bool SPIRVEntry::isEndOfBlock() const {
@@ -171,9 +193,13 @@ void SPIRVEntry::encodeLine(spv_ostream &O) const {
   if (!Module)
     return;
   const std::shared_ptr<const SPIRVLine> &CurrLine = Module->getCurrentLine();
-  if (Line && ((CurrLine && *Line != *CurrLine) || !CurrLine)) {
-    O << *Line;
-    Module->setCurrentLine(Line);
+  if (hasLine()) {
+    const std::shared_ptr<const SPIRVLine> &Line =
+        Module->getEntryInfoIndex().getLine(this);
+    if (!CurrLine || *Line != *CurrLine) {
+      O << *Line;
+      Module->setCurrentLine(Line);
+    }
   }
   if (isEndOfBlock() || OpCode == OpNoLine)
     Module->setCurrentLine(nullptr);
@@ -248,7 +274,7 @@ void SPIRVEntry::validateBuiltin(SPIRVWord TheSet, SPIRVWord Index) const {
 
 void SPIRVEntry::addDecorate(SPIRVDecorate *Dec) {
   auto Kind = Dec->getDecorateKind();
-  Decorates.insert(std::make_pair(Dec->getDecorateKind(), Dec));
+  Module->getDecorateIndex().add(Id, Dec);
   Module->addDecorate(Dec);
   if (Kind == spv::DecorationLinkageAttributes) {
     auto *LinkageAttr = static_cast<const SPIRVDecorateLinkageAttr *>(Dec);
@@ -265,22 +291,33 @@ void SPIRVEntry::addDecorate(Decoration Kind, SPIRVWord Literal) {
   addDecorate(new SPIRVDecorate(Kind, this, Literal));
 }
 
-void SPIRVEntry::eraseDecorate(Decoration Dec) { Decorates.erase(Dec); }
+void SPIRVEntry::eraseDecorate(Decoration Dec) {
+  Module->getDecorateIndex().erase(Id, Dec);
+}
 
-void SPIRVEntry::takeDecorates(SPIRVEntry *E) {
-  Decorates = std::move(E->Decorates);
-  SPIRVDBG(spvdbgs() << "[takeDecorates] " << Id << '\n';)
+std::shared_ptr<const SPIRVLine> SPIRVEntry::getLine() const {
+  if (!hasLine())
+    return nullptr;
+  return Module->getEntryInfoIndex().getLine(this);
 }
 
 void SPIRVEntry::setLine(const std::shared_ptr<const SPIRVLine> &L) {
-  Line = L;
   SPIRVDBG(if (L) spvdbgs() << "[setLine] " << *L << '\n';)
+  if (!L) {
+    if (hasLine())
+      Module->getEntryInfoIndex().eraseLine(this);
+    Attrib &= ~SPIRVEA_LINE;
+    return;
+  }
+  assert(Module && "Entry must belong to a module to have a line");
+  Module->getEntryInfoIndex().setLine(this, L);
+  Attrib |= SPIRVEA_LINE;
 }
 
 void SPIRVEntry::addMemberDecorate(SPIRVMemberDecorate *Dec) {
   assert(canHaveMemberDecorates() &&
-         MemberDecorates.find(Dec->getPair()) == MemberDecorates.end());
-  MemberDecorates[Dec->getPair()] = Dec;
+         !findMemberDecorate(Dec->getDecorateKind(), Dec->getMemberNumber()));
+  Module->getDecorateIndex().addMember(Id, Dec);
   Module->addDecorate(Dec);
   SPIRVDBG(spvdbgs() << "[addMemberDecorate] " << *Dec << '\n';)
 }
@@ -295,31 +332,39 @@ void SPIRVEntry::addMemberDecorate(SPIRVWord MemberNumber, Decoration Kind,
 }
 
 void SPIRVEntry::eraseMemberDecorate(SPIRVWord MemberNumber, Decoration Dec) {
-  MemberDecorates.erase(std::make_pair(MemberNumber, Dec));
-}
-
-void SPIRVEntry::takeMemberDecorates(SPIRVEntry *E) {
-  MemberDecorates = std::move(E->MemberDecorates);
-  SPIRVDBG(spvdbgs() << "[takeMemberDecorates] " << Id << '\n';)
+  Module->getDecorateIndex().eraseMember(Id, MemberNumber, Dec);
 }
 
+// Decorations are indexed by the Id shared by the forward reference and the
+// entry replacing it, so only the name and execution modes need moving.
 void SPIRVEntry::takeAnnotations(SPIRVForward *E) {
   Module->setName(this, E->getName());
-  takeDecorates(E);
-  takeMemberDecorates(E);
   if (OpCode == OpFunction)
     static_cast<SPIRVFunction *>(this)->takeExecutionModes(E);
 }
 
+const SPIRVDecorate *SPIRVEntry::findDecorate(Decoration Kind) const {
+  if (!hasId())
+    return nullptr;
+  return Module->getDecorateIndex().find(Id, Kind);
+}
+
+const SPIRVMemberDecorate *
+SPIRVEntry::findMemberDecorate(Decoration Kind, SPIRVWord MemberNumber) const {
+  if (!hasId())
+    return nullptr;
+  return Module->getDecorateIndex().findMember(Id, MemberNumber, Kind);
+}
+
 // Check if an entry has Kind of decoration and get the literal of the
 // first decoration of such kind at Index.
 bool SPIRVEntry::hasDecorate(Decoration Kind, size_t Index,
                              SPIRVWord *Result) const {
-  DecorateMapType::const_iterator Loc = Decorates.find(Kind);
-  if (Loc == Decorates.end())
+  auto Dec = findDecorate(Kind);
+  if (!Dec)
     return false;
   if (Result)
-    *Result = Loc->second->getLiteral(Index);
+    *Result = Dec->getLiteral(Index);
   return true;
 }
 
@@ -328,73 +373,68 @@ bool SPIRVEntry::hasDecorate(Decoration Kind, size_t Index,
 bool SPIRVEntry::hasMemberDecorate(Decoration Kind, size_t Index,
                                    SPIRVWord MemberNumber,
                                    SPIRVWord *Result) const {
-  auto Loc = MemberDecorates.find({MemberNumber, Kind});
-  if (Loc == MemberDecorates.end())
+  auto Dec = findMemberDecorate(Kind, MemberNumber);
+  if (!Dec)
     return false;
   if (Result)
-    *Result = Loc->second->getLiteral(Index);
+    *Result = Dec->getLiteral(Index);
   return true;
 }
 
 std::vector<std::string>
 SPIRVEntry::getDecorationStringLiteral(Decoration Kind) const {
-  auto Loc = Decorates.find(Kind);
-  if (Loc == Decorates.end())
+  auto Dec = findDecorate(Kind);
+  if (!Dec)
     return {};
 
-  return getVecString(Loc->second->getVecLiteral());
+  return getVecString(Dec->getVecLiteral());
 }
 
 std::vector<std::string>
 SPIRVEntry::getMemberDecorationStringLiteral(Decoration Kind,
                                              SPIRVWord MemberNumber) const {
-  auto Loc = MemberDecorates.find({MemberNumber, Kind});
-  if (Loc == MemberDecorates.end())
+  auto Dec = findMemberDecorate(Kind, MemberNumber);
+  if (!Dec)
     return {};
 
-  return getVecString(Loc->second->getVecLiteral());
+  return getVecString(Dec->getVecLiteral());
 }
 
 std::vector<SPIRVWord>
 SPIRVEntry::getDecorationLiterals(Decoration Kind) const {
-  auto Loc = Decorates.find(Kind);
-  if (Loc == Decorates.end())
+  auto Dec = findDecorate(Kind);
+  if (!Dec)
     return {};
 
-  return (Loc->second->getVecLiteral());
+  return (Dec->getVecLiteral());
 }
 
 std::vector<SPIRVWord>
 SPIRVEntry::getMemberDecorationLiterals(Decoration Kind,
                                         SPIRVWord MemberNumber) const {
-  auto Loc = MemberDecorates.find({MemberNumber, Kind});
-  if (Loc == MemberDecorates.end())
+  auto Dec = findMemberDecorate(Kind, MemberNumber);
+  if (!Dec)
     return {};
 
-  return (Loc->second->getVecLiteral());
+  return (Dec->getVecLiteral());
 }
 
 // Get literals of all decorations of Kind at Index.
 std::set<SPIRVWord> SPIRVEntry::getDecorate(Decoration Kind,
                                             size_t Index) const {
-  auto Range = Decorates.equal_range(Kind);
   std::set<SPIRVWord> Value;
-  for (auto I = Range.first, E = Range.second; I != E; ++I) {
-    assert(Index < I->second->getLiteralCount() && "Invalid index");
-    Value.insert(I->second->getLiteral(Index));
+  for (auto Dec : getDecorations(Kind)) {
+    assert(Index < Dec->getLiteralCount() && "Invalid index");
+    Value.insert(Dec->getLiteral(Index));
   }
   return Value;
 }
 
 std::vector<SPIRVDecorate const *>
 SPIRVEntry::getDecorations(Decoration Kind) const {
-  auto Range = Decorates.equal_range(Kind);
-  std::vector<SPIRVDecorate const *> Decors;
-  Decors.reserve(Decorates.count(Kind));
-  for (auto I = Range.first, E = Range.second; I != E; ++I) {
-    Decors.push_back(I->second);
-  }
-  return Decors;
+  if (!hasId())
+    return {};
+  return Module->getDecorateIndex().get(Id, Kind);
 }
 
 bool SPIRVEntry::hasLinkageType() const {
@@ -420,25 +460,18 @@ bool SPIRVEntry::isExtInst(const SPIRVExtInstSetKind InstSet,
   return false;
 }
 
-void SPIRVEntry::encodeDecorate(spv_ostream &O) const {
-  for (auto &I : Decorates)
-    O << *I.second;
-}
-
 SPIRVLinkageTypeKind SPIRVEntry::getLinkageType() const {
   assert(hasLinkageType());
-  DecorateMapType::const_iterator Loc =
-      Decorates.find(DecorationLinkageAttributes);
-  if (Loc == Decorates.end())
+  auto Dec = findDecorate(DecorationLinkageAttributes);
+  if (!Dec)
     return LinkageTypeInternal;
-  return static_cast<const SPIRVDecorateLinkageAttr *>(Loc->second)
-      ->getLinkageType();
+  return static_cast<const SPIRVDecorateLinkageAttr *>(Dec)->getLinkageType();
 }
 
 void SPIRVEntry::setLinkageType(SPIRVLinkageTypeKind LT) {
   assert(isValid(LT));
   assert(hasLinkageType());
-  addDecorate(new SPIRVDecorateLinkageAttr(this, Name, LT));
+  addDecorate(new SPIRVDecorateLinkageAttr(this, getName(), LT));
 }
 
 void SPIRVEntry::updateModuleVersion() const {
@@ -238,32 +238,34 @@ public:
     SPIRVEA_DEFAULT = 0,
     SPIRVEA_NOID = 1,   // Entry has no valid id
     SPIRVEA_NOTYPE = 2, // Value has no type
+    SPIRVEA_NAME = 4,   // Entry has a name in the module's info index
+    SPIRVEA_LINE = 8,   // Entry has a line in the module's info index
   };
 
   // Complete constructor for objects with id
   SPIRVEntry(SPIRVModule *M, unsigned TheWordCount, Op TheOpCode, SPIRVId TheId)
       : Module(M), OpCode(TheOpCode), Id(TheId), Attrib(SPIRVEA_DEFAULT),
-        WordCount(TheWordCount), Line(nullptr) {
+        WordCount(TheWordCount) {
     SPIRVEntry::validate();
   }
 
   // Complete constructor for objects without id
   SPIRVEntry(SPIRVModule *M, unsigned TheWordCount, Op TheOpCode)
       : Module(M), OpCode(TheOpCode), Id(SPIRVID_INVALID), Attrib(SPIRVEA_NOID),
-        WordCount(TheWordCount), Line(nullptr) {
+        WordCount(TheWordCount) {
     SPIRVEntry::validate();
   }
 
   // Incomplete constructor
   SPIRVEntry(Op TheOpCode)
       : Module(NULL), OpCode(TheOpCode), Id(SPIRVID_INVALID),
-        Attrib(SPIRVEA_DEFAULT), WordCount(0), Line(nullptr) {}
+        Attrib(SPIRVEA_DEFAULT), WordCount(0) {}
 
   SPIRVEntry()
       : Module(NULL), OpCode(OpNop), Id(SPIRVID_INVALID),
-        Attrib(SPIRVEA_DEFAULT), WordCount(0), Line(nullptr) {}
+        Attrib(SPIRVEA_DEFAULT), WordCount(0) {}
 
-  virtual ~SPIRVEntry() {}
+  virtual ~SPIRVEntry();
 
   bool exist(SPIRVId) const;
   template <class T> T *get(SPIRVId TheId) const {
@@ -284,13 +286,13 @@ public:
     assert(hasId());
     return Id;
   }
-  std::shared_ptr<const SPIRVLine> getLine() const { return Line; }
+  std::shared_ptr<const SPIRVLine> getLine() const;
   SPIRVLinkageTypeKind getLinkageType() const;
   Op getOpCode() const { return OpCode; }
   SPIRVModule *getModule() const { return Module; }
   virtual SPIRVCapVec getRequiredCapability() const { return SPIRVCapVec(); }
   virtual SPIRVExtSet getRequiredExtensions() const { return SPIRVExtSet(); }
-  const std::string &getName() const { return Name; }
+  const std::string &getName() const;
   bool hasDecorate(Decoration Kind, size_t Index = 0,
                    SPIRVWord *Result = 0) const;
   bool hasMemberDecorate(Decoration Kind, size_t Index = 0,
@@ -306,7 +308,7 @@ public:
   std::set<SPIRVWord> getDecorate(Decoration Kind, size_t Index = 0) const;
   std::vector<SPIRVDecorate const *> getDecorations(Decoration Kind) const;
   bool hasId() const { return !(Attrib & SPIRVEA_NOID); }
-  bool hasLine() const { return Line != nullptr; }
+  bool hasLine() const { return Attrib & SPIRVEA_LINE; }
   bool hasLinkageType() const;
   bool isAtomic() const { return isAtomicOpCode(OpCode); }
   bool isBasicBlock() const { return isLabel(); }
@@ -347,8 +349,6 @@ public:
   void setName(const std::string &TheName);
   virtual void setScope(SPIRVEntry *Scope){};
   void takeAnnotations(SPIRVForward *);
-  void takeDecorates(SPIRVEntry *);
-  void takeMemberDecorates(SPIRVEntry *);
 
   /// After a SPIRV entry is created during reading SPIRV binary by default
   /// constructor, this function is called to allow the SPIRV entry to resize
@@ -370,7 +370,6 @@ public:
   virtual void encodeAll(spv_ostream &O) const;
   virtual void encodeName(spv_ostream &O) const;
   virtual void encodeChildren(spv_ostream &O) const;
-  virtual void encodeDecorate(spv_ostream &O) const;
   virtual void encodeWordCountOpCode(spv_ostream &O) const;
   virtual void encode(spv_ostream &O) const;
   virtual void decode(std::istream &I);
@@ -397,32 +396,24 @@ public:
   }
 
 protected:
-  /// An entry may have multiple FuncParamAttr decorations.
-  typedef std::multimap<Decoration, const SPIRVDecorate *> DecorateMapType;
-  typedef std::map<std::pair<SPIRVWord, Decoration>,
-                   const SPIRVMemberDecorate *>
-      MemberDecorateMapType;
-
   bool canHaveMemberDecorates() const {
     return OpCode == OpTypeStruct || OpCode == OpForward;
   }
-  MemberDecorateMapType &getMemberDecorates() {
-    assert(canHaveMemberDecorates());
-    return MemberDecorates;
-  }
+  /// Decorations are kept in the module's SPIRVDecorateIndex keyed by the Id of
+  /// the entry, so they survive the replacement of a forward reference.
+  const SPIRVDecorate *findDecorate(Decoration Kind) const;
+  const SPIRVMemberDecorate *findMemberDecorate(Decoration Kind,
+                                                SPIRVWord MemberNumber) const;
 
   void updateModuleVersion() const;
 
+  /// Names and lines are kept in the module's SPIRVEntryInfoIndex, since most
+  /// entries have neither. Attrib records whether the index has them.
   SPIRVModule *Module;
   Op OpCode;
   SPIRVId Id;
-  std::string Name;
   unsigned Attrib;
   SPIRVWord WordCount;
-
-  DecorateMapType Decorates;
-  MemberDecorateMapType MemberDecorates;
-  std::shared_ptr<const SPIRVLine> Line;
 };
 
 class SPIRVEntryNoIdGeneric : public SPIRVEntry {
@@ -831,6 +822,8 @@ public:
     case CapabilityVectorComputeINTEL:
     case CapabilityVectorAnyINTEL:
       return getSet(ExtensionID::SPV_INTEL_vector_compute);
+    case CapabilityJointMatrixINTEL:
+      return getSet(ExtensionID::SPV_INTEL_joint_matrix);
     default:
       return SPIRVExtSet();
     }
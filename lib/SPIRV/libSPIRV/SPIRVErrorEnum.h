@@ -12,3 +12,6 @@ _SPIRV_OP(InvalidBitWidth, "Invalid bit width in input:")
 _SPIRV_OP(InvalidModule, "Invalid SPIR-V module:")
 _SPIRV_OP(UnimplementedOpCode, "Unimplemented opcode")
 _SPIRV_OP(FunctionPointers, "Can't translate function pointer:\n")
+_SPIRV_OP(UnknownKernel, "Selected kernel is not in the module:")
+_SPIRV_OP(RequiresExtension,
+          "Feature requires the following SPIR-V extension:\n")
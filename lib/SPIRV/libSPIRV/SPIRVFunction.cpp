@@ -43,7 +43,9 @@
 #include "SPIRVStream.h"
 
 #include <algorithm>
+#include <cstring>
 #include <functional>
+#include <sstream>
 using namespace SPIRV;
 
 SPIRVFunctionParameter::SPIRVFunctionParameter(SPIRVType *TheType,
@@ -58,9 +60,8 @@ SPIRVFunctionParameter::SPIRVFunctionParameter(SPIRVType *TheType,
 
 void SPIRVFunctionParameter::foreachAttr(
     std::function<void(SPIRVFuncParamAttrKind)> Func) {
-  auto Locs = Decorates.equal_range(DecorationFuncParamAttr);
-  for (auto I = Locs.first, E = Locs.second; I != E; ++I) {
-    auto Attr = static_cast<SPIRVFuncParamAttrKind>(I->second->getLiteral(0));
+  for (auto Dec : getDecorations(DecorationFuncParamAttr)) {
+    auto Attr = static_cast<SPIRVFuncParamAttrKind>(Dec->getLiteral(0));
     assert(isValid(Attr));
     Func(Attr);
   }
@@ -111,6 +112,15 @@ void SPIRVFunction::decode(std::istream &I) {
       break;
     }
     case OpLabel: {
+#ifdef _SPIRV_SUPPORT_TEXT_FMT
+      bool IsBinary = !SPIRVUseTextFormat;
+#else
+      bool IsBinary = true;
+#endif
+      if (IsBinary && Module->isLazyFunctionDecodingEnabled()) {
+        keepBody(Decoder);
+        break;
+      }
       if (!decodeBB(Decoder))
         return;
       break;
@@ -177,11 +187,49 @@ bool SPIRVFunction::decodeBB(SPIRVDecoder &Decoder) {
   return true;
 }
 
+/// Copy the binary of the basic blocks, starting from the OpLabel whose word
+/// count and opcode have already been read, up to OpFunctionEnd.
+void SPIRVFunction::keepBody(SPIRVDecoder &Decoder) {
+  std::string Body;
+  do {
+    SPIRVWord WordCountAndOpCode = (Decoder.WordCount << 16) | Decoder.OpCode;
+    size_t Pos = Body.size();
+    Body.resize(Pos + Decoder.WordCount * sizeof(SPIRVWord));
+    std::memcpy(&Body[Pos], &WordCountAndOpCode, sizeof(SPIRVWord));
+    Decoder.IS.read(&Body[Pos + sizeof(SPIRVWord)],
+                    (Decoder.WordCount - 1) * sizeof(SPIRVWord));
+  } while (Decoder.getWordCountAndOpCode() && Decoder.WordCount != 0 &&
+           Decoder.OpCode != OpFunctionEnd);
+  LazyBody = std::move(Body);
+}
+
+bool SPIRVFunction::materialize() {
+  if (isMaterialized())
+    return true;
+  SPIRVDBG(spvdbgs() << "Materialize function: " << Id << '\n');
+  // A body which failed to decode once would fail again, and its Ids are
+  // already taken in the module.
+  if (!Module->isModuleValid())
+    return false;
+  std::istringstream IS(LazyBody);
+  SPIRVDecoder Decoder = getDecoder(IS);
+  Module->setCurrentLine(nullptr);
+  Decoder.getWordCountAndOpCode();
+  while (Decoder.OpCode == OpLabel)
+    if (!decodeBB(Decoder)) {
+      // Drop the blocks decoded so far so that a partial body is never
+      // visible; the function stays unmaterialized.
+      BBVec.clear();
+      return false;
+    }
+  LazyBody.clear();
+  return true;
+}
+
 void SPIRVFunction::foreachReturnValueAttr(
     std::function<void(SPIRVFuncParamAttrKind)> Func) {
-  auto Locs = Decorates.equal_range(DecorationFuncParamAttr);
-  for (auto I = Locs.first, E = Locs.second; I != E; ++I) {
-    auto Attr = static_cast<SPIRVFuncParamAttrKind>(I->second->getLiteral(0));
+  for (auto Dec : getDecorations(DecorationFuncParamAttr)) {
+    auto Attr = static_cast<SPIRVFuncParamAttrKind>(Dec->getLiteral(0));
     assert(isValid(Attr));
     Func(Attr);
   }
@@ -114,6 +114,7 @@ public:
   void addVariable(const SPIRVValue *Variable) {
     Variables.push_back(Variable);
   }
+  void clearVariables() { Variables.clear(); }
   SPIRVFunctionParameter *getArgument(size_t I) const { return Parameters[I]; }
   void foreachArgument(std::function<void(SPIRVFunctionParameter *)> Func) {
     for (size_t I = 0, E = getNumArguments(); I != E; ++I)
@@ -128,6 +129,23 @@ public:
     ExecModes = std::move(Forward->ExecModes);
   }
 
+  /// Returns true if the body of the function has been decoded, or if it
+  /// was never deferred. Basic blocks of a function which is not
+  /// materialized are not visible yet.
+  bool isMaterialized() const { return LazyBody.empty(); }
+  /// Decodes the body kept by lazy function decoding. Returns false if the
+  /// body is invalid; the module is marked invalid in that case and the
+  /// function keeps no basic blocks and stays unmaterialized.
+  bool materialize();
+
+  /// Removes all basic blocks from the function and returns them. They stay
+  /// in the module until they are erased from it.
+  std::vector<SPIRVBasicBlock *> takeBasicBlocks() {
+    std::vector<SPIRVBasicBlock *> BBs;
+    BBs.swap(BBVec);
+    return BBs;
+  }
+
   // Assume BB contains valid Id.
   SPIRVBasicBlock *addBasicBlock(SPIRVBasicBlock *BB) {
     Module->add(BB);
@@ -159,6 +177,7 @@ private:
       addArgument(I, FirstArgId + I);
   }
   bool decodeBB(SPIRVDecoder &);
+  void keepBody(SPIRVDecoder &);
 
   SPIRVTypeFunction *FuncType; // Function type
   SPIRVWord FCtrlMask;         // Function control mask
@@ -167,6 +186,8 @@ private:
   std::vector<const SPIRVValue *> Variables;
   typedef std::vector<SPIRVBasicBlock *> SPIRVLBasicBlockVector;
   SPIRVLBasicBlockVector BBVec;
+  // Binary of the basic blocks which are not decoded yet
+  std::string LazyBody;
 
   bool FoundUncontractedFMulAdd = false;
   bool FoundContractedFMulAdd = false;
@@ -0,0 +1,673 @@
+//===- SPIRVIdOperands.cpp - Id operands of encoded instructions ----------===//
+//
+//                     The LLVM/SPIRV Translator
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+// Copyright (c) 2014 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimers.
+// Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimers in the documentation
+// and/or other materials provided with the distribution.
+// Neither the names of Advanced Micro Devices, Inc., nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// Software without specific prior written permission.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH
+// THE SOFTWARE.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// This file implements the decoding of the Id operands of SPIR-V
+/// instructions in their binary encoding.
+///
+//===----------------------------------------------------------------------===//
+
+#include "SPIRVIdOperands.h"
+#include "OpenCL.std.h"
+#include "SPIRV.debug.h"
+
+#include <algorithm>
+#include <cctype>
+
+using namespace llvm;
+
+namespace SPIRV {
+
+namespace {
+
+// Formats of the operands which follow the result type and the result Id:
+//   I - Id, L - literal word, S - literal string,
+//   i, l, s - optional Id, literal word or literal string,
+//   M - optional memory access operands,
+//   G - optional image operands,
+//   * - the previous operand is repeated until the end of the instruction.
+// Instructions with a result which are not listed take only Ids. nullptr is
+// returned for instructions without a result which are not listed.
+const char *getOperandFormat(Op OC, bool HasResult) {
+  switch (OC) {
+  case OpNop:
+  case OpNoLine:
+  case OpFunctionEnd:
+  case OpKill:
+  case OpReturn:
+  case OpUnreachable:
+    return "";
+  case OpSourceContinued:
+  case OpSourceExtension:
+  case OpExtension:
+  case OpModuleProcessed:
+  case OpString:
+  case OpExtInstImport:
+  case OpTypeOpaque:
+  case OpAsmTargetINTEL:
+    return "S";
+  case OpSource:
+    return "LLis";
+  case OpName:
+    return "IS";
+  case OpMemberName:
+    return "ILS";
+  case OpLine:
+    return "ILL";
+  case OpMemoryModel:
+  case OpTypeInt:
+    return "LL";
+  case OpEntryPoint:
+    return "LISI*";
+  case OpExecutionMode:
+  case OpDecorate:
+    return "IL*";
+  case OpExecutionModeId:
+  case OpDecorateId:
+    return "ILI*";
+  case OpMemberDecorate:
+    return "ILL*";
+  case OpCapability:
+  case OpTypeFloat:
+  case OpTypePipe:
+  case OpTypeBufferSurfaceINTEL:
+    return "L";
+  case OpTypeVector:
+  case OpTypeMatrix:
+  case OpTypeForwardPointer:
+  case OpArrayLength:
+  case OpGenericCastToPtrExplicit:
+  case OpSelectionMerge:
+  case OpLifetimeStart:
+  case OpLifetimeStop:
+    return "IL";
+  case OpTypeImage:
+    return "ILLLLLLl";
+  case OpTypePointer:
+  case OpFunction:
+    return "LI";
+  case OpConstant:
+  case OpSpecConstant:
+  case OpLoopControlINTEL:
+    return "L*";
+  case OpConstantSampler:
+  case OpConstantPipeStorage:
+    return "LLL";
+  case OpVariable:
+    return "Li";
+  case OpLoad:
+    return "IM";
+  case OpStore:
+    return "IIM";
+  case OpCopyMemory:
+    return "IIMM";
+  case OpCopyMemorySized:
+    return "IIIMM";
+  case OpJointMatrixLoadINTEL:
+    return "IIIIM";
+  case OpJointMatrixStoreINTEL:
+    return "IIIIIM";
+  case OpCompositeExtract:
+    return "IL*";
+  case OpVectorShuffle:
+  case OpCompositeInsert:
+  case OpLoopMerge:
+    return "IIL*";
+  case OpBranchConditional:
+    return "IIIL*";
+  case OpImageSampleImplicitLod:
+  case OpImageSampleExplicitLod:
+  case OpImageSampleProjImplicitLod:
+  case OpImageSampleProjExplicitLod:
+  case OpImageFetch:
+  case OpImageRead:
+  case OpImageSparseSampleImplicitLod:
+  case OpImageSparseSampleExplicitLod:
+  case OpImageSparseSampleProjImplicitLod:
+  case OpImageSparseSampleProjExplicitLod:
+  case OpImageSparseFetch:
+  case OpImageSparseRead:
+    return "IIG";
+  case OpImageSampleDrefImplicitLod:
+  case OpImageSampleDrefExplicitLod:
+  case OpImageSampleProjDrefImplicitLod:
+  case OpImageSampleProjDrefExplicitLod:
+  case OpImageGather:
+  case OpImageDrefGather:
+  case OpImageWrite:
+  case OpImageSparseSampleDrefImplicitLod:
+  case OpImageSparseSampleDrefExplicitLod:
+  case OpImageSparseSampleProjDrefImplicitLod:
+  case OpImageSparseSampleProjDrefExplicitLod:
+  case OpImageSparseGather:
+  case OpImageSparseDrefGather:
+    return "IIIG";
+  case OpImageSampleFootprintNV:
+    return "IIIIG";
+  case OpGroupIAdd:
+  case OpGroupFAdd:
+  case OpGroupFMin:
+  case OpGroupUMin:
+  case OpGroupSMin:
+  case OpGroupFMax:
+  case OpGroupUMax:
+  case OpGroupSMax:
+  case OpGroupIAddNonUniformAMD:
+  case OpGroupFAddNonUniformAMD:
+  case OpGroupFMinNonUniformAMD:
+  case OpGroupUMinNonUniformAMD:
+  case OpGroupSMinNonUniformAMD:
+  case OpGroupFMaxNonUniformAMD:
+  case OpGroupUMaxNonUniformAMD:
+  case OpGroupSMaxNonUniformAMD:
+  case OpGroupNonUniformBallotBitCount:
+    return "ILI";
+  case OpGroupNonUniformIAdd:
+  case OpGroupNonUniformFAdd:
+  case OpGroupNonUniformIMul:
+  case OpGroupNonUniformFMul:
+  case OpGroupNonUniformSMin:
+  case OpGroupNonUniformUMin:
+  case OpGroupNonUniformFMin:
+  case OpGroupNonUniformSMax:
+  case OpGroupNonUniformUMax:
+  case OpGroupNonUniformFMax:
+  case OpGroupNonUniformBitwiseAnd:
+  case OpGroupNonUniformBitwiseOr:
+  case OpGroupNonUniformBitwiseXor:
+  case OpGroupNonUniformLogicalAnd:
+  case OpGroupNonUniformLogicalOr:
+  case OpGroupNonUniformLogicalXor:
+    return "ILIi";
+  case OpAsmINTEL:
+    return "IISS";
+  // Instructions without a result which take only Ids.
+  case OpGroupDecorate:
+  case OpBranch:
+  case OpReturnValue:
+  case OpControlBarrier:
+  case OpMemoryBarrier:
+  case OpAtomicStore:
+  case OpAtomicFlagClear:
+  case OpGroupWaitEvents:
+  case OpCommitReadPipe:
+  case OpCommitWritePipe:
+  case OpGroupCommitReadPipe:
+  case OpGroupCommitWritePipe:
+  case OpRetainEvent:
+  case OpReleaseEvent:
+  case OpSetUserEventStatus:
+  case OpCaptureEventProfilingInfo:
+  case OpMemoryNamedBarrier:
+  case OpSubgroupBlockWriteINTEL:
+  case OpSubgroupImageBlockWriteINTEL:
+  case OpSubgroupImageMediaBlockWriteINTEL:
+    return "I*";
+  default:
+    return HasResult ? "I*" : nullptr;
+  }
+}
+
+/// Tell whether instructions with opcode \p OC have a result Id and a result
+/// type Id, which are the first operands if present.
+void getResultAndType(Op OC, bool &HasResult, bool &HasType) {
+  HasResult = HasType = false;
+  switch (OC) {
+  case OpNop:
+  case OpSourceContinued:
+  case OpSource:
+  case OpSourceExtension:
+  case OpName:
+  case OpMemberName:
+  case OpLine:
+  case OpExtension:
+  case OpMemoryModel:
+  case OpEntryPoint:
+  case OpExecutionMode:
+  case OpCapability:
+  case OpTypeForwardPointer:
+  case OpFunctionEnd:
+  case OpStore:
+  case OpCopyMemory:
+  case OpCopyMemorySized:
+  case OpDecorate:
+  case OpMemberDecorate:
+  case OpGroupDecorate:
+  case OpGroupMemberDecorate:
+  case OpImageWrite:
+  case OpEmitVertex:
+  case OpEndPrimitive:
+  case OpEmitStreamVertex:
+  case OpEndStreamPrimitive:
+  case OpControlBarrier:
+  case OpMemoryBarrier:
+  case OpAtomicStore:
+  case OpLoopMerge:
+  case OpSelectionMerge:
+  case OpBranch:
+  case OpBranchConditional:
+  case OpSwitch:
+  case OpKill:
+  case OpReturn:
+  case OpReturnValue:
+  case OpUnreachable:
+  case OpLifetimeStart:
+  case OpLifetimeStop:
+  case OpGroupWaitEvents:
+  case OpCommitReadPipe:
+  case OpCommitWritePipe:
+  case OpGroupCommitReadPipe:
+  case OpGroupCommitWritePipe:
+  case OpRetainEvent:
+  case OpReleaseEvent:
+  case OpSetUserEventStatus:
+  case OpCaptureEventProfilingInfo:
+  case OpNoLine:
+  case OpAtomicFlagClear:
+  case OpMemoryNamedBarrier:
+  case OpModuleProcessed:
+  case OpExecutionModeId:
+  case OpDecorateId:
+  case OpWritePackedPrimitiveIndices4x8NV:
+  case OpIgnoreIntersectionNV:
+  case OpTerminateRayNV:
+  case OpTraceNV:
+  case OpExecuteCallableNV:
+  case OpBeginInvocationInterlockEXT:
+  case OpEndInvocationInterlockEXT:
+  case OpDemoteToHelperInvocationEXT:
+  case OpSubgroupBlockWriteINTEL:
+  case OpSubgroupImageBlockWriteINTEL:
+  case OpSubgroupImageMediaBlockWriteINTEL:
+  case OpLoopControlINTEL:
+  case OpJointMatrixStoreINTEL:
+    return;
+  case OpString:
+  case OpExtInstImport:
+  case OpDecorationGroup:
+  case OpLabel:
+  case OpAsmTargetINTEL:
+  case OpTypeNamedBarrier:
+  case OpTypeAccelerationStructureNV:
+  case OpTypeBufferSurfaceINTEL:
+    HasResult = true;
+    return;
+  default:
+    HasResult = true;
+    HasType = !isTypeOpCode(OC);
+  }
+}
+
+/// \returns true if \p Word holds the terminating null of a literal string.
+bool endsString(uint32_t Word) {
+  return !(Word & 0xff) || !(Word & 0xff00) || !(Word & 0xff0000) ||
+         !(Word & 0xff000000);
+}
+
+
+/// \returns true if operand \p I of the debug information instruction \p Inst
+/// is a literal rather than an Id. The layouts are the ones the translator
+/// uses for both the SPIRV.debug and the OpenCL.DebugInfo.100 sets.
+bool isDebugLiteral(uint32_t Inst, unsigned I) {
+  using namespace SPIRVDebug::Operand;
+  switch (Inst) {
+  case SPIRVDebug::CompilationUnit:
+    return I != CompilationUnit::SourceIdx;
+  case SPIRVDebug::TypeBasic:
+    return I == TypeBasic::EncodingIdx;
+  case SPIRVDebug::TypePointer:
+    return I == TypePointer::StorageClassIdx || I == TypePointer::FlagsIdx;
+  case SPIRVDebug::TypeQualifier:
+    return I == TypeQualifier::QualifierIdx;
+  case SPIRVDebug::TypeArray:
+  case SPIRVDebug::TypeVector:
+    // The base type is followed by the component counts.
+    return I >= TypeArray::ComponentCountIdx;
+  case SPIRVDebug::Typedef:
+    return I == Typedef::LineIdx || I == Typedef::ColumnIdx;
+  case SPIRVDebug::TypeFunction:
+    return I == TypeFunction::FlagsIdx;
+  case SPIRVDebug::TypeEnum:
+    return I == TypeEnum::LineIdx || I == TypeEnum::ColumnIdx ||
+           I == TypeEnum::FlagsIdx;
+  case SPIRVDebug::TypeComposite:
+    return I == TypeComposite::TagIdx || I == TypeComposite::LineIdx ||
+           I == TypeComposite::ColumnIdx || I == TypeComposite::FlagsIdx;
+  case SPIRVDebug::TypeMember:
+    return I == TypeMember::LineIdx || I == TypeMember::ColumnIdx ||
+           I == TypeMember::FlagsIdx;
+  case SPIRVDebug::Inheritance:
+    return I == TypeInheritance::FlagsIdx;
+  case SPIRVDebug::TypeTemplateParameter:
+    return I == TemplateParameter::LineIdx ||
+           I == TemplateParameter::ColumnIdx;
+  case SPIRVDebug::TypeTemplateTemplateParameter:
+    return I == TemplateTemplateParameter::LineIdx ||
+           I == TemplateTemplateParameter::ColumnIdx;
+  case SPIRVDebug::TypeTemplateParameterPack:
+    return I == TemplateParameterPack::LineIdx ||
+           I == TemplateParameterPack::ColumnIdx;
+  case SPIRVDebug::GlobalVariable:
+    return I == GlobalVariable::LineIdx || I == GlobalVariable::ColumnIdx ||
+           I == GlobalVariable::FlagsIdx;
+  case SPIRVDebug::FunctionDecl:
+    return I == FunctionDeclaration::LineIdx ||
+           I == FunctionDeclaration::ColumnIdx ||
+           I == FunctionDeclaration::FlagsIdx;
+  case SPIRVDebug::Function:
+    return I == Function::LineIdx || I == Function::ColumnIdx ||
+           I == Function::FlagsIdx || I == Function::ScopeLineIdx;
+  case SPIRVDebug::LexicalBlock:
+    return I == LexicalBlock::LineIdx || I == LexicalBlock::ColumnIdx;
+  case SPIRVDebug::LexicalBlockDiscriminator:
+    return I == LexicalBlockDiscriminator::DiscriminatorIdx;
+  case SPIRVDebug::InlinedAt:
+    return I == InlinedAt::LineIdx;
+  case SPIRVDebug::LocalVariable:
+    return I == LocalVariable::LineIdx || I == LocalVariable::ColumnIdx ||
+           I == LocalVariable::FlagsIdx || I == LocalVariable::ArgNumberIdx;
+  case SPIRVDebug::Operation:
+    // The opcode of the operation and its arguments.
+    return true;
+  case SPIRVDebug::MacroDef:
+  case SPIRVDebug::MacroUndef:
+    // The source is followed by the line.
+    return I == 1;
+  case SPIRVDebug::ImportedEntity:
+    // Operand 2 is left unused by the translator.
+    return I == ImportedEntity::TagIdx || I == ImportedEntity::TagIdx + 1 ||
+           I == ImportedEntity::LineIdx || I == ImportedEntity::ColumnIdx;
+  default:
+    return false;
+  }
+}
+
+} // namespace
+
+std::string getLiteralString(ArrayRef<uint32_t> Words, unsigned I) {
+  if (I >= Words.size())
+    return std::string();
+  const char *Begin = reinterpret_cast<const char *>(Words.data() + I);
+  size_t MaxLen = (Words.size() - I) * sizeof(uint32_t);
+  return std::string(Begin, std::find(Begin, Begin + MaxLen, '\0'));
+}
+
+/// \returns the index of the first word after the literal string starting
+/// at \p I.
+unsigned skipLiteralString(ArrayRef<uint32_t> Words, unsigned I) {
+  while (I < Words.size())
+    if (endsString(Words[I++]))
+      break;
+  return I;
+}
+
+void SPIRVIdOperandDecoder::scan(ArrayRef<uint32_t> Ins) {
+  Op OC = static_cast<Op>(Ins[0] & OpCodeMask);
+  bool HasResult, HasType;
+  getResultAndType(OC, HasResult, HasType);
+  if (OC == OpExtInstImport && Ins.size() > 2)
+    ExtInstSets[Ins[1]] = getLiteralString(Ins, 2);
+  else if (OC == OpTypeInt && Ins.size() > 2)
+    IntWidths[Ins[1]] = Ins[2];
+  else if (HasResult && HasType && Ins.size() > 2)
+    ValueTypes[Ins[2]] = Ins[1];
+}
+
+bool SPIRVIdOperandDecoder::decode(SPIRVEncodedInst &Inst,
+                                   std::string &ErrMsg) {
+  ArrayRef<uint32_t> Ins = Inst.Words;
+  Op OC = Inst.getOpCode();
+  bool HasResult, HasType;
+  getResultAndType(OC, HasResult, HasType);
+  unsigned I = 1;
+  if (HasType)
+    Inst.IdPos.push_back(I++);
+  if (HasResult) {
+    Inst.ResultPos = I;
+    Inst.IdPos.push_back(I++);
+  }
+  if (I > Ins.size())
+    return malformed(OC, ErrMsg);
+
+  const char *Format = nullptr;
+  switch (OC) {
+  case OpExtInst:
+    return decodeExtInst(Inst, I, ErrMsg);
+  case OpSwitch:
+    return decodeSwitch(Inst, I, ErrMsg);
+  case OpGroupMemberDecorate:
+    // The decoration group, then pairs of a target and a member index.
+    if (I == Ins.size())
+      return malformed(OC, ErrMsg);
+    Inst.IdPos.push_back(I++);
+    for (; I + 1 < Ins.size(); I += 2)
+      Inst.IdPos.push_back(I);
+    return I == Ins.size() || malformed(OC, ErrMsg);
+  case OpSpecConstantOp: {
+    // The operands of the operation which computes the constant follow
+    // its opcode.
+    if (I == Ins.size())
+      return malformed(OC, ErrMsg);
+    Op Inner = static_cast<Op>(Ins[I++]);
+    if (Inner != OpExtInst && Inner != OpSwitch &&
+        Inner != OpGroupMemberDecorate && Inner != OpSpecConstantOp)
+      Format = getOperandFormat(Inner, true);
+    if (!Format)
+      return unsupported(Inner, ErrMsg);
+    break;
+  }
+  default:
+    Format = getOperandFormat(OC, HasResult);
+    if (!Format)
+      return unsupported(OC, ErrMsg);
+  }
+  return decodeFormat(Inst, I, Format) || malformed(OC, ErrMsg);
+}
+
+bool SPIRVIdOperandDecoder::decodeFormat(SPIRVEncodedInst &Inst, unsigned I,
+                                         const char *Format) {
+  unsigned E = Inst.Words.size();
+  for (const char *P = Format; *P; ++P) {
+    char Kind = *P;
+    bool Repeat = P[1] == '*';
+    if (Repeat)
+      ++P;
+    if (I == E) {
+      if (Repeat || islower(Kind) || Kind == 'M' || Kind == 'G')
+        continue;
+      return false;
+    }
+    do {
+      switch (Kind) {
+      case 'I':
+      case 'i':
+        Inst.IdPos.push_back(I++);
+        break;
+      case 'L':
+      case 'l':
+        ++I;
+        break;
+      case 'S':
+      case 's':
+        I = skipLiteralString(Inst.Words, I);
+        break;
+      case 'M': {
+        uint32_t Mask = Inst.Words[I++];
+        if (Mask & MemoryAccessAlignedMask)
+          ++I;
+        if (Mask & MemoryAccessMakePointerAvailableMask)
+          Inst.IdPos.push_back(I++);
+        if (Mask & MemoryAccessMakePointerVisibleMask)
+          Inst.IdPos.push_back(I++);
+        break;
+      }
+      case 'G':
+        // The image operands mask is followed by Ids only.
+        for (++I; I < E; ++I)
+          Inst.IdPos.push_back(I);
+        break;
+      default:
+        llvm_unreachable("Invalid operand format");
+      }
+    } while (Repeat && I < E);
+  }
+  return I == E;
+}
+
+bool SPIRVIdOperandDecoder::decodeExtInst(SPIRVEncodedInst &Inst, unsigned I,
+                                          std::string &ErrMsg) {
+  unsigned E = Inst.Words.size();
+  if (I + 2 > E)
+    return malformed(OpExtInst, ErrMsg);
+  auto Set = ExtInstSets.find(Inst.Words[I]);
+  if (Set != ExtInstSets.end() &&
+      (Set->second == "SPIRV.debug" ||
+       Set->second == "OpenCL.DebugInfo.100")) {
+    Inst.IdPos.push_back(I++);
+    uint32_t DebugInst = Inst.Words[I++];
+    if (DebugInst >= SPIRVDebug::InstCount)
+      return malformed(OpExtInst, ErrMsg);
+    for (unsigned Operand = 0; I < E; ++I, ++Operand)
+      if (!isDebugLiteral(DebugInst, Operand))
+        Inst.IdPos.push_back(I);
+    return true;
+  }
+  if (Set == ExtInstSets.end() || Set->second != "OpenCL.std") {
+    ErrMsg = "the extended instruction set \"" +
+             (Set == ExtInstSets.end() ? std::string() : Set->second) +
+             "\" is not supported";
+    return false;
+  }
+  Inst.IdPos.push_back(I++);
+  switch (Inst.Words[I++]) {
+  // The last operand of these is a vector size or a rounding mode.
+  case OpenCLLIB::Vloadn:
+  case OpenCLLIB::Vload_halfn:
+  case OpenCLLIB::Vloada_halfn:
+  case OpenCLLIB::Vstore_half_r:
+  case OpenCLLIB::Vstore_halfn_r:
+  case OpenCLLIB::Vstorea_halfn_r:
+    if (I == E)
+      return malformed(OpExtInst, ErrMsg);
+    --E;
+    break;
+  default:
+    break;
+  }
+  for (; I < E; ++I)
+    Inst.IdPos.push_back(I);
+  return true;
+}
+
+bool SPIRVIdOperandDecoder::decodeSwitch(SPIRVEncodedInst &Inst, unsigned I,
+                                         std::string &ErrMsg) {
+  unsigned E = Inst.Words.size();
+  if (I + 2 > E)
+    return malformed(OpSwitch, ErrMsg);
+  // The width of the case literals is the one of the selector.
+  auto Ty = ValueTypes.find(Inst.Words[I]);
+  auto Width = Ty == ValueTypes.end() ? IntWidths.end()
+                                      : IntWidths.find(Ty->second);
+  if (Width == IntWidths.end())
+    return malformed(OpSwitch, ErrMsg);
+  unsigned LiteralWords = Width->second > 32 ? 2 : 1;
+  Inst.IdPos.push_back(I++);
+  Inst.IdPos.push_back(I++);
+  for (; I + LiteralWords < E; I += LiteralWords + 1)
+    Inst.IdPos.push_back(I + LiteralWords);
+  return I == E || malformed(OpSwitch, ErrMsg);
+}
+
+bool SPIRVIdOperandDecoder::malformed(Op OC, std::string &ErrMsg) {
+  ErrMsg = "malformed instruction with opcode " + std::to_string(OC);
+  return false;
+}
+
+bool SPIRVIdOperandDecoder::unsupported(Op OC, std::string &ErrMsg) {
+  ErrMsg = "instructions with opcode " + std::to_string(OC) +
+           " are not supported";
+  return false;
+}
+
+bool renumberIds(std::vector<uint32_t> &Words, std::string &ErrMsg) {
+  if (Words.size() < 5 || Words[0] != MagicNumber || !Words[3]) {
+    ErrMsg = "invalid SPIR-V binary";
+    return false;
+  }
+  uint32_t Bound = Words[3];
+  ArrayRef<uint32_t> Module(Words);
+  SPIRVIdOperandDecoder Decoder;
+  for (size_t I = 5, E = Words.size(); I < E;) {
+    unsigned WordCount = Words[I] >> WordCountShift;
+    if (!WordCount || I + WordCount > E) {
+      ErrMsg = "invalid SPIR-V binary";
+      return false;
+    }
+    Decoder.scan(Module.slice(I, WordCount));
+    I += WordCount;
+  }
+
+  // The positions of all Ids in Words, and the Ids which are used.
+  std::vector<size_t> IdWords;
+  std::vector<uint32_t> NewIds(Bound, 0);
+  SPIRVEncodedInst Inst;
+  for (size_t I = 5, E = Words.size(); I < E; I += Inst.Words.size()) {
+    ArrayRef<uint32_t> Ins = Module.slice(I, Words[I] >> WordCountShift);
+    Inst.Words.assign(Ins.begin(), Ins.end());
+    Inst.IdPos.clear();
+    Inst.ResultPos = 0;
+    if (!Decoder.decode(Inst, ErrMsg))
+      return false;
+    for (uint16_t P : Inst.IdPos) {
+      uint32_t Id = Inst.Words[P];
+      if (!Id || Id >= Bound) {
+        ErrMsg = "Id " + std::to_string(Id) + " is out of bound";
+        return false;
+      }
+      NewIds[Id] = 1;
+      IdWords.push_back(I + P);
+    }
+  }
+
+  uint32_t NextId = 1;
+  for (uint32_t &Id : NewIds)
+    if (Id)
+      Id = NextId++;
+  for (size_t P : IdWords)
+    Words[P] = NewIds[Words[P]];
+  Words[3] = NextId;
+  return true;
+}
+
+} // namespace SPIRV
@@ -0,0 +1,113 @@
+//===- SPIRVIdOperands.h - Id operands of encoded instructions --*- C++ -*-===//
+//
+//                     The LLVM/SPIRV Translator
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+// Copyright (c) 2014 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimers.
+// Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimers in the documentation
+// and/or other materials provided with the distribution.
+// Neither the names of Advanced Micro Devices, Inc., nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// Software without specific prior written permission.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH
+// THE SOFTWARE.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// This file declares the decoding of the Id operands of SPIR-V instructions
+/// in their binary encoding, which lets a module be rewritten word by word
+/// without decoding it into a SPIRVModule.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef SPIRV_LIBSPIRV_SPIRVIDOPERANDS_H
+#define SPIRV_LIBSPIRV_SPIRVIDOPERANDS_H
+
+#include "SPIRVOpCode.h"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace SPIRV {
+
+/// An instruction in its binary encoding.
+struct SPIRVEncodedInst {
+  llvm::SmallVector<uint32_t, 8> Words;
+  /// Positions of the Id operands in Words, including the result.
+  llvm::SmallVector<uint16_t, 8> IdPos;
+  uint16_t ResultPos = 0;
+
+  Op getOpCode() const { return static_cast<Op>(Words[0] & OpCodeMask); }
+  uint32_t getResult() const { return ResultPos ? Words[ResultPos] : 0; }
+};
+
+/// Finds the Id operands of the instructions of one module.
+///
+/// Which operands of an instruction are Ids is given by a table of operand
+/// formats, and for the extended instruction sets the translator emits,
+/// OpenCL.std and the debug information sets, by their operand layouts.
+/// Instructions neither knows about are reported as an error.
+class SPIRVIdOperandDecoder {
+public:
+  /// Record the information needed to decode the instructions which refer to
+  /// the result of \p Ins. Every instruction of the module is scanned before
+  /// the first one is decoded.
+  void scan(llvm::ArrayRef<uint32_t> Ins);
+
+  /// Fill in the Id positions of \p Inst.
+  /// \returns false and sets \p ErrMsg if they are unknown.
+  bool decode(SPIRVEncodedInst &Inst, std::string &ErrMsg);
+
+private:
+  bool decodeFormat(SPIRVEncodedInst &Inst, unsigned I, const char *Format);
+  bool decodeExtInst(SPIRVEncodedInst &Inst, unsigned I, std::string &ErrMsg);
+  bool decodeSwitch(SPIRVEncodedInst &Inst, unsigned I, std::string &ErrMsg);
+  static bool malformed(Op OC, std::string &ErrMsg);
+  static bool unsupported(Op OC, std::string &ErrMsg);
+
+  llvm::DenseMap<uint32_t, std::string> ExtInstSets;
+  llvm::DenseMap<uint32_t, uint32_t> IntWidths;
+  llvm::DenseMap<uint32_t, uint32_t> ValueTypes;
+};
+
+/// \returns the literal string starting at word \p I of \p Words.
+std::string getLiteralString(llvm::ArrayRef<uint32_t> Words, unsigned I);
+
+/// \returns the index of the first word after the literal string starting
+/// at word \p I of \p Words.
+unsigned skipLiteralString(llvm::ArrayRef<uint32_t> Words, unsigned I);
+
+/// Renumber the Ids of the module encoded in \p Words to the dense range
+/// starting at 1, keeping their order, and lower the Id bound of the header
+/// accordingly.
+/// \returns false and sets \p ErrMsg, leaving \p Words unchanged, if an
+/// instruction cannot be decoded.
+bool renumberIds(std::vector<uint32_t> &Words, std::string &ErrMsg);
+
+} // namespace SPIRV
+
+#endif // SPIRV_LIBSPIRV_SPIRVIDOPERANDS_H
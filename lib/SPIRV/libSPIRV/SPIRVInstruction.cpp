@@ -50,7 +50,7 @@ SPIRVInstruction::SPIRVInstruction(unsigned TheWordCount, Op TheOC,
                                    SPIRVType *TheType, SPIRVId TheId,
                                    SPIRVBasicBlock *TheBB)
     : SPIRVValue(TheBB->getModule(), TheWordCount, TheOC, TheType, TheId),
-      BB(TheBB), DebugScope(nullptr) {
+      BB(TheBB), DebugScope(nullptr), Prev(nullptr), Next(nullptr) {
   SPIRVInstruction::validate();
 }
 
@@ -58,7 +58,7 @@ SPIRVInstruction::SPIRVInstruction(unsigned TheWordCount, Op TheOC,
                                    SPIRVType *TheType, SPIRVId TheId,
                                    SPIRVBasicBlock *TheBB, SPIRVModule *TheBM)
     : SPIRVValue(TheBM, TheWordCount, TheOC, TheType, TheId), BB(TheBB),
-      DebugScope(nullptr) {
+      DebugScope(nullptr), Prev(nullptr), Next(nullptr) {
   SPIRVInstruction::validate();
 }
 
@@ -66,21 +66,21 @@ SPIRVInstruction::SPIRVInstruction(unsigned TheWordCount, Op TheOC,
 SPIRVInstruction::SPIRVInstruction(unsigned TheWordCount, Op TheOC,
                                    SPIRVId TheId, SPIRVBasicBlock *TheBB)
     : SPIRVValue(TheBB->getModule(), TheWordCount, TheOC, TheId), BB(TheBB),
-      DebugScope(nullptr) {
+      DebugScope(nullptr), Prev(nullptr), Next(nullptr) {
   SPIRVInstruction::validate();
 }
 // Complete constructor for instruction without type and id
 SPIRVInstruction::SPIRVInstruction(unsigned TheWordCount, Op TheOC,
                                    SPIRVBasicBlock *TheBB)
     : SPIRVValue(TheBB->getModule(), TheWordCount, TheOC), BB(TheBB),
-      DebugScope(nullptr) {
+      DebugScope(nullptr), Prev(nullptr), Next(nullptr) {
   SPIRVInstruction::validate();
 }
 // Complete constructor for instruction with type but no id
 SPIRVInstruction::SPIRVInstruction(unsigned TheWordCount, Op TheOC,
                                    SPIRVType *TheType, SPIRVBasicBlock *TheBB)
     : SPIRVValue(TheBB->getModule(), TheWordCount, TheOC, TheType), BB(TheBB),
-      DebugScope(nullptr) {
+      DebugScope(nullptr), Prev(nullptr), Next(nullptr) {
   SPIRVInstruction::validate();
 }
 
@@ -89,7 +89,7 @@ SPIRVInstruction::SPIRVInstruction(unsigned TheWordCount, Op TheOC,
                                    SPIRVType *TheType, SPIRVId TheId,
                                    SPIRVModule *TheBM, SPIRVBasicBlock *TheBB)
     : SPIRVValue(TheBM, TheWordCount, TheOC, TheType, TheId), BB(TheBB),
-      DebugScope(nullptr) {
+      DebugScope(nullptr), Prev(nullptr), Next(nullptr) {
   SPIRVInstruction::validate();
 }
 
@@ -122,12 +122,13 @@ public:
 
   // Incomplete constructor
   SPIRVInstruction(Op TheOC = OpNop)
-      : SPIRVValue(TheOC), BB(NULL), DebugScope(nullptr) {}
+      : SPIRVValue(TheOC), BB(NULL), DebugScope(nullptr), Prev(nullptr),
+        Next(nullptr) {}
 
   bool isInst() const override { return true; }
   SPIRVBasicBlock *getParent() const { return BB; }
-  SPIRVInstruction *getPrevious() const { return BB->getPrevious(this); }
-  SPIRVInstruction *getNext() const { return BB->getNext(this); }
+  SPIRVInstruction *getPrevious() const { return Prev; }
+  SPIRVInstruction *getNext() const { return Next; }
   virtual std::vector<SPIRVValue *> getOperands();
   std::vector<SPIRVType *> getOperandTypes();
   static std::vector<SPIRVType *>
@@ -173,8 +174,12 @@ protected:
   void validate() const override { SPIRVValue::validate(); }
 
 private:
+  friend class SPIRVBasicBlock;
   SPIRVBasicBlock *BB;
   SPIRVEntry *DebugScope;
+  // Neighbours in the instruction list of BB.
+  SPIRVInstruction *Prev;
+  SPIRVInstruction *Next;
 };
 
 class SPIRVInstTemplateBase : public SPIRVInstruction {
@@ -434,7 +439,7 @@ public:
         StorageClass(TheStorageClass) {
     if (TheInitializer)
       Initializer.push_back(TheInitializer->getId());
-    Name = TheName;
+    setName(TheName);
     validate();
   }
   // Incomplete constructor
@@ -1909,6 +1914,10 @@ public:
     return getValues(Constituents);
   }
 
+  std::vector<SPIRVValue *> getOperands() override {
+    return getValues(Constituents);
+  }
+
 protected:
   void setWordCount(SPIRVWord TheWordCount) override {
     SPIRVEntry::setWordCount(TheWordCount);
@@ -1925,6 +1934,10 @@ protected:
     case OpTypeArray:
     case OpTypeStruct:
       break;
+    case OpTypeJointMatrixINTEL:
+      assert(getConstituents().size() == 1 &&
+             "There must be exactly one Constituent operand in joint matrix");
+      break;
     default:
       assert(false && "Invalid type");
     }
@@ -2798,6 +2811,27 @@ _SPIRV_OP(SubgroupImageMediaBlockReadINTEL, true, 7)
 _SPIRV_OP(SubgroupImageMediaBlockWriteINTEL, false, 6)
 #undef _SPIRV_OP
 
+class SPIRVJointMatrixINTELInstBase : public SPIRVInstTemplateBase {
+protected:
+  SPIRVCapVec getRequiredCapability() const override {
+    return getVec(CapabilityJointMatrixINTEL);
+  }
+  SPIRVExtSet getRequiredExtensions() const override {
+    return getSet(ExtensionID::SPV_INTEL_joint_matrix);
+  }
+};
+
+#define _SPIRV_OP(x, ...)                                                      \
+  typedef SPIRVInstTemplate<SPIRVJointMatrixINTELInstBase, Op##x,             \
+                            __VA_ARGS__>                                       \
+      SPIRV##x;
+// Intel Joint Matrix Instructions
+_SPIRV_OP(JointMatrixLoadINTEL, true, 7, true)
+_SPIRV_OP(JointMatrixStoreINTEL, false, 6, true)
+_SPIRV_OP(JointMatrixMadINTEL, true, 7)
+_SPIRV_OP(JointMatrixWorkItemLengthINTEL, true, 4)
+#undef _SPIRV_OP
+
 class SPIRVSubgroupAVCIntelInstBase : public SPIRVInstTemplateBase {
 protected:
   SPIRVCapVec getRequiredCapability() const override {
@@ -609,6 +609,7 @@ inline bool isValid(spv::Capability V) {
   case CapabilityKernelAttributesINTEL:
   case CapabilityFPGAKernelAttributesINTEL:
   case CapabilityFunctionFloatControlINTEL:
+  case CapabilityJointMatrixINTEL:
     return true;
   default:
     return false;
@@ -1057,6 +1058,11 @@ inline bool isValid(spv::Op V) {
   case OpSubgroupAvcSicGetInterRawSadsINTEL:
   case OpFPGARegINTEL:
   case OpLoopControlINTEL:
+  case OpTypeJointMatrixINTEL:
+  case OpJointMatrixLoadINTEL:
+  case OpJointMatrixStoreINTEL:
+  case OpJointMatrixMadINTEL:
+  case OpJointMatrixWorkItemLengthINTEL:
     return true;
   default:
     return false;
@@ -40,15 +40,20 @@
 #include "SPIRVModule.h"
 #include "SPIRVAsm.h"
 #include "SPIRVDebug.h"
+#include "SPIRVDecorate.h"
 #include "SPIRVEntry.h"
 #include "SPIRVExtInst.h"
 #include "SPIRVFunction.h"
+#include "SPIRVIdOperands.h"
 #include "SPIRVInstruction.h"
 #include "SPIRVStream.h"
 #include "SPIRVType.h"
 #include "SPIRVValue.h"
 
+#include <algorithm>
+#include <cstring>
 #include <set>
+#include <sstream>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -59,6 +64,22 @@ SPIRVModule::SPIRVModule()
 
 SPIRVModule::~SPIRVModule() {}
 
+void SPIRVDecorateIndex::add(SPIRVId Target, const SPIRVDecorate *Dec) {
+  Decs[getKey(Target, Dec->getDecorateKind())].push_back(Dec);
+}
+
+void SPIRVDecorateIndex::addMember(SPIRVId Target,
+                                   const SPIRVMemberDecorate *Dec) {
+  MemberDecs[{Target, Dec->getMemberNumber(), Dec->getDecorateKind()}] = Dec;
+}
+
+const SPIRVDecorateIndex::DecorateVec &
+SPIRVDecorateIndex::get(SPIRVId Target, Decoration Kind) const {
+  static const DecorateVec Empty;
+  auto Loc = Decs.find(getKey(Target, Kind));
+  return Loc == Decs.end() ? Empty : Loc->second;
+}
+
 class SPIRVModuleImpl : public SPIRVModule {
 public:
   SPIRVModuleImpl()
@@ -160,6 +181,7 @@ public:
   bool importBuiltinSet(const std::string &, SPIRVId *) override;
   bool importBuiltinSetWithId(const std::string &, SPIRVId) override;
   void optimizeDecorates() override;
+  void eliminateDeadEntries() override;
   void setAddressingModel(SPIRVAddressingModelKind AM) override {
     AddrModel = AM;
   }
@@ -219,6 +241,7 @@ public:
   SPIRVFunction *addFunction(SPIRVTypeFunction *, SPIRVId) override;
   SPIRVEntry *replaceForward(SPIRVForward *, SPIRVEntry *) override;
   void eraseInstruction(SPIRVInstruction *, SPIRVBasicBlock *) override;
+  void eraseFunctionBody(SPIRVFunction *) override;
 
   // Type creation functions
   template <class T> T *addType(T *Ty);
@@ -250,6 +273,10 @@ public:
   SPIRVTypeVmeImageINTEL *addVmeImageINTELType(SPIRVTypeImage *T) override;
   SPIRVTypeBufferSurfaceINTEL *
   addBufferSurfaceINTELType(SPIRVAccessQualifierKind Access) override;
+  SPIRVTypeJointMatrixINTEL *
+  addJointMatrixINTELType(SPIRVType *CompType, SPIRVConstant *Rows,
+                          SPIRVConstant *Columns, SPIRVConstant *Layout,
+                          SPIRVConstant *Scope) override;
 
   // Constant creation functions
   SPIRVInstruction *addBranchInst(SPIRVLabel *, SPIRVBasicBlock *) override;
@@ -426,6 +453,10 @@ public:
   friend std::istream &operator>>(std::istream &I, SPIRVModule &M);
 
 private:
+  /// Writes the module with its Ids renumbered densely.
+  /// \returns false if they cannot be renumbered.
+  bool encodeRenumbered(spv_ostream &O);
+
   SPIRVErrorLog ErrLog;
   SPIRVId NextId;
   SPIRVWord SPIRVVersion;
@@ -462,6 +493,24 @@ private:
   typedef std::unordered_map<std::string, SPIRVString *> SPIRVStringMap;
   typedef std::map<SPIRVTypeStruct *, std::vector<std::pair<unsigned, SPIRVId>>>
       SPIRVUnknownStructFieldMap;
+  /// Structural key of a uniqued type or constant: its opcode followed by all
+  /// of its operand words except the result Id.
+  typedef std::vector<SPIRVWord> SPIRVPoolKey;
+  struct SPIRVPoolKeyHash {
+    size_t operator()(const SPIRVPoolKey &Key) const {
+      size_t H = Key.size();
+      for (auto W : Key)
+        H ^= std::hash<SPIRVWord>()(W) + 0x9e3779b9 + (H << 6) + (H >> 2);
+      return H;
+    }
+  };
+  typedef std::unordered_map<SPIRVPoolKey, SPIRVEntry *, SPIRVPoolKeyHash>
+      SPIRVEntryPool;
+
+  /// Returns the pooled entry for \p Key, calling \p Create to make and add
+  /// it to the module the first time the key is seen.
+  template <class T, class CreatorT>
+  T *getOrAddPooled(SPIRVPoolKey Key, CreatorT Create);
 
   SPIRVForwardPointerVec ForwardPointerVec;
   SPIRVTypeVec TypeVec;
@@ -484,13 +533,18 @@ private:
   SPIRVExecModelIdSetMap EntryPointSet;
   SPIRVExecModelIdVecMap EntryPointVec;
   SPIRVStringMap StrMap;
+  /// Set once entries are erased, which leaves gaps in the Id range.
+  bool RenumberIds = false;
   SPIRVCapMap CapMap;
   SPIRVUnknownStructFieldMap UnknownStructFieldMap;
-  std::map<unsigned, SPIRVTypeInt *> IntTypeMap;
-  std::map<unsigned, SPIRVConstant *> LiteralMap;
+  SPIRVEntryPool EntryPool;
   std::vector<SPIRVExtInst *> DebugInstVec;
 
   void layoutEntry(SPIRVEntry *Entry);
+  /// Erase the entries with the Ids in \p Dead and the decorations and names
+  /// targeting them. The Ids of decoration groups left without targets are
+  /// added to \p Dead.
+  void eraseEntries(std::unordered_set<SPIRVId> &Dead);
 };
 
 SPIRVModuleImpl::~SPIRVModuleImpl() {
@@ -526,44 +580,45 @@ void SPIRVModuleImpl::addLine(SPIRVEntry *E, SPIRVId FileNameId, SPIRVWord Line,
 // multiple targets.
 void SPIRVModuleImpl::optimizeDecorates() {
   SPIRVDBG(spvdbgs() << "[optimizeDecorates] begin\n");
-  for (auto I = DecorateSet.begin(), E = DecorateSet.end(); I != E;) {
-    auto D = *I;
+  // Walk the decorations sorted by kind and literals, so that equivalent
+  // decorations of different targets form consecutive runs, and rebuild the
+  // set from the decorations which are not moved to a group.
+  std::vector<SPIRVDecorateGeneric *> Decs(DecorateSet.begin(),
+                                           DecorateSet.end());
+  DecorateSet.clear();
+  SPIRVDecorateGeneric::Comparator Less;
+  for (size_t I = 0, E = Decs.size(); I != E;) {
+    auto D = Decs[I];
     SPIRVDBG(spvdbgs() << "  check " << *D << '\n');
     if (D->getOpCode() == OpMemberDecorate) {
+      DecorateSet.insert(D);
       ++I;
       continue;
     }
-    auto ER = DecorateSet.equal_range(D);
-    SPIRVDBG(spvdbgs() << "  equal range " << **ER.first << " to ";
-             if (ER.second != DecorateSet.end()) spvdbgs() << **ER.second;
-             else spvdbgs() << "end"; spvdbgs() << '\n');
-    if (std::distance(ER.first, ER.second) < 2) {
-      I = ER.second;
+    size_t RangeEnd = I + 1;
+    while (RangeEnd != E && !Less(D, Decs[RangeEnd]))
+      ++RangeEnd;
+    // WordCount is only 16 bits.  We can only have 65535 - FixedWC targtets per
+    // group.
+    // For now, just skip using a group if the number of targets to too big
+    if (RangeEnd - I < 2 || RangeEnd - I >= 65530) {
       SPIRVDBG(spvdbgs() << "  skip equal range \n");
+      for (; I != RangeEnd; ++I)
+        DecorateSet.insert(Decs[I]);
       continue;
     }
     SPIRVDBG(spvdbgs() << "  add deco group. erase equal range\n");
     auto G = add(new SPIRVDecorationGroup(this, getId()));
     std::vector<SPIRVId> Targets;
-    Targets.push_back(D->getTargetId());
-    const_cast<SPIRVDecorateGeneric *>(D)->setTargetId(G->getId());
+    Targets.reserve(RangeEnd - I);
+    for (size_t J = I; J != RangeEnd; ++J)
+      Targets.push_back(Decs[J]->getTargetId());
+    D->setTargetId(G->getId());
     G->getDecorations().insert(D);
-    for (I = ER.first; I != ER.second; ++I) {
-      auto E = *I;
-      if (*E == *D)
-        continue;
-      Targets.push_back(E->getTargetId());
-    }
-
-    // WordCount is only 16 bits.  We can only have 65535 - FixedWC targtets per
-    // group.
-    // For now, just skip using a group if the number of targets to too big
-    if (Targets.size() < 65530) {
-      DecorateSet.erase(ER.first, ER.second);
-      auto GD = add(new SPIRVGroupDecorate(G, Targets));
-      DecGroupVec.push_back(G);
-      GroupDecVec.push_back(GD);
-    }
+    auto GD = add(new SPIRVGroupDecorate(G, Targets));
+    DecGroupVec.push_back(G);
+    GroupDecVec.push_back(GD);
+    I = RangeEnd;
   }
 }
 
@@ -571,16 +626,26 @@ SPIRVValue *SPIRVModuleImpl::addSamplerConstant(SPIRVType *TheType,
                                                 SPIRVWord AddrMode,
                                                 SPIRVWord ParametricMode,
                                                 SPIRVWord FilterMode) {
-  return addConstant(new SPIRVConstantSampler(this, TheType, getId(), AddrMode,
-                                              ParametricMode, FilterMode));
+  return getOrAddPooled<SPIRVValue>(
+      {OpConstantSampler, TheType->getId(), AddrMode, ParametricMode,
+       FilterMode},
+      [&] {
+        return addConstant(new SPIRVConstantSampler(
+            this, TheType, getId(), AddrMode, ParametricMode, FilterMode));
+      });
 }
 
 SPIRVValue *SPIRVModuleImpl::addPipeStorageConstant(SPIRVType *TheType,
                                                     SPIRVWord PacketSize,
                                                     SPIRVWord PacketAlign,
                                                     SPIRVWord Capacity) {
-  return addConstant(new SPIRVConstantPipeStorage(
-      this, TheType, getId(), PacketSize, PacketAlign, Capacity));
+  return getOrAddPooled<SPIRVValue>(
+      {OpConstantPipeStorage, TheType->getId(), PacketSize, PacketAlign,
+       Capacity},
+      [&] {
+        return addConstant(new SPIRVConstantPipeStorage(
+            this, TheType, getId(), PacketSize, PacketAlign, Capacity));
+      });
 }
 
 void SPIRVModuleImpl::addExtension(ExtensionID Ext) {
@@ -618,14 +683,8 @@ void SPIRVModuleImpl::addCapabilityInternal(SPIRVCapabilityKind Cap) {
 }
 
 SPIRVConstant *SPIRVModuleImpl::getLiteralAsConstant(unsigned Literal) {
-  auto Loc = LiteralMap.find(Literal);
-  if (Loc != LiteralMap.end())
-    return Loc->second;
-  auto Ty = addIntegerType(32);
-  auto V = new SPIRVConstant(this, Ty, getId(), static_cast<uint64_t>(Literal));
-  LiteralMap[Literal] = V;
-  addConstant(V);
-  return V;
+  return static_cast<SPIRVConstant *>(
+      addIntegerConstant(addIntegerType(32), Literal));
 }
 
 void SPIRVModuleImpl::layoutEntry(SPIRVEntry *E) {
@@ -801,6 +860,201 @@ void SPIRVModuleImpl::setName(SPIRVEntry *E, const std::string &Name) {
     NamedId.erase(E->getId());
 }
 
+// Dead entries are found by scanning the binary encoding of the live entries
+// for Ids. A literal which happens to be equal to an Id keeps that entry alive,
+// which is conservative but does not depend on every entry class reporting its
+// operands. Only module scope entries without side effects are candidates:
+// types, constants which are not specialization constants, and global
+// variables which are not exported. Functions are always kept.
+//
+// The Ids of the module itself are left as they are, since the translator
+// may still refer to them, but the module is written with its Ids renumbered
+// densely from then on.
+void SPIRVModuleImpl::eliminateDeadEntries() {
+  auto IsCandidate = [](SPIRVEntry *E) {
+    Op OC = E->getOpCode();
+    if (isTypeOpCode(OC))
+      return true;
+    if (isConstantOpCode(OC))
+      return !E->hasDecorate(DecorationSpecId);
+    if (OC == OpVariable)
+      return !static_cast<SPIRVVariable *>(E)->getParent() &&
+             E->getLinkageType() != LinkageTypeExport;
+    return false;
+  };
+
+  std::unordered_set<SPIRVId> Live;
+  std::vector<SPIRVEntry *> Worklist;
+  auto MarkLive = [&](SPIRVId Id) {
+    auto Loc = IdEntryMap.find(Id);
+    if (Loc == IdEntryMap.end() || !IsCandidate(Loc->second) ||
+        !Live.insert(Id).second)
+      return;
+    Worklist.push_back(Loc->second);
+  };
+
+#ifdef _SPIRV_SUPPORT_TEXT_FMT
+  auto SaveOpt = SPIRVUseTextFormat;
+  SPIRVUseTextFormat = false;
+#endif
+  std::ostringstream OS;
+  auto Scan = [&](const SPIRVEntry *E) {
+    OS.str(std::string());
+    OS << *E;
+    const std::string &Buf = OS.str();
+    for (size_t I = 0, N = Buf.size() / sizeof(SPIRVWord); I != N; ++I) {
+      SPIRVWord W;
+      std::memcpy(&W, Buf.data() + I * sizeof(SPIRVWord), sizeof(W));
+      MarkLive(W);
+    }
+  };
+
+  for (auto F : FuncVec)
+    Scan(F);
+  for (auto &I : EntryPointVec)
+    for (auto Id : I.second)
+      for (auto Var : get<SPIRVFunction>(Id)->getVariables())
+        MarkLive(Var);
+  for (auto E : DebugInstVec)
+    Scan(E);
+  for (auto E : ForwardPointerVec)
+    Scan(E);
+  for (auto E : AsmTargetVec)
+    Scan(E);
+  for (auto E : AsmVec)
+    Scan(E);
+  for (auto E : GroupDecVec)
+    if (E->getOpCode() == OpGroupMemberDecorate)
+      Scan(E);
+  for (auto E : ConstVec)
+    if (!IsCandidate(E))
+      Scan(E);
+  for (auto E : VariableVec)
+    if (!IsCandidate(E))
+      Scan(E);
+  while (!Worklist.empty()) {
+    auto E = Worklist.back();
+    Worklist.pop_back();
+    Scan(E);
+  }
+#ifdef _SPIRV_SUPPORT_TEXT_FMT
+  SPIRVUseTextFormat = SaveOpt;
+#endif
+
+  std::unordered_set<SPIRVId> Dead;
+  for (auto &I : IdEntryMap)
+    if (IsCandidate(I.second) && !Live.count(I.first))
+      Dead.insert(I.first);
+  if (Dead.empty())
+    return;
+  SPIRVDBG(spvdbgs() << "[eliminateDeadEntries] " << Dead.size()
+                     << " dead entries\n");
+  eraseEntries(Dead);
+  RenumberIds = true;
+}
+
+void SPIRVModuleImpl::eraseEntries(std::unordered_set<SPIRVId> &Dead) {
+  auto EraseNoIdEntry = [&](SPIRVEntry *E) {
+    if (EntryNoId.erase(E))
+      delete E;
+  };
+  auto IsDeadEntry = [&](SPIRVEntry *E) { return Dead.count(E->getId()); };
+
+  // Drop the decorations and names of dead entries.
+  std::vector<SPIRVDecorateGeneric *> Decs(DecorateSet.begin(),
+                                           DecorateSet.end());
+  DecorateSet.clear();
+  for (auto D : Decs) {
+    SPIRVId Target = D->getTargetId();
+    if (!Dead.count(Target)) {
+      DecorateSet.insert(D);
+      continue;
+    }
+    if (D->isMemberDecorate())
+      getDecorateIndex().eraseMember(
+          Target, static_cast<SPIRVMemberDecorate *>(D)->getMemberNumber(),
+          D->getDecorateKind());
+    else
+      getDecorateIndex().erase(Target, D->getDecorateKind());
+    EraseNoIdEntry(D);
+  }
+
+  std::unordered_set<SPIRVDecorationGroup *> UsedGroups;
+  GroupDecVec.erase(
+      std::remove_if(
+          GroupDecVec.begin(), GroupDecVec.end(),
+          [&](SPIRVGroupDecorateGeneric *GD) {
+            if (GD->getOpCode() != OpGroupDecorate) {
+              UsedGroups.insert(GD->getDecorationGroup());
+              return false;
+            }
+            std::vector<SPIRVId> Targets;
+            for (auto Target : GD->getTargets()) {
+              if (!Dead.count(Target)) {
+                Targets.push_back(Target);
+                continue;
+              }
+              for (auto D : GD->getDecorationGroup()->getDecorations())
+                getDecorateIndex().erase(Target, D->getDecorateKind());
+            }
+            if (Targets.empty()) {
+              EraseNoIdEntry(GD);
+              return true;
+            }
+            GD->setTargets(Targets);
+            UsedGroups.insert(GD->getDecorationGroup());
+            return false;
+          }),
+      GroupDecVec.end());
+  DecGroupVec.erase(std::remove_if(DecGroupVec.begin(), DecGroupVec.end(),
+                                   [&](SPIRVDecorationGroup *G) {
+                                     if (UsedGroups.count(G))
+                                       return false;
+                                     for (auto D : G->getDecorations())
+                                       EraseNoIdEntry(D);
+                                     Dead.insert(G->getId());
+                                     return true;
+                                   }),
+                    DecGroupVec.end());
+
+  MemberNameVec.erase(std::remove_if(MemberNameVec.begin(),
+                                     MemberNameVec.end(),
+                                     [&](SPIRVMemberName *MN) {
+                                       if (!Dead.count(MN->getTargetId()))
+                                         return false;
+                                       EraseNoIdEntry(MN);
+                                       return true;
+                                     }),
+                     MemberNameVec.end());
+
+  TypeVec.erase(std::remove_if(TypeVec.begin(), TypeVec.end(), IsDeadEntry),
+                TypeVec.end());
+  ConstVec.erase(std::remove_if(ConstVec.begin(), ConstVec.end(), IsDeadEntry),
+                 ConstVec.end());
+  VariableVec.erase(
+      std::remove_if(VariableVec.begin(), VariableVec.end(), IsDeadEntry),
+      VariableVec.end());
+  for (auto I = EntryPool.begin(); I != EntryPool.end();)
+    I = Dead.count(I->second->getId()) ? EntryPool.erase(I) : std::next(I);
+  for (auto I = UnknownStructFieldMap.begin();
+       I != UnknownStructFieldMap.end();)
+    I = Dead.count(I->first->getId()) ? UnknownStructFieldMap.erase(I)
+                                      : std::next(I);
+
+  for (auto Id : Dead) {
+    auto Loc = IdEntryMap.find(Id);
+    NamedId.erase(Id);
+    delete Loc->second;
+    IdEntryMap.erase(Loc);
+  }
+
+  // Ids of erased entries at the end of the range are not needed any more.
+  SPIRVId Bound = IdEntryMap.empty() ? 0 : IdEntryMap.rbegin()->first;
+  if (!IdToInstSetMap.empty())
+    Bound = std::max(Bound, IdToInstSetMap.rbegin()->first);
+  NextId = Bound + 1;
+}
+
 void SPIRVModuleImpl::resolveUnknownStructFields() {
   for (auto &KV : UnknownStructFieldMap) {
     auto *Struct = KV.first;
@@ -822,48 +1076,79 @@ template <class T> T *SPIRVModuleImpl::addType(T *Ty) {
   return Ty;
 }
 
+// Non-aggregate types and constants are hash-consed: requesting the same
+// opcode and operands again returns the entry created the first time, so
+// the writer never emits duplicate declarations. Struct types are nominal
+// and pipe types are completed after creation, so neither is pooled.
+template <class T, class CreatorT>
+T *SPIRVModuleImpl::getOrAddPooled(SPIRVPoolKey Key, CreatorT Create) {
+  auto Loc = EntryPool.find(Key);
+  if (Loc != EntryPool.end())
+    return static_cast<T *>(Loc->second);
+  T *E = Create();
+  EntryPool.emplace(std::move(Key), E);
+  return E;
+}
+
 SPIRVTypeVoid *SPIRVModuleImpl::addVoidType() {
-  return addType(new SPIRVTypeVoid(this, getId()));
+  return getOrAddPooled<SPIRVTypeVoid>({OpTypeVoid}, [&] {
+    return addType(new SPIRVTypeVoid(this, getId()));
+  });
 }
 
 SPIRVTypeArray *SPIRVModuleImpl::addArrayType(SPIRVType *ElementType,
                                               SPIRVConstant *Length) {
-  return addType(new SPIRVTypeArray(this, getId(), ElementType, Length));
+  return getOrAddPooled<SPIRVTypeArray>(
+      {OpTypeArray, ElementType->getId(), Length->getId()}, [&] {
+        return addType(new SPIRVTypeArray(this, getId(), ElementType, Length));
+      });
 }
 
 SPIRVTypeBool *SPIRVModuleImpl::addBoolType() {
-  return addType(new SPIRVTypeBool(this, getId()));
+  return getOrAddPooled<SPIRVTypeBool>({OpTypeBool}, [&] {
+    return addType(new SPIRVTypeBool(this, getId()));
+  });
 }
 
 SPIRVTypeInt *SPIRVModuleImpl::addIntegerType(unsigned BitWidth) {
-  auto Loc = IntTypeMap.find(BitWidth);
-  if (Loc != IntTypeMap.end())
-    return Loc->second;
-  auto Ty = new SPIRVTypeInt(this, getId(), BitWidth, false);
-  IntTypeMap[BitWidth] = Ty;
-  return addType(Ty);
+  return getOrAddPooled<SPIRVTypeInt>({OpTypeInt, BitWidth, 0}, [&] {
+    return addType(new SPIRVTypeInt(this, getId(), BitWidth, false));
+  });
 }
 
 SPIRVTypeFloat *SPIRVModuleImpl::addFloatType(unsigned BitWidth) {
-  SPIRVTypeFloat *T = addType(new SPIRVTypeFloat(this, getId(), BitWidth));
-  return T;
+  return getOrAddPooled<SPIRVTypeFloat>({OpTypeFloat, BitWidth}, [&] {
+    return addType(new SPIRVTypeFloat(this, getId(), BitWidth));
+  });
 }
 
 SPIRVTypePointer *
 SPIRVModuleImpl::addPointerType(SPIRVStorageClassKind StorageClass,
                                 SPIRVType *ElementType) {
-  return addType(
-      new SPIRVTypePointer(this, getId(), StorageClass, ElementType));
+  return getOrAddPooled<SPIRVTypePointer>(
+      {OpTypePointer, StorageClass, ElementType->getId()}, [&] {
+        return addType(
+            new SPIRVTypePointer(this, getId(), StorageClass, ElementType));
+      });
 }
 
 SPIRVTypeFunction *SPIRVModuleImpl::addFunctionType(
     SPIRVType *ReturnType, const std::vector<SPIRVType *> &ParameterTypes) {
-  return addType(
-      new SPIRVTypeFunction(this, getId(), ReturnType, ParameterTypes));
+  SPIRVPoolKey Key = {OpTypeFunction, ReturnType->getId()};
+  for (auto *PT : ParameterTypes)
+    Key.push_back(PT->getId());
+  return getOrAddPooled<SPIRVTypeFunction>(std::move(Key), [&] {
+    return addType(
+        new SPIRVTypeFunction(this, getId(), ReturnType, ParameterTypes));
+  });
 }
 
 SPIRVTypeOpaque *SPIRVModuleImpl::addOpaqueType(const std::string &Name) {
-  return addType(new SPIRVTypeOpaque(this, getId(), Name));
+  SPIRVPoolKey Key = getVec(Name);
+  Key.insert(Key.begin(), OpTypeOpaque);
+  return getOrAddPooled<SPIRVTypeOpaque>(std::move(Key), [&] {
+    return addType(new SPIRVTypeOpaque(this, getId(), Name));
+  });
 }
 
 SPIRVTypeStruct *SPIRVModuleImpl::openStructType(unsigned NumMembers,
@@ -879,18 +1164,28 @@ void SPIRVModuleImpl::closeStructType(SPIRVTypeStruct *T, bool Packed) {
 
 SPIRVTypeVector *SPIRVModuleImpl::addVectorType(SPIRVType *CompType,
                                                 SPIRVWord CompCount) {
-  return addType(new SPIRVTypeVector(this, getId(), CompType, CompCount));
+  return getOrAddPooled<SPIRVTypeVector>(
+      {OpTypeVector, CompType->getId(), CompCount}, [&] {
+        return addType(
+            new SPIRVTypeVector(this, getId(), CompType, CompCount));
+      });
 }
 SPIRVType *SPIRVModuleImpl::addOpaqueGenericType(Op TheOpCode) {
-  return addType(new SPIRVTypeOpaqueGeneric(TheOpCode, this, getId()));
+  return getOrAddPooled<SPIRVType>({TheOpCode}, [&] {
+    return addType(new SPIRVTypeOpaqueGeneric(TheOpCode, this, getId()));
+  });
 }
 
 SPIRVTypeDeviceEvent *SPIRVModuleImpl::addDeviceEventType() {
-  return addType(new SPIRVTypeDeviceEvent(this, getId()));
+  return getOrAddPooled<SPIRVTypeDeviceEvent>({OpTypeDeviceEvent}, [&] {
+    return addType(new SPIRVTypeDeviceEvent(this, getId()));
+  });
 }
 
 SPIRVTypeQueue *SPIRVModuleImpl::addQueueType() {
-  return addType(new SPIRVTypeQueue(this, getId()));
+  return getOrAddPooled<SPIRVTypeQueue>({OpTypeQueue}, [&] {
+    return addType(new SPIRVTypeQueue(this, getId()));
+  });
 }
 
 SPIRVTypePipe *SPIRVModuleImpl::addPipeType() {
@@ -900,32 +1195,54 @@ SPIRVTypePipe *SPIRVModuleImpl::addPipeType() {
 SPIRVTypeImage *
 SPIRVModuleImpl::addImageType(SPIRVType *SampledType,
                               const SPIRVTypeImageDescriptor &Desc) {
-  return addType(new SPIRVTypeImage(
-      this, getId(), SampledType ? SampledType->getId() : 0, Desc));
+  SPIRVId SampledId = SampledType ? SampledType->getId() : 0;
+  return getOrAddPooled<SPIRVTypeImage>(
+      {OpTypeImage, SampledId, Desc.Dim, Desc.Depth, Desc.Arrayed, Desc.MS,
+       Desc.Sampled, Desc.Format},
+      [&] {
+        return addType(new SPIRVTypeImage(this, getId(), SampledId, Desc));
+      });
 }
 
 SPIRVTypeImage *
 SPIRVModuleImpl::addImageType(SPIRVType *SampledType,
                               const SPIRVTypeImageDescriptor &Desc,
                               SPIRVAccessQualifierKind Acc) {
-  return addType(new SPIRVTypeImage(
-      this, getId(), SampledType ? SampledType->getId() : 0, Desc, Acc));
+  SPIRVId SampledId = SampledType ? SampledType->getId() : 0;
+  return getOrAddPooled<SPIRVTypeImage>(
+      {OpTypeImage, SampledId, Desc.Dim, Desc.Depth, Desc.Arrayed, Desc.MS,
+       Desc.Sampled, Desc.Format, Acc},
+      [&] {
+        return addType(
+            new SPIRVTypeImage(this, getId(), SampledId, Desc, Acc));
+      });
 }
 
 SPIRVTypeSampler *SPIRVModuleImpl::addSamplerType() {
-  return addType(new SPIRVTypeSampler(this, getId()));
+  return getOrAddPooled<SPIRVTypeSampler>({OpTypeSampler}, [&] {
+    return addType(new SPIRVTypeSampler(this, getId()));
+  });
 }
 
 SPIRVTypePipeStorage *SPIRVModuleImpl::addPipeStorageType() {
-  return addType(new SPIRVTypePipeStorage(this, getId()));
+  return getOrAddPooled<SPIRVTypePipeStorage>({OpTypePipeStorage}, [&] {
+    return addType(new SPIRVTypePipeStorage(this, getId()));
+  });
 }
 
 SPIRVTypeSampledImage *SPIRVModuleImpl::addSampledImageType(SPIRVTypeImage *T) {
-  return addType(new SPIRVTypeSampledImage(this, getId(), T));
+  return getOrAddPooled<SPIRVTypeSampledImage>(
+      {OpTypeSampledImage, T->getId()}, [&] {
+        return addType(new SPIRVTypeSampledImage(this, getId(), T));
+      });
 }
 
 void SPIRVModuleImpl::createForwardPointers() {
   std::unordered_set<SPIRVId> Seen;
+  // Pointers declared by a previous call, when more types were added since.
+  std::unordered_set<const SPIRVType *> Declared;
+  for (auto *FP : ForwardPointerVec)
+    Declared.insert(FP->getPointer());
 
   for (auto *T : TypeVec) {
     if (T->hasId())
@@ -942,7 +1259,7 @@ void SPIRVModuleImpl::createForwardPointers() {
         continue;
       auto Ptr = static_cast<SPIRVTypePointer *>(MemberTy);
 
-      if (Seen.find(Ptr->getId()) == Seen.end()) {
+      if (Seen.find(Ptr->getId()) == Seen.end() && !Declared.count(Ptr)) {
         ForwardPointerVec.push_back(new SPIRVTypeForwardPointer(
             this, Ptr, Ptr->getPointerStorageClass()));
       }
@@ -952,16 +1269,37 @@ void SPIRVModuleImpl::createForwardPointers() {
 
 SPIRVTypeVmeImageINTEL *
 SPIRVModuleImpl::addVmeImageINTELType(SPIRVTypeImage *T) {
-  return addType(new SPIRVTypeVmeImageINTEL(this, getId(), T));
+  return getOrAddPooled<SPIRVTypeVmeImageINTEL>(
+      {OpTypeVmeImageINTEL, T->getId()}, [&] {
+        return addType(new SPIRVTypeVmeImageINTEL(this, getId(), T));
+      });
 }
 
 SPIRVTypeBufferSurfaceINTEL *
 SPIRVModuleImpl::addBufferSurfaceINTELType(SPIRVAccessQualifierKind Access) {
-  return addType(new SPIRVTypeBufferSurfaceINTEL(this, getId(), Access));
+  return getOrAddPooled<SPIRVTypeBufferSurfaceINTEL>(
+      {OpTypeBufferSurfaceINTEL, Access}, [&] {
+        return addType(new SPIRVTypeBufferSurfaceINTEL(this, getId(), Access));
+      });
+}
+
+SPIRVTypeJointMatrixINTEL *SPIRVModuleImpl::addJointMatrixINTELType(
+    SPIRVType *CompType, SPIRVConstant *Rows, SPIRVConstant *Columns,
+    SPIRVConstant *Layout, SPIRVConstant *Scope) {
+  return getOrAddPooled<SPIRVTypeJointMatrixINTEL>(
+      {OpTypeJointMatrixINTEL, CompType->getId(), Rows->getId(),
+       Columns->getId(), Layout->getId(), Scope->getId()},
+      [&] {
+        return addType(new SPIRVTypeJointMatrixINTEL(this, getId(), CompType,
+                                                     Rows, Columns, Layout,
+                                                     Scope));
+      });
 }
 
 SPIRVType *SPIRVModuleImpl::addSubgroupAvcINTELType(Op TheOpCode) {
-  return addType(new SPIRVTypeSubgroupAvcINTEL(TheOpCode, this, getId()));
+  return getOrAddPooled<SPIRVType>({TheOpCode}, [&] {
+    return addType(new SPIRVTypeSubgroupAvcINTEL(TheOpCode, this, getId()));
+  });
 }
 
 SPIRVFunction *SPIRVModuleImpl::addFunction(SPIRVFunction *Func) {
@@ -1039,53 +1377,98 @@ void SPIRVModuleImpl::eraseInstruction(SPIRVInstruction *I,
   delete I;
 }
 
+void SPIRVModuleImpl::eraseFunctionBody(SPIRVFunction *F) {
+  std::unordered_set<SPIRVId> Dead;
+  for (auto BB : F->takeBasicBlocks()) {
+    for (auto I = BB->getFirstInst(); I;) {
+      auto Next = I->getNext();
+      if (I->hasId())
+        Dead.insert(I->getId());
+      else if (EntryNoId.erase(I))
+        delete I;
+      I = Next;
+    }
+    Dead.insert(BB->getId());
+  }
+  eraseEntries(Dead);
+}
+
 SPIRVValue *SPIRVModuleImpl::addConstant(SPIRVValue *C) { return add(C); }
 
 SPIRVValue *SPIRVModuleImpl::addConstant(SPIRVType *Ty, uint64_t V) {
   if (Ty->isTypeBool()) {
     if (V)
-      return addConstant(new SPIRVConstantTrue(this, Ty, getId()));
-    else
+      return getOrAddPooled<SPIRVValue>({OpConstantTrue, Ty->getId()}, [&] {
+        return addConstant(new SPIRVConstantTrue(this, Ty, getId()));
+      });
+    return getOrAddPooled<SPIRVValue>({OpConstantFalse, Ty->getId()}, [&] {
       return addConstant(new SPIRVConstantFalse(this, Ty, getId()));
+    });
   }
   if (Ty->isTypeInt())
     return addIntegerConstant(static_cast<SPIRVTypeInt *>(Ty), V);
-  return addConstant(new SPIRVConstant(this, Ty, getId(), V));
+  return getOrAddPooled<SPIRVValue>(
+      {OpConstant, Ty->getId(), static_cast<SPIRVWord>(V),
+       static_cast<SPIRVWord>(V >> 32)},
+      [&] { return addConstant(new SPIRVConstant(this, Ty, getId(), V)); });
 }
 
 SPIRVValue *SPIRVModuleImpl::addIntegerConstant(SPIRVTypeInt *Ty, uint64_t V) {
-  if (Ty->getBitWidth() == 32) {
-    unsigned I32 = static_cast<unsigned>(V);
-    assert(I32 == V && "Integer value truncated");
-    return getLiteralAsConstant(I32);
-  }
-  return addConstant(new SPIRVConstant(this, Ty, getId(), V));
+  assert((Ty->getBitWidth() != 32 || static_cast<unsigned>(V) == V) &&
+         "Integer value truncated");
+  return getOrAddPooled<SPIRVValue>(
+      {OpConstant, Ty->getId(), static_cast<SPIRVWord>(V),
+       static_cast<SPIRVWord>(V >> 32)},
+      [&] { return addConstant(new SPIRVConstant(this, Ty, getId(), V)); });
 }
 
 SPIRVValue *SPIRVModuleImpl::addFloatConstant(SPIRVTypeFloat *Ty, float V) {
-  return addConstant(new SPIRVConstant(this, Ty, getId(), V));
+  // Key on the bit pattern so that -0.0 and NaN payloads stay distinct.
+  SPIRVWord Bits;
+  std::memcpy(&Bits, &V, sizeof(Bits));
+  return getOrAddPooled<SPIRVValue>(
+      {OpConstant, Ty->getId(), Bits, 0},
+      [&] { return addConstant(new SPIRVConstant(this, Ty, getId(), V)); });
 }
 
 SPIRVValue *SPIRVModuleImpl::addDoubleConstant(SPIRVTypeFloat *Ty, double V) {
-  return addConstant(new SPIRVConstant(this, Ty, getId(), V));
+  uint64_t Bits;
+  std::memcpy(&Bits, &V, sizeof(Bits));
+  return getOrAddPooled<SPIRVValue>(
+      {OpConstant, Ty->getId(), static_cast<SPIRVWord>(Bits),
+       static_cast<SPIRVWord>(Bits >> 32)},
+      [&] { return addConstant(new SPIRVConstant(this, Ty, getId(), V)); });
 }
 
 SPIRVValue *SPIRVModuleImpl::addNullConstant(SPIRVType *Ty) {
-  return addConstant(new SPIRVConstantNull(this, Ty, getId()));
+  return getOrAddPooled<SPIRVValue>({OpConstantNull, Ty->getId()}, [&] {
+    return addConstant(new SPIRVConstantNull(this, Ty, getId()));
+  });
 }
 
 SPIRVValue *SPIRVModuleImpl::addCompositeConstant(
     SPIRVType *Ty, const std::vector<SPIRVValue *> &Elements) {
-  return addConstant(new SPIRVConstantComposite(this, Ty, getId(), Elements));
+  SPIRVPoolKey Key = {OpConstantComposite, Ty->getId()};
+  for (auto *E : Elements)
+    Key.push_back(E->getId());
+  return getOrAddPooled<SPIRVValue>(std::move(Key), [&] {
+    return addConstant(new SPIRVConstantComposite(this, Ty, getId(), Elements));
+  });
 }
 
 SPIRVValue *SPIRVModuleImpl::addConstFunctionPointerINTEL(SPIRVType *Ty,
                                                           SPIRVFunction *F) {
-  return addConstant(new SPIRVConstFunctionPointerINTEL(getId(), Ty, F, this));
+  return getOrAddPooled<SPIRVValue>(
+      {OpConstFunctionPointerINTEL, Ty->getId(), F->getId()}, [&] {
+        return addConstant(
+            new SPIRVConstFunctionPointerINTEL(getId(), Ty, F, this));
+      });
 }
 
 SPIRVValue *SPIRVModuleImpl::addUndef(SPIRVType *TheType) {
-  return addConstant(new SPIRVUndef(this, TheType, getId()));
+  return getOrAddPooled<SPIRVValue>({OpUndef, TheType->getId()}, [&] {
+    return addConstant(new SPIRVUndef(this, TheType, getId()));
+  });
 }
 
 // Instruction creation functions
@@ -1505,13 +1888,6 @@ spv_ostream &operator<<(spv_ostream &O, const std::vector<T *> &V) {
   return O;
 }
 
-template <class T, class B>
-spv_ostream &operator<<(spv_ostream &O, const std::multiset<T *, B> &V) {
-  for (auto &I : V)
-    O << *I;
-  return O;
-}
-
 // To satisfy SPIR-V spec requirement:
 // "All operands must be declared before being used",
 // we do DFS based topological sort
@@ -1602,9 +1978,14 @@ spv_ostream &operator<<(spv_ostream &O, const TopologicalSort &S) {
 
 spv_ostream &operator<<(spv_ostream &O, SPIRVModule &M) {
   SPIRVModuleImpl &MI = *static_cast<SPIRVModuleImpl *>(&M);
+  if (MI.RenumberIds && MI.encodeRenumbered(O))
+    return O;
   // Start tracking of the current line with no line
   MI.CurrentLine.reset();
 
+  for (auto F : MI.FuncVec)
+    F->materialize();
+
   SPIRVEncoder Encoder(O);
   Encoder << MagicNumber << MI.SPIRVVersion
           << (((SPIRVWord)MI.GeneratorId << 16) | MI.GeneratorVer)
@@ -1907,6 +2288,87 @@ bool isSpirvBinary(const std::string &Img) {
   return *Magic == MagicNumber;
 }
 
+size_t getSpirvModuleWordCount(SPIRVModule &M) {
+#ifdef _SPIRV_SUPPORT_TEXT_FMT
+  auto SaveOpt = SPIRVUseTextFormat;
+  SPIRVUseTextFormat = false;
+#endif
+  SPIRVCountingStreamBuf Counter;
+  std::ostream OS(&Counter);
+  OS << M;
+#ifdef _SPIRV_SUPPORT_TEXT_FMT
+  SPIRVUseTextFormat = SaveOpt;
+#endif
+  return Counter.getNumWrittenBytes() / sizeof(SPIRVWord);
+}
+
+bool writeSpirvModule(SPIRVModule &M, uint32_t *Words, size_t NumWords) {
+#ifdef _SPIRV_SUPPORT_TEXT_FMT
+  auto SaveOpt = SPIRVUseTextFormat;
+  SPIRVUseTextFormat = false;
+#endif
+  SPIRVWordStreamBuf Buf(Words, NumWords);
+  std::ostream OS(&Buf);
+  OS << M;
+#ifdef _SPIRV_SUPPORT_TEXT_FMT
+  SPIRVUseTextFormat = SaveOpt;
+#endif
+  return M.getErrorLog().checkError(OS.good(), SPIRVEC_InvalidModule,
+                                    "output buffer of " +
+                                        std::to_string(NumWords) +
+                                        " words is too small");
+}
+
+bool writeSpirvModule(SPIRVModule &M, std::vector<uint32_t> &Words) {
+#ifdef _SPIRV_SUPPORT_TEXT_FMT
+  auto SaveOpt = SPIRVUseTextFormat;
+  SPIRVUseTextFormat = false;
+#endif
+  SPIRVWordVectorStreamBuf Buf(Words);
+  std::ostream OS(&Buf);
+  OS << M;
+  Buf.finish();
+#ifdef _SPIRV_SUPPORT_TEXT_FMT
+  SPIRVUseTextFormat = SaveOpt;
+#endif
+  return M.getErrorLog().checkError(OS.good(), SPIRVEC_InvalidModule,
+                                    "failed to encode the module");
+}
+
+// The module is encoded, the Ids are renumbered in the encoding and, for the
+// text format, the encoding is decoded into a new module which is printed.
+bool SPIRVModuleImpl::encodeRenumbered(spv_ostream &O) {
+  std::vector<SPIRVWord> Words;
+  RenumberIds = false;
+  bool Encoded = writeSpirvModule(*this, Words);
+  RenumberIds = true;
+  std::string ErrMsg;
+  if (!Encoded || !renumberIds(Words, ErrMsg)) {
+    SPIRVDBG(spvdbgs() << "[encodeRenumbered] " << ErrMsg << '\n');
+    return false;
+  }
+#ifdef _SPIRV_SUPPORT_TEXT_FMT
+  if (SPIRVUseTextFormat) {
+    TranslatorOpts Opts = TranslationOpts;
+    Opts.setLazyFunctionDecodingEnabled(false);
+    SPIRVModuleImpl Renumbered(Opts);
+    std::istringstream IS(
+        std::string(reinterpret_cast<const char *>(Words.data()),
+                    Words.size() * sizeof(SPIRVWord)));
+    SPIRVUseTextFormat = false;
+    IS >> Renumbered;
+    SPIRVUseTextFormat = true;
+    if (!Renumbered.isModuleValid())
+      return false;
+    O << Renumbered;
+    return true;
+  }
+#endif
+  O.write(reinterpret_cast<const char *>(Words.data()),
+          Words.size() * sizeof(SPIRVWord));
+  return true;
+}
+
 #ifdef _SPIRV_SUPPORT_TEXT_FMT
 
 bool convertSpirv(std::istream &IS, std::ostream &OS, std::string &ErrMsg,
@@ -1937,10 +2399,10 @@ bool convertSpirv(std::istream &IS, std::ostream &OS, std::string &ErrMsg,
 }
 
 bool isSpirvText(const std::string &Img) {
-  std::istringstream SS(Img);
-  unsigned Magic = 0;
-  SS >> Magic;
-  if (SS.bad())
+  SPIRVMemoryStreamBuf Buf(Img.data(), Img.size());
+  std::istream SS(&Buf);
+  uint32_t Magic = 0;
+  if (!readTextWord(SS, Magic))
     return false;
   return Magic == MagicNumber;
 }
@@ -1952,7 +2414,8 @@ bool convertSpirv(std::string &Input, std::string &Out, std::string &ErrMsg,
     Out = Input;
     return true;
   }
-  std::istringstream IS(Input);
+  SPIRVMemoryStreamBuf Buf(Input.data(), Input.size());
+  std::istream IS(&Buf);
   std::ostringstream OS;
   if (!convertSpirv(IS, OS, ErrMsg, FromText, ToText))
     return false;
@@ -80,7 +80,9 @@ class SPIRVTypePipe;
 class SPIRVTypeVmeImageINTEL;
 class SPIRVValue;
 class SPIRVVariable;
+class SPIRVDecorate;
 class SPIRVDecorateGeneric;
+class SPIRVMemberDecorate;
 class SPIRVDecorationGroup;
 class SPIRVGroupDecorate;
 class SPIRVGroupMemberDecorate;
@@ -90,10 +92,96 @@ class SPIRVAsmTargetINTEL;
 class SPIRVAsmINTEL;
 class SPIRVAsmCallINTEL;
 class SPIRVTypeBufferSurfaceINTEL;
+class SPIRVTypeJointMatrixINTEL;
 
 typedef SPIRVBasicBlock SPIRVLabel;
 struct SPIRVTypeImageDescriptor;
 
+/// Decorations of a module indexed by the Id of the decorated entry and the
+/// decoration kind, so that checking whether an entry has a decoration is a
+/// single hash lookup. Decorations applied through a decoration group are
+/// recorded for every target when the OpGroupDecorate is processed.
+class SPIRVDecorateIndex {
+public:
+  /// An entry may have multiple decorations of one kind, e.g. FuncParamAttr.
+  typedef std::vector<const SPIRVDecorate *> DecorateVec;
+
+  void add(SPIRVId Target, const SPIRVDecorate *Dec);
+  void addMember(SPIRVId Target, const SPIRVMemberDecorate *Dec);
+  void erase(SPIRVId Target, Decoration Kind) {
+    Decs.erase(getKey(Target, Kind));
+  }
+  void eraseMember(SPIRVId Target, SPIRVWord MemberNumber, Decoration Kind) {
+    MemberDecs.erase({Target, MemberNumber, Kind});
+  }
+
+  /// \returns all decorations of \p Kind of \p Target in the order they were
+  /// added.
+  const DecorateVec &get(SPIRVId Target, Decoration Kind) const;
+  /// \returns the first decoration of \p Kind of \p Target or nullptr.
+  const SPIRVDecorate *find(SPIRVId Target, Decoration Kind) const {
+    auto Loc = Decs.find(getKey(Target, Kind));
+    return Loc == Decs.end() ? nullptr : Loc->second.front();
+  }
+  const SPIRVMemberDecorate *findMember(SPIRVId Target, SPIRVWord MemberNumber,
+                                        Decoration Kind) const {
+    auto Loc = MemberDecs.find({Target, MemberNumber, Kind});
+    return Loc == MemberDecs.end() ? nullptr : Loc->second;
+  }
+
+private:
+  struct MemberKey {
+    SPIRVId Target;
+    SPIRVWord MemberNumber;
+    Decoration Kind;
+    bool operator==(const MemberKey &Other) const {
+      return Target == Other.Target && MemberNumber == Other.MemberNumber &&
+             Kind == Other.Kind;
+    }
+  };
+  struct MemberKeyHash {
+    size_t operator()(const MemberKey &Key) const {
+      return std::hash<uint64_t>()(
+          (static_cast<uint64_t>(Key.Target) << 32 | Key.MemberNumber) * 31 +
+          Key.Kind);
+    }
+  };
+  static uint64_t getKey(SPIRVId Target, Decoration Kind) {
+    return static_cast<uint64_t>(Target) << 32 | static_cast<uint32_t>(Kind);
+  }
+
+  std::unordered_map<uint64_t, DecorateVec> Decs;
+  std::unordered_map<MemberKey, const SPIRVMemberDecorate *, MemberKeyHash>
+      MemberDecs;
+};
+
+/// Names and source lines of the entries of a module. Few entries have either,
+/// so they are kept here keyed by entry rather than in every SPIRVEntry. The
+/// entry flags whether it has an element in each table, so queries for entries
+/// without one never reach the tables.
+class SPIRVEntryInfoIndex {
+public:
+  const std::string &getName(const SPIRVEntry *E) const {
+    return Names.find(E)->second;
+  }
+  const std::shared_ptr<const SPIRVLine> &getLine(const SPIRVEntry *E) const {
+    return Lines.find(E)->second;
+  }
+  void setName(const SPIRVEntry *E, const std::string &Name) {
+    Names[E] = Name;
+  }
+  void setLine(const SPIRVEntry *E, const std::shared_ptr<const SPIRVLine> &L) {
+    Lines[E] = L;
+  }
+  void eraseName(const SPIRVEntry *E) { Names.erase(E); }
+  void eraseLine(const SPIRVEntry *E) { Lines.erase(E); }
+
+private:
+  std::unordered_map<const SPIRVEntry *, std::string> Names;
+  std::unordered_map<const SPIRVEntry *, std::shared_ptr<const SPIRVLine>>
+      Lines;
+};
+
 class SPIRVModule {
 public:
   typedef std::map<SPIRVCapabilityKind, SPIRVCapability *> SPIRVCapMap;
@@ -165,6 +253,15 @@ public:
   virtual void setName(SPIRVEntry *, const std::string &) = 0;
   virtual void setSourceLanguage(SourceLanguage, SPIRVWord) = 0;
   virtual void optimizeDecorates() = 0;
+  /// Remove types, constants and global variables which are not referenced
+  /// by any function, entry point, debug info or other live entry, together
+  /// with their names and decorations, and lower the Id bound to the largest
+  /// Id still in use.
+  /// The remaining Ids are not renumbered, since entries hold the Ids of
+  /// their operands as plain words, and equal types and constants are not
+  /// merged here: they are uniqued when they are added to the module.
+  /// Pointers to erased entries held outside the module become dangling.
+  virtual void eliminateDeadEntries() = 0;
   virtual void setAutoAddCapability(bool E) { AutoAddCapability = E; }
   virtual void setValidateCapability(bool E) { ValidateCapability = E; }
   virtual void setAutoAddExtensions(bool E) { AutoAddExtensions = E; }
@@ -215,6 +312,9 @@ public:
                                      SPIRVId Id = SPIRVID_INVALID) = 0;
   virtual SPIRVEntry *replaceForward(SPIRVForward *, SPIRVEntry *) = 0;
   virtual void eraseInstruction(SPIRVInstruction *, SPIRVBasicBlock *) = 0;
+  /// Erase the basic blocks of a function and their instructions, together
+  /// with their names and decorations. The function keeps its parameters.
+  virtual void eraseFunctionBody(SPIRVFunction *) = 0;
 
   // Type creation functions
   virtual SPIRVTypeArray *addArrayType(SPIRVType *, SPIRVConstant *) = 0;
@@ -246,6 +346,10 @@ public:
   virtual SPIRVTypeVmeImageINTEL *addVmeImageINTELType(SPIRVTypeImage *) = 0;
   virtual SPIRVTypeBufferSurfaceINTEL *
   addBufferSurfaceINTELType(SPIRVAccessQualifierKind Access) = 0;
+  virtual SPIRVTypeJointMatrixINTEL *
+  addJointMatrixINTELType(SPIRVType *CompType, SPIRVConstant *Rows,
+                          SPIRVConstant *Columns, SPIRVConstant *Layout,
+                          SPIRVConstant *Scope) = 0;
   virtual void createForwardPointers() = 0;
 
   // Constants creation functions
@@ -466,6 +570,33 @@ public:
     return TranslationOpts.getSpecializationConstant(SpecId, ConstValue);
   }
 
+  bool isSpecConstBranchFoldingEnabled() const {
+    return TranslationOpts.isSpecConstBranchFoldingEnabled();
+  }
+
+  // Replaces the translation options of an already decoded module, e.g. to
+  // translate it once more with other specialization constant values.
+  // Options which only affect decoding have no effect anymore.
+  void setTranslatorOpts(const SPIRV::TranslatorOpts &Opts) {
+    TranslationOpts = Opts;
+  }
+
+  bool hasSelectedKernels() const {
+    return TranslationOpts.hasSelectedKernels();
+  }
+
+  const std::set<std::string> &getSelectedKernels() const {
+    return TranslationOpts.getSelectedKernels();
+  }
+
+  bool isKernelSelected(const std::string &Name) const {
+    return TranslationOpts.isKernelSelected(Name);
+  }
+
+  bool isLazyFunctionDecodingEnabled() const {
+    return TranslationOpts.isLazyFunctionDecodingEnabled();
+  }
+
   FPContractMode getFPContractMode() const {
     return TranslationOpts.getFPContractMode();
   }
@@ -486,6 +617,13 @@ public:
     }
   }
 
+  SPIRVDecorateIndex &getDecorateIndex() { return DecorateIndex; }
+  const SPIRVDecorateIndex &getDecorateIndex() const { return DecorateIndex; }
+  SPIRVEntryInfoIndex &getEntryInfoIndex() { return EntryInfoIndex; }
+  const SPIRVEntryInfoIndex &getEntryInfoIndex() const {
+    return EntryInfoIndex;
+  }
+
   // I/O functions
   friend spv_ostream &operator<<(spv_ostream &O, SPIRVModule &M);
   friend std::istream &operator>>(std::istream &I, SPIRVModule &M);
@@ -495,6 +633,8 @@ protected:
   bool ValidateCapability;
   bool AutoAddExtensions = true;
   SPIRV::TranslatorOpts TranslationOpts;
+  SPIRVDecorateIndex DecorateIndex;
+  SPIRVEntryInfoIndex EntryInfoIndex;
 
 private:
   bool IsValid;
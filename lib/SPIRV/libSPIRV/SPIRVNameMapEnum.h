@@ -539,6 +539,7 @@ template <> inline void SPIRVMap<Capability, std::string>::init() {
   add(CapabilityIndirectReferencesINTEL, "IndirectReferencesINTEL");
   add(CapabilityKernelAttributesINTEL, "KernelAttributesINTEL");
   add(CapabilityFPGAKernelAttributesINTEL, "FPGAKernelAttributesINTEL");
+  add(CapabilityJointMatrixINTEL, "JointMatrixINTEL");
   add(CapabilityGroupNonUniform, "GroupNonUniform");
   add(CapabilityGroupNonUniformVote, "GroupNonUniformVote");
   add(CapabilityGroupNonUniformArithmetic, "GroupNonUniformArithmetic");
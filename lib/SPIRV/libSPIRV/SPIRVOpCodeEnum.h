@@ -471,3 +471,8 @@ _SPIRV_OP(ReadPipeBlockingINTEL, 5946)
 _SPIRV_OP(WritePipeBlockingINTEL, 5947)
 _SPIRV_OP(FPGARegINTEL, 5949)
 _SPIRV_OP(TypeBufferSurfaceINTEL, 6086)
+_SPIRV_OP(TypeJointMatrixINTEL, 6119)
+_SPIRV_OP(JointMatrixLoadINTEL, 6120)
+_SPIRV_OP(JointMatrixStoreINTEL, 6121)
+_SPIRV_OP(JointMatrixMadINTEL, 6122)
+_SPIRV_OP(JointMatrixWorkItemLengthINTEL, 6410)
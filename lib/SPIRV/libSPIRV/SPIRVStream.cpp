@@ -57,29 +57,195 @@ static void writeQuotedString(spv_ostream &O, const std::string &Str) {
   O << '"';
 }
 
-/// Read quoted string. Replace \" with ".
+#ifdef _SPIRV_SUPPORT_TEXT_FMT
+// The text format lexer works on the stream buffer directly. Going through
+// the formatted std::istream operators costs a sentry object and a locale
+// lookup for every single token, which dominates text conversion time.
+typedef std::char_traits<char> TextTraits;
+
+static bool isTextSpace(TextTraits::int_type C) {
+  return C == ' ' || C == '\n' || C == '\t' || C == '\r' || C == '\v' ||
+         C == '\f';
+}
+
+static bool isTextDigit(TextTraits::int_type C) { return C >= '0' && C <= '9'; }
+
+/// Skip whitespace and comments. Comment starts with ';', ends with '\n'.
+/// \returns the first character after them without consuming it.
+static TextTraits::int_type skipTextSpace(std::streambuf &SB) {
+  TextTraits::int_type C = SB.sgetc();
+  for (;;) {
+    while (isTextSpace(C))
+      C = SB.snextc();
+    if (C != ';')
+      return C;
+    while (C != TextTraits::eof() && C != '\n')
+      C = SB.snextc();
+  }
+}
+
+bool readTextWord(std::istream &IS, uint32_t &W) {
+  if (!IS.good()) {
+    IS.setstate(std::ios_base::failbit);
+    return false;
+  }
+  std::streambuf &SB = *IS.rdbuf();
+  TextTraits::int_type C = skipTextSpace(SB);
+  bool IsNegative = C == '-';
+  if (IsNegative || C == '+')
+    C = SB.snextc();
+  if (!isTextDigit(C)) {
+    W = 0;
+    IS.setstate(C == TextTraits::eof()
+                    ? std::ios_base::failbit | std::ios_base::eofbit
+                    : std::ios_base::failbit);
+    return false;
+  }
+  uint64_t V = 0;
+  bool IsOverflow = false;
+  do {
+    if (!IsOverflow) {
+      V = V * 10 + (C - '0');
+      IsOverflow = V > std::numeric_limits<uint32_t>::max();
+    }
+    C = SB.snextc();
+  } while (isTextDigit(C));
+  if (C == TextTraits::eof())
+    IS.setstate(std::ios_base::eofbit);
+  if (IsOverflow) {
+    W = std::numeric_limits<uint32_t>::max();
+    IS.setstate(std::ios_base::failbit);
+    return false;
+  }
+  // Same as std::istream, a negative value wraps around for unsigned words.
+  W = IsNegative ? static_cast<uint32_t>(-V) : static_cast<uint32_t>(V);
+  return true;
+}
+
+/// Read a whitespace separated token, e.g. an enumerator name.
+static bool readTextToken(std::istream &IS, std::string &Token) {
+  if (!IS.good()) {
+    IS.setstate(std::ios_base::failbit);
+    return false;
+  }
+  std::streambuf &SB = *IS.rdbuf();
+  TextTraits::int_type C = skipTextSpace(SB);
+  while (C != TextTraits::eof() && !isTextSpace(C)) {
+    Token += TextTraits::to_char_type(C);
+    C = SB.snextc();
+  }
+  if (C == TextTraits::eof())
+    IS.setstate(std::ios_base::eofbit);
+  if (Token.empty()) {
+    IS.setstate(std::ios_base::failbit);
+    return false;
+  }
+  return true;
+}
+
+/// Read quoted string. Replace \" with ". Whitespace inside the quotes is
+/// preserved, so strings written by writeQuotedString round-trip exactly.
 static void readQuotedString(std::istream &IS, std::string &Str) {
-  char Ch = ' ';
-  char PreCh = ' ';
-  while (IS >> Ch && Ch != '"')
-    ;
-
-  if (IS >> PreCh && PreCh != '"') {
-    while (IS >> Ch) {
-      if (Ch == '"') {
-        if (PreCh != '\\') {
-          Str += PreCh;
-          break;
-        } else
-          PreCh = Ch;
-      } else {
-        Str += PreCh;
-        PreCh = Ch;
+  if (!IS.good()) {
+    IS.setstate(std::ios_base::failbit);
+    return;
+  }
+  std::streambuf &SB = *IS.rdbuf();
+  TextTraits::int_type C = skipTextSpace(SB);
+  while (C != TextTraits::eof() && C != '"')
+    C = SB.snextc();
+  if (C == TextTraits::eof()) {
+    IS.setstate(std::ios_base::failbit | std::ios_base::eofbit);
+    return;
+  }
+  for (C = SB.snextc(); C != TextTraits::eof(); C = SB.snextc()) {
+    char Ch = TextTraits::to_char_type(C);
+    if (Ch == '"') {
+      if (!Str.empty() && Str.back() == '\\') {
+        Str.back() = '"';
+        continue;
       }
+      SB.sbumpc();
+      return;
     }
+    Str += Ch;
   }
+  IS.setstate(std::ios_base::failbit | std::ios_base::eofbit);
 }
 
+namespace {
+/// Name table for enumerations used by the text format. It is built once from
+/// the corresponding SPIRVMap and provides an open addressing hash table for
+/// name to value lookups, and a sorted array for value to name lookups.
+template <class T> class SPIRVTextNameTable {
+public:
+  static const SPIRVTextNameTable &get() {
+    static const SPIRVTextNameTable Table;
+    return Table;
+  }
+
+  bool rfind(const std::string &Name, T *Val) const {
+    for (size_t I = hash(Name) & Mask;; I = (I + 1) & Mask) {
+      const Slot &S = Slots[I];
+      if (!S.Name)
+        return false;
+      if (*S.Name == Name) {
+        *Val = S.Value;
+        return true;
+      }
+    }
+  }
+
+  const std::string &map(T Val) const {
+    auto Loc = std::lower_bound(
+        Names.begin(), Names.end(), Val,
+        [](const std::pair<T, std::string> &E, T V) { return E.first < V; });
+    assert(Loc != Names.end() && Loc->first == Val && "Invalid key");
+    return Loc->second;
+  }
+
+private:
+  struct Slot {
+    const std::string *Name;
+    T Value;
+  };
+
+  SPIRVTextNameTable() {
+    typedef decltype(getNameMap(T())) MapTy;
+    MapTy::foreach (
+        [&](T V, std::string N) { Names.emplace_back(V, std::move(N)); });
+    size_t Size = 1;
+    while (Size < 2 * Names.size())
+      Size <<= 1;
+    Mask = Size - 1;
+    Slots.assign(Size, Slot{nullptr, T()});
+    for (auto &E : Names) {
+      // Use the reverse map to pick the same value for names shared by
+      // several enumerators.
+      T V = E.first;
+      MapTy::rfind(E.second, &V);
+      size_t I = hash(E.second) & Mask;
+      while (Slots[I].Name && *Slots[I].Name != E.second)
+        I = (I + 1) & Mask;
+      Slots[I] = Slot{&E.second, V};
+    }
+  }
+
+  // FNV-1a
+  static size_t hash(const std::string &Str) {
+    uint32_t H = 2166136261u;
+    for (char C : Str)
+      H = (H ^ static_cast<unsigned char>(C)) * 16777619u;
+    return H;
+  }
+
+  std::vector<std::pair<T, std::string>> Names;
+  std::vector<Slot> Slots;
+  size_t Mask;
+};
+} // namespace
+#endif
+
 #ifdef _SPIRV_SUPPORT_TEXT_FMT
 bool SPIRVUseTextFormat = false;
 #endif
@@ -102,8 +268,11 @@ template <class T> const SPIRVDecoder &decode(const SPIRVDecoder &I, T &V) {
 #ifdef _SPIRV_SUPPORT_TEXT_FMT
   if (SPIRVUseTextFormat) {
     std::string W;
-    I.IS >> W;
-    V = getNameMap(V).rmap(W);
+    if (readTextToken(I.IS, W) &&
+        !SPIRVTextNameTable<T>::get().rfind(W, &V)) {
+      assert(false && "Invalid key");
+      I.IS.setstate(std::ios_base::failbit);
+    }
     SPIRVDBG(spvdbgs() << "Read word: W = " << W << " V = " << V << '\n');
     return I;
   }
@@ -114,7 +283,7 @@ template <class T> const SPIRVDecoder &decode(const SPIRVDecoder &I, T &V) {
 template <class T> const SPIRVEncoder &encode(const SPIRVEncoder &O, T V) {
 #ifdef _SPIRV_SUPPORT_TEXT_FMT
   if (SPIRVUseTextFormat) {
-    O.OS << getNameMap(V).map(V) << " ";
+    O.OS << SPIRVTextNameTable<T>::get().map(V) << ' ';
     return O;
   }
 #endif
@@ -48,6 +48,8 @@
 #include <cstdint>
 #include <iostream>
 #include <iterator>
+#include <limits>
+#include <streambuf>
 #include <string>
 #include <vector>
 
@@ -92,6 +94,108 @@ public:
   spv_ostream &OS;
 };
 
+/// Stream buffer writing SPIR-V binary directly into a caller-owned,
+/// contiguous array of words. The array is never reallocated: a write past
+/// its end fails and puts the owning stream into a bad state.
+class SPIRVWordStreamBuf : public std::streambuf {
+public:
+  SPIRVWordStreamBuf(SPIRVWord *Begin, size_t NumWords) {
+    char *B = reinterpret_cast<char *>(Begin);
+    setp(B, B + NumWords * sizeof(SPIRVWord));
+  }
+  size_t getNumWrittenWords() const {
+    return (pptr() - pbase()) / sizeof(SPIRVWord);
+  }
+};
+
+/// Stream buffer writing SPIR-V binary into a vector of words, which grows
+/// geometrically while the module is encoded. finish() truncates the vector
+/// to the words written, so the module is encoded in a single pass.
+class SPIRVWordVectorStreamBuf : public std::streambuf {
+public:
+  explicit SPIRVWordVectorStreamBuf(std::vector<SPIRVWord> &Words)
+      : Words(Words) {
+    Words.resize(std::max<size_t>(Words.capacity(), 256));
+    resetPutArea(0);
+  }
+  void finish() {
+    Words.resize((pptr() - pbase()) / sizeof(SPIRVWord));
+    setp(nullptr, nullptr);
+  }
+
+protected:
+  std::streamsize xsputn(const char *S, std::streamsize N) override {
+    if (epptr() - pptr() < N)
+      grow(N);
+    std::copy(S, S + N, pptr());
+    advance(N);
+    return N;
+  }
+  int_type overflow(int_type C) override {
+    if (traits_type::eq_int_type(C, traits_type::eof()))
+      return traits_type::not_eof(C);
+    grow(1);
+    *pptr() = traits_type::to_char_type(C);
+    pbump(1);
+    return C;
+  }
+
+private:
+  void grow(size_t NumBytes) {
+    size_t Used = pptr() - pbase();
+    size_t Needed =
+        (Used + NumBytes + sizeof(SPIRVWord) - 1) / sizeof(SPIRVWord);
+    Words.resize(std::max(Needed, Words.size() * 2));
+    resetPutArea(Used);
+  }
+  void resetPutArea(size_t Used) {
+    char *B = reinterpret_cast<char *>(Words.data());
+    setp(B, B + Words.size() * sizeof(SPIRVWord));
+    advance(Used);
+  }
+  // pbump() takes an int, so large counts are applied in several steps.
+  void advance(size_t NumBytes) {
+    const size_t MaxStep = std::numeric_limits<int>::max();
+    for (; NumBytes > MaxStep; NumBytes -= MaxStep)
+      pbump(static_cast<int>(MaxStep));
+    pbump(static_cast<int>(NumBytes));
+  }
+
+  std::vector<SPIRVWord> &Words;
+};
+
+/// Stream buffer which drops everything written to it and only counts the
+/// number of bytes. Used to compute the exact size of a binary up front.
+class SPIRVCountingStreamBuf : public std::streambuf {
+public:
+  size_t getNumWrittenBytes() const { return Count; }
+
+protected:
+  std::streamsize xsputn(const char *, std::streamsize N) override {
+    Count += N;
+    return N;
+  }
+  int_type overflow(int_type C) override {
+    if (traits_type::eq_int_type(C, traits_type::eof()))
+      return traits_type::not_eof(C);
+    ++Count;
+    return C;
+  }
+
+private:
+  size_t Count = 0;
+};
+
+/// Read-only stream buffer over a memory region owned by the caller. Unlike
+/// std::istringstream it does not copy the input.
+class SPIRVMemoryStreamBuf : public std::streambuf {
+public:
+  SPIRVMemoryStreamBuf(const char *Begin, size_t Size) {
+    char *B = const_cast<char *>(Begin);
+    setg(B, B, B + Size);
+  }
+};
+
 /// Output a new line in text mode. Do nothing in binary mode.
 class SPIRVNL {
   friend spv_ostream &operator<<(spv_ostream &O, const SPIRVNL &E);
@@ -107,29 +211,9 @@ const SPIRVDecoder &decodeBinary(const SPIRVDecoder &I, T &V) {
 }
 
 #ifdef _SPIRV_SUPPORT_TEXT_FMT
-/// Skip comment and whitespace. Comment starts with ';', ends with '\n'.
-inline std::istream &skipcomment(std::istream &IS) {
-  if (IS.eof() || IS.bad())
-    return IS;
-
-  char C = IS.peek();
-
-  while (std::char_traits<char>::not_eof(C) && std::isspace(C)) {
-    IS.get();
-    C = IS.peek();
-  }
-
-  while (std::char_traits<char>::not_eof(C) && C == ';') {
-    IS.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-    C = IS.peek();
-    while (std::char_traits<char>::not_eof(C) && std::isspace(C)) {
-      IS.get();
-      C = IS.peek();
-    }
-  }
-
-  return IS;
-}
+/// Read a decimal word in text format, skipping preceding whitespace and
+/// comments. Sets failbit on \p IS if no word can be read.
+bool readTextWord(std::istream &IS, uint32_t &W);
 #endif
 
 template <typename T>
@@ -137,7 +221,7 @@ const SPIRVDecoder &operator>>(const SPIRVDecoder &I, T &V) {
 #ifdef _SPIRV_SUPPORT_TEXT_FMT
   if (SPIRVUseTextFormat) {
     uint32_t W;
-    I.IS >> skipcomment >> W;
+    readTextWord(I.IS, W);
     V = static_cast<T>(W);
     SPIRVDBG(spvdbgs() << "Read word: W = " << W << " V = " << V << '\n');
     return I;
@@ -153,6 +153,10 @@ bool SPIRVType::isTypeComposite() const {
   return isTypeVector() || isTypeArray() || isTypeStruct();
 }
 
+bool SPIRVType::isTypeJointMatrixINTEL() const {
+  return OpCode == OpTypeJointMatrixINTEL;
+}
+
 bool SPIRVType::isTypeFloat(unsigned Bits) const {
   return isType<SPIRVTypeFloat>(this, Bits);
 }
@@ -256,6 +260,44 @@ SPIRVConstant *SPIRVTypeArray::getLength() const {
 
 _SPIRV_IMP_ENCDEC3(SPIRVTypeArray, Id, ElemType, Length)
 
+SPIRVTypeJointMatrixINTEL::SPIRVTypeJointMatrixINTEL(
+    SPIRVModule *M, SPIRVId TheId, SPIRVType *TheCompType,
+    SPIRVConstant *TheRows, SPIRVConstant *TheColumns, SPIRVConstant *TheLayout,
+    SPIRVConstant *TheScope)
+    : SPIRVType(M, FixedWC, OC, TheId), CompType(TheCompType),
+      Rows(TheRows->getId()), Columns(TheColumns->getId()),
+      Layout(TheLayout->getId()), Scope(TheScope->getId()) {
+  validate();
+}
+
+void SPIRVTypeJointMatrixINTEL::validate() const {
+  SPIRVEntry::validate();
+  assert(CompType->isTypeInt() || CompType->isTypeFloat());
+  assert(getValue(Rows)->getType()->isTypeInt() &&
+         getValue(Columns)->getType()->isTypeInt() &&
+         getValue(Layout)->getType()->isTypeInt() &&
+         getValue(Scope)->getType()->isTypeInt());
+}
+
+SPIRVConstant *SPIRVTypeJointMatrixINTEL::getRows() const {
+  return get<SPIRVConstant>(Rows);
+}
+
+SPIRVConstant *SPIRVTypeJointMatrixINTEL::getColumns() const {
+  return get<SPIRVConstant>(Columns);
+}
+
+SPIRVConstant *SPIRVTypeJointMatrixINTEL::getLayout() const {
+  return get<SPIRVConstant>(Layout);
+}
+
+SPIRVConstant *SPIRVTypeJointMatrixINTEL::getScope() const {
+  return get<SPIRVConstant>(Scope);
+}
+
+_SPIRV_IMP_ENCDEC6(SPIRVTypeJointMatrixINTEL, Id, CompType, Rows, Columns,
+                   Layout, Scope)
+
 void SPIRVTypeForwardPointer::encode(spv_ostream &O) const {
   getEncoder(O) << Pointer << SC;
 }
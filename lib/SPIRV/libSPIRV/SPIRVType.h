@@ -103,6 +103,7 @@ public:
   bool isTypeVectorOrScalarInt() const;
   bool isTypeVectorOrScalarFloat() const;
   bool isTypeVectorOrScalarBool() const;
+  bool isTypeJointMatrixINTEL() const;
   bool isTypeSubgroupAvcINTEL() const;
   bool isTypeSubgroupAvcMceINTEL() const;
 };
@@ -399,14 +400,21 @@ public:
   // Complete constructor
   SPIRVTypeOpaque(SPIRVModule *M, SPIRVId TheId, const std::string &TheName)
       : SPIRVType(M, 2 + getSizeInWords(TheName), OpTypeOpaque, TheId) {
-    Name = TheName;
+    setName(TheName);
     validate();
   }
   // Incomplete constructor
   SPIRVTypeOpaque() : SPIRVType(OpTypeOpaque) {}
 
 protected:
-  _SPIRV_DEF_ENCDEC2(Id, Name)
+  void encode(spv_ostream &O) const override {
+    getEncoder(O) << Id << getName();
+  }
+  void decode(std::istream &I) override {
+    std::string TheName;
+    getDecoder(I) >> Id >> TheName;
+    setName(TheName);
+  }
   void validate() const override { SPIRVEntry::validate(); }
 };
 
@@ -609,13 +617,13 @@ public:
     MemberTypeIdVec.resize(TheMemberTypes.size());
     for (auto &T : TheMemberTypes)
       MemberTypeIdVec.push_back(T->getId());
-    Name = TheName;
+    setName(TheName);
     validate();
   }
   SPIRVTypeStruct(SPIRVModule *M, SPIRVId TheId, unsigned NumMembers,
                   const std::string &TheName)
       : SPIRVType(M, 2 + NumMembers, OpTypeStruct, TheId) {
-    Name = TheName;
+    setName(TheName);
     validate();
     MemberTypeIdVec.resize(NumMembers);
   }
@@ -854,6 +862,53 @@ private:
   llvm::Optional<SPIRVAccessQualifierKind> AccessKind;
 };
 
+// SPV_INTEL_joint_matrix extension types
+class SPIRVTypeJointMatrixINTEL : public SPIRVType {
+public:
+  const static Op OC = OpTypeJointMatrixINTEL;
+  const static SPIRVWord FixedWC = 7;
+  // Complete constructor
+  SPIRVTypeJointMatrixINTEL(SPIRVModule *M, SPIRVId TheId,
+                            SPIRVType *TheCompType, SPIRVConstant *TheRows,
+                            SPIRVConstant *TheColumns, SPIRVConstant *TheLayout,
+                            SPIRVConstant *TheScope);
+  // Incomplete constructor
+  SPIRVTypeJointMatrixINTEL()
+      : SPIRVType(OC), CompType(nullptr), Rows(SPIRVID_INVALID),
+        Columns(SPIRVID_INVALID), Layout(SPIRVID_INVALID),
+        Scope(SPIRVID_INVALID) {}
+
+  SPIRVType *getComponentType() const { return CompType; }
+  SPIRVConstant *getRows() const;
+  SPIRVConstant *getColumns() const;
+  SPIRVConstant *getLayout() const;
+  SPIRVConstant *getScope() const;
+
+  SPIRVCapVec getRequiredCapability() const override {
+    return getVec(CapabilityJointMatrixINTEL);
+  }
+
+  SPIRVExtSet getRequiredExtensions() const override {
+    return getSet(ExtensionID::SPV_INTEL_joint_matrix);
+  }
+
+  std::vector<SPIRVEntry *> getNonLiteralOperands() const override {
+    return {CompType, getEntry(Rows), getEntry(Columns), getEntry(Layout),
+            getEntry(Scope)};
+  }
+
+protected:
+  _SPIRV_DCL_ENCDEC
+  void validate() const override;
+
+private:
+  SPIRVType *CompType; // Component Type
+  SPIRVId Rows;        // Number of rows
+  SPIRVId Columns;     // Number of columns
+  SPIRVId Layout;      // Layout of the matrix in memory
+  SPIRVId Scope;       // Execution scope of the matrix operations
+};
+
 // SPV_INTEL_device_side_avc_motion_estimation extension types
 class SPIRVTypeVmeImageINTEL : public SPIRVType {
 public:
@@ -75,7 +75,10 @@ static llvm::sys::Mutex MapLock;
     return MT;                                                                 \
   }
 
-// A bi-way map
+// A bi-way map. Each direction is built at run time, the first time it is
+// used, by running init() and sorting the entries it added by key. Lookups
+// are binary searches over that vector and iteration is in key order. The
+// tables are not generated at compile time.
 template <class Ty1, class Ty2, class Identifier = void> struct SPIRVMap {
 public:
   typedef Ty1 KeyTy;
@@ -131,7 +134,7 @@ public:
 
   static bool find(Ty1 Key, Ty2 *Val = nullptr) {
     const SPIRVMap &Map = getMap();
-    typename MapTy::const_iterator Loc = Map.Map.find(Key);
+    typename MapTy::const_iterator Loc = lookup(Map.Map, Key);
     if (Loc == Map.Map.end())
       return false;
     if (Val)
@@ -141,7 +144,7 @@ public:
 
   static bool rfind(Ty2 Key, Ty1 *Val = nullptr) {
     const SPIRVMap &Map = getRMap();
-    typename RevMapTy::const_iterator Loc = Map.RevMap.find(Key);
+    typename RevMapTy::const_iterator Loc = lookup(Map.RevMap, Key);
     if (Loc == Map.RevMap.end())
       return false;
     if (Val)
@@ -151,17 +154,56 @@ public:
   SPIRVMap() : IsReverse(false) {}
 
 protected:
-  SPIRVMap(bool Reverse) : IsReverse(Reverse) { init(); }
-  typedef std::map<Ty1, Ty2> MapTy;
-  typedef std::map<Ty2, Ty1> RevMapTy;
+  SPIRVMap(bool Reverse) : IsReverse(Reverse) {
+    init();
+    if (IsReverse)
+      sortEntries(RevMap);
+    else
+      sortEntries(Map);
+  }
+  typedef std::vector<std::pair<Ty1, Ty2>> MapTy;
+  typedef std::vector<std::pair<Ty2, Ty1>> RevMapTy;
 
   void add(Ty1 V1, Ty2 V2) {
     if (IsReverse) {
-      RevMap[V2] = V1;
+      RevMap.emplace_back(V2, V1);
       return;
     }
-    Map[V1] = V2;
+    Map.emplace_back(V1, V2);
+  }
+
+  // Sorts the entries by key. If a key was added more than once, the value
+  // added last is kept.
+  template <class EntriesTy> static void sortEntries(EntriesTy &Entries) {
+    typedef typename EntriesTy::value_type EntryTy;
+    std::stable_sort(
+        Entries.begin(), Entries.end(),
+        [](const EntryTy &A, const EntryTy &B) { return A.first < B.first; });
+    auto Out = Entries.begin();
+    for (auto I = Entries.begin(), E = Entries.end(); I != E; ++I) {
+      auto Next = std::next(I);
+      if (Next != E && !(I->first < Next->first))
+        continue;
+      if (Out != I)
+        *Out = std::move(*I);
+      ++Out;
+    }
+    Entries.erase(Out, Entries.end());
+    Entries.shrink_to_fit();
+  }
+
+  template <class EntriesTy, class KeyTy>
+  static typename EntriesTy::const_iterator lookup(const EntriesTy &Entries,
+                                                   const KeyTy &Key) {
+    typedef typename EntriesTy::value_type EntryTy;
+    auto Loc = std::lower_bound(
+        Entries.begin(), Entries.end(), Key,
+        [](const EntryTy &E, const KeyTy &K) { return E.first < K; });
+    if (Loc == Entries.end() || Key < Loc->first)
+      return Entries.end();
+    return Loc;
   }
+
   MapTy Map;
   RevMapTy RevMap;
   bool IsReverse;
@@ -962,6 +962,7 @@ enum Capability {
   CapabilityFPGARegINTEL = 5948,
   CapabilityKernelAttributesINTEL= 5892,
   CapabilityFPGAKernelAttributesINTEL= 5897,
+  CapabilityJointMatrixINTEL = 6118,
   CapabilityMax = 0x7fffffff,
 };
 
@@ -1499,6 +1500,11 @@ enum Op {
   OpWritePipeBlockingINTEL = 5947,
   OpFPGARegINTEL = 5949,
   OpTypeBufferSurfaceINTEL = 6086,
+  OpTypeJointMatrixINTEL = 6119,
+  OpJointMatrixLoadINTEL = 6120,
+  OpJointMatrixStoreINTEL = 6121,
+  OpJointMatrixMadINTEL = 6122,
+  OpJointMatrixWorkItemLengthINTEL = 6410,
   OpMax = 0x7fffffff,
 };
 
@@ -2034,6 +2040,11 @@ inline void HasResultAndType(Op opcode, bool *hasResult, bool *hasResultType) {
       *hasResult = true;
       *hasResultType = false;
       break;
+    case OpTypeJointMatrixINTEL: *hasResult = true; *hasResultType = false; break;
+    case OpJointMatrixLoadINTEL: *hasResult = true; *hasResultType = true; break;
+    case OpJointMatrixStoreINTEL: *hasResult = false; *hasResultType = false; break;
+    case OpJointMatrixMadINTEL: *hasResult = true; *hasResultType = true; break;
+    case OpJointMatrixWorkItemLengthINTEL: *hasResult = true; *hasResultType = true; break;
     }
 }
 #endif /* SPV_ENABLE_UTILITY_CODE */
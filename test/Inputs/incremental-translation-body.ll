@@ -0,0 +1,49 @@
+target datalayout = "e-i64:64-i128:128-v16:16-v32:32-n16:32:64"
+target triple = "nvptx64-nvidia-cuda"
+
+%struct.S = type { i32, float }
+
+define internal float @helper(float %a, float %b, float %c) {
+entry:
+  %m = fmul contract float %a, %b
+  %s = fadd contract float %m, %c
+  ret float %s
+}
+
+define internal i32 @other(i32 %x) {
+entry:
+  %r = mul i32 %x, 3
+  ret i32 %r
+}
+
+define void @k(float addrspace(1)* %f, i32 addrspace(1)* %i) {
+entry:
+  %f1.p = getelementptr inbounds float, float addrspace(1)* %f, i64 1
+  %f2.p = getelementptr inbounds float, float addrspace(1)* %f, i64 2
+  %f0 = load float, float addrspace(1)* %f, align 4
+  %f1 = load float, float addrspace(1)* %f1.p, align 4
+  %f2 = load float, float addrspace(1)* %f2.p, align 4
+  %fr = call float @helper(float %f0, float %f1, float %f2)
+  store float %fr, float addrspace(1)* %f, align 4
+  %i0 = load i32, i32 addrspace(1)* %i, align 4
+  %ir = call i32 @other(i32 %i0)
+  store i32 %ir, i32 addrspace(1)* %i, align 4
+  ret void
+}
+
+define void @s(%struct.S addrspace(1)* %p) {
+entry:
+  %a.p = getelementptr inbounds %struct.S, %struct.S addrspace(1)* %p, i64 0, i32 0
+  %b.p = getelementptr inbounds %struct.S, %struct.S addrspace(1)* %p, i64 0, i32 1
+  %a = load i32, i32 addrspace(1)* %a.p, align 4
+  %a1 = add i32 %a, 1
+  store i32 %a1, i32 addrspace(1)* %a.p, align 4
+  %b = load float, float addrspace(1)* %b.p, align 4
+  %b1 = fmul float %b, 2.000000e+00
+  store float %b1, float addrspace(1)* %b.p, align 4
+  ret void
+}
+
+!nvvm.annotations = !{!0, !1}
+!0 = !{void (float addrspace(1)*, i32 addrspace(1)*)* @k, !"kernel", i32 1}
+!1 = !{void (%struct.S addrspace(1)*)* @s, !"kernel", i32 1}
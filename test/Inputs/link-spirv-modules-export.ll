@@ -0,0 +1,13 @@
+target datalayout = "e-i64:64-i128:128-v16:16-v32:32-n16:32:64"
+target triple = "nvptx64-nvidia-cuda"
+
+@counter = addrspace(1) global i32 0, align 4
+
+define i32 @foo(i32 %x) {
+entry:
+  %v = load i32, i32 addrspace(1)* @counter, align 4
+  %add = add nsw i32 %x, %v
+  ret i32 %add
+}
+
+!nvvm.annotations = !{}
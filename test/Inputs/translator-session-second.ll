@@ -0,0 +1,28 @@
+target datalayout = "e-i64:64-i128:128-v16:16-v32:32-n16:32:64"
+target triple = "nvptx64-nvidia-cuda"
+
+@table = internal addrspace(4) constant [4 x i32] [i32 3, i32 5, i32 7, i32 11], align 4
+
+define internal i32 @lookup(i32 %i) {
+entry:
+  %i64 = zext i32 %i to i64
+  %p = getelementptr inbounds [4 x i32], [4 x i32] addrspace(4)* @table, i64 0, i64 %i64
+  %v = load i32, i32 addrspace(4)* %p, align 4
+  ret i32 %v
+}
+
+define void @gather(i32 addrspace(1)* %out) {
+entry:
+  %tid = call i32 @llvm.nvvm.read.ptx.sreg.tid.x()
+  %idx = and i32 %tid, 3
+  %v = call i32 @lookup(i32 %idx)
+  %tid64 = zext i32 %tid to i64
+  %o = getelementptr inbounds i32, i32 addrspace(1)* %out, i64 %tid64
+  store i32 %v, i32 addrspace(1)* %o, align 4
+  ret void
+}
+
+declare i32 @llvm.nvvm.read.ptx.sreg.tid.x()
+
+!nvvm.annotations = !{!0}
+!0 = !{void (i32 addrspace(1)*)* @gather, !"kernel", i32 1}
@@ -0,0 +1,46 @@
+; RUN: llvm-as %s -o %t.bc
+; RUN: llvm-spirv %t.bc -spirv-text -o %t
+; RUN: FileCheck < %t %s --check-prefix=CHECK-SPIRV
+; RUN: llvm-spirv %t.bc -o %t.spv
+; RUN: spirv-val %t.spv
+; RUN: llvm-spirv -r %t.spv -o %t.rev.bc
+; RUN: llvm-dis < %t.rev.bc | FileCheck %s --check-prefix=CHECK-LLVM
+
+; Repeated elements of a constant data array share a single OpConstant. The
+; NVPTX constant address space 4 is translated to UniformConstant, which the
+; reader maps to the SPIR constant address space 2.
+
+; CHECK-SPIRV-DAG: TypeInt [[Int:[0-9]+]] 32 0
+; CHECK-SPIRV-DAG: TypeFloat [[Float:[0-9]+]] 32
+; CHECK-SPIRV-DAG: Constant [[Int]] [[One:[0-9]+]] 1 {{$}}
+; CHECK-SPIRV-DAG: Constant [[Int]] [[Two:[0-9]+]] 2 {{$}}
+; CHECK-SPIRV-DAG: Constant [[Float]] [[Half:[0-9]+]] 1056964608 {{$}}
+; CHECK-SPIRV-DAG: Constant [[Float]] [[NegHalf:[0-9]+]] 3204448256 {{$}}
+; CHECK-SPIRV: ConstantComposite {{[0-9]+}} {{[0-9]+}} [[One]] [[Two]] [[One]] [[Two]] [[One]] [[Two]] [[One]] [[Two]] {{$}}
+; CHECK-SPIRV: ConstantComposite {{[0-9]+}} {{[0-9]+}} [[Half]] [[NegHalf]] [[Half]] [[NegHalf]] {{$}}
+
+; CHECK-LLVM: @ints = addrspace(2) constant [8 x i32] [i32 1, i32 2, i32 1, i32 2, i32 1, i32 2, i32 1, i32 2]
+; CHECK-LLVM: @floats = addrspace(2) constant [4 x float] [float 5.000000e-01, float -5.000000e-01, float 5.000000e-01, float -5.000000e-01]
+
+target datalayout = "e-i64:64-i128:128-v16:16-v32:32-n16:32:64"
+target triple = "nvptx64-nvidia-cuda"
+
+@ints = addrspace(4) constant [8 x i32] [i32 1, i32 2, i32 1, i32 2, i32 1, i32 2, i32 1, i32 2], align 4
+@floats = addrspace(4) constant [4 x float] [float 5.000000e-01, float -5.000000e-01, float 5.000000e-01, float -5.000000e-01], align 4
+
+; Function Attrs: nounwind
+define void @lookup(i32 addrspace(1)* %out, float addrspace(1)* %fout, i64 %i) #0 {
+entry:
+  %p = getelementptr inbounds [8 x i32], [8 x i32] addrspace(4)* @ints, i64 0, i64 %i
+  %v = load i32, i32 addrspace(4)* %p, align 4
+  store i32 %v, i32 addrspace(1)* %out, align 4
+  %fp = getelementptr inbounds [4 x float], [4 x float] addrspace(4)* @floats, i64 0, i64 %i
+  %f = load float, float addrspace(4)* %fp, align 4
+  store float %f, float addrspace(1)* %fout, align 4
+  ret void
+}
+
+attributes #0 = { nounwind }
+
+!nvvm.annotations = !{!0}
+!0 = !{void (i32 addrspace(1)*, float addrspace(1)*, i64)* @lookup, !"kernel", i32 1}
@@ -0,0 +1,44 @@
+; RUN: llvm-as %s -o %t.bc
+; RUN: llvm-spirv %t.bc -spirv-text -o %t.default.spt
+; RUN: FileCheck < %t.default.spt %s --check-prefix=CHECK-DEFAULT
+; RUN: llvm-spirv %t.bc -spirv-eliminate-dead-entries -spirv-text -o %t.spt
+; RUN: FileCheck < %t.spt %s
+; RUN: llvm-spirv %t.bc -spirv-eliminate-dead-entries -o %t.spv
+; RUN: spirv-val %t.spv
+; RUN: llvm-spirv -r %t.spv -o - | llvm-dis -o - | FileCheck %s --check-prefix=CHECK-LLVM
+; RUN: cat %t.default.spt %t.spt | FileCheck %s --check-prefix=CHECK-BOUND
+
+; CHECK-DEFAULT: Name {{[0-9]+}} "unused"
+; CHECK-DEFAULT: TypeFloat {{[0-9]+}} 32
+
+; CHECK: EntryPoint 6 {{[0-9]+}} "kern"
+; CHECK: Name {{[0-9]+}} "used"
+; CHECK-NOT: "unused"
+; CHECK-NOT: TypeFloat
+
+; The Ids are renumbered densely: the Id bound in the header drops by the
+; four Ids of the dead entries, the float type, the pointer to it, the
+; variable and its initializer, although they are not the last ones.
+; CHECK-BOUND: 119734787 {{[0-9]+}} {{[0-9]+}} [[#DEFAULT:]] 0
+; CHECK-BOUND: TypeFloat
+; CHECK-BOUND: Function
+; CHECK-BOUND: 119734787 {{[0-9]+}} {{[0-9]+}} [[#DEFAULT - 4]] 0
+
+; CHECK-LLVM: @used = internal addrspace(1) global i32 1
+; CHECK-LLVM-NOT: @unused
+
+target datalayout = "e-i64:64-i128:128-v16:16-v32:32-n16:32:64"
+target triple = "nvptx64-nvidia-cuda"
+
+@used = internal addrspace(1) global i32 1, align 4
+@unused = internal addrspace(1) global float 1.000000e+00, align 4
+
+define void @kern(i32 addrspace(1)* %out) {
+entry:
+  %0 = load i32, i32 addrspace(1)* @used, align 4
+  store i32 %0, i32 addrspace(1)* %out, align 4
+  ret void
+}
+
+!nvvm.annotations = !{!0}
+!0 = !{void (i32 addrspace(1)*)* @kern, !"kernel", i32 1}
@@ -0,0 +1,125 @@
+; RUN: llvm-as %s -o %t.first.bc
+; RUN: cp %t.first.bc %t.same.bc
+; RUN: llvm-as %S/Inputs/incremental-translation-body.ll -o %t.body.bc
+; RUN: llvm-as %S/Inputs/incremental-translation-struct.ll -o %t.struct.bc
+; RUN: llvm-as %S/Inputs/incremental-translation-fp.ll -o %t.fp.bc
+; RUN: llvm-as %S/Inputs/incremental-translation-shape.ll -o %t.shape.bc
+; RUN: llvm-spirv %t.first.bc -o %t.first.full.spv
+; RUN: llvm-spirv %t.body.bc -o %t.body.full.spv
+; RUN: llvm-spirv %t.struct.bc -o %t.struct.full.spv
+; RUN: llvm-spirv %t.fp.bc -o %t.fp.full.spv
+; RUN: llvm-spirv %t.shape.bc -o %t.shape.full.spv
+
+; Each module is translated incrementally from the previous one. The modules
+; share a context, which renames %struct.S of every module after the first,
+; as in %struct.S.0.
+; RUN: llvm-spirv -spirv-session -spirv-incremental %t.first.bc %t.same.bc %t.body.bc %t.struct.bc %t.fp.bc %t.shape.bc
+; RUN: spirv-val %t.first.spv
+; RUN: spirv-val %t.same.spv
+; RUN: spirv-val %t.body.spv
+; RUN: spirv-val %t.struct.spv
+; RUN: spirv-val %t.fp.spv
+; RUN: spirv-val %t.shape.spv
+
+; The first module is translated in full.
+; RUN: cmp %t.first.spv %t.first.full.spv
+
+; Without a change the previous result is kept as is.
+; RUN: cmp %t.same.spv %t.first.spv
+
+; Only @other changed, so only its body is translated again, with new Ids.
+; The result still reads back as the full translation does.
+; RUN: not cmp %t.body.spv %t.body.full.spv
+; RUN: llvm-spirv -r %t.body.spv -o %t.body.rev.bc
+; RUN: llvm-spirv -r %t.body.full.spv -o %t.body.full.rev.bc
+; RUN: llvm-dis %t.body.rev.bc -o %t.body.rev.ll
+; RUN: llvm-dis %t.body.full.rev.bc -o %t.body.full.rev.ll
+; RUN: diff %t.body.rev.ll %t.body.full.rev.ll
+; RUN: FileCheck < %t.body.rev.ll %s --check-prefix=CHECK-BODY
+
+; Only the body of @s changed. Its struct type is reused under its first name
+; rather than translated again under the name the context gave it.
+; RUN: not cmp %t.struct.spv %t.body.spv
+; RUN: not cmp %t.struct.spv %t.struct.full.spv
+; RUN: llvm-spirv -r %t.struct.spv -o %t.struct.rev.bc
+; RUN: llvm-spirv -r %t.struct.full.spv -o %t.struct.full.rev.bc
+; RUN: llvm-dis %t.struct.rev.bc -o %t.struct.rev.ll
+; RUN: llvm-dis %t.struct.full.rev.bc -o %t.struct.full.rev.ll
+; RUN: diff %t.struct.rev.ll %t.struct.full.rev.ll
+; RUN: FileCheck < %t.struct.rev.ll %s --check-prefix=CHECK-STRUCT-REV
+; RUN: llvm-spirv %t.struct.spv -to-text -o - | FileCheck %s --check-prefix=CHECK-STRUCT
+
+; @helper no longer allows contraction, which changes the execution modes of
+; its callers, so the module is translated in full.
+; RUN: cmp %t.fp.spv %t.fp.full.spv
+; RUN: llvm-spirv %t.first.spv -to-text -o - | FileCheck %s --check-prefix=CHECK-FIRST-FP
+; RUN: llvm-spirv %t.fp.spv -to-text -o - | FileCheck %s --check-prefix=CHECK-FP
+
+; A new global variable changes the shape of the module, so it is translated
+; in full.
+; RUN: cmp %t.shape.spv %t.shape.full.spv
+
+; CHECK-BODY: define {{.*}}i32 @other(i32 %x)
+; CHECK-BODY: mul i32 %x, 3
+
+; CHECK-STRUCT-REV: define {{.*}}void @s(%struct.S addrspace(1)* %p)
+; CHECK-STRUCT-REV: add i32 %a, 5
+
+; CHECK-STRUCT: TypeStruct
+; CHECK-STRUCT-NOT: TypeStruct
+
+; CHECK-FIRST-FP: EntryPoint 6 [[K:[0-9]+]] "k"
+; CHECK-FIRST-FP-NOT: ExecutionMode [[K]] 31
+
+; CHECK-FP: EntryPoint 6 [[K:[0-9]+]] "k"
+; CHECK-FP: ExecutionMode [[K]] 31
+
+target datalayout = "e-i64:64-i128:128-v16:16-v32:32-n16:32:64"
+target triple = "nvptx64-nvidia-cuda"
+
+%struct.S = type { i32, float }
+
+define internal float @helper(float %a, float %b, float %c) {
+entry:
+  %m = fmul contract float %a, %b
+  %s = fadd contract float %m, %c
+  ret float %s
+}
+
+define internal i32 @other(i32 %x) {
+entry:
+  %r = mul i32 %x, 2
+  ret i32 %r
+}
+
+define void @k(float addrspace(1)* %f, i32 addrspace(1)* %i) {
+entry:
+  %f1.p = getelementptr inbounds float, float addrspace(1)* %f, i64 1
+  %f2.p = getelementptr inbounds float, float addrspace(1)* %f, i64 2
+  %f0 = load float, float addrspace(1)* %f, align 4
+  %f1 = load float, float addrspace(1)* %f1.p, align 4
+  %f2 = load float, float addrspace(1)* %f2.p, align 4
+  %fr = call float @helper(float %f0, float %f1, float %f2)
+  store float %fr, float addrspace(1)* %f, align 4
+  %i0 = load i32, i32 addrspace(1)* %i, align 4
+  %ir = call i32 @other(i32 %i0)
+  store i32 %ir, i32 addrspace(1)* %i, align 4
+  ret void
+}
+
+define void @s(%struct.S addrspace(1)* %p) {
+entry:
+  %a.p = getelementptr inbounds %struct.S, %struct.S addrspace(1)* %p, i64 0, i32 0
+  %b.p = getelementptr inbounds %struct.S, %struct.S addrspace(1)* %p, i64 0, i32 1
+  %a = load i32, i32 addrspace(1)* %a.p, align 4
+  %a1 = add i32 %a, 1
+  store i32 %a1, i32 addrspace(1)* %a.p, align 4
+  %b = load float, float addrspace(1)* %b.p, align 4
+  %b1 = fmul float %b, 2.000000e+00
+  store float %b1, float addrspace(1)* %b.p, align 4
+  ret void
+}
+
+!nvvm.annotations = !{!0, !1}
+!0 = !{void (float addrspace(1)*, i32 addrspace(1)*)* @k, !"kernel", i32 1}
+!1 = !{void (%struct.S addrspace(1)*)* @s, !"kernel", i32 1}
@@ -0,0 +1,47 @@
+; RUN: llvm-as %s -o %t.bc
+; RUN: llvm-spirv %t.bc -spirv-text -o %t.spt
+; RUN: FileCheck < %t.spt %s --check-prefix=CHECK-SPIRV
+; RUN: FileCheck < %t.spt %s --check-prefix=CHECK-NOALIAS
+; RUN: FileCheck < %t.spt %s --check-prefix=CHECK-NOWRITE
+; RUN: llvm-spirv %t.bc -o %t.spv
+; RUN: llvm-spirv -r %t.spv -o - | llvm-dis | FileCheck %s --check-prefix=CHECK-LLVM
+
+; Kernel argument metadata of a CUDA kernel is derived from the argument
+; types and attributes: noalias pointers are restrict, read-only pointers are
+; const. Each attribute produces exactly one decoration.
+
+; CHECK-SPIRV: String {{[0-9]+}} "kernel_arg_type.qual.float*,float*,int*,int,"
+; CHECK-SPIRV-DAG: Name [[In:[0-9]+]] "in"
+; CHECK-SPIRV-DAG: Name [[Out:[0-9]+]] "out"
+; CHECK-SPIRV-DAG: Name [[P:[0-9]+]] "p"
+; CHECK-SPIRV-DAG: Decorate [[In]] FuncParamAttr 4
+; CHECK-SPIRV-DAG: Decorate [[In]] FuncParamAttr 6
+; CHECK-SPIRV-DAG: Decorate [[Out]] FuncParamAttr 4
+; CHECK-SPIRV-DAG: Decorate [[P]] FuncParamAttr 5
+; CHECK-SPIRV-DAG: Decorate [[P]] MaxByteOffset 64
+
+; CHECK-NOALIAS-COUNT-2: Decorate {{[0-9]+}} FuncParamAttr 4 {{$}}
+; CHECK-NOALIAS-NOT: Decorate {{[0-9]+}} FuncParamAttr 4 {{$}}
+
+; CHECK-NOWRITE-COUNT-1: Decorate {{[0-9]+}} FuncParamAttr 6 {{$}}
+; CHECK-NOWRITE-NOT: Decorate {{[0-9]+}} FuncParamAttr 6 {{$}}
+
+; CHECK-LLVM: define spir_kernel void @qual(
+; CHECK-LLVM-SAME: !kernel_arg_addr_space ![[AS:[0-9]+]]
+; CHECK-LLVM-SAME: !kernel_arg_type ![[Ty:[0-9]+]]
+; CHECK-LLVM-DAG: ![[AS]] = !{i32 1, i32 1, i32 1, i32 0}
+; CHECK-LLVM-DAG: ![[Ty]] = !{!"float*", !"float*", !"int*", !"int"}
+
+target datalayout = "e-i64:64-i128:128-v16:16-v32:32-n16:32:64"
+target triple = "nvptx64-nvidia-cuda"
+
+define void @qual(float* noalias readonly %in, float* noalias %out, i32* nocapture dereferenceable(64) %p, i32 %n) {
+entry:
+  %v = load float, float* %in, align 4
+  store float %v, float* %out, align 4
+  store i32 %n, i32* %p, align 4
+  ret void
+}
+
+!nvvm.annotations = !{!0}
+!0 = !{void (float*, float*, i32*, i32)* @qual, !"kernel", i32 1}
@@ -0,0 +1,64 @@
+; RUN: llvm-as %s -o %t.bc
+; RUN: llvm-spirv %t.bc -spirv-kernel=k1 -spirv-text -o %t.spt
+; RUN: FileCheck < %t.spt %s --check-prefix=CHECK-SPIRV
+; RUN: FileCheck < %t.spt %s --check-prefix=CHECK-SPIRV-NEG
+; RUN: llvm-spirv %t.bc -o %t.spv
+; RUN: llvm-spirv -r %t.spv -spirv-kernel=k2 -o - | llvm-dis | FileCheck %s --check-prefix=CHECK-LLVM
+; RUN: not --crash llvm-spirv -r %t.spv -spirv-kernel=nope 2>&1 | FileCheck %s --check-prefix=CHECK-ERROR
+
+; Only the call graph of the selected kernel is translated, together with the
+; global variables it uses.
+
+; CHECK-SPIRV-DAG: EntryPoint 6 {{[0-9]+}} "k1"
+; CHECK-SPIRV-DAG: Name {{[0-9]+}} "used_g"
+; CHECK-SPIRV-DAG: Name {{[0-9]+}} "helper"
+
+; CHECK-SPIRV-NEG-NOT: "k2"
+; CHECK-SPIRV-NEG-NOT: "dead_helper"
+; CHECK-SPIRV-NEG-NOT: "dead_g"
+
+; CHECK-LLVM-NOT: define {{.*}} @k1(
+; CHECK-LLVM-NOT: define {{.*}} @helper(
+; CHECK-LLVM: define spir_kernel void @k2(
+; CHECK-LLVM: call spir_func void @dead_helper()
+; CHECK-LLVM: define spir_func void @dead_helper()
+; CHECK-LLVM-NOT: define {{.*}} @k1(
+; CHECK-LLVM-NOT: define {{.*}} @helper(
+
+; CHECK-ERROR: Selected kernel is not in the module: nope
+
+target datalayout = "e-i64:64-i128:128-v16:16-v32:32-n16:32:64"
+target triple = "nvptx64-nvidia-cuda"
+
+@used_g = addrspace(1) global i32 1, align 4
+@dead_g = addrspace(1) global i32 2, align 4
+
+define i32 @helper(i32 %x) {
+entry:
+  %v = load i32, i32 addrspace(1)* @used_g, align 4
+  %r = add i32 %x, %v
+  ret i32 %r
+}
+
+define void @dead_helper() {
+entry:
+  store i32 0, i32 addrspace(1)* @dead_g, align 4
+  ret void
+}
+
+define void @k1(i32 addrspace(1)* %p) {
+entry:
+  %v = call i32 @helper(i32 3)
+  store i32 %v, i32 addrspace(1)* %p, align 4
+  ret void
+}
+
+define void @k2(i32 addrspace(1)* %p) {
+entry:
+  call void @dead_helper()
+  ret void
+}
+
+!nvvm.annotations = !{!0, !1}
+!0 = !{void (i32 addrspace(1)*)* @k1, !"kernel", i32 1}
+!1 = !{void (i32 addrspace(1)*)* @k2, !"kernel", i32 1}
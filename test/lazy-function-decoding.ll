@@ -0,0 +1,38 @@
+; RUN: llvm-as %s -o %t.bc
+; RUN: llvm-spirv %t.bc -o %t.spv
+; RUN: llvm-spirv -r %t.spv -o %t.eager.bc
+; RUN: llvm-spirv -r -spirv-lazy-function-decoding %t.spv -o %t.lazy.bc
+; RUN: llvm-dis %t.eager.bc -o %t.eager.ll
+; RUN: llvm-dis %t.lazy.bc -o %t.lazy.ll
+; RUN: diff %t.eager.ll %t.lazy.ll
+; RUN: FileCheck < %t.lazy.ll %s --check-prefix=CHECK-LLVM
+
+; RUN: llvm-spirv -spirv-lazy-function-decoding %t.bc -o %t.spv 2>&1 | FileCheck %s --check-prefix=CHECK-NOTE
+; CHECK-NOTE: Note: --spirv-lazy-function-decoding option ignored as it only affects translation from SPIR-V to LLVM IR
+
+; The body of @helper is decoded when the call in the kernel is translated,
+; before the function itself is reached.
+
+; CHECK-LLVM: define void @foo(i32 addrspace(1)* %dst)
+; CHECK-LLVM: call spir_func i32 @helper(i32 3)
+; CHECK-LLVM: define spir_func i32 @helper(i32 %x)
+; CHECK-LLVM: mul {{.*}}i32 %x, 7
+
+target datalayout = "e-i64:64-i128:128-v16:16-v32:32-n16:32:64"
+target triple = "nvptx64-nvidia-cuda"
+
+define void @foo(i32 addrspace(1)* %dst) {
+entry:
+  %v = call i32 @helper(i32 3)
+  store i32 %v, i32 addrspace(1)* %dst, align 4
+  ret void
+}
+
+define i32 @helper(i32 %x) {
+entry:
+  %r = mul nsw i32 %x, 7
+  ret i32 %r
+}
+
+!nvvm.annotations = !{!0}
+!0 = !{void (i32 addrspace(1)*)* @foo, !"kernel", i32 1}
@@ -0,0 +1,60 @@
+; RUN: llvm-as %s -o %t.bc
+; RUN: llvm-as %S/Inputs/link-spirv-modules-debug-info-export.ll -o %t.export.bc
+; RUN: llvm-spirv %t.bc -o %t.kernel.spv
+; RUN: llvm-spirv %t.export.bc -o %t.export.spv
+; RUN: llvm-spirv -link %t.kernel.spv %t.export.spv -o %t.spv
+; RUN: spirv-val %t.spv
+; RUN: llvm-spirv -to-text %t.spv -o - | FileCheck %s --check-prefixes=CHECK-SPIRV,CHECK-SPIRV-DEBUG
+; RUN: llvm-spirv -r %t.spv -o - | llvm-dis -o - | FileCheck %s --check-prefix=CHECK-LLVM
+
+; RUN: llvm-spirv %t.bc -o %t.kernel.ocl.spv --spirv-debug-info-version=ocl-100
+; RUN: llvm-spirv %t.export.bc -o %t.export.ocl.spv --spirv-debug-info-version=ocl-100
+; RUN: llvm-spirv -link %t.kernel.ocl.spv %t.export.ocl.spv -o %t.ocl.spv
+; RUN: spirv-val %t.ocl.spv
+; RUN: llvm-spirv -to-text %t.ocl.spv -o - | FileCheck %s --check-prefixes=CHECK-SPIRV,CHECK-SPIRV-OCL
+; RUN: llvm-spirv -r %t.ocl.spv -o - | llvm-dis -o - | FileCheck %s --check-prefix=CHECK-LLVM
+
+; The debug information of both inputs is kept. The imports of its extended
+; instruction set are merged, the Ids of its instructions are moved along
+; with the rest of each input, and literals such as line numbers are not.
+
+; CHECK-SPIRV-DEBUG: ExtInstImport [[Set:[0-9]+]] "SPIRV.debug"
+; CHECK-SPIRV-DEBUG-NOT: ExtInstImport {{[0-9]+}} "SPIRV.debug"
+; CHECK-SPIRV-OCL: ExtInstImport [[Set:[0-9]+]] "OpenCL.DebugInfo.100"
+; CHECK-SPIRV-OCL-NOT: ExtInstImport {{[0-9]+}} "OpenCL.DebugInfo.100"
+; CHECK-SPIRV-DAG: String [[kern:[0-9]+]] "kern"
+; CHECK-SPIRV-DAG: String [[foo:[0-9]+]] "foo"
+; CHECK-SPIRV: ExtInst {{[0-9]+}} {{[0-9]+}} [[Set]] DebugFunction [[kern]] {{[0-9]+}} {{[0-9]+}} 3 0
+; CHECK-SPIRV: ExtInst {{[0-9]+}} {{[0-9]+}} [[Set]] DebugFunction [[foo]] {{[0-9]+}} {{[0-9]+}} 12 0
+
+; CHECK-LLVM-DAG: !DISubprogram(name: "kern",{{.*}} line: 3,
+; CHECK-LLVM-DAG: !DISubprogram(name: "foo",{{.*}} line: 12,
+; CHECK-LLVM-DAG: !DILocation(line: 4,
+; CHECK-LLVM-DAG: !DILocation(line: 13,
+
+target datalayout = "e-i64:64-i128:128-v16:16-v32:32-n16:32:64"
+target triple = "nvptx64-nvidia-cuda"
+
+declare i32 @foo(i32)
+
+define void @kern(i32 addrspace(1)* %out) !dbg !6 {
+entry:
+  %call = call i32 @foo(i32 1), !dbg !9
+  store i32 %call, i32 addrspace(1)* %out, align 4, !dbg !9
+  ret void, !dbg !9
+}
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3, !4}
+!nvvm.annotations = !{!5}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_OpenCL, file: !1, producer: "clang", isOptimized: false, runtimeVersion: 0, emissionKind: FullDebug, enums: !2)
+!1 = !DIFile(filename: "kern.cl", directory: "/tmp")
+!2 = !{}
+!3 = !{i32 2, !"Dwarf Version", i32 4}
+!4 = !{i32 2, !"Debug Info Version", i32 3}
+!5 = !{void (i32 addrspace(1)*)* @kern, !"kernel", i32 1}
+!6 = distinct !DISubprogram(name: "kern", scope: !1, file: !1, line: 3, type: !7, scopeLine: 3, spFlags: DISPFlagDefinition, unit: !0, retainedNodes: !2)
+!7 = !DISubroutineType(types: !8)
+!8 = !{null}
+!9 = !DILocation(line: 4, column: 3, scope: !6)
@@ -0,0 +1,59 @@
+; RUN: llvm-as %s -o %t.bc
+; RUN: llvm-spirv %t.bc -o %t.kernel.spv
+; RUN: llvm-as %S/Inputs/link-spirv-modules-export.ll -o %t.export.bc
+; RUN: llvm-spirv %t.export.bc -o %t.export.spv
+; RUN: llvm-spirv -link %t.kernel.spv %t.export.spv -o %t.spv
+; RUN: spirv-val %t.spv
+; RUN: llvm-spirv -to-text %t.spv -o %t.spt
+; RUN: FileCheck < %t.spt %s --check-prefix=CHECK-SPIRV
+; RUN: FileCheck < %t.spt %s --check-prefix=CHECK-SPIRV-NEG
+; RUN: llvm-spirv -r %t.spv -o - | llvm-dis -o - | FileCheck %s --check-prefix=CHECK-LLVM
+
+; An Export definition cannot be linked twice.
+; RUN: not llvm-spirv -link %t.export.spv %t.export.spv -o %t.err.spv 2>&1 \
+; RUN:   | FileCheck %s --check-prefix=CHECK-ERROR
+
+; The declarations of @foo and @counter are replaced by the definitions of
+; the other module, and the types both modules use are emitted once.
+
+; CHECK-SPIRV: EntryPoint 6 {{[0-9]+}} "kern"
+; CHECK-SPIRV-DAG: Decorate [[foo:[0-9]+]] LinkageAttributes "foo" Export
+; CHECK-SPIRV-DAG: Decorate [[counter:[0-9]+]] LinkageAttributes "counter" Export
+; CHECK-SPIRV: TypeInt [[i32:[0-9]+]] 32 0
+; CHECK-SPIRV: Variable {{[0-9]+}} [[counter]] 5
+; CHECK-SPIRV: FunctionCall [[i32]] {{[0-9]+}} [[foo]]
+; CHECK-SPIRV: Load [[i32]] {{[0-9]+}} [[counter]]
+; CHECK-SPIRV: Function [[i32]] [[foo]]
+; CHECK-SPIRV: Load [[i32]] {{[0-9]+}} [[counter]]
+
+; CHECK-SPIRV-NEG-NOT: LinkageAttributes {{.*}} Import
+; CHECK-SPIRV-NEG: TypeInt {{[0-9]+}} 32 0
+; CHECK-SPIRV-NEG-NOT: TypeInt {{[0-9]+}} 32 0
+
+; CHECK-LLVM: @counter = addrspace(1) global i32 0
+; CHECK-LLVM: define spir_kernel void @kern(
+; CHECK-LLVM: call spir_func i32 @foo(i32 1)
+; CHECK-LLVM: load i32, i32 addrspace(1)* @counter
+; CHECK-LLVM: define spir_func i32 @foo(i32 %x)
+; CHECK-LLVM: load i32, i32 addrspace(1)* @counter
+
+; CHECK-ERROR: Fails to link SPIR-V modules: symbol multiply defined: foo
+
+target datalayout = "e-i64:64-i128:128-v16:16-v32:32-n16:32:64"
+target triple = "nvptx64-nvidia-cuda"
+
+@counter = external addrspace(1) global i32, align 4
+
+declare i32 @foo(i32)
+
+define void @kern(i32 addrspace(1)* %out) {
+entry:
+  %call = call i32 @foo(i32 1)
+  %c = load i32, i32 addrspace(1)* @counter, align 4
+  %sum = add i32 %call, %c
+  store i32 %sum, i32 addrspace(1)* %out, align 4
+  ret void
+}
+
+!nvvm.annotations = !{!0}
+!0 = !{void (i32 addrspace(1)*)* @kern, !"kernel", i32 1}
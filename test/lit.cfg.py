@@ -19,7 +19,7 @@ config.test_format = lit.formats.ShTest(not llvm_config.use_lit_shell)
 config.suffixes = ['.cl', '.ll', '.spt', '.spvasm']
 
 # excludes: A list of directories  and fles to exclude from the testsuite.
-config.excludes = ['CMakeLists.txt']
+config.excludes = ['CMakeLists.txt', 'Inputs']
 
 if not config.spirv_skip_debug_info_tests:
     # Direct object generation.
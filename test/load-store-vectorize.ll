@@ -0,0 +1,54 @@
+; RUN: llvm-as %s -o %t.bc
+; RUN: llvm-spirv %t.bc -spirv-vectorize-load-store -spirv-text -o - | FileCheck %s --check-prefix=CHECK-SPIRV
+; RUN: llvm-spirv %t.bc -spirv-text -o - | FileCheck %s --check-prefix=CHECK-SCALAR
+
+; Adjacent scalar accesses with enough alignment are merged into one vector
+; access, unaligned ones are left alone.
+
+; CHECK-SPIRV: TypeFloat [[Float:[0-9]+]] 32
+; CHECK-SPIRV: TypeVector [[Float4:[0-9]+]] [[Float]] 4
+; CHECK-SPIRV: {{[0-9]+}} Function {{[0-9]+}}
+; CHECK-SPIRV: Load [[Float4]] {{[0-9]+}} {{[0-9]+}} 2 16
+; CHECK-SPIRV: Store {{[0-9]+}} {{[0-9]+}} 2 16
+; CHECK-SPIRV: {{[0-9]+}} Function {{[0-9]+}}
+; CHECK-SPIRV: Load [[Float]] {{[0-9]+}} {{[0-9]+}} 2 4
+; CHECK-SPIRV: Load [[Float]] {{[0-9]+}} {{[0-9]+}} 2 4
+
+; CHECK-SCALAR-NOT: TypeVector
+
+target datalayout = "e-i64:64-i128:128-v16:16-v32:32-n16:32:64"
+target triple = "nvptx64-nvidia-cuda"
+
+define void @copy4(float* %in, float* %out) {
+entry:
+  %in1 = getelementptr inbounds float, float* %in, i64 1
+  %in2 = getelementptr inbounds float, float* %in, i64 2
+  %in3 = getelementptr inbounds float, float* %in, i64 3
+  %a0 = load float, float* %in, align 16
+  %a1 = load float, float* %in1, align 4
+  %a2 = load float, float* %in2, align 8
+  %a3 = load float, float* %in3, align 4
+  %out1 = getelementptr inbounds float, float* %out, i64 1
+  %out2 = getelementptr inbounds float, float* %out, i64 2
+  %out3 = getelementptr inbounds float, float* %out, i64 3
+  store float %a3, float* %out, align 16
+  store float %a2, float* %out1, align 4
+  store float %a1, float* %out2, align 8
+  store float %a0, float* %out3, align 4
+  ret void
+}
+
+define void @unaligned(float* %in, float* %out) {
+entry:
+  %in1 = getelementptr inbounds float, float* %in, i64 1
+  %a0 = load float, float* %in, align 4
+  %a1 = load float, float* %in1, align 4
+  %s = fadd float %a0, %a1
+  store float %s, float* %out, align 4
+  ret void
+}
+
+!nvvm.annotations = !{!0, !1}
+
+!0 = !{void (float*, float*)* @copy4, !"kernel", i32 1}
+!1 = !{void (float*, float*)* @unaligned, !"kernel", i32 1}
@@ -0,0 +1,49 @@
+; RUN: llvm-as %s -o %t.bc
+; RUN: llvm-spirv %t.bc -spirv-text -o %t
+; RUN: FileCheck < %t %s --check-prefix=CHECK-SPIRV
+; RUN: llvm-spirv %t.bc -o %t.spv
+; RUN: spirv-val %t.spv
+
+; A constant expression is lowered to one instruction per function, no matter
+; how many times the function uses it.
+
+; CHECK-SPIRV: Function
+; CHECK-SPIRV: PtrAccessChain
+; CHECK-SPIRV-NOT: PtrAccessChain
+; CHECK-SPIRV: FunctionEnd
+; CHECK-SPIRV: Function
+; CHECK-SPIRV: PtrAccessChain
+; CHECK-SPIRV-NOT: PtrAccessChain
+; CHECK-SPIRV: FunctionEnd
+
+target datalayout = "e-i64:64-i128:128-v16:16-v32:32-n16:32:64"
+target triple = "nvptx64-nvidia-cuda"
+
+@tab = addrspace(4) constant [4 x i32] [i32 1, i32 2, i32 3, i32 4], align 4
+
+; Function Attrs: nounwind
+define i32 @twice(i1 %c) #0 {
+entry:
+  %a = load i32, i32 addrspace(4)* getelementptr inbounds ([4 x i32], [4 x i32] addrspace(4)* @tab, i64 0, i64 1), align 4
+  br i1 %c, label %then, label %exit
+
+then:
+  %b = load i32, i32 addrspace(4)* getelementptr inbounds ([4 x i32], [4 x i32] addrspace(4)* @tab, i64 0, i64 1), align 4
+  %s = add i32 %a, %b
+  br label %exit
+
+exit:
+  %r = phi i32 [ %a, %entry ], [ %s, %then ]
+  ret i32 %r
+}
+
+; Function Attrs: nounwind
+define i32 @once() #0 {
+entry:
+  %a = load i32, i32 addrspace(4)* getelementptr inbounds ([4 x i32], [4 x i32] addrspace(4)* @tab, i64 0, i64 1), align 4
+  ret i32 %a
+}
+
+attributes #0 = { nounwind }
+
+!nvvm.annotations = !{}
@@ -0,0 +1,35 @@
+; WMMA fragments whose registers are used by element-wise arithmetic cannot be
+; rebuilt as joint matrices. The translator reports this instead of leaving
+; the WMMA intrinsics in the module.
+; RUN: llvm-as %s -o %t.bc
+; RUN: not llvm-spirv %t.bc --spirv-ext=+SPV_INTEL_joint_matrix -o %t.spv 2>&1 | FileCheck %s
+
+; CHECK: Unable to lower WMMA intrinsics of scale to joint matrix operations: fragment register is used by %s0 = fmul float %c0, 2.000000e+00
+
+target datalayout = "e-i64:64-i128:128-v16:16-v32:32-n16:32:64"
+target triple = "nvptx64-nvidia-cuda"
+
+define dso_local void @scale(float* %c, i32 %n) {
+entry:
+  %pc = bitcast float* %c to i8*
+  %fc = call { float, float, float, float, float, float, float, float } @llvm.nvvm.wmma.m16n16k16.load.c.row.stride.f32.p0i8(i8* %pc, i32 %n)
+  %c0 = extractvalue { float, float, float, float, float, float, float, float } %fc, 0
+  %c1 = extractvalue { float, float, float, float, float, float, float, float } %fc, 1
+  %c2 = extractvalue { float, float, float, float, float, float, float, float } %fc, 2
+  %c3 = extractvalue { float, float, float, float, float, float, float, float } %fc, 3
+  %c4 = extractvalue { float, float, float, float, float, float, float, float } %fc, 4
+  %c5 = extractvalue { float, float, float, float, float, float, float, float } %fc, 5
+  %c6 = extractvalue { float, float, float, float, float, float, float, float } %fc, 6
+  %c7 = extractvalue { float, float, float, float, float, float, float, float } %fc, 7
+  call void @llvm.nvvm.wmma.m16n16k16.store.d.row.stride.f32.p0i8(i8* %pc, float %c0, float %c1, float %c2, float %c3, float %c4, float %c5, float %c6, float %c7, i32 %n)
+  %s0 = fmul float %c0, 2.0
+  store float %s0, float* %c
+  ret void
+}
+
+declare { float, float, float, float, float, float, float, float } @llvm.nvvm.wmma.m16n16k16.load.c.row.stride.f32.p0i8(i8*, i32)
+declare void @llvm.nvvm.wmma.m16n16k16.store.d.row.stride.f32.p0i8(i8*, float, float, float, float, float, float, float, float, i32)
+
+!nvvm.annotations = !{!0}
+
+!0 = !{void (float*, i32)* @scale, !"kernel", i32 1}
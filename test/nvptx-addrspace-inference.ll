@@ -0,0 +1,57 @@
+; RUN: llvm-as %s -o %t.bc
+; RUN: llvm-spirv %t.bc -spirv-text -o %t.spt
+; RUN: FileCheck < %t.spt %s --check-prefix=CHECK-SPIRV
+; RUN: FileCheck < %t.spt %s --check-prefix=CHECK-SPIRV-NEG
+; RUN: llvm-spirv %t.bc -o %t.spv
+; RUN: llvm-spirv -r %t.spv -o - | llvm-dis | FileCheck %s --check-prefix=CHECK-LLVM
+
+; NVPTX address spaces are mapped to SPIR ones, kernel pointer arguments are
+; CrossWorkgroup pointers and accesses through generic pointers derived from
+; them, from __shared__/__constant__ variables and from allocas use the
+; specific storage class.
+
+; CHECK-SPIRV-DAG: TypePointer {{[0-9]+}} 5 {{[0-9]+}}
+; CHECK-SPIRV-DAG: TypePointer [[SharedArrPtr:[0-9]+]] 4 {{[0-9]+}}
+; CHECK-SPIRV-DAG: TypePointer [[ConstArrPtr:[0-9]+]] 0 {{[0-9]+}}
+; CHECK-SPIRV-DAG: Variable [[SharedArrPtr]] {{[0-9]+}} 4
+; CHECK-SPIRV-DAG: Variable [[ConstArrPtr]] {{[0-9]+}} 0
+
+; CHECK-SPIRV-NEG-NOT: PtrCastToGeneric
+; CHECK-SPIRV-NEG-NOT: TypePointer {{[0-9]+}} 8
+
+; CHECK-LLVM: @smem = internal addrspace(3) global [64 x float]
+; CHECK-LLVM: @cmem = addrspace(2) constant [4 x float]
+; CHECK-LLVM: define spir_kernel void @vec(float addrspace(1)* %out, i32 %i)
+; CHECK-LLVM: load float, float addrspace(2)*
+; CHECK-LLVM: store float {{.*}}, float addrspace(3)*
+; CHECK-LLVM: store float {{.*}}, float addrspace(1)*
+
+target datalayout = "e-i64:64-i128:128-v16:16-v32:32-n16:32:64"
+target triple = "nvptx64-nvidia-cuda"
+
+@smem = internal addrspace(3) global [64 x float] undef, align 4
+@cmem = addrspace(4) constant [4 x float] [float 1.0, float 2.0, float 3.0, float 4.0], align 4
+
+define dso_local void @vec(float* %out, i32 %i) {
+entry:
+  %tmp = alloca float, align 4
+  %idx = sext i32 %i to i64
+  %s = getelementptr inbounds [64 x float], [64 x float]* addrspacecast ([64 x float] addrspace(3)* @smem to [64 x float]*), i64 0, i64 %idx
+  %c = getelementptr inbounds [4 x float], [4 x float]* addrspacecast ([4 x float] addrspace(4)* @cmem to [4 x float]*), i64 0, i64 %idx
+  %cv = load float, float* %c, align 4
+  store float %cv, float* %s, align 4
+  store float %cv, float* %tmp, align 4
+  call void @llvm.nvvm.barrier0()
+  %sv = load float, float* %s, align 4
+  %tv = load float, float* %tmp, align 4
+  %sum = fadd float %sv, %tv
+  %o = getelementptr inbounds float, float* %out, i64 %idx
+  store float %sum, float* %o, align 4
+  ret void
+}
+
+declare void @llvm.nvvm.barrier0()
+
+!nvvm.annotations = !{!0}
+
+!0 = !{void (float*, i32)* @vec, !"kernel", i32 1}
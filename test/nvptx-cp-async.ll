@@ -0,0 +1,150 @@
+; RUN: llvm-as %s -o %t.bc
+; RUN: llvm-spirv %t.bc -spirv-text -o - | FileCheck %s --check-prefix=CHECK-SPIRV
+; RUN: llvm-spirv %t.bc -o %t.spv
+; RUN: llvm-spirv -r %t.spv -o - | llvm-dis | FileCheck %s --check-prefix=CHECK-LLVM
+
+; cp.async copies of a tile indexed by the x local id become async work group
+; copies whose events are waited by cp.async.wait.group. Copies under
+; divergent control flow are done synchronously, and so are the copies of a
+; kernel which leaves committing or waiting to the functions it calls.
+
+; CHECK-SPIRV: TypeEvent [[Event:[0-9]+]]
+; CHECK-SPIRV: {{^[0-9]+ Function }}
+; CHECK-SPIRV: GroupAsyncCopy [[Event]]
+; CHECK-SPIRV: GroupAsyncCopy [[Event]]
+; CHECK-SPIRV: GroupWaitEvents
+; CHECK-SPIRV: {{^[0-9]+ FunctionEnd}}
+; CHECK-SPIRV: {{^[0-9]+ Function }}
+; CHECK-SPIRV-NOT: GroupAsyncCopy
+; CHECK-SPIRV-NOT: GroupWaitEvents
+; CHECK-SPIRV: {{^[0-9]+ FunctionEnd}}
+; CHECK-SPIRV: {{^[0-9]+ Function }}
+; CHECK-SPIRV-NOT: GroupAsyncCopy
+; CHECK-SPIRV-NOT: GroupWaitEvents
+; CHECK-SPIRV: {{^[0-9]+ FunctionEnd}}
+; CHECK-SPIRV: {{^[0-9]+ Function }}
+; CHECK-SPIRV-NOT: GroupAsyncCopy
+; CHECK-SPIRV-NOT: GroupWaitEvents
+; CHECK-SPIRV: {{^[0-9]+ FunctionEnd}}
+
+; CHECK-LLVM: define spir_kernel void @pipe
+; CHECK-LLVM: call spir_func %opencl.event_t{{.*}}* @_Z29async_work_group_strided_copy
+; CHECK-LLVM: call spir_func void @_Z17wait_group_events
+; CHECK-LLVM: define spir_kernel void @guarded
+; CHECK-LLVM-NOT: async_work_group
+; CHECK-LLVM: load i32, i32 addrspace(1)*
+; CHECK-LLVM: store i32 {{.*}}, i32 addrspace(3)*
+; CHECK-LLVM: define spir_kernel void @split
+; CHECK-LLVM-NOT: async_work_group
+; CHECK-LLVM: load <4 x i32>, <4 x i32> addrspace(1)*
+; CHECK-LLVM: store <4 x i32> {{.*}}, <4 x i32> addrspace(3)*
+; CHECK-LLVM: call spir_func void @wait_tile()
+; CHECK-LLVM: define spir_func void @wait_tile()
+; CHECK-LLVM-NOT: wait_group_events
+; CHECK-LLVM: ret void
+
+target datalayout = "e-i64:64-i128:128-v16:16-v32:32-n16:32:64"
+target triple = "nvptx64-nvidia-cuda"
+
+@tile = internal addrspace(3) global [2 x [512 x float]] undef, align 16
+@small = internal addrspace(3) global [128 x float] undef, align 16
+
+define void @pipe(float addrspace(1)* %in, float addrspace(1)* %out, i32 %n) {
+entry:
+  %tid = call i32 @llvm.nvvm.read.ptx.sreg.tid.x()
+  %tid64 = zext i32 %tid to i64
+  %off = shl i64 %tid64, 2
+  %src0 = getelementptr inbounds float, float addrspace(1)* %in, i64 %off
+  %dst0 = getelementptr inbounds [2 x [512 x float]], [2 x [512 x float]] addrspace(3)* @tile, i64 0, i64 0, i64 %off
+  %s0 = bitcast float addrspace(1)* %src0 to i8 addrspace(1)*
+  %d0 = bitcast float addrspace(3)* %dst0 to i8 addrspace(3)*
+  call void @llvm.nvvm.cp.async.ca.shared.global.16(i8 addrspace(3)* %d0, i8 addrspace(1)* %s0)
+  call void @llvm.nvvm.cp.async.commit.group()
+  br label %loop
+
+loop:
+  %k = phi i32 [ 0, %entry ], [ %k.next, %loop ]
+  %k.next = add nuw nsw i32 %k, 1
+  %stage = and i32 %k, 1
+  %next = and i32 %k.next, 1
+  %next64 = zext i32 %next to i64
+  %kbase = mul i32 %k.next, 512
+  %kbase64 = zext i32 %kbase to i64
+  %srcidx = add i64 %kbase64, %off
+  %src = getelementptr inbounds float, float addrspace(1)* %in, i64 %srcidx
+  %dst = getelementptr inbounds [2 x [512 x float]], [2 x [512 x float]] addrspace(3)* @tile, i64 0, i64 %next64, i64 %off
+  %s = bitcast float addrspace(1)* %src to i8 addrspace(1)*
+  %d = bitcast float addrspace(3)* %dst to i8 addrspace(3)*
+  call void @llvm.nvvm.cp.async.ca.shared.global.16(i8 addrspace(3)* %d, i8 addrspace(1)* %s)
+  call void @llvm.nvvm.cp.async.commit.group()
+  call void @llvm.nvvm.cp.async.wait.group(i32 1)
+  call void @llvm.nvvm.barrier0()
+  %stage64 = zext i32 %stage to i64
+  %v.ptr = getelementptr inbounds [2 x [512 x float]], [2 x [512 x float]] addrspace(3)* @tile, i64 0, i64 %stage64, i64 %tid64
+  %v = load float, float addrspace(3)* %v.ptr, align 4
+  %o = getelementptr inbounds float, float addrspace(1)* %out, i64 %tid64
+  store float %v, float addrspace(1)* %o, align 4
+  call void @llvm.nvvm.barrier0()
+  %cmp = icmp slt i32 %k.next, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  call void @llvm.nvvm.cp.async.wait.all()
+  ret void
+}
+
+define void @guarded(float addrspace(1)* %in, i32 %n) {
+entry:
+  %tid = call i32 @llvm.nvvm.read.ptx.sreg.tid.x()
+  %c = icmp ult i32 %tid, %n
+  br i1 %c, label %copy, label %done
+
+copy:
+  %tid64 = zext i32 %tid to i64
+  %src = getelementptr inbounds float, float addrspace(1)* %in, i64 %tid64
+  %dst = getelementptr inbounds [128 x float], [128 x float] addrspace(3)* @small, i64 0, i64 %tid64
+  %s = bitcast float addrspace(1)* %src to i8 addrspace(1)*
+  %d = bitcast float addrspace(3)* %dst to i8 addrspace(3)*
+  call void @llvm.nvvm.cp.async.ca.shared.global.4(i8 addrspace(3)* %d, i8 addrspace(1)* %s)
+  br label %done
+
+done:
+  call void @llvm.nvvm.cp.async.wait.all()
+  ret void
+}
+
+define void @split(float addrspace(1)* %in) {
+entry:
+  %tid = call i32 @llvm.nvvm.read.ptx.sreg.tid.x()
+  %tid64 = zext i32 %tid to i64
+  %off = shl i64 %tid64, 2
+  %src = getelementptr inbounds float, float addrspace(1)* %in, i64 %off
+  %dst = getelementptr inbounds [2 x [512 x float]], [2 x [512 x float]] addrspace(3)* @tile, i64 0, i64 0, i64 %off
+  %s = bitcast float addrspace(1)* %src to i8 addrspace(1)*
+  %d = bitcast float addrspace(3)* %dst to i8 addrspace(3)*
+  call void @llvm.nvvm.cp.async.ca.shared.global.16(i8 addrspace(3)* %d, i8 addrspace(1)* %s)
+  call void @wait_tile()
+  ret void
+}
+
+define void @wait_tile() {
+entry:
+  call void @llvm.nvvm.cp.async.commit.group()
+  call void @llvm.nvvm.cp.async.wait.group(i32 0)
+  call void @llvm.nvvm.barrier0()
+  ret void
+}
+
+declare i32 @llvm.nvvm.read.ptx.sreg.tid.x()
+declare void @llvm.nvvm.barrier0()
+declare void @llvm.nvvm.cp.async.ca.shared.global.4(i8 addrspace(3)*, i8 addrspace(1)*)
+declare void @llvm.nvvm.cp.async.ca.shared.global.16(i8 addrspace(3)*, i8 addrspace(1)*)
+declare void @llvm.nvvm.cp.async.commit.group()
+declare void @llvm.nvvm.cp.async.wait.group(i32)
+declare void @llvm.nvvm.cp.async.wait.all()
+
+!nvvm.annotations = !{!0, !1, !2}
+
+!0 = !{void (float addrspace(1)*, float addrspace(1)*, i32)* @pipe, !"kernel", i32 1}
+!1 = !{void (float addrspace(1)*, i32)* @guarded, !"kernel", i32 1}
+!2 = !{void (float addrspace(1)*)* @split, !"kernel", i32 1}
@@ -0,0 +1,105 @@
+; RUN: llvm-as %s -o %t.bc
+; RUN: llvm-spirv %t.bc --spirv-ext=+SPV_INTEL_joint_matrix -spirv-text -o - | FileCheck %s --check-prefix=CHECK-SPIRV
+; RUN: llvm-spirv %t.bc --spirv-ext=+SPV_INTEL_joint_matrix -o %t.spv
+; RUN: spirv-val %t.spv
+; RUN: llvm-spirv -r %t.spv -o - | llvm-dis | FileCheck %s --check-prefix=CHECK-LLVM
+; RUN: not --crash llvm-spirv %t.bc -o %t.noext.spv 2>&1 | FileCheck %s --check-prefix=CHECK-NOEXT
+
+; A WMMA GEMM loop becomes joint matrix loads, multiply-adds and stores.
+; The accumulator registers carried by the loop are replaced by a single
+; matrix phi initialized from a splat of zero. A is row major and B column
+; major, so they get different matrix types; the accumulator is row major.
+
+; CHECK-SPIRV: Capability JointMatrixINTEL
+; CHECK-SPIRV: Extension "SPV_INTEL_joint_matrix"
+; CHECK-SPIRV-DAG: TypeInt [[Int:[0-9]+]] 32 0
+; CHECK-SPIRV-DAG: Constant [[Int]] [[Zero32:[0-9]+]] 0 {{$}}
+; CHECK-SPIRV-DAG: Constant [[Int]] [[One:[0-9]+]] 1 {{$}}
+; CHECK-SPIRV-DAG: Constant [[Int]] [[Subgroup:[0-9]+]] 3 {{$}}
+; CHECK-SPIRV-DAG: Constant [[Int]] [[Sixteen:[0-9]+]] 16 {{$}}
+; CHECK-SPIRV-DAG: TypeFloat [[Half:[0-9]+]] 16
+; CHECK-SPIRV-DAG: TypeFloat [[Float:[0-9]+]] 32
+; CHECK-SPIRV-DAG: TypeJointMatrixINTEL [[RowHalfMat:[0-9]+]] [[Half]] [[Sixteen]] [[Sixteen]] [[Zero32]] [[Subgroup]] {{$}}
+; CHECK-SPIRV-DAG: TypeJointMatrixINTEL [[ColHalfMat:[0-9]+]] [[Half]] [[Sixteen]] [[Sixteen]] [[One]] [[Subgroup]] {{$}}
+; CHECK-SPIRV-DAG: TypeJointMatrixINTEL [[FloatMat:[0-9]+]] [[Float]] [[Sixteen]] [[Sixteen]] [[Zero32]] [[Subgroup]] {{$}}
+; CHECK-SPIRV: CompositeConstruct [[FloatMat]] [[Zero:[0-9]+]]
+; CHECK-SPIRV: Phi [[FloatMat]] [[Acc:[0-9]+]] [[Zero]]
+; CHECK-SPIRV: JointMatrixLoadINTEL [[RowHalfMat]] [[A:[0-9]+]] {{[0-9]+}} {{[0-9]+}} [[Zero32]] [[Subgroup]] {{$}}
+; CHECK-SPIRV: JointMatrixLoadINTEL [[ColHalfMat]] [[B:[0-9]+]] {{[0-9]+}} [[Sixteen]] [[One]] [[Subgroup]] {{$}}
+; CHECK-SPIRV: JointMatrixMadINTEL [[FloatMat]] [[D:[0-9]+]] [[A]] [[B]] [[Acc]] [[Subgroup]] {{$}}
+; CHECK-SPIRV: JointMatrixStoreINTEL {{[0-9]+}} [[D]] {{[0-9]+}} [[Zero32]] [[Subgroup]] {{$}}
+
+; CHECK-LLVM: define spir_kernel void @gemm
+; CHECK-LLVM: phi %spirv.JointMatrixINTEL._float_16_16_0_3 addrspace(1)*
+; CHECK-LLVM: call spir_func %spirv.JointMatrixINTEL._half_16_16_0_3 addrspace(1)* @_Z{{[0-9]+}}__spirv_JointMatrixLoadINTEL
+; CHECK-LLVM: call spir_func %spirv.JointMatrixINTEL._half_16_16_1_3 addrspace(1)* @_Z{{[0-9]+}}__spirv_JointMatrixLoadINTEL
+; CHECK-LLVM: call spir_func %spirv.JointMatrixINTEL._float_16_16_0_3 addrspace(1)* @_Z{{[0-9]+}}__spirv_JointMatrixMadINTEL
+; CHECK-LLVM: call spir_func void @_Z{{[0-9]+}}__spirv_JointMatrixStoreINTEL
+
+; CHECK-NOEXT: Feature requires the following SPIR-V extension:
+; CHECK-NOEXT-NEXT: SPV_INTEL_joint_matrix
+
+target datalayout = "e-i64:64-i128:128-v16:16-v32:32-n16:32:64"
+target triple = "nvptx64-nvidia-cuda"
+
+define dso_local void @gemm(half* %a, half* %b, float* %c, i32 %n) {
+entry:
+  %pa = bitcast half* %a to i8*
+  %pb = bitcast half* %b to i8*
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %inc, %loop ]
+  %c0 = phi float [ 0.0, %entry ], [ %d0, %loop ]
+  %c1 = phi float [ 0.0, %entry ], [ %d1, %loop ]
+  %c2 = phi float [ 0.0, %entry ], [ %d2, %loop ]
+  %c3 = phi float [ 0.0, %entry ], [ %d3, %loop ]
+  %c4 = phi float [ 0.0, %entry ], [ %d4, %loop ]
+  %c5 = phi float [ 0.0, %entry ], [ %d5, %loop ]
+  %c6 = phi float [ 0.0, %entry ], [ %d6, %loop ]
+  %c7 = phi float [ 0.0, %entry ], [ %d7, %loop ]
+  %fa = call { <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half> } @llvm.nvvm.wmma.m16n16k16.load.a.row.stride.f16.p0i8(i8* %pa, i32 %n)
+  %fb = call { <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half> } @llvm.nvvm.wmma.m16n16k16.load.b.col.f16.p0i8(i8* %pb)
+  %a0 = extractvalue { <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half> } %fa, 0
+  %a1 = extractvalue { <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half> } %fa, 1
+  %a2 = extractvalue { <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half> } %fa, 2
+  %a3 = extractvalue { <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half> } %fa, 3
+  %a4 = extractvalue { <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half> } %fa, 4
+  %a5 = extractvalue { <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half> } %fa, 5
+  %a6 = extractvalue { <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half> } %fa, 6
+  %a7 = extractvalue { <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half> } %fa, 7
+  %b0 = extractvalue { <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half> } %fb, 0
+  %b1 = extractvalue { <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half> } %fb, 1
+  %b2 = extractvalue { <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half> } %fb, 2
+  %b3 = extractvalue { <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half> } %fb, 3
+  %b4 = extractvalue { <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half> } %fb, 4
+  %b5 = extractvalue { <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half> } %fb, 5
+  %b6 = extractvalue { <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half> } %fb, 6
+  %b7 = extractvalue { <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half> } %fb, 7
+  %d = call { float, float, float, float, float, float, float, float } @llvm.nvvm.wmma.m16n16k16.mma.row.col.f32.f32(<2 x half> %a0, <2 x half> %a1, <2 x half> %a2, <2 x half> %a3, <2 x half> %a4, <2 x half> %a5, <2 x half> %a6, <2 x half> %a7, <2 x half> %b0, <2 x half> %b1, <2 x half> %b2, <2 x half> %b3, <2 x half> %b4, <2 x half> %b5, <2 x half> %b6, <2 x half> %b7, float %c0, float %c1, float %c2, float %c3, float %c4, float %c5, float %c6, float %c7)
+  %d0 = extractvalue { float, float, float, float, float, float, float, float } %d, 0
+  %d1 = extractvalue { float, float, float, float, float, float, float, float } %d, 1
+  %d2 = extractvalue { float, float, float, float, float, float, float, float } %d, 2
+  %d3 = extractvalue { float, float, float, float, float, float, float, float } %d, 3
+  %d4 = extractvalue { float, float, float, float, float, float, float, float } %d, 4
+  %d5 = extractvalue { float, float, float, float, float, float, float, float } %d, 5
+  %d6 = extractvalue { float, float, float, float, float, float, float, float } %d, 6
+  %d7 = extractvalue { float, float, float, float, float, float, float, float } %d, 7
+  %inc = add i32 %i, 16
+  %cmp = icmp slt i32 %inc, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  %pc = bitcast float* %c to i8*
+  call void @llvm.nvvm.wmma.m16n16k16.store.d.row.stride.f32.p0i8(i8* %pc, float %d0, float %d1, float %d2, float %d3, float %d4, float %d5, float %d6, float %d7, i32 %n)
+  ret void
+}
+
+declare { <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half> } @llvm.nvvm.wmma.m16n16k16.load.a.row.stride.f16.p0i8(i8*, i32)
+declare { <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half> } @llvm.nvvm.wmma.m16n16k16.load.b.col.f16.p0i8(i8*)
+declare { float, float, float, float, float, float, float, float } @llvm.nvvm.wmma.m16n16k16.mma.row.col.f32.f32(<2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, <2 x half>, float, float, float, float, float, float, float, float)
+declare void @llvm.nvvm.wmma.m16n16k16.store.d.row.stride.f32.p0i8(i8*, float, float, float, float, float, float, float, float, i32)
+
+!nvvm.annotations = !{!0}
+
+!0 = !{void (half*, half*, float*, i32)* @gemm, !"kernel", i32 1}
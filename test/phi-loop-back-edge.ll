@@ -0,0 +1,43 @@
+; RUN: llvm-as %s -o %t.bc
+; RUN: llvm-spirv %t.bc -o %t.spv
+; RUN: spirv-val %t.spv
+; RUN: llvm-spirv -r %t.spv -o %t.rev.bc
+; RUN: llvm-dis < %t.rev.bc | FileCheck %s --check-prefix=CHECK-LLVM
+
+; PHI operands coming along loop back edges are defined after the PHI itself.
+; Check that they are resolved to the values defined in the loop body.
+
+; CHECK-LLVM-NOT: placeholder
+; CHECK-LLVM: for.body:
+; CHECK-LLVM-NEXT: %[[I:[a-z0-9.]+]] = phi i32 [ 0, %entry ], [ %[[INC:[a-z0-9.]+]], %for.body ]
+; CHECK-LLVM-NEXT: %[[SUM:[a-z0-9.]+]] = phi i32 [ 0, %entry ], [ %[[ADD:[a-z0-9.]+]], %for.body ]
+; CHECK-LLVM: %[[ADD]] = add i32 %[[SUM]], %[[I]]
+; CHECK-LLVM: %[[INC]] = add {{.*}}i32 %[[I]], 1
+; CHECK-LLVM: for.end:
+; CHECK-LLVM-NEXT: store i32 %[[ADD]]
+
+target datalayout = "e-i64:64-i128:128-v16:16-v32:32-n16:32:64"
+target triple = "nvptx64-nvidia-cuda"
+
+; Function Attrs: nounwind
+define void @sum(i32 addrspace(1)* %out, i32 %n) #0 {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i32 [ 0, %entry ], [ %inc, %for.body ]
+  %s = phi i32 [ 0, %entry ], [ %add, %for.body ]
+  %add = add i32 %s, %i
+  %inc = add nuw nsw i32 %i, 1
+  %cmp = icmp slt i32 %inc, %n
+  br i1 %cmp, label %for.body, label %for.end
+
+for.end:
+  store i32 %add, i32 addrspace(1)* %out, align 4
+  ret void
+}
+
+attributes #0 = { nounwind }
+
+!nvvm.annotations = !{!0}
+!0 = !{void (i32 addrspace(1)*, i32)* @sum, !"kernel", i32 1}
@@ -0,0 +1,68 @@
+; RUN: llvm-as %s -o %t.bc
+; RUN: rm -rf %t.cache
+; RUN: llvm-spirv %t.bc -spirv-cache-dir=%t.cache -o %t.1.spv
+; RUN: ls %t.cache | FileCheck %s --check-prefix=CHECK-ONE
+
+; The second translation returns the cached result: replace it and check that
+; the replacement is what comes out.
+; RUN: echo "cached result" > %t.cached
+; RUN: cp %t.cached %t.cache/llvmcache-*
+; RUN: llvm-spirv %t.bc -spirv-cache-dir=%t.cache -o %t.2.spv
+; RUN: cmp %t.cached %t.2.spv
+; RUN: ls %t.cache | FileCheck %s --check-prefix=CHECK-ONE
+
+; Other options or another output format give other results.
+; RUN: llvm-spirv %t.bc -spirv-cache-dir=%t.cache -spirv-text -o %t.spt
+; RUN: llvm-spirv %t.bc -spirv-cache-dir=%t.cache -spirv-lower-const-expr=false -o %t.3.spv
+; RUN: llvm-spirv %t.bc -spirv-cache-dir=%t.cache -spirv-erase-cl-md=false -o %t.4.spv
+; RUN: ls %t.cache | FileCheck %s --check-prefix=CHECK-FOUR
+
+; RUN: llvm-spirv -r %t.1.spv -spirv-cache-dir=%t.cache -o %t.1.rev.bc
+; RUN: llvm-spirv -r %t.1.spv -spirv-cache-dir=%t.cache -o %t.2.rev.bc
+; RUN: cmp %t.1.rev.bc %t.2.rev.bc
+; RUN: llvm-dis %t.2.rev.bc -o - | FileCheck %s --check-prefix=CHECK-LLVM
+; RUN: llvm-spirv -r %t.1.spv -spirv-cache-dir=%t.cache -spirv-expand-step=false -o %t.3.rev.bc
+; RUN: ls %t.cache | FileCheck %s --check-prefix=CHECK-SIX
+
+; Folding branches on specialized values is part of the key.
+; RUN: llvm-spirv -r %t.1.spv -spirv-cache-dir=%t.cache -spec-const "1:i32:0" -o %t.4.rev.bc
+; RUN: llvm-spirv -r %t.1.spv -spirv-cache-dir=%t.cache -spec-const "1:i32:0" -spec-const-fold-branches -o %t.5.rev.bc
+; RUN: ls %t.cache | FileCheck %s --check-prefix=CHECK-EIGHT
+
+; Temporary files of translations which did not finish are removed when the
+; cache is pruned next, unless they may still be written.
+; RUN: touch -t 200001010000 %t.cache/tmp-stale
+; RUN: touch %t.cache/tmp-recent
+; RUN: rm %t.cache/llvmcache.timestamp
+; RUN: llvm-spirv %t.bc -spirv-cache-dir=%t.cache -spirv-mem2reg -o %t.5.spv
+; RUN: ls %t.cache | FileCheck %s --check-prefix=CHECK-TEMP
+
+; CHECK-ONE: llvmcache-{{[0-9a-f]+$}}
+; CHECK-ONE-NOT: llvmcache-{{[0-9a-f]+$}}
+
+; CHECK-FOUR-COUNT-4: llvmcache-{{[0-9a-f]+$}}
+; CHECK-FOUR-NOT: llvmcache-{{[0-9a-f]+$}}
+
+; CHECK-SIX-COUNT-6: llvmcache-{{[0-9a-f]+$}}
+; CHECK-SIX-NOT: llvmcache-{{[0-9a-f]+$}}
+
+; CHECK-EIGHT-COUNT-8: llvmcache-{{[0-9a-f]+$}}
+; CHECK-EIGHT-NOT: llvmcache-{{[0-9a-f]+$}}
+
+; CHECK-TEMP-NOT: tmp-stale
+; CHECK-TEMP: tmp-recent
+; CHECK-TEMP-NOT: tmp-stale
+
+; CHECK-LLVM: define spir_kernel void @k(
+
+target datalayout = "e-i64:64-i128:128-v16:16-v32:32-n16:32:64"
+target triple = "nvptx64-nvidia-cuda"
+
+define void @k(i32 addrspace(1)* %p) {
+entry:
+  store i32 1, i32 addrspace(1)* %p, align 4
+  ret void
+}
+
+!nvvm.annotations = !{!0}
+!0 = !{void (i32 addrspace(1)*)* @k, !"kernel", i32 1}
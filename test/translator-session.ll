@@ -0,0 +1,62 @@
+; RUN: llvm-as %s -o %t.first.bc
+; RUN: llvm-as %S/Inputs/translator-session-second.ll -o %t.second.bc
+; RUN: cp %t.first.bc %t.first-copy.bc
+; RUN: cp %t.second.bc %t.second-copy.bc
+; RUN: llvm-spirv %t.first.bc -o %t.first.fresh.spv
+; RUN: llvm-spirv %t.second.bc -o %t.second.fresh.spv
+
+; Modules translated one after the other by one session give the same SPIR-V
+; as separate translations, in either order. The first module has loop
+; metadata and the second does not, so they run different pipelines of the
+; session. The copies run those pipelines again, with a new SPIRVModule.
+; RUN: llvm-spirv -spirv-session %t.first.bc %t.second.bc %t.first-copy.bc %t.second-copy.bc
+; RUN: spirv-val %t.first.spv
+; RUN: spirv-val %t.second.spv
+; RUN: cmp %t.first.spv %t.first.fresh.spv
+; RUN: cmp %t.second.spv %t.second.fresh.spv
+; RUN: cmp %t.first-copy.spv %t.first.fresh.spv
+; RUN: cmp %t.second-copy.spv %t.second.fresh.spv
+; RUN: llvm-spirv -spirv-session %t.second.bc %t.first.bc %t.first-copy.bc
+; RUN: cmp %t.first.spv %t.first.fresh.spv
+; RUN: cmp %t.second.spv %t.second.fresh.spv
+; RUN: cmp %t.first-copy.spv %t.first.fresh.spv
+
+; The same holds for the translation back to LLVM IR.
+; RUN: llvm-spirv -r %t.first.fresh.spv -o %t.first.fresh.bc
+; RUN: llvm-spirv -r %t.second.fresh.spv -o %t.second.fresh.bc
+; RUN: llvm-spirv -r -spirv-session %t.first.spv %t.second.spv %t.first-copy.spv %t.second-copy.spv
+; RUN: cmp %t.first.bc %t.first.fresh.bc
+; RUN: cmp %t.second.bc %t.second.fresh.bc
+; RUN: cmp %t.first-copy.bc %t.first.fresh.bc
+; RUN: cmp %t.second-copy.bc %t.second.fresh.bc
+
+; RUN: not llvm-spirv -spirv-session %t.first.bc -o %t.spv 2>&1 | FileCheck %s --check-prefix=CHECK-ERROR
+; CHECK-ERROR: Cannot use -spirv-session with -link, -s, -spec-const-info, -o or standard input
+
+target datalayout = "e-i64:64-i128:128-v16:16-v32:32-n16:32:64"
+target triple = "nvptx64-nvidia-cuda"
+
+define void @scale(float addrspace(1)* %p, float %f, i32 %n) {
+entry:
+  %cmp0 = icmp sgt i32 %n, 0
+  br i1 %cmp0, label %loop, label %exit
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %i64 = zext i32 %i to i64
+  %q = getelementptr inbounds float, float addrspace(1)* %p, i64 %i64
+  %v = load float, float addrspace(1)* %q, align 4
+  %m = fmul float %v, %f
+  store float %m, float addrspace(1)* %q, align 4
+  %i.next = add nuw nsw i32 %i, 1
+  %cmp = icmp slt i32 %i.next, %n
+  br i1 %cmp, label %loop, label %exit, !llvm.loop !1
+
+exit:
+  ret void
+}
+
+!nvvm.annotations = !{!0}
+!0 = !{void (float addrspace(1)*, float, i32)* @scale, !"kernel", i32 1}
+!1 = distinct !{!1, !2}
+!2 = !{!"llvm.loop.unroll.disable"}
@@ -0,0 +1,104 @@
+; RUN: llvm-as %s -o %t.bc
+; RUN: llvm-spirv %t.bc -spirv-text -o %t
+; RUN: FileCheck < %t %s --check-prefix=CHECK-SPIRV
+; RUN: FileCheck < %t %s --check-prefix=CHECK-FLOAT
+; RUN: FileCheck < %t %s --check-prefix=CHECK-PTR
+; RUN: FileCheck < %t %s --check-prefix=CHECK-FUNC
+; RUN: FileCheck < %t %s --check-prefix=CHECK-INT-CONST
+; RUN: FileCheck < %t %s --check-prefix=CHECK-FLOAT-CONST
+; RUN: FileCheck < %t %s --check-prefix=CHECK-UNDEF
+; RUN: FileCheck < %t %s --check-prefix=CHECK-NULL
+; RUN: llvm-spirv %t.bc -o %t.spv
+; RUN: spirv-val %t.spv
+
+; The OpenCL and SPIR-V spellings of the same opaque type are distinct LLVM
+; types, but they must be translated to a single SPIR-V declaration.
+
+; CHECK-SPIRV: 2 TypeQueue [[Queue:[0-9]+]]
+; CHECK-SPIRV-NOT: TypeQueue
+; CHECK-SPIRV: 2 TypeDeviceEvent [[Event:[0-9]+]]
+; CHECK-SPIRV-NOT: TypeDeviceEvent
+; CHECK-SPIRV: 7 TypeFunction {{[0-9]+}} {{[0-9]+}} [[Queue]] [[Queue]] [[Event]] [[Event]]
+; CHECK-SPIRV-NOT: TypeFunction {{[0-9]+}} {{[0-9]+}} [[Queue]] [[Queue]] [[Event]] [[Event]]
+
+; So are the types and constants built from them: @g and @h differ only in
+; the spelling of the queue type, and each of their pointer types, their
+; function type and their undef and null constants is emitted once.
+
+; CHECK-PTR: TypeQueue [[Queue:[0-9]+]]
+; CHECK-PTR: TypePointer [[PQ:[0-9]+]] {{[0-9]+}} [[Queue]] {{$}}
+; CHECK-PTR-NOT: TypePointer {{[0-9]+}} {{[0-9]+}} [[Queue]] {{$}}
+; CHECK-PTR: TypePointer [[PPQ:[0-9]+]] {{[0-9]+}} [[PQ]] {{$}}
+; CHECK-PTR-NOT: TypePointer {{[0-9]+}} {{[0-9]+}} [[PQ]] {{$}}
+
+; CHECK-FUNC: TypeQueue [[Queue:[0-9]+]]
+; CHECK-FUNC: TypePointer [[PQ:[0-9]+]] {{[0-9]+}} [[Queue]] {{$}}
+; CHECK-FUNC: TypePointer [[PPQ:[0-9]+]] {{[0-9]+}} [[PQ]] {{$}}
+; CHECK-FUNC: TypeFunction {{[0-9]+}} {{[0-9]+}} [[PQ]] [[PPQ]] {{$}}
+; CHECK-FUNC-NOT: TypeFunction {{[0-9]+}} {{[0-9]+}} [[PQ]] [[PPQ]] {{$}}
+
+; CHECK-UNDEF: TypeQueue [[Queue:[0-9]+]]
+; CHECK-UNDEF: Undef [[Queue]] {{[0-9]+}} {{$}}
+; CHECK-UNDEF-NOT: Undef [[Queue]]
+
+; CHECK-NULL: TypeQueue [[Queue:[0-9]+]]
+; CHECK-NULL: TypePointer [[PQ:[0-9]+]] {{[0-9]+}} [[Queue]] {{$}}
+; CHECK-NULL: ConstantNull [[PQ]] {{[0-9]+}} {{$}}
+; CHECK-NULL-NOT: ConstantNull [[PQ]]
+
+; The elements of constant data vectors are requested one by one, next to
+; the scalar constants with the same value, and the float type is shared by
+; the scalar, vector and pointer types built from it.
+
+; CHECK-FLOAT: TypeFloat {{[0-9]+}} 32 {{$}}
+; CHECK-FLOAT-NOT: TypeFloat
+
+; CHECK-INT-CONST: TypeInt [[I32:[0-9]+]] 32 0 {{$}}
+; CHECK-INT-CONST: Constant [[I32]] {{[0-9]+}} 7 {{$}}
+; CHECK-INT-CONST-NOT: Constant [[I32]] {{[0-9]+}} 7 {{$}}
+
+; 2.0f is 0x40000000.
+; CHECK-FLOAT-CONST: TypeFloat [[F32:[0-9]+]] 32 {{$}}
+; CHECK-FLOAT-CONST: Constant [[F32]] {{[0-9]+}} 1073741824 {{$}}
+; CHECK-FLOAT-CONST-NOT: Constant [[F32]] {{[0-9]+}} 1073741824 {{$}}
+
+target datalayout = "e-i64:64-i128:128-v16:16-v32:32-n16:32:64"
+target triple = "nvptx64-nvidia-cuda"
+
+%spirv.Queue = type opaque
+%opencl.queue_t = type opaque
+%spirv.DeviceEvent = type opaque
+%opencl.clk_event_t = type opaque
+
+; Function Attrs: nounwind readnone
+define void @f(%spirv.Queue* %q1, %opencl.queue_t* %q2, %spirv.DeviceEvent* %e1, %opencl.clk_event_t* %e2) #0 {
+entry:
+  ret void
+}
+
+define void @g(%spirv.Queue** %q, %spirv.Queue*** %qq) {
+entry:
+  store %spirv.Queue* undef, %spirv.Queue** %q, align 8
+  store %spirv.Queue** null, %spirv.Queue*** %qq, align 8
+  ret void
+}
+
+define void @h(%opencl.queue_t** %q, %opencl.queue_t*** %qq) {
+entry:
+  store %opencl.queue_t* undef, %opencl.queue_t** %q, align 8
+  store %opencl.queue_t** null, %opencl.queue_t*** %qq, align 8
+  ret void
+}
+
+define void @k(<2 x i32> addrspace(1)* %vi, i32 addrspace(1)* %i, <2 x float> addrspace(1)* %vf, float addrspace(1)* %f) {
+entry:
+  store <2 x i32> <i32 7, i32 7>, <2 x i32> addrspace(1)* %vi, align 8
+  store i32 7, i32 addrspace(1)* %i, align 4
+  store <2 x float> <float 2.000000e+00, float 2.000000e+00>, <2 x float> addrspace(1)* %vf, align 8
+  store float 2.000000e+00, float addrspace(1)* %f, align 4
+  ret void
+}
+
+attributes #0 = { nounwind readnone }
+
+!nvvm.annotations = !{}
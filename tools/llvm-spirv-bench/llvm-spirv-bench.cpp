@@ -0,0 +1,541 @@
+//===-- llvm-spirv-bench.cpp - Translator throughput benchmarks -*- C++ -*-===//
+//
+//
+//                     The LLVM/SPIRV Translator
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimers.
+// Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimers in the documentation
+// and/or other materials provided with the distribution.
+// Neither the names of Advanced Micro Devices, Inc., nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// Software without specific prior written permission.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH
+// THE SOFTWARE.
+//
+/// \file
+///
+///  Measures the throughput of every phase of the translation in both
+///  directions, on synthetic modules and on bitcode or textual IR samples.
+///
+///  Common Usage:
+///  llvm-spirv-bench              - Run all synthetic generators
+///  llvm-spirv-bench x.bc y.ll    - Run the given samples only
+///  llvm-spirv-bench -gen=cfg x.bc - Run the CFG generator and x.bc
+///
+///  Every phase is run -repeat times on a fresh copy of its input and the
+///  fastest run is reported, in MB of SPIR-V binary per second and in LLVM
+///  instructions of the sample per second.
+///
+//===----------------------------------------------------------------------===//
+
+#include "LLVMSPIRVLib.h"
+#include "SPIRVModule.h"
+
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/DIBuilder.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/IntrinsicsNVPTX.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+enum GeneratorKind { GenFunctions, GenCFG, GenConstants, GenDebugInfo,
+                     GenBuiltins };
+} // namespace
+
+static cl::list<std::string> InputFiles(cl::Positional, cl::ZeroOrMore,
+                                        cl::desc("<bitcode or IR samples>"));
+
+static cl::list<GeneratorKind> Generators(
+    "gen", cl::CommaSeparated,
+    cl::desc("Synthetic modules to benchmark (default: all of them if no "
+             "sample is given)"),
+    cl::values(clEnumValN(GenFunctions, "functions", "Many small functions"),
+               clEnumValN(GenCFG, "cfg", "One kernel with a deep CFG"),
+               clEnumValN(GenConstants, "constants", "Big constant arrays"),
+               clEnumValN(GenDebugInfo, "debug", "Heavy debug info"),
+               clEnumValN(GenBuiltins, "builtins", "Builtin-dense code")));
+
+static cl::opt<unsigned>
+    Scale("scale", cl::init(1000),
+          cl::desc("Size of the synthetic modules (functions, blocks, array "
+                   "elements or calls, depending on the generator)"));
+
+static cl::opt<unsigned> Repeat("repeat", cl::init(3),
+                                cl::desc("Runs of each phase"));
+
+static std::unique_ptr<Module> createModule(LLVMContext &C, StringRef Name) {
+  auto M = std::make_unique<Module>(Name, C);
+  M->setTargetTriple("nvptx64-nvidia-cuda");
+  M->setDataLayout("e-i64:64-i128:128-v16:16-v32:32-n16:32:64");
+  return M;
+}
+
+/// Add a kernel taking an i32 global pointer, listed in !nvvm.annotations as
+/// CUDA front ends do.
+static Function *addKernel(Module &M, StringRef Name) {
+  LLVMContext &C = M.getContext();
+  Type *I32 = Type::getInt32Ty(C);
+  auto *FT = FunctionType::get(Type::getVoidTy(C),
+                               {PointerType::get(I32, /*AddressSpace=*/1)},
+                               /*isVarArg=*/false);
+  Function *F = Function::Create(FT, GlobalValue::ExternalLinkage, Name, &M);
+  Metadata *MDs[] = {ValueAsMetadata::get(F), MDString::get(C, "kernel"),
+                     ConstantAsMetadata::get(ConstantInt::get(I32, 1))};
+  M.getOrInsertNamedMetadata("nvvm.annotations")
+      ->addOperand(MDNode::get(C, MDs));
+  return F;
+}
+
+/// Scale functions, each called once from a single kernel.
+static std::unique_ptr<Module> generateFunctions(LLVMContext &C) {
+  auto M = createModule(C, "functions");
+  Type *I32 = Type::getInt32Ty(C);
+  auto *FT = FunctionType::get(I32, {I32, I32}, /*isVarArg=*/false);
+  Function *K = addKernel(*M, "kernel");
+  IRBuilder<> KB(BasicBlock::Create(C, "entry", K));
+  Value *Acc = KB.getInt32(0);
+  for (unsigned I = 0; I != Scale; ++I) {
+    Function *F = Function::Create(FT, GlobalValue::InternalLinkage,
+                                   "f" + Twine(I), M.get());
+    IRBuilder<> B(BasicBlock::Create(C, "entry", F));
+    Value *X = B.CreateMul(F->getArg(0), B.getInt32(I + 1));
+    X = B.CreateXor(X, F->getArg(1));
+    B.CreateRet(B.CreateAdd(X, B.getInt32(I)));
+    Acc = KB.CreateCall(F, {Acc, KB.getInt32(I)});
+  }
+  KB.CreateStore(Acc, K->getArg(0));
+  KB.CreateRetVoid();
+  return M;
+}
+
+/// A kernel made of Scale nested diamonds, merged with PHIs, inside a loop.
+static std::unique_ptr<Module> generateCFG(LLVMContext &C) {
+  auto M = createModule(C, "cfg");
+  Function *K = addKernel(*M, "kernel");
+  Type *I32 = Type::getInt32Ty(C);
+  BasicBlock *Entry = BasicBlock::Create(C, "entry", K);
+  BasicBlock *Header = BasicBlock::Create(C, "header", K);
+  IRBuilder<> B(Entry);
+  Value *Init = B.CreateLoad(I32, K->getArg(0));
+  B.CreateBr(Header);
+  B.SetInsertPoint(Header);
+  PHINode *IV = B.CreatePHI(I32, 2);
+  IV->addIncoming(B.getInt32(0), Entry);
+  PHINode *Sum = B.CreatePHI(I32, 2);
+  Sum->addIncoming(Init, Entry);
+  Value *Cur = Sum;
+  for (unsigned I = 0; I != Scale; ++I) {
+    BasicBlock *Then = BasicBlock::Create(C, "then", K);
+    BasicBlock *Else = BasicBlock::Create(C, "else", K);
+    BasicBlock *Merge = BasicBlock::Create(C, "merge", K);
+    Value *Bit = B.CreateAnd(Cur, B.getInt32(1u << (I % 31)));
+    B.CreateCondBr(B.CreateICmpEQ(Bit, B.getInt32(0)), Then, Else);
+    B.SetInsertPoint(Then);
+    Value *T = B.CreateAdd(Cur, B.getInt32(I));
+    B.CreateBr(Merge);
+    B.SetInsertPoint(Else);
+    Value *E = B.CreateMul(Cur, B.getInt32(3));
+    B.CreateBr(Merge);
+    B.SetInsertPoint(Merge);
+    PHINode *P = B.CreatePHI(I32, 2);
+    P->addIncoming(T, Then);
+    P->addIncoming(E, Else);
+    Cur = P;
+  }
+  Value *Next = B.CreateAdd(IV, B.getInt32(1));
+  BasicBlock *Exit = BasicBlock::Create(C, "exit", K);
+  BasicBlock *Latch = B.GetInsertBlock();
+  B.CreateCondBr(B.CreateICmpULT(Next, B.getInt32(16)), Header, Exit);
+  IV->addIncoming(Next, Latch);
+  Sum->addIncoming(Cur, Latch);
+  B.SetInsertPoint(Exit);
+  B.CreateStore(Cur, K->getArg(0));
+  B.CreateRetVoid();
+  return M;
+}
+
+/// Constant global arrays of Scale integers and floats read by a kernel.
+static std::unique_ptr<Module> generateConstants(LLVMContext &C) {
+  auto M = createModule(C, "constants");
+  Type *I32 = Type::getInt32Ty(C);
+  std::vector<uint32_t> Ints(Scale);
+  std::vector<float> Floats(Scale);
+  for (unsigned I = 0; I != Scale; ++I) {
+    Ints[I] = I * 2654435761u;
+    Floats[I] = static_cast<float>(I) * 0.5f;
+  }
+  Constant *Arrays[] = {ConstantDataArray::get(C, Ints),
+                        ConstantDataArray::get(C, Floats)};
+  Function *K = addKernel(*M, "kernel");
+  IRBuilder<> B(BasicBlock::Create(C, "entry", K));
+  Value *Idx = B.CreateLoad(I32, K->getArg(0));
+  Value *Acc = B.getInt32(0);
+  for (Constant *Init : Arrays) {
+    auto *GV = new GlobalVariable(*M, Init->getType(), /*isConstant=*/true,
+                                  GlobalValue::InternalLinkage, Init, "table",
+                                  nullptr, GlobalValue::NotThreadLocal,
+                                  /*AddressSpace=*/4);
+    Value *Ptr = B.CreateInBoundsGEP(Init->getType(), GV,
+                                     {B.getInt32(0), Idx});
+    Type *ElemTy = Init->getType()->getArrayElementType();
+    Value *V = B.CreateLoad(ElemTy, Ptr);
+    if (ElemTy->isFloatTy())
+      V = B.CreateBitCast(V, I32);
+    Acc = B.CreateAdd(Acc, V);
+  }
+  B.CreateStore(Acc, K->getArg(0));
+  B.CreateRetVoid();
+  return M;
+}
+
+/// Scale functions with subprograms, local variables and a location on every
+/// instruction.
+static std::unique_ptr<Module> generateDebugInfo(LLVMContext &C) {
+  auto M = generateFunctions(C);
+  M->setModuleIdentifier("debug");
+  M->addModuleFlag(Module::Warning, "Debug Info Version",
+                   DEBUG_METADATA_VERSION);
+  DIBuilder DB(*M);
+  DIFile *File = DB.createFile("bench.cu", "/tmp");
+  DB.createCompileUnit(dwarf::DW_LANG_C_plus_plus, File, "llvm-spirv-bench",
+                       /*isOptimized=*/false, "", 0);
+  DIType *IntTy = DB.createBasicType("int", 32, dwarf::DW_ATE_signed);
+  DISubroutineType *SubTy =
+      DB.createSubroutineType(DB.getOrCreateTypeArray({IntTy, IntTy, IntTy}));
+  unsigned Line = 1;
+  for (Function &F : *M) {
+    DISubprogram *SP = DB.createFunction(
+        File, F.getName(), F.getName(), File, Line, SubTy, Line,
+        DINode::FlagPrototyped, DISubprogram::SPFlagDefinition);
+    F.setSubprogram(SP);
+    for (unsigned I = 0; I != F.arg_size(); ++I)
+      DB.createParameterVariable(SP, "a" + std::to_string(I), I + 1, File,
+                                 Line, IntTy);
+    for (Instruction &I : instructions(F))
+      I.setDebugLoc(DILocation::get(C, ++Line, 1, SP));
+    DB.finalizeSubprogram(SP);
+  }
+  DB.finalize();
+  return M;
+}
+
+/// A kernel which reads the CUDA special registers and synchronizes Scale
+/// times.
+static std::unique_ptr<Module> generateBuiltins(LLVMContext &C) {
+  auto M = createModule(C, "builtins");
+  Function *K = addKernel(*M, "kernel");
+  IRBuilder<> B(BasicBlock::Create(C, "entry", K));
+  Intrinsic::ID Regs[] = {Intrinsic::nvvm_read_ptx_sreg_tid_x,
+                          Intrinsic::nvvm_read_ptx_sreg_ntid_y,
+                          Intrinsic::nvvm_read_ptx_sreg_ctaid_z,
+                          Intrinsic::nvvm_read_ptx_sreg_nctaid_x};
+  Function *Barrier = Intrinsic::getDeclaration(M.get(),
+                                                Intrinsic::nvvm_barrier0);
+  Value *Acc = B.getInt32(0);
+  for (unsigned I = 0; I != Scale; ++I) {
+    Function *Reg =
+        Intrinsic::getDeclaration(M.get(), Regs[I % array_lengthof(Regs)]);
+    Acc = B.CreateAdd(Acc, B.CreateCall(Reg));
+    if (I % 8 == 7)
+      B.CreateCall(Barrier);
+  }
+  B.CreateStore(Acc, K->getArg(0));
+  B.CreateRetVoid();
+  return M;
+}
+
+namespace {
+/// Keeps the passes added to it instead of running them.
+class PassCollector : public legacy::PassManagerBase {
+public:
+  void add(Pass *P) override { Passes.emplace_back(P); }
+
+  std::vector<std::unique_ptr<Pass>> Passes;
+};
+
+struct PhaseResult {
+  std::string Name;
+  double Seconds = std::numeric_limits<double>::max();
+};
+
+class Benchmark {
+public:
+  Benchmark(const Module &Sample, const SPIRV::TranslatorOpts &Opts)
+      : Sample(Sample), Opts(Opts) {
+    for (const Function &F : Sample)
+      NumInsts += F.getInstructionCount();
+  }
+
+  /// Run all phases Repeat times. Returns false and sets \p Err if the
+  /// translation fails.
+  bool run(std::string &Err);
+  void print(raw_ostream &OS) const;
+
+private:
+  void printRow(raw_ostream &OS, StringRef Name, double Seconds) const;
+
+  /// Record the time of \p Fn under \p Name in \p Into, keeping the fastest
+  /// run.
+  template <class FnT>
+  auto time(std::vector<PhaseResult> &Into, StringRef Name, FnT Fn)
+      -> decltype(Fn());
+  template <class FnT> auto time(StringRef Name, FnT Fn) -> decltype(Fn()) {
+    return time(Phases, Name, Fn);
+  }
+
+  const Module &Sample;
+  SPIRV::TranslatorOpts Opts;
+  size_t NumInsts = 0;
+  size_t SpirvBytes = 0;
+  std::vector<PhaseResult> Phases;
+  /// Whole translations through the one-shot API and through a session,
+  /// reported apart from the phases they are made of.
+  std::vector<PhaseResult> EndToEnd;
+};
+} // namespace
+
+template <class FnT>
+auto Benchmark::time(std::vector<PhaseResult> &Into, StringRef Name, FnT Fn)
+    -> decltype(Fn()) {
+  auto Loc = std::find_if(Into.begin(), Into.end(),
+                          [&](const PhaseResult &P) { return P.Name == Name; });
+  if (Loc == Into.end()) {
+    Into.push_back(PhaseResult());
+    Into.back().Name = Name.str();
+    Loc = Into.end() - 1;
+  }
+  PhaseResult &Phase = *Loc;
+  auto Start = std::chrono::steady_clock::now();
+  struct Recorder {
+    PhaseResult &Phase;
+    std::chrono::steady_clock::time_point Start;
+    ~Recorder() {
+      std::chrono::duration<double> D = std::chrono::steady_clock::now() - Start;
+      Phase.Seconds = std::min(Phase.Seconds, D.count());
+    }
+  } R{Phase, Start};
+  return Fn();
+}
+
+bool Benchmark::run(std::string &Err) {
+  llvm::SpirvTranslatorSession Session(Opts);
+  // The incremental translations take modules in the session context.
+  std::string SampleBitcode;
+  {
+    raw_string_ostream OS(SampleBitcode);
+    WriteBitcodeToFile(Sample, OS);
+  }
+  for (unsigned Run = 0; Run != Repeat; ++Run) {
+    std::unique_ptr<Module> M = CloneModule(Sample);
+    // The lowering passes of writeSpirv, each timed on its own.
+    PassCollector LoweringPasses;
+    addPassesForSPIRV(LoweringPasses, Opts);
+    for (auto &Pass : LoweringPasses.Passes) {
+      StringRef Name = Pass->getPassName();
+      legacy::PassManager PM;
+      PM.add(Pass.release());
+      time(Name, [&] { return PM.run(*M); });
+    }
+
+    std::unique_ptr<SPIRV::SPIRVModule> BM(
+        SPIRV::SPIRVModule::createSPIRVModule(Opts));
+    {
+      legacy::PassManager PM;
+      PM.add(createLLVMToSPIRV(BM.get()));
+      time("LLVMToSPIRV", [&] {
+        bool Changed = PM.run(*M);
+        if (Opts.isDeadEntryEliminationEnabled())
+          BM->eliminateDeadEntries();
+        return Changed;
+      });
+    }
+    if (BM->getError(Err) != SPIRV::SPIRVEC_Success)
+      return false;
+
+    std::vector<uint32_t> Words;
+    if (!time("Encode", [&] { return SPIRV::writeSpirvModule(*BM, Words); })) {
+      BM->getError(Err);
+      return false;
+    }
+    std::string Binary(reinterpret_cast<const char *>(Words.data()),
+                       Words.size() * sizeof(uint32_t));
+    SpirvBytes = Binary.size();
+
+    // Translate to SPIR-V friendly IR so that the lowering to the desired
+    // representation of builtins is measured on its own.
+    SPIRV::TranslatorOpts ReverseOpts = Opts;
+    ReverseOpts.setDesiredBIsRepresentation(
+        SPIRV::BIsRepresentation::SPIRVFriendlyIR);
+    std::istringstream IS(Binary);
+    std::unique_ptr<SPIRV::SPIRVModule> RBM = time(
+        "Decode", [&] { return SPIRV::readSpirvModule(IS, ReverseOpts, Err); });
+    if (!RBM)
+      return false;
+    LLVMContext Context;
+    std::unique_ptr<Module> RM = time("SPIRVToLLVM", [&] {
+      return convertSpirvToLLVM(Context, *RBM, ReverseOpts, Err);
+    });
+    if (!RM)
+      return false;
+    if (ModulePass *Lowering = createSPIRVBIsLoweringPass(
+            *RM, Opts.getDesiredBIsRepresentation())) {
+      legacy::PassManager PM;
+      PM.add(Lowering);
+      time("SPIRVBIsLowering", [&] { return PM.run(*RM); });
+    }
+
+    std::unique_ptr<Module> OneShotM = CloneModule(Sample);
+    std::unique_ptr<Module> SessionM = CloneModule(Sample);
+    if (!time(EndToEnd, "writeSpirv",
+              [&] { return writeSpirv(OneShotM.get(), Opts, Words, Err); }) ||
+        !time(EndToEnd, "session writeSpirv",
+              [&] { return Session.writeSpirv(SessionM.get(), Words, Err); }))
+      return false;
+    // The sample is the same in every run, so from the second run on, this
+    // measures an incremental translation where no function changed.
+    Expected<std::unique_ptr<Module>> IncrementalM =
+        parseBitcodeFile(MemoryBufferRef(SampleBitcode, Sample.getName()),
+                         Session.getContext());
+    if (!IncrementalM) {
+      Err = toString(IncrementalM.takeError());
+      return false;
+    }
+    if (!time(EndToEnd, "session incremental", [&] {
+          return Session.writeSpirvIncremental(IncrementalM->get(), Words,
+                                               Err);
+        }))
+      return false;
+    std::istringstream OneShotIS(Binary);
+    Module *OneShotRM = nullptr;
+    if (!time(EndToEnd, "readSpirv", [&] {
+          return readSpirv(Context, Opts, OneShotIS, OneShotRM, Err);
+        }))
+      return false;
+    delete OneShotRM;
+    std::istringstream SessionIS(Binary);
+    if (!time(EndToEnd, "session readSpirv",
+              [&] { return Session.readSpirv(Context, SessionIS, Err); }))
+      return false;
+  }
+  return true;
+}
+
+void Benchmark::printRow(raw_ostream &OS, StringRef Name,
+                         double Seconds) const {
+  OS << "  " << left_justify(Name, 24)
+     << format("%13.3f%13.2f%15.3f\n", Seconds * 1e3,
+               SpirvBytes / Seconds / 1e6, NumInsts / Seconds / 1e6);
+}
+
+void Benchmark::print(raw_ostream &OS) const {
+  OS << Sample.getModuleIdentifier() << ": " << NumInsts
+     << " LLVM instructions, " << SpirvBytes << " bytes of SPIR-V\n";
+  OS << "  " << left_justify("phase", 24) << right_justify("time (ms)", 13)
+     << right_justify("MB/s", 13) << right_justify("Minst/s", 15) << '\n';
+  double Total = 0;
+  for (const PhaseResult &P : Phases) {
+    Total += P.Seconds;
+    printRow(OS, P.Name, P.Seconds);
+  }
+  printRow(OS, "total", Total);
+  for (const PhaseResult &P : EndToEnd)
+    printRow(OS, P.Name, P.Seconds);
+}
+
+int main(int Ac, char **Av) {
+  sys::PrintStackTraceOnErrorSignal(Av[0]);
+  PrettyStackTraceProgram X(Ac, Av);
+  cl::ParseCommandLineOptions(Ac, Av, "LLVM/SPIR-V translator benchmarks");
+
+  if (Generators.empty() && InputFiles.empty())
+    for (GeneratorKind K :
+         {GenFunctions, GenCFG, GenConstants, GenDebugInfo, GenBuiltins})
+      Generators.push_back(K);
+
+  SPIRV::TranslatorOpts Opts;
+  Opts.enableAllExtensions();
+
+  LLVMContext Context;
+  std::vector<std::unique_ptr<Module>> Samples;
+  for (GeneratorKind K : Generators) {
+    switch (K) {
+    case GenFunctions:
+      Samples.push_back(generateFunctions(Context));
+      break;
+    case GenCFG:
+      Samples.push_back(generateCFG(Context));
+      break;
+    case GenConstants:
+      Samples.push_back(generateConstants(Context));
+      break;
+    case GenDebugInfo:
+      Samples.push_back(generateDebugInfo(Context));
+      break;
+    case GenBuiltins:
+      Samples.push_back(generateBuiltins(Context));
+      break;
+    }
+  }
+  for (const std::string &File : InputFiles) {
+    SMDiagnostic Diag;
+    std::unique_ptr<Module> M = parseIRFile(File, Diag, Context);
+    if (!M) {
+      Diag.print(Av[0], errs());
+      return -1;
+    }
+    Samples.push_back(std::move(M));
+  }
+
+  int Ret = 0;
+  for (const std::unique_ptr<Module> &M : Samples) {
+    Benchmark B(*M, Opts);
+    std::string Err;
+    if (!B.run(Err)) {
+      errs() << M->getModuleIdentifier() << ": translation failed: " << Err
+             << '\n';
+      Ret = -1;
+      continue;
+    }
+    B.print(outs());
+  }
+  return Ret;
+}
@@ -0,0 +1,35 @@
+; Vector addition kernel as emitted by clang for CUDA:
+;   __global__ void vecadd(int *a, int *b, int *c) {
+;     int i = blockIdx.x * blockDim.x + threadIdx.x;
+;     c[i] = a[i] + b[i];
+;   }
+target datalayout = "e-i64:64-i128:128-v16:16-v32:32-n16:32:64"
+target triple = "nvptx64-nvidia-cuda"
+
+define dso_local void @_Z6vecaddPiS_S_(i32* %a, i32* %b, i32* %c) {
+entry:
+  %0 = call i32 @llvm.nvvm.read.ptx.sreg.ctaid.x()
+  %1 = call i32 @llvm.nvvm.read.ptx.sreg.ntid.x()
+  %mul = mul i32 %0, %1
+  %2 = call i32 @llvm.nvvm.read.ptx.sreg.tid.x()
+  %add = add i32 %mul, %2
+  %idxprom = sext i32 %add to i64
+  %arrayidx = getelementptr inbounds i32, i32* %a, i64 %idxprom
+  %3 = load i32, i32* %arrayidx, align 4
+  %arrayidx2 = getelementptr inbounds i32, i32* %b, i64 %idxprom
+  %4 = load i32, i32* %arrayidx2, align 4
+  %add3 = add nsw i32 %3, %4
+  %arrayidx5 = getelementptr inbounds i32, i32* %c, i64 %idxprom
+  store i32 %add3, i32* %arrayidx5, align 4
+  ret void
+}
+
+declare i32 @llvm.nvvm.read.ptx.sreg.ctaid.x()
+declare i32 @llvm.nvvm.read.ptx.sreg.ntid.x()
+declare i32 @llvm.nvvm.read.ptx.sreg.tid.x()
+
+!nvvm.annotations = !{!0}
+!nvvmir.version = !{!1}
+
+!0 = !{void (i32*, i32*, i32*)* @_Z6vecaddPiS_S_, !"kernel", i32 1}
+!1 = !{i32 1, i32 4}
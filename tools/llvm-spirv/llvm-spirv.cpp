@@ -85,6 +85,10 @@ using namespace llvm;
 static cl::opt<std::string> InputFile(cl::Positional, cl::desc("<input file>"),
                                       cl::init("-"));
 
+static cl::list<std::string>
+    LinkInputFiles(cl::Positional, cl::ZeroOrMore,
+                   cl::desc("<more input files to link>"));
+
 static cl::opt<std::string> OutputFile("o",
                                        cl::desc("Override output filename"),
                                        cl::value_desc("filename"));
@@ -96,6 +100,20 @@ static cl::opt<bool>
     IsRegularization("s",
                      cl::desc("Regularize LLVM to be representable by SPIR-V"));
 
+static cl::opt<bool>
+    IsLink("link", cl::desc("Link SPIR-V modules into a single SPIR-V module"));
+
+static cl::opt<bool> IsSession(
+    "spirv-session",
+    cl::desc("Translate every input file with a single translator session, "
+             "naming each output file after its input file"));
+
+static cl::opt<bool> IsIncremental(
+    "spirv-incremental",
+    cl::desc("With -spirv-session, translate each input file to SPIR-V "
+             "incrementally from the previous one, re-translating only the "
+             "functions whose bodies changed"));
+
 using SPIRV::VersionNumber;
 
 static cl::opt<VersionNumber> MaxSPIRVVersion(
@@ -113,6 +131,12 @@ static cl::list<std::string>
            cl::value_desc("+SPV_extenstion1_name,-SPV_extension2_name"),
            cl::ValueRequired);
 
+static cl::list<std::string> SPIRVKernels(
+    "spirv-kernel", cl::CommaSeparated,
+    cl::desc("Translate only the listed kernels and what they use, "
+             "in either direction"),
+    cl::value_desc("kernel1,kernel2"));
+
 static cl::opt<bool> SPIRVGenKernelArgNameMD(
     "spirv-gen-kernel-arg-name-md", cl::init(false),
     cl::desc("Enable generating OpenCL kernel argument name "
@@ -156,10 +180,43 @@ static cl::opt<std::string> SpecConst(
              "Supported types are: i1, i8, i16, i32, i64, f16, f32, f64.\n"),
     cl::value_desc("id1:type1:value1 id2:type2:value2 ..."));
 
+static cl::opt<bool> SpecConstFoldBranches(
+    "spec-const-fold-branches", cl::init(false),
+    cl::desc("With -spec-const, fold branches on specialized values and "
+             "remove the blocks made unreachable"));
+
 static cl::opt<bool>
     SPIRVMemToReg("spirv-mem2reg", cl::init(false),
                   cl::desc("LLVM/SPIR-V translation enable mem2reg"));
 
+static cl::opt<bool> SPIRVVectorizeLoadStore(
+    "spirv-vectorize-load-store", cl::init(false),
+    cl::desc("Merge adjacent aligned scalar loads and stores into vector "
+             "loads and stores before translation to SPIR-V"));
+
+static cl::opt<bool> SPIRVEliminateDeadEntries(
+    "spirv-eliminate-dead-entries", cl::init(false),
+    cl::desc("Remove types, constants and global variables which are not "
+             "referenced from the generated SPIR-V module, and renumber its "
+             "Ids densely"));
+
+static cl::opt<bool> SPIRVLazyFunctionDecoding(
+    "spirv-lazy-function-decoding", cl::init(false),
+    cl::desc("Decode bodies of SPIR-V functions only when they are "
+             "translated to LLVM IR"));
+
+static cl::opt<std::string> SPIRVCacheDir(
+    "spirv-cache-dir",
+    cl::desc("Reuse translation results cached in the directory, and cache "
+             "new ones there"),
+    cl::value_desc("dir"));
+
+static cl::opt<uint64_t> SPIRVCacheMaxSize(
+    "spirv-cache-max-size", cl::init(0),
+    cl::desc("Bound in bytes of the size of the cache directory, checked "
+             "at most every 20 minutes, evicting least recently used results "
+             "first (0 = no bound)"));
+
 static cl::opt<bool> SpecConstInfo(
     "spec-const-info",
     cl::desc("Display id of constants available for specializaion and their "
@@ -205,6 +262,37 @@ static std::string removeExt(const std::string &FileName) {
 
 static ExitOnError ExitOnErr;
 
+static std::string getDefaultOutputFile(bool IsReverse) {
+  if (InputFile == "-")
+    return "-";
+  if (IsReverse)
+    return removeExt(InputFile) + kExt::LLVMBinary;
+  return removeExt(InputFile) +
+         (SPIRV::SPIRVUseTextFormat ? kExt::SpirvText : kExt::SpirvBinary);
+}
+
+// Writes the binary in Words to FileName, or to the standard output for "-".
+// Reports the error and returns false if it cannot be written.
+static bool writeWords(const std::string &FileName,
+                       const std::vector<uint32_t> &Words) {
+  const char *Data = reinterpret_cast<const char *>(Words.data());
+  std::streamsize Size = Words.size() * sizeof(uint32_t);
+  if (FileName == "-") {
+    if (std::cout.write(Data, Size).flush())
+      return true;
+  } else {
+    std::ofstream OutFile(FileName, std::ios::binary);
+    if (OutFile) {
+      OutFile.write(Data, Size);
+      OutFile.close();
+      if (OutFile)
+        return true;
+    }
+  }
+  errs() << "Fails to write output file: " << FileName << '\n';
+  return false;
+}
+
 static int convertLLVMToSPIRV(const SPIRV::TranslatorOpts &Opts) {
   LLVMContext Context;
 
@@ -215,22 +303,25 @@ static int convertLLVMToSPIRV(const SPIRV::TranslatorOpts &Opts) {
                                            /*ShouldLazyLoadMetadata=*/true));
   ExitOnErr(M->materializeAll());
 
-  if (OutputFile.empty()) {
-    if (InputFile == "-")
-      OutputFile = "-";
-    else
-      OutputFile =
-          removeExt(InputFile) +
-          (SPIRV::SPIRVUseTextFormat ? kExt::SpirvText : kExt::SpirvBinary);
-  }
+  if (OutputFile.empty())
+    OutputFile = getDefaultOutputFile(/*IsReverse=*/false);
 
   std::string Err;
   bool Success = false;
-  if (OutputFile != "-") {
-    std::ofstream OutFile(OutputFile, std::ios::binary);
-    Success = writeSpirv(M.get(), Opts, OutFile, Err);
+  if (SPIRV::SPIRVUseTextFormat) {
+    if (OutputFile != "-") {
+      std::ofstream OutFile(OutputFile, std::ios::binary);
+      Success = writeSpirv(M.get(), Opts, OutFile, Err);
+    } else {
+      Success = writeSpirv(M.get(), Opts, std::cout, Err);
+    }
   } else {
-    Success = writeSpirv(M.get(), Opts, std::cout, Err);
+    // Encode the binary into a single exactly sized buffer and write it out
+    // at once instead of streaming it word by word.
+    std::vector<uint32_t> Words;
+    Success = writeSpirv(M.get(), Opts, Words, Err);
+    if (Success && !writeWords(OutputFile, Words))
+      return -1;
   }
 
   if (!Success) {
@@ -240,6 +331,47 @@ static int convertLLVMToSPIRV(const SPIRV::TranslatorOpts &Opts) {
   return 0;
 }
 
+// Runs Convert, unless the result of translating the same input with the same
+// options is found in the cache directory. Only file to file translations are
+// cached.
+static int convertCached(bool IsReverse, const SPIRV::TranslatorOpts &Opts,
+                         int (*Convert)(const SPIRV::TranslatorOpts &)) {
+  if (SPIRVCacheDir.empty() || InputFile == "-")
+    return Convert(Opts);
+  if (OutputFile.empty())
+    OutputFile = getDefaultOutputFile(IsReverse);
+  if (OutputFile == "-")
+    return Convert(Opts);
+  auto Input = MemoryBuffer::getFile(InputFile, /*FileSize=*/-1,
+                                     /*RequiresNullTerminator=*/false);
+  if (!Input)
+    return Convert(Opts);
+
+  SPIRV::TranslationCache Cache(SPIRVCacheDir, SPIRVCacheMaxSize);
+  std::string Kind = "spirv";
+  if (IsReverse)
+    Kind = "llvm-bc";
+  else if (SPIRV::SPIRVUseTextFormat)
+    Kind = "spirv-text";
+  std::string Key =
+      SPIRV::TranslationCache::getKey((*Input)->getBuffer().str(), Opts, Kind);
+  std::string Result;
+  if (Cache.lookup(Key, Result)) {
+    std::ofstream OutFile(OutputFile, std::ios::binary);
+    OutFile.write(Result.data(), Result.size());
+    return OutFile ? 0 : -1;
+  }
+
+  int Ret = Convert(Opts);
+  if (Ret == 0) {
+    auto Output = MemoryBuffer::getFile(OutputFile, /*FileSize=*/-1,
+                                        /*RequiresNullTerminator=*/false);
+    if (Output)
+      Cache.store(Key, (*Output)->getBuffer().str());
+  }
+  return Ret;
+}
+
 static bool isFileEmpty(const std::string &FileName) {
   std::ifstream File(FileName);
   return File && File.peek() == EOF;
@@ -264,12 +396,8 @@ static int convertSPIRVToLLVM(const SPIRV::TranslatorOpts &Opts) {
     return -1;
   }
 
-  if (OutputFile.empty()) {
-    if (InputFile == "-")
-      OutputFile = "-";
-    else
-      OutputFile = removeExt(InputFile) + kExt::LLVMBinary;
-  }
+  if (OutputFile.empty())
+    OutputFile = getDefaultOutputFile(/*IsReverse=*/true);
 
   std::error_code EC;
   ToolOutputFile Out(OutputFile.c_str(), EC, sys::fs::F_None);
@@ -360,6 +488,135 @@ static int regularizeLLVM(SPIRV::TranslatorOpts &Opts) {
   return 0;
 }
 
+static int linkSPIRV(const SPIRV::TranslatorOpts &Opts) {
+  std::vector<std::string> InputFiles(1, InputFile);
+  InputFiles.insert(InputFiles.end(), LinkInputFiles.begin(),
+                    LinkInputFiles.end());
+
+  std::vector<std::unique_ptr<std::ifstream>> IFSs;
+  std::vector<std::istream *> Inputs;
+  for (const std::string &FileName : InputFiles) {
+    IFSs.emplace_back(new std::ifstream(FileName, std::ios::binary));
+    if (!*IFSs.back()) {
+      errs() << "Fails to open input file: " << FileName << '\n';
+      return -1;
+    }
+    Inputs.push_back(IFSs.back().get());
+  }
+
+  if (OutputFile.empty()) {
+    if (InputFile == "-")
+      OutputFile = "-";
+    else
+      OutputFile =
+          removeExt(InputFile) + ".linked" +
+          (SPIRV::SPIRVUseTextFormat ? kExt::SpirvText : kExt::SpirvBinary);
+  }
+
+  std::string Err;
+  bool Success = false;
+  if (SPIRV::SPIRVUseTextFormat) {
+    if (OutputFile != "-") {
+      std::ofstream OutFile(OutputFile, std::ios::binary);
+      Success = linkSpirv(Opts, Inputs, OutFile, Err);
+    } else {
+      Success = linkSpirv(Opts, Inputs, std::cout, Err);
+    }
+  } else {
+    std::vector<uint32_t> Words;
+    Success = linkSpirv(Opts, Inputs, Words, Err);
+    if (Success && !writeWords(OutputFile, Words))
+      return -1;
+  }
+
+  if (!Success) {
+    errs() << "Fails to link SPIR-V modules: " << Err << '\n';
+    return -1;
+  }
+  return 0;
+}
+
+// Translates the input files one after the other with the same session, in
+// either direction. Incremental translations update the SPIR-V of the
+// previous input file.
+static int translateWithSession(const SPIRV::TranslatorOpts &Opts) {
+  std::vector<std::string> InputFiles(1, InputFile);
+  InputFiles.insert(InputFiles.end(), LinkInputFiles.begin(),
+                    LinkInputFiles.end());
+
+  SpirvTranslatorSession Session(Opts);
+  std::unique_ptr<LLVMContext> Context;
+  for (const std::string &FileName : InputFiles) {
+    // Every module gets a context of its own, as with separate runs, unless
+    // it is translated incrementally, which requires the session context.
+    LLVMContext *C = &Session.getContext();
+    if (!IsIncremental) {
+      Context = std::make_unique<LLVMContext>();
+      C = Context.get();
+    }
+    std::string Err;
+    if (IsReverse) {
+      std::ifstream IFS(FileName, std::ios::binary);
+      if (!IFS) {
+        errs() << "Fails to open input file: " << FileName << '\n';
+        return -1;
+      }
+      std::unique_ptr<Module> M = Session.readSpirv(*C, IFS, Err);
+      if (!M) {
+        errs() << "Fails to load SPIR-V as LLVM Module: " << Err << '\n';
+        return -1;
+      }
+      raw_string_ostream ErrorOS(Err);
+      if (verifyModule(*M, &ErrorOS)) {
+        errs() << "Fails to verify module: " << ErrorOS.str();
+        return -1;
+      }
+      std::error_code EC;
+      ToolOutputFile Out(removeExt(FileName) + kExt::LLVMBinary, EC,
+                         sys::fs::F_None);
+      if (EC) {
+        errs() << "Fails to open output file: " << EC.message();
+        return -1;
+      }
+      WriteBitcodeToFile(*M, Out.os());
+      Out.keep();
+      continue;
+    }
+
+    std::unique_ptr<MemoryBuffer> MB =
+        ExitOnErr(errorOrToExpected(MemoryBuffer::getFile(FileName)));
+    std::unique_ptr<Module> M =
+        ExitOnErr(getOwningLazyBitcodeModule(std::move(MB), *C,
+                                             /*ShouldLazyLoadMetadata=*/true));
+    ExitOnErr(M->materializeAll());
+
+    bool Success = false;
+    if (SPIRV::SPIRVUseTextFormat) {
+      std::string OutputName = removeExt(FileName) + kExt::SpirvText;
+      std::ofstream OutFile(OutputName, std::ios::binary);
+      Success = Session.writeSpirv(M.get(), OutFile, Err);
+      OutFile.close();
+      if (Success && !OutFile) {
+        errs() << "Fails to write output file: " << OutputName << '\n';
+        return -1;
+      }
+    } else {
+      std::vector<uint32_t> Words;
+      Success = IsIncremental
+                    ? Session.writeSpirvIncremental(M.get(), Words, Err)
+                    : Session.writeSpirv(M.get(), Words, Err);
+      if (Success &&
+          !writeWords(removeExt(FileName) + kExt::SpirvBinary, Words))
+        return -1;
+    }
+    if (!Success) {
+      errs() << "Fails to save LLVM as SPIR-V: " << Err << '\n';
+      return -1;
+    }
+  }
+  return 0;
+}
+
 static int parseSPVExtOption(
     SPIRV::TranslatorOpts::ExtensionsStatusMap &ExtensionsStatus) {
   // Map name -> id for known extensions
@@ -377,8 +634,10 @@ static int parseSPVExtOption(
   //  - during SPIR-V generation, assume that any known extension is disallowed.
   //  - during conversion to/from SPIR-V text representation, assume that any
   //    known extension is allowed.
+  //  - during linking, assume that any known extension is allowed, so that
+  //    the extensions used by the inputs are kept.
   for (const auto &It : ExtensionNamesMap)
-    ExtensionsStatus[It.second] = IsReverse;
+    ExtensionsStatus[It.second] = IsReverse || IsLink;
 
   if (SPVExt.empty())
     return 0; // Nothing to do
@@ -562,6 +821,9 @@ int main(int Ac, char **Av) {
     }
   }
 
+  for (const std::string &Kernel : SPIRVKernels)
+    Opts.addSelectedKernel(Kernel);
+
   if (SPIRVMemToReg)
     Opts.setMemToRegEnabled(SPIRVMemToReg);
   if (SPIRVGenKernelArgNameMD)
@@ -569,6 +831,7 @@ int main(int Ac, char **Av) {
   if (IsReverse && !SpecConst.empty()) {
     if (parseSpecConstOpt(SpecConst, Opts))
       return -1;
+    Opts.setSpecConstBranchFoldingEnabled(SpecConstFoldBranches);
   }
 
   if (SPIRVAllowUnknownIntrinsics.getNumOccurrences() != 0) {
@@ -581,6 +844,33 @@ int main(int Ac, char **Av) {
     }
   }
 
+  if (SPIRVVectorizeLoadStore.getNumOccurrences() != 0) {
+    if (IsReverse) {
+      errs() << "Note: --spirv-vectorize-load-store option ignored as it "
+                "only affects translation from LLVM IR to SPIR-V";
+    } else {
+      Opts.setLoadStoreVectorizationEnabled(SPIRVVectorizeLoadStore);
+    }
+  }
+
+  if (SPIRVEliminateDeadEntries.getNumOccurrences() != 0) {
+    if (IsReverse) {
+      errs() << "Note: --spirv-eliminate-dead-entries option ignored as it "
+                "only affects translation from LLVM IR to SPIR-V";
+    } else {
+      Opts.setDeadEntryEliminationEnabled(SPIRVEliminateDeadEntries);
+    }
+  }
+
+  if (SPIRVLazyFunctionDecoding.getNumOccurrences() != 0) {
+    if (!IsReverse) {
+      errs() << "Note: --spirv-lazy-function-decoding option ignored as it "
+                "only affects translation from SPIR-V to LLVM IR";
+    } else {
+      Opts.setLazyFunctionDecodingEnabled(SPIRVLazyFunctionDecoding);
+    }
+  }
+
   if (DebugEIS.getNumOccurrences() != 0) {
     if (IsReverse) {
       errs() << "Note: --spirv-debug-info-version option ignored as it only "
@@ -591,13 +881,13 @@ int main(int Ac, char **Av) {
   }
 
 #ifdef _SPIRV_SUPPORT_TEXT_FMT
-  if (ToText && (ToBinary || IsReverse || IsRegularization)) {
-    errs() << "Cannot use -to-text with -to-binary, -r, -s\n";
+  if (ToText && (ToBinary || IsReverse || IsRegularization || IsLink)) {
+    errs() << "Cannot use -to-text with -to-binary, -r, -s, -link\n";
     return -1;
   }
 
-  if (ToBinary && (ToText || IsReverse || IsRegularization)) {
-    errs() << "Cannot use -to-binary with -to-text, -r, -s\n";
+  if (ToBinary && (ToText || IsReverse || IsRegularization || IsLink)) {
+    errs() << "Cannot use -to-binary with -to-text, -r, -s, -link\n";
     return -1;
   }
 
@@ -605,15 +895,48 @@ int main(int Ac, char **Av) {
     return convertSPIRV();
 #endif
 
+  if (!LinkInputFiles.empty() && !IsLink && !IsSession) {
+    errs() << "Multiple input files are only supported with -link and "
+              "-spirv-session\n";
+    return -1;
+  }
+
+  if (IsSession) {
+    if (IsLink || IsRegularization || SpecConstInfo || !OutputFile.empty() ||
+        InputFile == "-") {
+      errs() << "Cannot use -spirv-session with -link, -s, -spec-const-info, "
+                "-o or standard input\n";
+      return -1;
+    }
+    if (IsIncremental && (IsReverse || SPIRV::SPIRVUseTextFormat)) {
+      errs() << "Cannot use -spirv-incremental with -r or -spirv-text\n";
+      return -1;
+    }
+    return translateWithSession(Opts);
+  }
+
+  if (IsIncremental) {
+    errs() << "-spirv-incremental requires -spirv-session\n";
+    return -1;
+  }
+
+  if (IsLink) {
+    if (IsReverse || IsRegularization || SpecConstInfo) {
+      errs() << "Cannot use -link with -r, -s, -spec-const-info\n";
+      return -1;
+    }
+    return linkSPIRV(Opts);
+  }
+
   if (!IsReverse && !IsRegularization && !SpecConstInfo)
-    return convertLLVMToSPIRV(Opts);
+    return convertCached(/*IsReverse=*/false, Opts, convertLLVMToSPIRV);
 
   if (IsReverse && IsRegularization) {
     errs() << "Cannot have both -r and -s options\n";
     return -1;
   }
   if (IsReverse)
-    return convertSPIRVToLLVM(Opts);
+    return convertCached(/*IsReverse=*/true, Opts, convertSPIRVToLLVM);
 
   if (IsRegularization)
     return regularizeLLVM(Opts);